@@ -3,15 +3,28 @@
 # This module defines
 #  FFTW3_INCLUDE_DIR, where to find FFTW3lib.h, etc.
 #  FFTW3_LIBRARIES, the libraries needed to use FFTW3.
+#  FFTW3_THREADS_FOUND, true if the multi-threaded FFTW3 library was found
+#      (it is then included in FFTW3_LIBRARIES).
+#  FFTW3L_THREADS_FOUND, true if the multi-threaded long double FFTW3 library
+#      was found (it is not included in FFTW3_LIBRARIES, because VIGRA itself
+#      doesn't need the long double library).
 #  JFFTW3_FOUND, If false, do not try to use FFTW3.
 # also defined, but not for general use are
 #  FFTW3_LIBRARY, where to find the FFTW3 library.
+#  FFTW3_THREADS_LIBRARY, where to find the multi-threaded FFTW3 library.
+#  FFTW3L_THREADS_LIBRARY, where to find the multi-threaded long double FFTW3 library.
 
 FIND_PATH(FFTW3_INCLUDE_DIR fftw3.h)
 
 SET(FFTW3_NAMES ${FFTW3_NAMES} fftw3)
 FIND_LIBRARY(FFTW3_LIBRARY NAMES ${FFTW3_NAMES} )
 
+SET(FFTW3_THREADS_NAMES ${FFTW3_THREADS_NAMES} fftw3_threads)
+FIND_LIBRARY(FFTW3_THREADS_LIBRARY NAMES ${FFTW3_THREADS_NAMES} )
+
+SET(FFTW3L_THREADS_NAMES ${FFTW3L_THREADS_NAMES} fftw3l_threads)
+FIND_LIBRARY(FFTW3L_THREADS_LIBRARY NAMES ${FFTW3L_THREADS_NAMES} )
+
 # handle the QUIETLY and REQUIRED arguments and set FFTW3_FOUND to TRUE if 
 # all listed variables are TRUE
 INCLUDE(FindPackageHandleStandardArgs)
@@ -19,6 +32,18 @@ FIND_PACKAGE_HANDLE_STANDARD_ARGS(FFTW3 DEFAULT_MSG FFTW3_LIBRARY FFTW3_INCLUDE_
 
 IF(FFTW3_FOUND)
   SET(FFTW3_LIBRARIES ${FFTW3_LIBRARY})
+  IF(FFTW3_THREADS_LIBRARY)
+    SET(FFTW3_THREADS_FOUND TRUE)
+    # the threads library depends on the main library and must come first
+    SET(FFTW3_LIBRARIES ${FFTW3_THREADS_LIBRARY} ${FFTW3_LIBRARIES})
+  ELSE()
+    SET(FFTW3_THREADS_FOUND FALSE)
+  ENDIF()
+  IF(FFTW3L_THREADS_LIBRARY)
+    SET(FFTW3L_THREADS_FOUND TRUE)
+  ELSE()
+    SET(FFTW3L_THREADS_FOUND FALSE)
+  ENDIF()
 ENDIF(FFTW3_FOUND)
 
 # Deprecated declarations.
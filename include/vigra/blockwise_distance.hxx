@@ -0,0 +1,265 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+#ifndef VIGRA_BLOCKWISE_DISTANCE_HXX
+#define VIGRA_BLOCKWISE_DISTANCE_HXX
+
+#include <string>
+#include "multi_distance.hxx"
+#include "vector_distance.hxx"
+#include "multi_blockwise.hxx"
+#include "multi_array_chunked.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace blockwise_distance_detail {
+
+    // One pass of the separable distance transform along dimension 'd'.
+    // The array is cut into slabs which span the entire extent of dimension 'd'
+    // and have the cross section 'slabShape' otherwise. Each slab is checked out,
+    // processed line by line, and committed by a single thread.
+template <class Buffer, unsigned int N, class T1, class T2,
+          class Init, class Kernel, class Finish>
+void
+separableDistSlabPass(ChunkedArray<N, T1> const & in, ChunkedArray<N, T2> & out,
+                      int d, typename MultiArrayShape<N>::type slabShape,
+                      Init const & init, Kernel const & kernel, Finish const & finish,
+                      ThreadPool & pool)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape shape(in.shape());
+    slabShape[d] = shape[d];
+    slabShape = min(slabShape, shape);
+    Shape grid = (shape + slabShape - Shape(1)) / slabShape;
+
+    parallel_foreach(pool, prod(grid),
+        [&](size_t /*thread_id*/, MultiArrayIndex i)
+        {
+            Shape p;
+            detail::ScanOrderToCoordinate<N>::exec(i, grid, p);
+            Shape start = p*slabShape,
+                  stop  = min(start + slabShape, shape);
+
+            MultiArray<N, T1> src(stop - start);
+            in.checkoutSubarray(start, src);
+            MultiArray<N, T2> dest(stop - start);
+            Buffer buffer;
+            detail::separableDistLines<Buffer>(src, dest, d, 0, src.size() / src.shape(d),
+                                               buffer, init, kernel, finish);
+            out.commitSubarray(start, dest);
+        });
+}
+
+template <unsigned int N, class T2>
+typename MultiArrayShape<N>::type
+slabShape(ChunkedArray<N, T2> const & dest, BlockwiseOptions const & options)
+{
+    return options.getBlockShape().size() == 0
+               ? dest.chunkShape()
+               : options.template getBlockShapeN<N>();
+}
+
+template <unsigned int N, class T1, class T2, class Array, class Finish>
+void
+separableMultiDistChunked(ChunkedArray<N, T1> const & source, ChunkedArray<N, T2> & dest,
+                          bool background, Array const & pixelPitch, Finish const & finish,
+                          BlockwiseOptions const & options, std::string const & name)
+{
+    typedef typename NumericTraits<T2>::RealPromote Real;
+    typedef ArrayVector<Real> Buffer;
+    using detail::DistCast;
+    using detail::DistParabolaKernel;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        name + "(): shape mismatch between input and output.");
+    vigra_precondition(pixelPitch.size() == N,
+        name + "(): pixelPitch has wrong length.");
+
+    // intermediate results are stored in 'dest'
+    Real maxDist;
+    bool needTmp = detail::separableDistNeedsTmp<T2>(source.shape(), pixelPitch, maxDist);
+    vigra_precondition(!needTmp || N == 1 || (IsSameType<T2, Real>::value),
+        name + "(): destination type cannot hold intermediate results, use a floating-point type.");
+
+    ThreadPool pool(options);
+    typename MultiArrayShape<N>::type slab = slabShape(dest, options);
+    detail::DistThreshold<T1, Real> init(background, maxDist);
+    if(N == 1)
+    {
+        separableDistSlabPass<Buffer>(source, dest, 0, slab, init,
+                                      DistParabolaKernel(pixelPitch[0]), finish, pool);
+        return;
+    }
+    separableDistSlabPass<Buffer>(source, dest, 0, slab, init,
+                                  DistParabolaKernel(pixelPitch[0]), DistCast<T2>(), pool);
+    for(int d = 1; d < (int)N-1; ++d)
+        separableDistSlabPass<Buffer>(dest, dest, d, slab, DistCast<Real>(),
+                                      DistParabolaKernel(pixelPitch[d]), DistCast<T2>(), pool);
+    separableDistSlabPass<Buffer>(dest, dest, N-1, slab, DistCast<Real>(),
+                                  DistParabolaKernel(pixelPitch[N-1]), finish, pool);
+}
+
+} // namespace blockwise_distance_detail
+
+/** \addtogroup DistanceTransform
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*     separableMultiDistSquared (ChunkedArray)         */
+/*                                                      */
+/********************************************************/
+
+/** \brief Separable distance transforms of chunked arrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistSquared(ChunkedArray<N, T1> const & source,
+                                  ChunkedArray<N, T2> & dest,
+                                  bool background,
+                                  Array const & pixelPitch,
+                                  BlockwiseOptions const & options = BlockwiseOptions());
+
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistance(ChunkedArray<N, T1> const & source,
+                               ChunkedArray<N, T2> & dest,
+                               bool background,
+                               Array const & pixelPitch,
+                               BlockwiseOptions const & options = BlockwiseOptions());
+
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableVectorDistance(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                Array const & pixelPitch,
+                                BlockwiseOptions const & options = BlockwiseOptions());
+    }
+    \endcode
+
+    These functions compute the same results as \ref separableMultiDistSquared(),
+    \ref separableMultiDistance(), and \ref separableVectorDistance() for
+    arrays that do not fit into memory. The distance transform is not local,
+    so it cannot be computed on independent blocks with a fixed overlap. Instead,
+    each axis is processed in turn: the array is cut into slabs that span
+    the entire extent of the current axis, and the slabs are checked out,
+    transformed, and committed in parallel with <tt>options.getNumThreads()</tt>
+    threads. The cross section of the slabs is taken from <tt>options.blockShape()</tt>
+    and defaults to the chunk shape of <tt>dest</tt>.
+
+    Intermediate results are stored in <tt>dest</tt>. For the scalar transforms,
+    <tt>dest</tt> must therefore have a floating-point value type whenever
+    \ref separableMultiDistSquared() would allocate a temporary array (i.e. for
+    non-integer pixel pitch or when the squared distances could overflow).
+    <tt>source</tt> and <tt>dest</tt> may be the same array.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_distance.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    ChunkedArrayLazy<3, UInt8> mask(Shape3(1000));
+    ChunkedArrayCompressed<3, float> dist(Shape3(1000));
+    ...
+
+    separableMultiDistance(mask, dist, true, TinyVector<double, 3>(1.0),
+                           BlockwiseOptions().numThreads(8));
+    \endcode
+
+    \see vigra::separableMultiDistSquared(), vigra::separableVectorDistance()
+*/
+template <unsigned int N, class T1, class T2, class Array>
+void
+separableMultiDistSquared(ChunkedArray<N, T1> const & source, ChunkedArray<N, T2> & dest,
+                          bool background, Array const & pixelPitch,
+                          BlockwiseOptions const & options = BlockwiseOptions())
+{
+    blockwise_distance_detail::separableMultiDistChunked(source, dest, background, pixelPitch,
+                              detail::DistCast<T2>(), options, "separableMultiDistSquared");
+}
+
+template <unsigned int N, class T1, class T2, class Array>
+void
+separableMultiDistance(ChunkedArray<N, T1> const & source, ChunkedArray<N, T2> & dest,
+                       bool background, Array const & pixelPitch,
+                       BlockwiseOptions const & options = BlockwiseOptions())
+{
+    blockwise_distance_detail::separableMultiDistChunked(source, dest, background, pixelPitch,
+                              detail::DistSqrt<T2>(), options, "separableMultiDistance");
+}
+
+template <unsigned int N, class T1, class T2, class Array>
+void
+separableVectorDistance(ChunkedArray<N, T1> const & source, ChunkedArray<N, T2> & dest,
+                        bool background, Array const & pixelPitch,
+                        BlockwiseOptions const & options = BlockwiseOptions())
+{
+    using namespace blockwise_distance_detail;
+    typedef ArrayVector<T2> Buffer;
+    typedef detail::VectorialDistParabolaKernel<Array> Kernel;
+
+    VIGRA_STATIC_ASSERT((Error_output_pixel_type_must_be_TinyVector_of_appropriate_length<N == T2::static_size>));
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableVectorDistance(): shape mismatch between input and output.");
+    vigra_precondition(pixelPitch.size() == N,
+        "separableVectorDistance(): pixelPitch has wrong length.");
+
+    ThreadPool pool(options);
+    typename MultiArrayShape<N>::type slab = slabShape(dest, options);
+    T2 maxDist(2*sum(source.shape()*pixelPitch));
+
+    separableDistSlabPass<Buffer>(source, dest, 0, slab,
+                                  detail::DistThreshold<T1, T2>(background, maxDist),
+                                  Kernel(0, pixelPitch), detail::DistCast<T2>(), pool);
+    for(unsigned d = 1; d < N; ++d)
+        separableDistSlabPass<Buffer>(dest, dest, d, slab, detail::DistCast<T2>(),
+                                      Kernel(d, pixelPitch), detail::DistCast<T2>(), pool);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_DISTANCE_HXX
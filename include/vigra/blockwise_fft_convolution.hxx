@@ -0,0 +1,336 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_BLOCKWISE_FFT_CONVOLUTION_HXX
+#define VIGRA_BLOCKWISE_FFT_CONVOLUTION_HXX
+
+#include <memory>
+#include <vector>
+#include "multi_fft.hxx"
+#include "multi_blocking.hxx"
+#include "multi_blockwise.hxx"
+#include "multi_array_chunked.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace blockwise_fft_detail {
+
+    // map a coordinate into [0, size) by reflection at the borders, excluding the
+    // border pixel itself (the border treatment of convolveFFT())
+inline MultiArrayIndex reflectIndex(MultiArrayIndex i, MultiArrayIndex size)
+{
+    if(size == 1)
+        return 0;
+    const MultiArrayIndex period = 2*(size - 1);
+    i %= period;
+    if(i < 0)
+        i += period;
+    return i < size ? i : period - i;
+}
+
+    // read the region [begin, end) of the source into a plain array
+template <unsigned int N, class T, class S, class U>
+void readRegion(MultiArrayView<N, T, S> const & source,
+                typename MultiArrayShape<N>::type const & begin,
+                MultiArray<N, U> & region)
+{
+    region = source.subarray(begin, begin + region.shape());
+}
+
+template <unsigned int N, class T, class U>
+void readRegion(ChunkedArray<N, T> const & source,
+                typename MultiArrayShape<N>::type const & begin,
+                MultiArray<N, U> & region)
+{
+    source.checkoutSubarray(begin, region);
+}
+
+template <unsigned int N, class T, class S, class U, class C>
+void writeRegion(MultiArrayView<N, T, S> dest,
+                 typename MultiArrayShape<N>::type const & begin,
+                 MultiArrayView<N, U, C> const & region)
+{
+    dest.subarray(begin, begin + region.shape()) = region;
+}
+
+template <unsigned int N, class T, class U, class C>
+void writeRegion(ChunkedArray<N, T> & dest,
+                 typename MultiArrayShape<N>::type const & begin,
+                 MultiArrayView<N, U, C> const & region)
+{
+    dest.commitSubarray(begin, region);
+}
+
+    /*
+        Overlap-save convolution: every core block is extended by the kernel
+        support, transformed with a fixed padded shape, multiplied with the
+        (once transformed) kernel, and only the core of the result is kept.
+        Since all tiles share the padded shape, a single pair of plans and a
+        single kernel transform serve all tiles, and each thread only needs
+        one work array.
+    */
+template <unsigned int N, class Real>
+class OverlapSaveConvolution
+{
+  public:
+    typedef typename MultiArrayShape<N>::type                   Shape;
+    typedef FFTWComplex<Real>                                   Complex;
+    typedef MultiArray<N, Complex, FFTWAllocator<Complex> >     CArray;
+    typedef MultiArrayView<N, Real, StridedArrayTag>            RView;
+    typedef MultiBlocking<N, MultiArrayIndex>                   Blocking;
+    typedef typename Blocking::Block                            Block;
+
+        // in-place R2C work array
+    struct Workspace
+    {
+        CArray fourier;
+        RView  real;
+
+        explicit Workspace(Shape const & paddedShape)
+        : fourier(fftwCorrespondingShapeR2C(paddedShape)),
+          real(paddedShape, realStrides(fourier), (Real*)fourier.data())
+        {}
+
+        static Shape realStrides(CArray const & fourier)
+        {
+            Shape strides = 2*fourier.stride();
+            strides[0] = 1;
+            return strides;
+        }
+    };
+
+    template <class C>
+    OverlapSaveConvolution(MultiArrayView<N, Real, C> const & kernel,
+                           Shape const & coreShape)
+    : kernelShape_(kernel.shape()),
+      before_(kernelShape_ - Shape(1) - kernelShape_ / 2),
+      coreShape_(coreShape),
+      paddedShape_(fftwBestPaddedShapeR2C(coreShape + kernelShape_ - Shape(1))),
+      fourierKernel_(fftwCorrespondingShapeR2C(paddedShape_))
+    {
+        Workspace w(paddedShape_);
+        forward_.init(w.real, w.fourier);
+        backward_.init(w.fourier, w.real);
+
+        detail::fftEmbedKernel(kernel, w.real);
+        forward_.execute(w.real, w.fourier);
+        fourierKernel_ = w.fourier;
+    }
+
+    Shape const & paddedShape() const
+    {
+        return paddedShape_;
+    }
+
+        // convolve the core block 'core' of 'source' and write it to 'dest'
+    template <class SRC, class DEST>
+    void convolveBlock(SRC const & source, DEST & dest, Block const & core,
+                       Workspace & w) const
+    {
+        const Shape shape = source.shape(),
+                    windowBegin = core.begin() - before_,
+                    windowShape = core.size() + kernelShape_ - Shape(1);
+
+        // source coordinates of the window, reflected at the array border
+        Shape readBegin(shape), readEnd(0);
+        std::vector<MultiArrayIndex> index[N];
+        for(unsigned int d=0; d<N; ++d)
+        {
+            index[d].resize(windowShape[d]);
+            for(MultiArrayIndex k=0; k<windowShape[d]; ++k)
+            {
+                MultiArrayIndex i = reflectIndex(windowBegin[d] + k, shape[d]);
+                index[d][k] = i;
+                readBegin[d] = std::min(readBegin[d], i);
+                readEnd[d] = std::max(readEnd[d], i+1);
+            }
+            for(MultiArrayIndex k=0; k<windowShape[d]; ++k)
+                index[d][k] = (index[d][k] - readBegin[d]);
+        }
+
+        MultiArray<N, Real> region(readEnd - readBegin);
+        readRegion(source, readBegin, region);
+
+        w.real.init(Real(0));
+        MultiCoordinateIterator<N> k(windowShape), end = k.getEndIterator();
+        for(; k != end; ++k)
+        {
+            MultiArrayIndex offset = 0;
+            for(unsigned int d=0; d<N; ++d)
+                offset += index[d][(*k)[d]] * region.stride(d);
+            w.real[*k] = region.data()[offset];
+        }
+
+        forward_.execute(w.real, w.fourier);
+        w.fourier *= fourierKernel_;
+        backward_.execute(w.fourier, w.real);
+
+        writeRegion(dest, core.begin(), w.real.subarray(before_, before_ + core.size()));
+    }
+
+  private:
+    Shape kernelShape_, before_, coreShape_, paddedShape_;
+    FFTWPlan<N, Real> forward_, backward_;
+    CArray fourierKernel_;
+};
+
+template <unsigned int N, class Real, class C, class SRC, class DEST>
+void convolveFFTBlockwiseImpl(SRC const & source,
+                              MultiArrayView<N, Real, C> const & kernel,
+                              DEST & dest,
+                              typename MultiArrayShape<N>::type blockShape,
+                              BlockwiseOptions const & options)
+{
+    typedef OverlapSaveConvolution<N, Real>             Convolution;
+    typedef typename Convolution::Workspace             Workspace;
+    typedef typename Convolution::Blocking              Blocking;
+    typedef typename Convolution::Block                 Block;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "convolveFFTBlockwise(): shape mismatch between input and output.");
+
+    blockShape = min(blockShape, source.shape());
+    Blocking blocking(source.shape(), blockShape);
+    Convolution convolution(kernel, blockShape);
+
+    // one work array per thread, allocated on first use
+    ThreadPool pool(options);
+    std::vector<std::unique_ptr<Workspace> > workspaces(std::max<size_t>(1, pool.nThreads()));
+
+    parallel_foreach(pool, blocking.blockBegin(), blocking.blockEnd(),
+        [&](size_t threadId, Block const & core)
+        {
+            if(!workspaces[threadId])
+                workspaces[threadId].reset(new Workspace(convolution.paddedShape()));
+            convolution.convolveBlock(source, dest, core, *workspaces[threadId]);
+        },
+        blocking.numBlocks()
+    );
+}
+
+} // namespace blockwise_fft_detail
+
+/********************************************************/
+/*                                                      */
+/*                 convolveFFTBlockwise                 */
+/*                                                      */
+/********************************************************/
+
+/** \brief Blockwise FFT-based convolution for large arrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class Real, class C2,
+                                  class T3, class S3>
+        void
+        convolveFFTBlockwise(MultiArrayView<N, T1, S1> const & in,
+                             MultiArrayView<N, Real, C2> const & kernel,
+                             MultiArrayView<N, T3, S3> out,
+                             BlockwiseOptions const & options = BlockwiseOptions());
+
+        template <unsigned int N, class T1, class Real, class C2, class T3>
+        void
+        convolveFFTBlockwise(ChunkedArray<N, T1> const & in,
+                             MultiArrayView<N, Real, C2> const & kernel,
+                             ChunkedArray<N, T3> & out,
+                             BlockwiseOptions const & options = BlockwiseOptions());
+    }
+    \endcode
+
+    Computes the same result as \ref convolveFFT() (with a real-valued kernel in the
+    spatial domain, reflective border treatment), but uses the overlap-save method:
+    the output is split into blocks via \ref MultiBlocking, and each block is computed
+    from the corresponding input block, extended by the kernel support, with a padded FFT
+    of fixed size. Thus, the memory required for the transforms is proportional to the
+    block size instead of the array size, and the blocks are processed in parallel
+    according to <tt>options.numThreads()</tt>. All blocks share one pair of FFTW plans and
+    one transformed kernel.
+
+    The block shape is taken from <tt>options.blockShape()</tt>. For ChunkedArrays, the
+    default is the chunk shape of the output, so that each block is written by a single thread.
+    Blocks should be considerably larger than the kernel for efficiency.
+    The precision of the computation is determined by the kernel's value type <tt>Real</tt>
+    (<tt>float</tt>, <tt>double</tt>, or <tt>long double</tt>).
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_fft_convolution.hxx\><br>
+    Namespace: vigra
+
+    \code
+    ChunkedArrayHDF5<3, float> in(...), out(...);
+
+    MultiArray<3, float> kernel(Shape3(31));
+    ... // fill kernel
+
+    convolveFFTBlockwise(in, kernel, out, BlockwiseOptions().numThreads(8));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void convolveFFTBlockwise)
+
+template <unsigned int N, class T1, class S1,
+                          class Real, class C2,
+                          class T3, class S3>
+void
+convolveFFTBlockwise(MultiArrayView<N, T1, S1> const & in,
+                     MultiArrayView<N, Real, C2> const & kernel,
+                     MultiArrayView<N, T3, S3> out,
+                     BlockwiseOptions const & options = BlockwiseOptions())
+{
+    blockwise_fft_detail::convolveFFTBlockwiseImpl(in, kernel, out,
+                                    options.template getBlockShapeN<N>(), options);
+}
+
+template <unsigned int N, class T1, class Real, class C2, class T3>
+void
+convolveFFTBlockwise(ChunkedArray<N, T1> const & in,
+                     MultiArrayView<N, Real, C2> const & kernel,
+                     ChunkedArray<N, T3> & out,
+                     BlockwiseOptions const & options = BlockwiseOptions())
+{
+    typename MultiArrayShape<N>::type blockShape =
+        options.getBlockShape().size() == 0
+            ? out.chunkShape()
+            : options.template getBlockShapeN<N>();
+    blockwise_fft_detail::convolveFFTBlockwiseImpl(in, kernel, out, blockShape, options);
+}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_FFT_CONVOLUTION_HXX
@@ -103,29 +103,14 @@ public:
         BlockwiseOptions::numThreads(n);
         return *this;
     }
+
+        // the number of threads is controlled by BlockwiseOptions
+    using BlockwiseOptions::getNumThreads;
 };
 
 namespace blockwise_labeling_detail
 {
 
-template <class Equal, class Label>
-struct BorderVisitor
-{
-    Label u_label_offset;
-    Label v_label_offset;
-    UnionFindArray<Label>* global_unions;
-    Equal* equal;
-
-    template <class Data, class Shape>
-    void operator()(const Data& u_data, Label& u_label, const Data& v_data, Label& v_label, const Shape& diff)
-    {
-        if(labeling_equality::callEqual(*equal, u_data, v_data, diff))
-        {
-            global_unions->makeUnion(u_label + u_label_offset, v_label + v_label_offset);
-        }
-    }
-};
-
 // needed by MSVC
 template <class LabelBlocksIterator>
 struct BlockwiseLabelingResult
@@ -157,6 +142,12 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
 
     bool has_background = options.hasBackgroundValue();
 
+    ThreadPool pool(options.getNumThreads());
+
+    // blocks are labeled concurrently, but each block on its own is labeled sequentially
+    LabelOptions block_options(options);
+    block_options.numThreads(ParallelOptions::NoThreads);
+
     // mapping stage: label each block and save number of labels assigned in blocks before the current block in label_offsets
     Label unmerged_label_number;
     {
@@ -173,10 +164,10 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         //std::vector<int> ids(d);
         //std::iota(ids.begin(), ids.end(), 0 );
 
-        parallel_foreach(options.getNumThreads(), d,
+        parallel_foreach(pool, d,
             [&](const int /*threadId*/, const uint64_t i){
                 Label resVal = labelMultiArray(data_blocks_it[i], label_blocks_it[i],
-                                               options, equal);
+                                               block_options, equal);
                 if(has_background) // FIXME: reversed condition?
                     ++resVal;
                 nSeg[i] = resVal;
@@ -195,7 +186,7 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
     }
 
     // reduce stage: merge adjacent labels if the region overlaps
-    UnionFindArray<Label> global_unions(unmerged_label_number);
+    ConcurrentUnionFindArray<Label> global_unions(unmerged_label_number);
     if(has_background)
     {
         // merge all labels that refer to background
@@ -207,24 +198,8 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         }
     }
 
-    typedef GridGraph<Dimensions, undirected_tag> Graph;
-    typedef typename Graph::edge_iterator EdgeIterator;
-    Graph blocks_graph(blocks_shape, options.getNeighborhood());
-    for(EdgeIterator it = blocks_graph.get_edge_iterator(); it != blocks_graph.get_edge_end_iterator(); ++it)
-    {
-        Shape u = blocks_graph.u(*it);
-        Shape v = blocks_graph.v(*it);
-        Shape difference = v - u;
-
-        BorderVisitor<Equal, Label> border_visitor;
-        border_visitor.u_label_offset = label_offsets[u];
-        border_visitor.v_label_offset = label_offsets[v];
-        border_visitor.global_unions = &global_unions;
-        border_visitor.equal = &equal;
-        visitBorder(data_blocks_begin[u], label_blocks_begin[u],
-                    data_blocks_begin[v], label_blocks_begin[v],
-                    difference, options.getNeighborhood(), border_visitor);
-    }
+    labeling_detail::mergeBlockBorders(pool, data_blocks_begin, label_blocks_begin, label_offsets,
+                                       options.getNeighborhood(), equal, global_unions);
 
     // fill mapping (local labels) -> (global labels)
     Label last_label = global_unions.makeContiguous();
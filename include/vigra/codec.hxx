@@ -203,6 +203,26 @@ namespace vigra
         virtual const void * currentScanlineOfBand( unsigned int ) const = 0;
         virtual void nextScanline() = 0;
 
+        // restrict decoding to a region of interest (must be called before the first
+        // nextScanline()). Codecs that support this natively return true. Then, the
+        // first nextScanline() delivers the ROI's top row, and currentScanlineOfBand()
+        // points to the ROI's left column. Otherwise, false is returned and the caller
+        // has to skip the unwanted rows and columns itself.
+        virtual bool setROI( const vigra::Rect2D & )
+        {
+            return false;
+        }
+
+        // zero-copy alternative to nextScanline(): decode the next row directly into
+        // 'dest', which must provide room for getWidth() pixels of getNumBands()
+        // interleaved samples of type getPixelType(). Returns false without consuming
+        // a row if the codec (in its current configuration) cannot do this, so that
+        // the caller has to fall back to nextScanline() and currentScanlineOfBand().
+        virtual bool nextScanlineInto( void * )
+        {
+            return false;
+        }
+
         typedef ArrayVector<unsigned char> ICCProfile;
 
         const ICCProfile & getICCProfile() const
@@ -224,6 +244,13 @@ namespace vigra
           init(fileName);
         }
 
+        // initialize for writing the file contents into a memory buffer.
+        // Returns false for codecs that do not support this feature.
+        virtual bool initMemory( std::vector<char> & )
+        {
+          return false;
+        }
+
         virtual void close() = 0;
         virtual void abort() = 0;
 
@@ -285,6 +312,11 @@ namespace vigra
     VIGRA_EXPORT VIGRA_UNIQUE_PTR<Encoder>
     getEncoder( const std::string &, const std::string & = "undefined", const std::string & = "w" );
 
+    // get an encoder writing into the given buffer (the file name only
+    // determines the file type if none is given)
+    VIGRA_EXPORT VIGRA_UNIQUE_PTR<Encoder>
+    getMemoryEncoder( std::vector<char> &, const std::string &, const std::string & = "undefined" );
+
     VIGRA_EXPORT std::string
     getEncoderType( const std::string &, const std::string & = "undefined" );
 
@@ -42,10 +42,12 @@
 
 /*std*/
 #include <algorithm>
+#include <numeric>
 #include <vector>
 #include <functional>
 #include <set>
 #include <iomanip>
+#include <memory>
 
 /*vigra*/
 #include "graphs.hxx"
@@ -55,6 +57,9 @@
 #include "union_find.hxx"
 #include "adjacency_list_graph.hxx"
 #include "graph_maps.hxx"
+#ifndef VIGRA_SINGLE_THREADED
+#include "threadpool.hxx"
+#endif
 
 #include "timing.hxx"
 //#include "openmp_helper.hxx"
@@ -112,6 +117,129 @@ namespace vigra{
     }
 
 
+#ifndef VIGRA_SINGLE_THREADED
+    namespace detail_graph_algorithms{
+
+        // sort 'data' by splitting it into one chunk per thread,
+        // sorting the chunks concurrently, and merging pairs of
+        // sorted runs (also concurrently) until a single run is left
+        template<class T, class COMPERATOR>
+        void parallelSort(std::vector<T> & data, const COMPERATOR & comperator, ThreadPool & pool)
+        {
+            const size_t size    = data.size();
+            const size_t nChunks = std::min<size_t>(std::max<size_t>(1, pool.nThreads()),
+                                                    std::max<size_t>(1, size / 1024));
+            if(nChunks <= 1){
+                std::sort(data.begin(), data.end(), comperator);
+                return;
+            }
+
+            std::vector<size_t> bounds(nChunks+1);
+            for(size_t c=0; c<=nChunks; ++c)
+                bounds[c] = (c*size) / nChunks;
+
+            parallel_foreach(pool, nChunks,
+                [&](size_t /*threadId*/, size_t c)
+                {
+                    std::sort(data.begin()+bounds[c], data.begin()+bounds[c+1], comperator);
+                }
+            );
+
+            std::vector<T> buffer(size);
+            while(bounds.size() > 2){
+                const size_t nRuns  = bounds.size()-1;
+                const size_t nPairs = (nRuns+1) / 2;
+                parallel_foreach(pool, nPairs,
+                    [&](size_t /*threadId*/, size_t p)
+                    {
+                        const size_t begin = bounds[2*p],
+                                     mid   = bounds[std::min(2*p+1, nRuns)],
+                                     end   = bounds[std::min(2*p+2, nRuns)];
+                        std::merge(data.begin()+begin, data.begin()+mid,
+                                   data.begin()+mid,   data.begin()+end,
+                                   buffer.begin()+begin, comperator);
+                    }
+                );
+                data.swap(buffer);
+                std::vector<size_t> newBounds;
+                for(size_t b=0; b<bounds.size(); b+=2)
+                    newBounds.push_back(bounds[b]);
+                if(newBounds.back() != size)
+                    newBounds.push_back(size);
+                bounds.swap(newBounds);
+            }
+        }
+
+        // order (weight, index) pairs by weight, ties by index
+        template<class COMPERATOR>
+        struct WeightIndexCompare
+        {
+            WeightIndexCompare(const COMPERATOR & comperator)
+            : comperator_(comperator)
+            {}
+
+            template<class PAIR>
+            bool operator()(const PAIR & a, const PAIR & b) const{
+                if(comperator_(a.first, b.first))
+                    return true;
+                if(comperator_(b.first, a.first))
+                    return false;
+                return a.second < b.second;
+            }
+
+            COMPERATOR comperator_;
+        };
+    } // namespace detail_graph_algorithms
+
+    /// \brief get a vector of Edge descriptors (parallel version)
+    ///
+    /// Sort the Edge descriptors given weights 
+    /// and a comperator. The weights are read once (in parallel)
+    /// and cached, so that comparisons do not go through the
+    /// edge map. Edges with equal weights are kept in 
+    /// edge iteration order, so the result does not depend
+    /// on the number of threads.
+    template<class GRAPH,class WEIGHTS,class COMPERATOR>
+    void edgeSort(
+        const GRAPH   & g,
+        const WEIGHTS & weights,
+        const COMPERATOR  & comperator,
+        std::vector<typename GRAPH::Edge> & sortedEdges,
+        const ParallelOptions & options
+    ){
+        typedef typename GRAPH::Edge    Edge;
+        typedef typename WEIGHTS::Value WeightType;
+        typedef std::pair<WeightType, size_t> Key;
+
+        std::vector<Edge> edges(g.edgeNum());
+        size_t c=0;
+        for(typename GRAPH::EdgeIt e(g);e!=lemon::INVALID;++e){
+            edges[c]=*e;
+            ++c;
+        }
+
+        ThreadPool pool(options);
+        std::vector<Key> keys(edges.size());
+        parallel_foreach(pool, edges.size(),
+            [&](size_t /*threadId*/, size_t i)
+            {
+                keys[i] = Key(weights[edges[i]], i);
+            }
+        );
+
+        detail_graph_algorithms::WeightIndexCompare<COMPERATOR> keyComperator(comperator);
+        detail_graph_algorithms::parallelSort(keys, keyComperator, pool);
+
+        sortedEdges.resize(edges.size());
+        parallel_foreach(pool, keys.size(),
+            [&](size_t /*threadId*/, size_t i)
+            {
+                sortedEdges[i] = edges[keys[i].second];
+            }
+        );
+    }
+#endif // VIGRA_SINGLE_THREADED
+
     /// \brief copy a lemon node map
     template<class G,class A,class B>
     void copyNodeMap(const G & g,const A & a ,B & b){
@@ -213,6 +341,349 @@ namespace vigra{
         }
     }
 
+    /// \brief compact storage of the affiliated edges of a region adjacency graph
+    ///
+    /// The affiliated edges of all rag edges are stored as base graph edge IDs in
+    /// a single array, and the IDs of the rag edge with ID \a i are located at
+    /// <tt>ids()[offsets()[i]]</tt> to <tt>ids()[offsets()[i+1]-1]</tt> (compressed
+    /// sparse row format). In contrast to an <tt>EdgeMap< std::vector<Edge> ></tt>,
+    /// this needs no heap allocation per rag edge and only a single index per base
+    /// graph edge. \a INDEX_TYPE may be a 32-bit type if the base graph has less than
+    /// 2^32 edges. The base graph must live at least as long as this object.
+    ///
+    /// <tt>affEdges[ragEdge]</tt> returns a range with <tt>size()</tt> and <tt>operator[]</tt>
+    /// (returning base graph edge descriptors), so that algorithms written for the
+    /// vector-based representation, e.g. serializeAffiliatedEdges(), accept both.
+    ///
+    template<class GRAPH, class INDEX_TYPE = typename GRAPH::index_type>
+    class CompressedAffiliatedEdges{
+    public:
+        typedef GRAPH                    BaseGraph;
+        typedef typename GRAPH::Edge     BaseGraphEdge;
+        typedef INDEX_TYPE               index_type;
+        typedef AdjacencyListGraph::Edge Key;
+
+        /// \brief the affiliated edges of a single rag edge
+        class Range{
+        public:
+            typedef BaseGraphEdge value_type;
+
+            Range(const BaseGraph & graph, const index_type * begin, const index_type * end)
+            :   graph_(&graph),
+                begin_(begin),
+                end_(end){
+            }
+
+            size_t size()const{
+                return end_ - begin_;
+            }
+
+            bool empty()const{
+                return begin_ == end_;
+            }
+
+            BaseGraphEdge operator[](const size_t i)const{
+                return graph_->edgeFromId(begin_[i]);
+            }
+
+            const index_type * idsBegin()const{
+                return begin_;
+            }
+
+            const index_type * idsEnd()const{
+                return end_;
+            }
+
+        private:
+            const BaseGraph * graph_;
+            const index_type * begin_;
+            const index_type * end_;
+        };
+
+        CompressedAffiliatedEdges()
+        :   graph_(0),
+            offsets_(1, 0){
+        }
+
+        /// \brief empty storage for the given base graph
+        explicit CompressedAffiliatedEdges(const BaseGraph & graph)
+        :   graph_(&graph),
+            offsets_(1, 0){
+        }
+
+        /// \brief convert the vector-based representation
+        template<class AFF_EDGES>
+        CompressedAffiliatedEdges(const BaseGraph & graph, const AdjacencyListGraph & rag,
+                                  const AFF_EDGES & affEdges)
+        :   graph_(&graph){
+            assign(graph, rag, affEdges);
+        }
+
+        /// \brief convert the vector-based representation
+        template<class AFF_EDGES>
+        void assign(const BaseGraph & graph, const AdjacencyListGraph & rag, const AFF_EDGES & affEdges){
+            typedef AdjacencyListGraph::EdgeIt EdgeIt;
+            vigra_precondition(graph.maxEdgeId() <= static_cast<Int64>(NumericTraits<index_type>::max()),
+                "CompressedAffiliatedEdges::assign(): index_type too small for the base graph.");
+
+            graph_ = &graph;
+            offsets_.assign(rag.maxEdgeId()+2, 0);
+            for(EdgeIt e(rag); e!=lemon::INVALID; ++e)
+                offsets_[rag.id(*e)+1] = affEdges[*e].size();
+            std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+
+            ids_.resize(offsets_.back());
+            for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+                index_type * ids = &ids_[0] + offsets_[rag.id(*e)];
+                for(size_t i=0; i<affEdges[*e].size(); ++i)
+                    ids[i] = static_cast<index_type>(graph.id(affEdges[*e][i]));
+            }
+        }
+
+        Range operator[](const Key & edge)const{
+            const index_type * ids = ids_.empty() ? 0 : &ids_[0];
+            return Range(*graph_, ids + offsets_[edge.id()], ids + offsets_[edge.id()+1]);
+        }
+
+        /// \brief the base graph
+        const BaseGraph & baseGraph()const{
+            return *graph_;
+        }
+
+        /// \brief offsets into ids() for each rag edge ID, plus the end
+        const std::vector<size_t> & offsets()const{
+            return offsets_;
+        }
+
+        std::vector<size_t> & offsets(){
+            return offsets_;
+        }
+
+        /// \brief the base graph edge IDs of all affiliated edges
+        const std::vector<index_type> & ids()const{
+            return ids_;
+        }
+
+        std::vector<index_type> & ids(){
+            return ids_;
+        }
+
+        /// \brief memory consumption in bytes
+        size_t memoryBytes()const{
+            return offsets_.size()*sizeof(size_t) + ids_.size()*sizeof(index_type);
+        }
+
+    private:
+        const BaseGraph * graph_;
+        std::vector<size_t> offsets_;
+        std::vector<index_type> ids_;
+    };
+
+#ifndef VIGRA_SINGLE_THREADED
+    namespace detail_graph_algorithms{
+
+        // a base graph edge between two regions: (smaller label, larger label, edge ID)
+        typedef TinyVector<Int64, 3> RagEdgeEntry;
+
+        // sort 'v', whose parts [bounds[k], bounds[k+1]) are already sorted,
+        // by merging neighboring parts in parallel until one part is left
+        template<class T>
+        void parallelMergeSortedParts(ThreadPool & pool, std::vector<T> & v,
+                                      std::vector<std::size_t> bounds){
+            while(bounds.size() > 2){
+                const std::size_t pairs = (bounds.size() - 1) / 2;
+                parallel_foreach(pool, pairs,
+                    [&v, &bounds](int /*thread_id*/, std::size_t k){
+                        std::inplace_merge(v.begin() + bounds[2*k],
+                                           v.begin() + bounds[2*k+1],
+                                           v.begin() + bounds[2*k+2]);
+                    });
+                std::vector<std::size_t> merged;
+                for(std::size_t k=0; k<bounds.size(); k+=2)
+                    merged.push_back(bounds[k]);
+                if(merged.back() != bounds.back())
+                    merged.push_back(bounds.back());
+                bounds.swap(merged);
+            }
+        }
+
+        // Build the nodes and edges of the rag. On return, the boundary edges
+        // of the rag edge with ID r are entries[runs[r]] to entries[runs[r+1]-1].
+        template<unsigned int DIM, class DTAG, class GRAPH_IN_NODE_LABEL_MAP>
+        void makeRegionAdjacencyGraphEntries(
+            ThreadPool & pool,
+            const GridGraph<DIM,DTAG>     & graphIn,
+            const GRAPH_IN_NODE_LABEL_MAP & labels,
+            AdjacencyListGraph & rag,
+            const Int64 ignoreLabel,
+            std::vector<RagEdgeEntry> & entries,
+            std::vector<std::size_t> & runs
+        ){
+            typedef GridGraph<DIM,DTAG> GraphIn;
+            typedef typename GraphIn::Node          NodeGraphIn;
+            typedef typename GraphIn::Edge          EdgeGraphIn;
+            typedef typename GraphIn::IncBackEdgeIt IncBackEdgeItGraphIn;
+            typedef RagEdgeEntry Entry;
+
+            const MultiArrayIndex nodeNum = graphIn.nodeNum();
+            const MultiArrayIndex blockNum = std::max<MultiArrayIndex>(1,
+                                    std::min<MultiArrayIndex>(std::max<MultiArrayIndex>(1, pool.nThreads()), nodeNum));
+
+            // collect the labels and the boundary edges of each block
+            std::vector<std::vector<Int64> > blockLabels(blockNum);
+            std::vector<std::vector<Entry> >  blockEntries(blockNum);
+            parallel_foreach(pool, blockNum,
+                [&](int /*thread_id*/, MultiArrayIndex b){
+                    const MultiArrayIndex begin = b*nodeNum/blockNum,
+                                          end   = (b+1)*nodeNum/blockNum;
+                    std::vector<Int64> & nodeLabels = blockLabels[b];
+                    std::vector<Entry> & blockEdges = blockEntries[b];
+
+                    NodeGraphIn node(graphIn.nodeFromId(begin));
+                    for(MultiArrayIndex i=begin; i<end; ++i){
+                        const Int64 lu = static_cast<Int64>(labels[node]);
+                        if(ignoreLabel==-1 || lu!=ignoreLabel){
+                            if(nodeLabels.empty() || nodeLabels.back()!=lu)
+                                nodeLabels.push_back(lu);
+                            for(IncBackEdgeItGraphIn e(graphIn,node); e!=lemon::INVALID; ++e){
+                                const EdgeGraphIn edge(*e);
+                                const Int64 lv = static_cast<Int64>(labels[graphIn.v(edge)]);
+                                if(lu!=lv && (ignoreLabel==-1 || lv!=ignoreLabel))
+                                    blockEdges.push_back(Entry(std::min(lu,lv), std::max(lu,lv), graphIn.id(edge)));
+                            }
+                        }
+                        // advance to the next node in scan order
+                        for(unsigned int d=0; d<DIM && ++node[d]==graphIn.shape()[d]; ++d)
+                            node[d] = 0;
+                    }
+                    std::sort(nodeLabels.begin(), nodeLabels.end());
+                    nodeLabels.erase(std::unique(nodeLabels.begin(), nodeLabels.end()), nodeLabels.end());
+                    std::sort(blockEdges.begin(), blockEdges.end());
+                });
+
+            // nodes
+            std::vector<Int64> nodeLabels;
+            for(MultiArrayIndex b=0; b<blockNum; ++b)
+                nodeLabels.insert(nodeLabels.end(), blockLabels[b].begin(), blockLabels[b].end());
+            std::sort(nodeLabels.begin(), nodeLabels.end());
+            nodeLabels.erase(std::unique(nodeLabels.begin(), nodeLabels.end()), nodeLabels.end());
+
+            rag=AdjacencyListGraph();
+            if(!nodeLabels.empty())
+                rag.reserveMaxNodeId(nodeLabels.back());
+            for(std::size_t k=0; k<nodeLabels.size(); ++k)
+                rag.addNode(nodeLabels[k]);
+
+            // concatenate the sorted entries of all blocks and merge them
+            std::vector<std::size_t> bounds(1, 0);
+            for(MultiArrayIndex b=0; b<blockNum; ++b)
+                bounds.push_back(bounds.back() + blockEntries[b].size());
+            entries.resize(bounds.back());
+            parallel_foreach(pool, blockNum,
+                [&](int /*thread_id*/, MultiArrayIndex b){
+                    std::copy(blockEntries[b].begin(), blockEntries[b].end(), entries.begin() + bounds[b]);
+                    std::vector<Entry>().swap(blockEntries[b]);
+                });
+            parallelMergeSortedParts(pool, entries, bounds);
+
+            // each run of equal label pairs becomes one edge of the rag
+            runs.clear();
+            for(std::size_t k=0; k<entries.size(); ++k){
+                if(k==0 || entries[k][0]!=entries[k-1][0] || entries[k][1]!=entries[k-1][1])
+                    runs.push_back(k);
+            }
+            runs.push_back(entries.size());
+
+            rag.reserveEdges(runs.size()-1);
+            for(std::size_t r=0; r+1<runs.size(); ++r){
+                const Entry & entry = entries[runs[r]];
+                rag.addEdge(rag.nodeFromId(entry[0]), rag.nodeFromId(entry[1]));
+            }
+        }
+    } // namespace detail_graph_algorithms
+
+    /// \brief make a region adjacency graph from a grid graph and labels in parallel
+    ///
+    /// \param graphIn  : input grid graph
+    /// \param labels   : labels w.r.t. graphIn (e.g. a MultiArrayView of the graph's shape)
+    /// \param[out] rag  : region adjacency graph
+    /// \param[out] affiliatedEdges : a vector of edges of graphIn for each edge in rag
+    /// \param      ignoreLabel : label to ignore (-1 means no label will be ignored)
+    /// \param      options : number of threads to be used
+    ///
+    /// The nodes of graphIn are split into blocks. Each thread collects the
+    /// label pairs of the boundary edges in its blocks, the pairs are sorted
+    /// and merged, and the rag is built in a single pass without searching
+    /// for existing edges. In contrast to the sequential version, the
+    /// edges of the rag are ordered lexicographically by their end node IDs,
+    /// and each list of affiliated edges is ordered by base graph edge ID.
+    ///
+    template<unsigned int DIM, class DTAG, class GRAPH_IN_NODE_LABEL_MAP>
+    void makeRegionAdjacencyGraph(
+        const GridGraph<DIM,DTAG>     & graphIn,
+        const GRAPH_IN_NODE_LABEL_MAP & labels,
+        AdjacencyListGraph & rag,
+        typename AdjacencyListGraph:: template EdgeMap< std::vector<typename GridGraph<DIM,DTAG>::Edge> > & affiliatedEdges,
+        const Int64   ignoreLabel,
+        const ParallelOptions & options
+    ){
+        typedef typename GridGraph<DIM,DTAG>::Edge EdgeGraphIn;
+
+        ThreadPool pool(options);
+        std::vector<detail_graph_algorithms::RagEdgeEntry> entries;
+        std::vector<std::size_t> runs;
+        detail_graph_algorithms::makeRegionAdjacencyGraphEntries(pool, graphIn, labels, rag,
+                                                                 ignoreLabel, entries, runs);
+
+        affiliatedEdges.assign(rag);
+        parallel_foreach(pool, runs.size()-1,
+            [&](int /*thread_id*/, std::size_t r){
+                std::vector<EdgeGraphIn> & affEdges = affiliatedEdges[rag.edgeFromId(r)];
+                affEdges.reserve(runs[r+1]-runs[r]);
+                for(std::size_t k=runs[r]; k<runs[r+1]; ++k)
+                    affEdges.push_back(graphIn.edgeFromId(entries[k][2]));
+            });
+    }
+
+    /// \brief make a region adjacency graph from a grid graph and labels in parallel,
+    /// storing the affiliated edges in compressed form
+    ///
+    /// Same as the variant above, but \a affiliatedEdges is a CompressedAffiliatedEdges
+    /// object, which needs much less memory than a vector per rag edge.
+    ///
+    template<unsigned int DIM, class DTAG, class GRAPH_IN_NODE_LABEL_MAP, class INDEX_TYPE>
+    void makeRegionAdjacencyGraph(
+        const GridGraph<DIM,DTAG>     & graphIn,
+        const GRAPH_IN_NODE_LABEL_MAP & labels,
+        AdjacencyListGraph & rag,
+        CompressedAffiliatedEdges<GridGraph<DIM,DTAG>, INDEX_TYPE> & affiliatedEdges,
+        const Int64   ignoreLabel = -1,
+        const ParallelOptions & options = ParallelOptions()
+    ){
+        vigra_precondition(graphIn.maxEdgeId() <= static_cast<Int64>(NumericTraits<INDEX_TYPE>::max()),
+            "makeRegionAdjacencyGraph(): index type of affiliatedEdges too small for the base graph.");
+
+        ThreadPool pool(options);
+        std::vector<detail_graph_algorithms::RagEdgeEntry> entries;
+        std::vector<std::size_t> runs;
+        detail_graph_algorithms::makeRegionAdjacencyGraphEntries(pool, graphIn, labels, rag,
+                                                                 ignoreLabel, entries, runs);
+
+        // rag edge IDs are consecutive, so the runs are the CSR offsets
+        affiliatedEdges = CompressedAffiliatedEdges<GridGraph<DIM,DTAG>, INDEX_TYPE>(graphIn);
+        affiliatedEdges.offsets().swap(runs);
+        std::vector<INDEX_TYPE> & ids = affiliatedEdges.ids();
+        ids.resize(entries.size());
+        const std::size_t blockNum = std::max<std::size_t>(1, pool.nThreads());
+        parallel_foreach(pool, blockNum,
+            [&](int /*thread_id*/, std::size_t b){
+                const std::size_t end = (b+1)*entries.size()/blockNum;
+                for(std::size_t k=b*entries.size()/blockNum; k<end; ++k)
+                    ids[k] = static_cast<INDEX_TYPE>(entries[k][2]);
+            });
+    }
+#endif
+
     template<unsigned int DIM, class DTAG, class AFF_EDGES>
     size_t affiliatedEdgesSerializationSize(
         const GridGraph<DIM,DTAG> &,
@@ -292,6 +763,46 @@ namespace vigra{
 
 
 
+    template<class IN_ITER, unsigned int DIM, class DTAG, class INDEX_TYPE>
+    void deserializeAffiliatedEdges(
+        const GridGraph<DIM,DTAG> & graph,
+        const AdjacencyListGraph & rag,
+        CompressedAffiliatedEdges<GridGraph<DIM,DTAG>, INDEX_TYPE> & affEdges,
+        IN_ITER begin,
+        IN_ITER
+    ){
+
+        typedef typename  AdjacencyListGraph::EdgeIt EdgeIt;
+        typedef typename  GridGraph<DIM,DTAG>::Edge GEdge;
+
+        affEdges = CompressedAffiliatedEdges<GridGraph<DIM,DTAG>, INDEX_TYPE>(graph);
+        std::vector<size_t> & offsets = affEdges.offsets();
+        std::vector<INDEX_TYPE> & ids = affEdges.ids();
+        offsets.assign(rag.maxEdgeId()+2, 0);
+
+        // edges are serialized in EdgeIt order, which is ascending in ID
+        for(EdgeIt iter(rag); iter!=lemon::INVALID; ++iter){
+
+            const size_t edgeId = rag.id(*iter);
+            const size_t numAffEdge = *begin; ++begin;
+
+            for(size_t i=0; i<numAffEdge; ++i){
+                GEdge gEdge;
+                for(size_t d=0; d<DIM+1; ++d){
+                    gEdge[d]=*begin; ++begin;
+                }
+                ids.push_back(static_cast<INDEX_TYPE>(graph.id(gEdge)));
+            }
+            offsets[edgeId+1] = ids.size();
+        }
+        // IDs without an edge get empty ranges
+        for(size_t k=1; k<offsets.size(); ++k)
+            offsets[k] = std::max(offsets[k], offsets[k-1]);
+    }
+
+
+
+
     /// \brief shortest path computer
     template<class GRAPH,class WEIGHT_TYPE>
     class ShortestPathDijkstra{
@@ -321,6 +832,7 @@ namespace vigra{
         /// \brief run shortest path given edge weights
         ///
         /// \param weights : edge weights encoding the distance between adjacent nodes (must be non-negative) 
+        ///                 Instead of an explicit edge map, a GridGraphImplicitEdgeMap can be used.
         /// \param source  : source node where shortest path should start
         /// \param target  : target node where shortest path should stop. If target is not given
         ///                  or <tt>INVALID</tt>, the shortest path from source to all reachable nodes is computed
@@ -586,6 +1098,275 @@ namespace vigra{
         Node target_;
     };
 
+    /// \brief bidirectional point-to-point shortest path computer
+    ///
+    /// The search grows from the source and the target simultaneously
+    /// (always expanding the side whose closest queued node is nearer)
+    /// and stops as soon as no shorter connection can be found, which
+    /// typically visits far fewer nodes than a search from the source alone.
+    /// The graph must be undirected.
+    ///
+    /// An object of this class is a reusable workspace: the node maps are
+    /// allocated once in the constructor, and each <tt>run()</tt> only
+    /// resets the nodes touched by the previous run. Use one object per thread
+    /// (see \ref shortestPathBatch()) to answer many queries on the same graph.
+    template<class GRAPH,class WEIGHT_TYPE>
+    class BidirectionalShortestPathDijkstra{
+    public:
+        typedef GRAPH Graph;
+
+        typedef typename Graph::Node Node;
+        typedef typename Graph::NodeIt NodeIt;
+        typedef typename Graph::Edge Edge;
+        typedef typename Graph::OutArcIt OutArcIt;
+
+        typedef WEIGHT_TYPE WeightType;
+        typedef ChangeablePriorityQueue<WeightType>           PqType;
+        typedef typename Graph:: template NodeMap<Node>       PredecessorsMap;
+        typedef typename Graph:: template NodeMap<WeightType> DistanceMap;
+        typedef ArrayVector<Node>                             Path;
+
+        /// \brief constructor from graph
+        BidirectionalShortestPathDijkstra(const Graph & g)
+        :   graph_(g),
+            forwardPq_(g.maxNodeId()+1),
+            backwardPq_(g.maxNodeId()+1),
+            forwardPredMap_(g),
+            backwardPredMap_(g),
+            forwardDistMap_(g),
+            backwardDistMap_(g),
+            distance_(NumericTraits<WeightType>::max())
+        {
+            for(NodeIt n(graph_); n!=lemon::INVALID; ++n){
+                forwardPredMap_[*n]=lemon::INVALID;
+                backwardPredMap_[*n]=lemon::INVALID;
+            }
+        }
+
+        /// \brief find the shortest path between \a source and \a target
+        ///
+        /// \param weights : edge weights encoding the distance between adjacent nodes (must be non-negative)
+        /// \param source  : start of the path
+        /// \param target  : end of the path
+        /// \param maxDistance  : path search is terminated when no path of length <tt>maxDistance</tt> or
+        ///                       shorter can exist
+        ///
+        /// Returns the length of the shortest path, or <tt>NumericTraits<WeightType>::max()</tt>
+        /// when \a target is unreachable (within \a maxDistance).
+        template<class WEIGHTS>
+        WeightType run(const WEIGHTS & weights, const Node & source, const Node & target,
+                       WeightType maxDistance=NumericTraits<WeightType>::max())
+        {
+            this->reInitializeMaps(source, target);
+            if(source == target){
+                distance_ = static_cast<WeightType>(0.0);
+                meetingNode_ = source;
+            }
+            while(!forwardPq_.empty() && !backwardPq_.empty()){
+                const WeightType forwardTop  = forwardPq_.topPriority(),
+                                 backwardTop = backwardPq_.topPriority();
+                // every path that is yet to be found is at least this long
+                if(forwardTop + backwardTop >= distance_ || forwardTop + backwardTop > maxDistance)
+                    break;
+                if(forwardTop <= backwardTop)
+                    expand(weights, forwardPq_, forwardPredMap_, forwardDistMap_,
+                           backwardPredMap_, backwardDistMap_);
+                else
+                    expand(weights, backwardPq_, backwardPredMap_, backwardDistMap_,
+                           forwardPredMap_, forwardDistMap_);
+            }
+            forwardPq_.clear();
+            backwardPq_.clear();
+            if(distance_ > maxDistance){
+                distance_ = NumericTraits<WeightType>::max();
+                meetingNode_ = lemon::INVALID;
+            }
+            return distance_;
+        }
+
+        /// \brief get the graph
+        const Graph & graph()const{
+            return graph_;
+        }
+        /// \brief get the source node of the last run
+        const Node & source()const{
+            return source_;
+        }
+        /// \brief get the target node of the last run
+        const Node & target()const{
+            return target_;
+        }
+
+        /// \brief check if the last run found a path
+        bool hasPath()const{
+            return meetingNode_!=lemon::INVALID;
+        }
+
+        /// \brief get the length of the path found by the last run
+        ///        (<tt>NumericTraits<WeightType>::max()</tt> if there was none)
+        WeightType distance()const{
+            return distance_;
+        }
+
+        /// \brief get the nodes of the path found by the last run,
+        ///        from source to target (empty if there was none)
+        Path path()const{
+            Path res;
+            if(!hasPath())
+                return res;
+            for(Node n = meetingNode_; n != source_; n = forwardPredMap_[n])
+                res.push_back(n);
+            res.push_back(source_);
+            std::reverse(res.begin(), res.end());
+            for(Node n = meetingNode_; n != target_; ){
+                n = backwardPredMap_[n];
+                res.push_back(n);
+            }
+            return res;
+        }
+
+    private:
+
+        template<class WEIGHTS>
+        void expand(const WEIGHTS & weights, PqType & pq,
+                    PredecessorsMap & predMap, DistanceMap & distMap,
+                    const PredecessorsMap & otherPredMap, const DistanceMap & otherDistMap)
+        {
+            const Node topNode(graph_.nodeFromId(pq.top()));
+            pq.pop();
+            for(OutArcIt outArcIt(graph_,topNode);outArcIt!=lemon::INVALID;++outArcIt){
+                const Node otherNode = graph_.target(*outArcIt);
+                const size_t otherNodeId = graph_.id(otherNode);
+                const WeightType alternativeDist = distMap[topNode]+weights[Edge(*outArcIt)];
+                if(predMap[otherNode]==lemon::INVALID){
+                    pq.push(otherNodeId,alternativeDist);
+                    distMap[otherNode]=alternativeDist;
+                    predMap[otherNode]=topNode;
+                    touched_.push_back(otherNode);
+                }
+                else if(pq.contains(otherNodeId) && alternativeDist<distMap[otherNode]){
+                    pq.push(otherNodeId,alternativeDist);
+                    distMap[otherNode]=alternativeDist;
+                    predMap[otherNode]=topNode;
+                }
+                else{
+                    continue; // no improvement
+                }
+                // the other search has reached this node as well
+                if(otherPredMap[otherNode]!=lemon::INVALID &&
+                   distMap[otherNode]+otherDistMap[otherNode] < distance_){
+                    distance_ = distMap[otherNode]+otherDistMap[otherNode];
+                    meetingNode_ = otherNode;
+                }
+            }
+        }
+
+        void reInitializeMaps(Node const & source, Node const & target){
+            for(unsigned int n=0; n<touched_.size(); ++n){
+                forwardPredMap_[touched_[n]]=lemon::INVALID;
+                backwardPredMap_[touched_[n]]=lemon::INVALID;
+            }
+            touched_.clear();
+            source_=source;
+            target_=target;
+            meetingNode_=lemon::INVALID;
+            distance_=NumericTraits<WeightType>::max();
+
+            forwardDistMap_[source]=static_cast<WeightType>(0.0);
+            forwardPredMap_[source]=source;
+            forwardPq_.push(graph_.id(source),0.0);
+            backwardDistMap_[target]=static_cast<WeightType>(0.0);
+            backwardPredMap_[target]=target;
+            backwardPq_.push(graph_.id(target),0.0);
+            touched_.push_back(source);
+            touched_.push_back(target);
+        }
+
+        const Graph  & graph_;
+        PqType  forwardPq_, backwardPq_;
+        PredecessorsMap forwardPredMap_, backwardPredMap_;
+        DistanceMap     forwardDistMap_, backwardDistMap_;
+        ArrayVector<Node> touched_;
+
+        Node source_;
+        Node target_;
+        Node meetingNode_;
+        WeightType distance_;
+    };
+
+#ifndef VIGRA_SINGLE_THREADED
+    /// \brief answer many point-to-point shortest path queries in parallel
+    ///
+    /// For every <tt>k</tt>, <tt>distances[k]</tt> receives the length of the shortest path
+    /// from <tt>sources[k]</tt> to <tt>targets[k]</tt> (or <tt>NumericTraits<WEIGHT_TYPE>::max()</tt>
+    /// if there is none within \a maxDistance), and <tt>paths[k]</tt> the path's nodes from
+    /// source to target (empty if there is none). The queries are distributed over the
+    /// threads according to \a options, and each thread answers its queries with its own
+    /// \ref BidirectionalShortestPathDijkstra workspace, so that the graph-sized maps are
+    /// allocated only once per thread.
+    template<class GRAPH, class WEIGHTS, class WEIGHT_TYPE>
+    void shortestPathBatch(
+        const GRAPH & graph,
+        const WEIGHTS & weights,
+        const std::vector<typename GRAPH::Node> & sources,
+        const std::vector<typename GRAPH::Node> & targets,
+        std::vector<WEIGHT_TYPE> & distances,
+        std::vector<ArrayVector<typename GRAPH::Node> > & paths,
+        const ParallelOptions & options = ParallelOptions(),
+        WEIGHT_TYPE maxDistance = NumericTraits<WEIGHT_TYPE>::max()
+    ){
+        typedef BidirectionalShortestPathDijkstra<GRAPH, WEIGHT_TYPE> Workspace;
+
+        vigra_precondition(sources.size() == targets.size(),
+            "shortestPathBatch(): number of sources and targets must be equal.");
+        distances.resize(sources.size());
+        paths.resize(sources.size());
+
+        ThreadPool pool(options);
+        std::vector<std::unique_ptr<Workspace> > workspaces(std::max<size_t>(1, pool.nThreads()));
+        parallel_foreach(pool, sources.size(),
+            [&](size_t threadId, size_t k)
+            {
+                if(!workspaces[threadId])
+                    workspaces[threadId].reset(new Workspace(graph));
+                Workspace & sp = *workspaces[threadId];
+                distances[k] = sp.run(weights, sources[k], targets[k], maxDistance);
+                paths[k] = sp.path();
+            }
+        );
+    }
+
+    /// \brief answer many point-to-point shortest path queries in parallel,
+    ///        computing only the path lengths
+    template<class GRAPH, class WEIGHTS, class WEIGHT_TYPE>
+    void shortestPathBatch(
+        const GRAPH & graph,
+        const WEIGHTS & weights,
+        const std::vector<typename GRAPH::Node> & sources,
+        const std::vector<typename GRAPH::Node> & targets,
+        std::vector<WEIGHT_TYPE> & distances,
+        const ParallelOptions & options = ParallelOptions(),
+        WEIGHT_TYPE maxDistance = NumericTraits<WEIGHT_TYPE>::max()
+    ){
+        typedef BidirectionalShortestPathDijkstra<GRAPH, WEIGHT_TYPE> Workspace;
+
+        vigra_precondition(sources.size() == targets.size(),
+            "shortestPathBatch(): number of sources and targets must be equal.");
+        distances.resize(sources.size());
+
+        ThreadPool pool(options);
+        std::vector<std::unique_ptr<Workspace> > workspaces(std::max<size_t>(1, pool.nThreads()));
+        parallel_foreach(pool, sources.size(),
+            [&](size_t threadId, size_t k)
+            {
+                if(!workspaces[threadId])
+                    workspaces[threadId].reset(new Workspace(graph));
+                distances[k] = workspaces[threadId]->run(weights, sources[k], targets[k], maxDistance);
+            }
+        );
+    }
+#endif // VIGRA_SINGLE_THREADED
+
     /// \brief get the length in node units of a path
     template<class NODE,class PREDECESSORS>
     size_t pathLength(
@@ -864,7 +1645,7 @@ namespace vigra{
     /// \brief edge weighted watersheds Segmentataion
     /// 
     /// \param g: input graph
-    /// \param edgeWeights : edge weights / edge indicator
+    /// \param edgeWeights : edge weights / edge indicator (an explicit edge map or e.g. a GridGraphImplicitEdgeMap)
     /// \param seeds : seed must be non empty!
     /// \param[out] labels : resulting  nodeLabeling (not necessarily dense)
     template<class GRAPH,class EDGE_WEIGHTS,class SEEDS,class LABELS>
@@ -904,26 +1685,64 @@ namespace vigra{
         detail_watersheds_segmentation::edgeWeightedWatershedsSegmentationImpl(g,edgeWeights,seeds,fPriority,labels);
     }
 
-    /// \brief edge weighted watersheds Segmentataion
-    /// 
-    /// \param graph: input graph
-    /// \param edgeWeights : edge weights / edge indicator
-    /// \param nodeSizes : size of each node
-    /// \param k : free parameter of felzenszwalb algorithm
-    /// \param[out] nodeLabeling :  nodeLabeling (not necessarily dense)
-    /// \param nodeNumStopCond      : optional stopping condition
+    namespace detail_felzenszwalb_segmentation{
+
+    // the Felzenszwalb merge criterion for a single edge:
+    // merge the regions of u and v if the edge weight does not exceed
+    // the (size-penalized) internal difference of either region
+    template<class GRAPH, class WEIGHT_TYPE, class UFD, class INTERNAL_DIFF, class NODE_SIZE_ACC>
+    bool mergeEdge(
+        const GRAPH &           graph,
+        const typename GRAPH::Edge & e,
+        const WEIGHT_TYPE       w,
+        const float             k,
+        UFD &                   ufdArray,
+        INTERNAL_DIFF &         internalDiff,
+        NODE_SIZE_ACC &         nodeSizeAcc
+    ){
+        typedef typename GRAPH::Node           Node;
+        typedef WEIGHT_TYPE                    WeightType;
+        typedef WEIGHT_TYPE                    NodeSizeType;
+
+        const size_t rui = ufdArray.findIndex(graph.id(graph.u(e)));
+        const size_t rvi = ufdArray.findIndex(graph.id(graph.v(e)));
+        if(rui==rvi)
+            return false;
+        const Node   ru  = graph.nodeFromId(rui);
+        const Node   rv  = graph.nodeFromId(rvi);
+
+        //check if to merge or not ?
+        const NodeSizeType sizeRu    = nodeSizeAcc[ru];
+        const NodeSizeType sizeRv    = nodeSizeAcc[rv];
+        const WeightType tauRu       = static_cast<WeightType>(k)/static_cast<WeightType>(sizeRu);
+        const WeightType tauRv       = static_cast<WeightType>(k)/static_cast<WeightType>(sizeRv);
+        const WeightType minIntDiff  = std::min(internalDiff[ru]+tauRu,internalDiff[rv]+tauRv);
+        if(w<=minIntDiff){
+            // do merge
+            ufdArray.makeUnion(rui,rvi);
+            // update size and internal difference
+            const size_t newRepId = ufdArray.findIndex(rui);
+            const Node newRepNode = graph.nodeFromId(newRepId);
+            internalDiff[newRepNode]=w;
+            nodeSizeAcc[newRepNode] = sizeRu+sizeRv;
+            return true;
+        }
+        return false;
+    }
+
+    // Felzenszwalb segmentation given the edges in ascending weight order
     template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
-    void felzenszwalbSegmentation(
+    void felzenszwalbSegmentationImpl(
         const GRAPH &         graph,
         const EDGE_WEIGHTS &  edgeWeights,
         const NODE_SIZE    &  nodeSizes,
-        float           k,
+        float                 k,
         NODE_LABEL_MAP     &  nodeLabeling,
-        const int             nodeNumStopCond = -1
+        const int             nodeNumStopCond,
+        const std::vector<typename GRAPH::Edge> & sortedEdges
     ){
         typedef GRAPH Graph;
         typedef typename Graph::Edge Edge;
-        typedef typename Graph::Node Node;
 
         typedef typename EDGE_WEIGHTS::Value WeightType;
         typedef typename EDGE_WEIGHTS::Value NodeSizeType;
@@ -936,15 +1755,6 @@ namespace vigra{
         copyNodeMap(graph,nodeSizes,nodeSizeAcc);
         fillNodeMap(graph,internalDiff,static_cast<WeightType>(0.0));
 
-
-
-        // initlaize internal node diff map
-
-        // sort the edges by their weights
-        std::vector<Edge> sortedEdges;
-        std::less<WeightType> comperator;
-        edgeSort(graph,edgeWeights,comperator,sortedEdges);
-
         // make the ufd
         UnionFindArray<UInt64> ufdArray(graph.maxNodeId()+1);
 
@@ -956,30 +1766,8 @@ namespace vigra{
             // iterate over edges is the sorted order
             for(size_t i=0;i<sortedEdges.size();++i){
                 const Edge e  = sortedEdges[i];
-                const size_t rui = ufdArray.findIndex(graph.id(graph.u(e)));
-                const size_t rvi = ufdArray.findIndex(graph.id(graph.v(e)));
-                const Node   ru  = graph.nodeFromId(rui);
-                const Node   rv  = graph.nodeFromId(rvi);
-                if(rui!=rvi){
-
-                    //check if to merge or not ?
-                    const WeightType   w         = edgeWeights[e];
-                    const NodeSizeType sizeRu    = nodeSizeAcc[ru];
-                    const NodeSizeType sizeRv    = nodeSizeAcc[rv];
-                    const WeightType tauRu       = static_cast<WeightType>(k)/static_cast<WeightType>(sizeRu);
-                    const WeightType tauRv       = static_cast<WeightType>(k)/static_cast<WeightType>(sizeRv);
-                    const WeightType minIntDiff  = std::min(internalDiff[ru]+tauRu,internalDiff[rv]+tauRv);
-                    if(w<=minIntDiff){
-                        // do merge
-                        ufdArray.makeUnion(rui,rvi);
-                        --nodeNum;
-                        // update size and internal difference
-                        const size_t newRepId = ufdArray.findIndex(rui);
-                        const Node newRepNode = graph.nodeFromId(newRepId);
-                        internalDiff[newRepNode]=w;
-                        nodeSizeAcc[newRepNode] = sizeRu+sizeRv;
-                    }
-                }
+                if(mergeEdge(graph,e,edgeWeights[e],k,ufdArray,internalDiff,nodeSizeAcc))
+                    --nodeNum;
                 if(nodeNumStopCond >= 0 && nodeNum==static_cast<size_t>(nodeNumStopCond)){
                     break;
                 }
@@ -998,11 +1786,194 @@ namespace vigra{
         }
         ufdArray.makeContiguous();
         for(typename  GRAPH::NodeIt n(graph);n!=lemon::INVALID;++n){
-            const Node node(*n);
+            const typename Graph::Node node(*n);
             nodeLabeling[node]=ufdArray.findLabel(graph.id(node));
         }
+    }
+
+    } // end namespace detail_felzenszwalb_segmentation
+
+    /// \brief edge weighted watersheds Segmentataion
+    /// 
+    /// \param graph: input graph
+    /// \param edgeWeights : edge weights / edge indicator (an explicit edge map or e.g. a GridGraphImplicitEdgeMap)
+    /// \param nodeSizes : size of each node
+    /// \param k : free parameter of felzenszwalb algorithm
+    /// \param[out] nodeLabeling :  nodeLabeling (not necessarily dense)
+    /// \param nodeNumStopCond      : optional stopping condition
+    template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
+    void felzenszwalbSegmentation(
+        const GRAPH &         graph,
+        const EDGE_WEIGHTS &  edgeWeights,
+        const NODE_SIZE    &  nodeSizes,
+        float           k,
+        NODE_LABEL_MAP     &  nodeLabeling,
+        const int             nodeNumStopCond = -1
+    ){
+        typedef typename EDGE_WEIGHTS::Value WeightType;
+
+        // sort the edges by their weights
+        std::vector<typename GRAPH::Edge> sortedEdges;
+        std::less<WeightType> comperator;
+        edgeSort(graph,edgeWeights,comperator,sortedEdges);
+
+        detail_felzenszwalb_segmentation::felzenszwalbSegmentationImpl(
+            graph,edgeWeights,nodeSizes,k,nodeLabeling,nodeNumStopCond,sortedEdges);
     } 
 
+#ifndef VIGRA_SINGLE_THREADED
+    /// \brief felzenszwalb segmentation with parallel edge sorting
+    ///
+    /// Same as the serial version, but the edges are sorted with the parallel
+    /// \ref edgeSort() according to \a options. Since the sorting dominates
+    /// the run time for large graphs, this gives most of the possible speed-up
+    /// while producing the same result for any number of threads.
+    template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
+    void felzenszwalbSegmentation(
+        const GRAPH &         graph,
+        const EDGE_WEIGHTS &  edgeWeights,
+        const NODE_SIZE    &  nodeSizes,
+        float                 k,
+        NODE_LABEL_MAP     &  nodeLabeling,
+        const int             nodeNumStopCond,
+        const ParallelOptions & options
+    ){
+        typedef typename EDGE_WEIGHTS::Value WeightType;
+
+        std::vector<typename GRAPH::Edge> sortedEdges;
+        std::less<WeightType> comperator;
+        edgeSort(graph,edgeWeights,comperator,sortedEdges,options);
+
+        detail_felzenszwalb_segmentation::felzenszwalbSegmentationImpl(
+            graph,edgeWeights,nodeSizes,k,nodeLabeling,nodeNumStopCond,sortedEdges);
+    }
+
+    /// \brief blockwise parallel felzenszwalb segmentation of a GridGraph
+    ///
+    /// The grid is split into blocks of shape \a blockShape. Each block is
+    /// segmented independently (and in parallel) using only the edges inside
+    /// the block. Afterwards, the edges crossing block borders are sorted and
+    /// processed sequentially with the same merge criterion, starting from the
+    /// region sizes and internal differences found in the blocks. The result
+    /// is an approximation of the global algorithm: regions never merge across
+    /// a block border before the blocks themselves are finished.
+    ///
+    /// \param graph: input graph
+    /// \param edgeWeights : edge weights / edge indicator
+    /// \param nodeSizes : size of each node
+    /// \param k : free parameter of felzenszwalb algorithm
+    /// \param[out] nodeLabeling :  nodeLabeling (dense, starting at 0)
+    /// \param blockShape : shape of the blocks that are processed in parallel
+    /// \param options : number of threads
+    template<unsigned int N, class EDGE_WEIGHTS, class NODE_SIZE, class NODE_LABEL_MAP>
+    void felzenszwalbSegmentationBlockwise(
+        const GridGraph<N, boost_graph::undirected_tag> & graph,
+        const EDGE_WEIGHTS &  edgeWeights,
+        const NODE_SIZE    &  nodeSizes,
+        float                 k,
+        NODE_LABEL_MAP     &  nodeLabeling,
+        const typename MultiArrayShape<N>::type & blockShape,
+        const ParallelOptions & options = ParallelOptions()
+    ){
+        typedef GridGraph<N, boost_graph::undirected_tag> Graph;
+        typedef typename Graph::Edge            Edge;
+        typedef typename Graph::Node            Node;
+        typedef typename Graph::shape_type      Shape;
+        typedef typename EDGE_WEIGHTS::Value    WeightType;
+        typedef typename EDGE_WEIGHTS::Value    NodeSizeType;
+        typedef typename Graph:: template NodeMap<WeightType>   NodeIntDiffMap;
+        typedef typename Graph:: template NodeMap<NodeSizeType> NodeSizeAccMap;
+        typedef std::pair<WeightType, size_t>   Key;
+
+        vigra_precondition(allGreater(blockShape, Shape(0)),
+            "felzenszwalbSegmentationBlockwise(): blockShape must be positive.");
+
+        NodeIntDiffMap internalDiff(graph);
+        NodeSizeAccMap nodeSizeAcc(graph);
+        copyNodeMap(graph,nodeSizes,nodeSizeAcc);
+        fillNodeMap(graph,internalDiff,static_cast<WeightType>(0.0));
+
+        // node ids of different blocks are disjoint, so the blocks
+        // can work on the same union-find array concurrently
+        UnionFindArray<UInt64> ufdArray(graph.maxNodeId()+1);
+
+        const Shape shape = graph.shape();
+        const Shape blocksPerAxis = (shape + blockShape - Shape(1)) / blockShape;
+        const size_t blockCount = prod(blocksPerAxis);
+
+        ThreadPool pool(options);
+        std::vector<std::vector<Edge> > borderEdges(blockCount);
+
+        parallel_foreach(pool, blockCount,
+            [&](size_t /*threadId*/, size_t blockIndex)
+            {
+                Shape blockCoord;
+                size_t rest = blockIndex;
+                for(unsigned int d=0; d<N; ++d){
+                    blockCoord[d] = rest % blocksPerAxis[d];
+                    rest /= blocksPerAxis[d];
+                }
+                const Shape blockBegin = blockCoord * blockShape;
+                const Shape blockEnd   = min(blockBegin + blockShape, shape);
+
+                // collect the inner edges (with their weights) and the border edges
+                // (every edge is attributed to the block of its u node)
+                std::vector<Edge> innerEdges;
+                std::vector<Key>  keys;
+                MultiCoordinateIterator<N> c(blockEnd - blockBegin), cend = c.getEndIterator();
+                for(; c != cend; ++c){
+                    const Node u = blockBegin + *c;
+                    for(MultiArrayIndex i=0; i<(MultiArrayIndex)graph.maxUniqueDegree(); ++i){
+                        const Node v = u + graph.neighborOffset(i);
+                        if(!allGreaterEqual(v, Shape(0)) || !allLess(v, shape))
+                            continue;
+                        Edge e;
+                        e.template subarray<0,N>() = u;
+                        e[N] = i;
+                        if(allGreaterEqual(v, blockBegin) && allLess(v, blockEnd)){
+                            keys.push_back(Key(edgeWeights[e], innerEdges.size()));
+                            innerEdges.push_back(e);
+                        }
+                        else{
+                            borderEdges[blockIndex].push_back(e);
+                        }
+                    }
+                }
+
+                std::sort(keys.begin(), keys.end(),
+                          detail_graph_algorithms::WeightIndexCompare<std::less<WeightType> >(std::less<WeightType>()));
+                for(size_t i=0; i<keys.size(); ++i)
+                    detail_felzenszwalb_segmentation::mergeEdge(graph, innerEdges[keys[i].second], keys[i].first,
+                                                                k, ufdArray, internalDiff, nodeSizeAcc);
+            }
+        );
+
+        // merge across the block borders
+        std::vector<Edge> edges;
+        for(size_t b=0; b<blockCount; ++b)
+            edges.insert(edges.end(), borderEdges[b].begin(), borderEdges[b].end());
+        std::vector<Key> keys(edges.size());
+        parallel_foreach(pool, edges.size(),
+            [&](size_t /*threadId*/, size_t i)
+            {
+                keys[i] = Key(edgeWeights[edges[i]], i);
+            }
+        );
+        std::less<WeightType> comperator;
+        detail_graph_algorithms::parallelSort(keys,
+            detail_graph_algorithms::WeightIndexCompare<std::less<WeightType> >(comperator), pool);
+        for(size_t i=0; i<keys.size(); ++i)
+            detail_felzenszwalb_segmentation::mergeEdge(graph, edges[keys[i].second], keys[i].first,
+                                                        k, ufdArray, internalDiff, nodeSizeAcc);
+
+        ufdArray.makeContiguous();
+        for(typename Graph::NodeIt n(graph);n!=lemon::INVALID;++n){
+            const Node node(*n);
+            nodeLabeling[node]=ufdArray.findLabel(graph.id(node));
+        }
+    }
+#endif // VIGRA_SINGLE_THREADED
+
 
 
 
@@ -37,8 +37,12 @@
 #ifndef VIGRA_GRAPH_MAPS
 #define VIGRA_GRAPH_MAPS
 
+/*std*/
+#include <algorithm>
+
 /*vigra*/
 #include "multi_array.hxx"
+#include "array_vector.hxx"
 #include "graph_generalization.hxx"
 #include "graphs.hxx"
 
@@ -262,6 +266,7 @@ class ZeroNodeMap
 
 template<class T_OUT>
 struct MeanFunctor{
+    typedef T_OUT result_type;
     template<class T>
     T_OUT operator()(const T & a, const T & b)const{
         return static_cast<T_OUT>(a+b)/static_cast<T_OUT>(2.0);
@@ -269,6 +274,34 @@ struct MeanFunctor{
 
 };
 
+template<class T_OUT>
+struct MaxFunctor{
+    typedef T_OUT result_type;
+    template<class T>
+    T_OUT operator()(const T & a, const T & b)const{
+        return static_cast<T_OUT>(std::max(a,b));
+    }
+};
+
+template<class T_OUT>
+struct MinFunctor{
+    typedef T_OUT result_type;
+    template<class T>
+    T_OUT operator()(const T & a, const T & b)const{
+        return static_cast<T_OUT>(std::min(a,b));
+    }
+};
+
+// absolute difference of scalars, norm of the difference of vectors
+template<class T_OUT>
+struct AbsDifferenceFunctor{
+    typedef T_OUT result_type;
+    template<class T>
+    T_OUT operator()(const T & a, const T & b)const{
+        return static_cast<T_OUT>(norm(a-b));
+    }
+};
+
 
 // implicit edge map:
 // the values of a node map are converted
@@ -318,6 +351,77 @@ private:
 };
 
 
+// implicit edge map of a GridGraph:
+// the edge value is computed on the fly by applying
+// FUNCTOR to the entries of a node array at the edge's
+// two end points. In contrast to OnTheFlyEdgeMap2,
+// the end points are not constructed explicitly, but
+// addressed by precomputed memory offsets, which makes
+// the map about as fast as an explicit GridGraph::EdgeMap
+// while requiring no memory per edge.
+template<unsigned int N,class DIRECTED_TAG,class T,class STRIDE,class FUNCTOR,
+         class RESULT = typename FUNCTOR::result_type>
+class GridGraphImplicitEdgeMap{
+
+public:
+    typedef GridGraph<N,DIRECTED_TAG> Graph;
+    typedef typename Graph::Node      Node;
+    typedef typename  Graph::Edge     Key;
+    typedef MultiArrayView<N,T,STRIDE> NodeArray;
+    typedef RESULT   Value;
+    typedef RESULT   ConstReference;
+
+    typedef Key             key_type;
+    typedef Value           value_type;
+    typedef ConstReference  const_reference;
+
+    typedef boost_graph::readable_property_map_tag category;
+
+    GridGraphImplicitEdgeMap(const Graph & graph,const NodeArray & nodeArray,FUNCTOR f = FUNCTOR())
+    :   graph_(graph),
+        nodeArray_(nodeArray),
+        neighborOffsets_(graph.maxDegree()),
+        f_(f)
+    {
+        vigra_precondition(nodeArray.shape() == graph.shape(),
+            "GridGraphImplicitEdgeMap(): shape mismatch between graph and node array.");
+        for(size_t i=0; i<neighborOffsets_.size(); ++i)
+            neighborOffsets_[i] = dot(graph.neighborOffset(i), nodeArray.stride());
+    }
+
+    ConstReference operator[](const Key & key)const{
+        const T * u = nodeArray_.data() + dot(key.template subarray<0,N>(), nodeArray_.stride());
+        return f_(*u, u[neighborOffsets_[key[N]]]);
+    }
+
+    const Graph & graph()const{
+        return graph_;
+    }
+
+    const NodeArray & nodeArray()const{
+        return nodeArray_;
+    }
+private:
+
+    const Graph & graph_;
+    NodeArray nodeArray_;
+    ArrayVector<MultiArrayIndex> neighborOffsets_;
+    FUNCTOR  f_;
+};
+
+// create an implicit edge map of a GridGraph,
+// e.g. makeImplicitEdgeMap(graph, image, MaxFunctor<float>()).
+// nodeArray may also be a MultiArray or a GridGraph::NodeMap,
+// which must outlive the returned map.
+template<unsigned int N,class DIRECTED_TAG,class T,class STRIDE,class FUNCTOR>
+inline GridGraphImplicitEdgeMap<N,DIRECTED_TAG,T,STRIDE,FUNCTOR>
+makeImplicitEdgeMap(const GridGraph<N,DIRECTED_TAG> & graph,
+                    const MultiArrayView<N,T,STRIDE> & nodeArray,
+                    FUNCTOR f){
+    return GridGraphImplicitEdgeMap<N,DIRECTED_TAG,T,STRIDE,FUNCTOR>(graph,nodeArray,f);
+}
+
+
 // convert 2 edge maps with a functor into a single edge map
 template<class G,class EDGE_MAP_A,class EDGE_MAP_B,class FUNCTOR,class RESULT>
 class BinaryOpEdgeMap{
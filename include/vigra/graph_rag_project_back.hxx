@@ -55,6 +55,7 @@
 #include "union_find.hxx"
 #include "adjacency_list_graph.hxx"
 #include "graph_maps.hxx"
+#include "threadpool.hxx"
 
 
 
@@ -78,7 +79,8 @@ namespace vigra{
             const Int64 ignoreLabel,
             const BASE_GRAPH_LABELS bgLabels,
             const RAG_FEATURES & ragFeatures,
-            BASE_GRAPH_FEATURES & bgFeatures
+            BASE_GRAPH_FEATURES & bgFeatures,
+            const ParallelOptions & /*options*/
         ){
             typedef BASE_GRAPH Bg;
             typedef typename Bg::NodeIt BgNodeIt;
@@ -120,7 +122,8 @@ namespace vigra{
             const Int64 ignoreLabel,
             const BASE_GRAPH_LABELS bgLabels,
             const RAG_FEATURES & ragFeatures,
-            BASE_GRAPH_FEATURES & bgFeatures
+            BASE_GRAPH_FEATURES & bgFeatures,
+            const ParallelOptions & options
         ){
             typedef BASE_GRAPH Bg;
             typedef typename Bg::Node BgNode;
@@ -128,32 +131,20 @@ namespace vigra{
 
             vigra::TinyVector<Int64, 3> shape = bg.shape();
 
-
-            if(ignoreLabel==-1){
-                
-// FIXME: replace with threadpool                #pragma omp parallel for
-                for(Int64 z=0; z<shape[2]; ++z){    
-                    BgNode node;
-                    node[2]=z;
-                    for(node[1]=0; node[1]<shape[1]; ++node[1])  
-                    for(node[0]=0; node[0]<shape[0]; ++node[0]){
-                        bgFeatures[node] = ragFeatures[rag.nodeFromId(bgLabels[node])];
-                    }  
-                }
-
-            }
-            else{
-// FIXME: replace with threadpool                #pragma omp parallel for
-                for(Int64 z=0; z<shape[2]; ++z){    
+            // every slice writes distinct base graph nodes,
+            // so the slices can be processed independently
+            parallel_foreach(options.getNumThreads(), shape[2],
+                [&](size_t /*thread_id*/, Int64 z)
+                {
                     BgNode node;
                     node[2]=z;
-                    for(node[1]=0; node[1]<shape[1]; ++node[1])  
+                    for(node[1]=0; node[1]<shape[1]; ++node[1])
                     for(node[0]=0; node[0]<shape[0]; ++node[0]){
-                        if(static_cast<Int64>(bgLabels[node])!=ignoreLabel)
+                        if(ignoreLabel==-1 || static_cast<Int64>(bgLabels[node])!=ignoreLabel)
                             bgFeatures[node] = ragFeatures[rag.nodeFromId(bgLabels[node])];
-                    }  
+                    }
                 }
-            }
+            );
         }
     };
 
@@ -166,7 +157,9 @@ namespace vigra{
     /// graph back to the base graph.
     ///
     /// This function can be used to show a segmentation
-    /// or node features of RAG on pixel / voxel level
+    /// or node features of RAG on pixel / voxel level.
+    /// For 3D grid graphs, the slices can be processed
+    /// in parallel according to \a options (default: sequentially).
     template< class BASE_GRAPH,
                 class BASE_GRAPH_LABELS,
                 class RAG_FEATURES,
@@ -178,11 +171,12 @@ namespace vigra{
             const Int64 ignoreLabel,
             const BASE_GRAPH_LABELS bgLabels,
             const RAG_FEATURES & ragFeatures,
-            BASE_GRAPH_FEATURES & bgFeatures
+            BASE_GRAPH_FEATURES & bgFeatures,
+            const ParallelOptions & options = ParallelOptions().numThreads(ParallelOptions::NoThreads)
     ){
         using namespace detail_rag_project_back;
         detail_rag_project_back::RagProjectBack< BASE_GRAPH,BASE_GRAPH_LABELS,RAG_FEATURES,BASE_GRAPH_FEATURES>::projectBack(rag,
-            bg,ignoreLabel,bgLabels,ragFeatures,bgFeatures);
+            bg,ignoreLabel,bgLabels,ragFeatures,bgFeatures,options);
     }
 
 
@@ -39,6 +39,9 @@
 #include <string>
 #include <algorithm>
 #include <utility>
+#include <map>
+#include <vector>
+#include <cstring>
 
 #define H5Gcreate_vers 2
 #define H5Gopen_vers 2
@@ -74,12 +77,29 @@
 # include <hdf5_hl.h>
 #endif
 
+#define VIGRA_HDF5_VERSION_GE(maj, min, rel) \
+    (H5_VERS_MAJOR > maj || (H5_VERS_MAJOR == maj && \
+        (H5_VERS_MINOR > min || (H5_VERS_MINOR == min && H5_VERS_RELEASE >= rel))))
+
+// H5Pset_chunk_cache()
+#if VIGRA_HDF5_VERSION_GE(1, 8, 3)
+# define VIGRA_HDF5_CHUNK_CACHE
+#endif
+// H5Dread_chunk(), H5Dwrite_chunk(), H5Dget_chunk_storage_size()
+#if VIGRA_HDF5_VERSION_GE(1, 10, 3)
+# define VIGRA_HDF5_DIRECT_CHUNK_IO
+#endif
+
 #include "impex.hxx"
 #include "multi_array.hxx"
 #include "multi_iterator_coupled.hxx"
 #include "multi_impex.hxx"
 #include "utilities.hxx"
 #include "error.hxx"
+#include "compression.hxx"
+#ifndef VIGRA_SINGLE_THREADED
+# include "threadpool.hxx"
+#endif
 
 #if defined(_MSC_VER)
 #  include <io.h>
@@ -920,6 +940,148 @@ inline hid_t getH5DataType<FFTWComplex<double> >()
 }
 #endif
 
+    // properties of a dataset that determine if its chunks
+    // can be transferred by direct chunk I/O
+struct HDF5ChunkLayout
+{
+    HDF5ChunkLayout()
+    : direct_io(false),
+      deflate_level(-1)
+    {}
+
+    bool direct_io;
+    int deflate_level;                         // -1: uncompressed
+    ArrayVector<MultiArrayIndex> shape;        // VIGRA order, without band axis
+    ArrayVector<MultiArrayIndex> chunk_shape;  // VIGRA order, without band axis
+};
+
+    // vigra::compress() and vigra::uncompress() support 'zlib'
+    // if and only if VIGRA was compiled with ZLIB
+inline bool hdf5ZlibAvailable()
+{
+    static const bool available = []()
+    {
+        try
+        {
+            std::vector<char> buffer;
+            char data = 0;
+            compress(&data, 1, buffer, ZLIB_FAST);
+            return true;
+        }
+        catch(PreconditionViolation &)
+        {
+            return false;
+        }
+    }();
+    return available;
+}
+
+    // Direct chunk I/O requires chunked datasets whose data need no
+    // type conversion and which are either uncompressed or use 'zlib'
+    // as their only filter.
+inline HDF5ChunkLayout
+hdf5ChunkLayout(hid_t dataset, hid_t memoryType, int numBands)
+{
+    HDF5ChunkLayout layout;
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+    HDF5Handle plist(H5Dget_create_plist(dataset), &H5Pclose,
+                     "hdf5ChunkLayout(): failed to get property list.");
+    if(H5Pget_layout(plist) != H5D_CHUNKED)
+        return layout;
+
+    HDF5Handle dataspace(H5Dget_space(dataset), &H5Sclose,
+                         "hdf5ChunkLayout(): unable to access dataspace.");
+    int dimensions = H5Sget_simple_extent_ndims(dataspace);
+    int N = numBands > 1 ? dimensions - 1 : dimensions;
+    if(N < 1)
+        return layout;
+    ArrayVector<hsize_t> fileShape(dimensions), fileChunks(dimensions);
+    H5Sget_simple_extent_dims(dataspace, fileShape.data(), NULL);
+    if(H5Pget_chunk(plist, dimensions, fileChunks.data()) != dimensions)
+        return layout;
+    // the band axis must not be split into several chunks
+    if(numBands > 1 && (fileShape[N] != (hsize_t)numBands || fileChunks[N] != (hsize_t)numBands))
+        return layout;
+
+    HDF5Handle fileType(H5Dget_type(dataset), &H5Tclose,
+                        "hdf5ChunkLayout(): failed to get data type.");
+    if(H5Tequal(fileType, memoryType) <= 0)
+        return layout;
+
+    int filters = H5Pget_nfilters(plist);
+    if(filters == 1)
+    {
+        unsigned int flags = 0, values[4] = {0, 0, 0, 0};
+        std::size_t nvalues = 4;
+        char name[64];
+        if(H5Pget_filter2(plist, 0, &flags, &nvalues, values, 64, name, 0) != H5Z_FILTER_DEFLATE ||
+           !hdf5ZlibAvailable())
+            return layout;
+        layout.deflate_level = nvalues > 0 ? (int)values[0] : (int)ZLIB;
+    }
+    else if(filters != 0)
+    {
+        return layout;
+    }
+
+    layout.shape.resize(N);
+    layout.chunk_shape.resize(N);
+    for(int k=0; k<N; ++k)
+    {
+        layout.shape[k] = (MultiArrayIndex)fileShape[N-1-k];
+        layout.chunk_shape[k] = (MultiArrayIndex)fileChunks[N-1-k];
+    }
+    layout.direct_io = true;
+#endif
+    return layout;
+}
+
+    // undo the filters of a chunk obtained by HDF5File::readChunkRaw(),
+    // 'dest' must have room for a complete chunk of 'bytes' bytes
+inline void
+hdf5DecodeChunk(std::vector<char> const & raw, unsigned int filterMask,
+                int deflateLevel, char * dest, std::size_t bytes)
+{
+    if(deflateLevel >= 0 && (filterMask & 1) == 0)
+    {
+        uncompress(raw.data(), raw.size(), dest, bytes, ZLIB);
+    }
+    else
+    {
+        vigra_postcondition(raw.size() == bytes,
+            "hdf5DecodeChunk(): stored chunk has unexpected size.");
+        std::memcpy(dest, raw.data(), bytes);
+    }
+}
+
+    // starting points of all chunks intersecting the block [begin, end)
+template <class Shape>
+void
+hdf5ChunksInBlock(Shape const & begin, Shape const & end,
+                  Shape const & chunkShape, ArrayVector<Shape> & chunks)
+{
+    Shape first = begin / chunkShape,
+          last  = (end + chunkShape - Shape(1)) / chunkShape;
+    MultiCoordinateIterator<Shape::static_size> i(last - first),
+                                                iend = i.getEndIterator();
+    for(; i != iend; ++i)
+        chunks.push_back((first + *i) * chunkShape);
+}
+
+    // apply the 'zlib' filter to a complete chunk before HDF5File::writeChunkRaw()
+inline void
+hdf5EncodeChunk(char const * src, std::size_t bytes,
+                int deflateLevel, std::vector<char> & dest)
+{
+    // vigra::compress() only knows some of the zlib levels
+    CompressionMethod method = (deflateLevel == ZLIB_NONE || deflateLevel == ZLIB_FAST ||
+                                deflateLevel == ZLIB_BEST)
+                                   ? (CompressionMethod)deflateLevel
+                                   : ZLIB;
+    // compress() inserts at the front of 'dest'
+    dest.clear();
+    compress(src, bytes, dest, method);
+}
 
 } // namespace detail
 
@@ -933,6 +1095,12 @@ VIGRA_EXPORT H5O_type_t HDF5_get_type(hid_t, const char*);
 extern "C" VIGRA_EXPORT herr_t HDF5_ls_inserter_callback(hid_t, const char*, const H5L_info_t*, void*);
 extern "C" VIGRA_EXPORT herr_t HDF5_listAttributes_inserter_callback(hid_t, const char*, const H5A_info_t*, void*);
 
+// filter id of LZ4 compression in the HDF5 filter registry
+#define VIGRA_H5Z_FILTER_LZ4 32004
+
+// register VIGRA's LZ4 filter with the HDF5 library, returns false on failure
+VIGRA_EXPORT bool HDF5_register_lz4_filter();
+
 /********************************************************/
 /*                                                      */
 /*                     HDF5File                         */
@@ -985,6 +1153,16 @@ class HDF5File
 
     bool read_only_;
 
+    // raw data chunk cache settings used when opening a dataset
+    struct ChunkCacheSettings
+    {
+        std::size_t nbytes, nslots;
+        double w0;
+    };
+
+    // absolute dataset path => settings, "" => default for all datasets
+    std::map<std::string, ChunkCacheSettings> chunk_cache_settings_;
+
     // helper classes for ls() and listAttributes()
     struct ls_closure
     {
@@ -1040,6 +1218,17 @@ class HDF5File
                           //                           Open otherwise
     };
 
+        /** \brief Flags that can be combined with the compression parameter.
+
+            <tt>Shuffle</tt> enables HDF5's shuffle filter, which stores corresponding bytes
+            of multi-byte elements together before compression (e.g.
+            <tt>LZ4 | HDF5File::Shuffle</tt>). This usually improves the compression
+            ratio of numeric data considerably.
+        */
+    enum CompressionFlags {
+        Shuffle = 0x100
+    };
+
         /** \brief Default constructor.
 
         A file can later be opened via the open() function. Time tagging of datasets is disabled.
@@ -1102,6 +1291,8 @@ class HDF5File
       read_only_(read_only)
 
     {
+        HDF5_register_lz4_filter();
+
         // get group handle for given pathname
         // calling openCreateGroup_ without setting a valid cGroupHandle does
         // not work. Starting from root() is a safe bet.
@@ -1126,7 +1317,8 @@ class HDF5File
     HDF5File(HDF5File const & other)
     : fileHandle_(other.fileHandle_),
       track_time(other.track_time),
-      read_only_(other.read_only_)
+      read_only_(other.read_only_),
+      chunk_cache_settings_(other.chunk_cache_settings_)
     {
         cGroupHandle_ = HDF5Handle(openCreateGroup_(other.currentGroupName_()), &H5Gclose,
                                    "HDF5File(HDF5File const &): Failed to open group.");
@@ -1157,6 +1349,7 @@ class HDF5File
                                        "HDF5File::operator=(): Failed to open group.");
             track_time = other.track_time;
             read_only_ = other.read_only_;
+            chunk_cache_settings_ = other.chunk_cache_settings_;
         }
         return *this;
     }
@@ -1187,6 +1380,7 @@ class HDF5File
     void open(std::string filePath, OpenMode mode)
     {
         close();
+        HDF5_register_lz4_filter();
 
         std::string errorMessage = "HDF5File.open(): Could not open or create file '" + filePath + "'.";
         fileHandle_ = HDF5HandleShared(createFile_(filePath, mode), &H5Fclose, errorMessage.c_str());
@@ -1453,6 +1647,54 @@ class HDF5File
         return shape;
     }
 
+        /** \brief Set the size of the raw data chunk cache of a dataset.
+
+            HDF5 caches recently used chunks of every open dataset, by default in 1 MB
+            per dataset. When a block is read or written that covers chunks larger
+            than the cache (or more chunks than fit into it), the same chunk is
+            decompressed repeatedly. A cache that holds all chunks touched by a single
+            access avoids this.
+
+            The settings apply whenever \a datasetName is opened afterwards (handles
+            that are already open are not affected). If \a datasetName is empty, they
+            become the default for all datasets without specific settings.
+
+            \a nbytes is the cache size in bytes (0 disables the cache), \a nslots the number
+            of hash table slots (ideally a prime about 100 times the number of chunks
+            fitting into the cache; 0 chooses the slots in proportion to \a nbytes), and
+            \a w0 the preemption policy: with 1.0, chunks that have been completely read
+            or written are evicted first.
+
+            Has no effect when VIGRA is compiled against HDF5 prior to version 1.8.3.
+        */
+    void setChunkCache(std::string datasetName, std::size_t nbytes,
+                       std::size_t nslots = 0, double w0 = 0.75)
+    {
+        vigra_precondition(w0 >= 0.0 && w0 <= 1.0,
+            "HDF5File::setChunkCache(): w0 must be in [0, 1].");
+        if(datasetName != "")
+            datasetName = get_absolute_path(datasetName);
+        if(nslots == 0)
+        {
+            // keep the slot density of HDF5's default (521 slots per MB)
+            nslots = std::max<std::size_t>(521, nbytes / 2011);
+            while(!isPrime_(nslots))
+                ++nslots;
+        }
+        ChunkCacheSettings settings = { nbytes, nslots, w0 };
+        chunk_cache_settings_[datasetName] = settings;
+    }
+
+        /** \brief Remove the chunk cache settings of a dataset (or the default
+            settings if \a datasetName is empty), reverting to HDF5's defaults.
+        */
+    void resetChunkCache(std::string datasetName = "")
+    {
+        if(datasetName != "")
+            datasetName = get_absolute_path(datasetName);
+        chunk_cache_settings_.erase(datasetName);
+    }
+
         /** Query the pixel type of the dataset.
 
             Possible values are:
@@ -1777,7 +2019,10 @@ class HDF5File
             Compression can be activated by setting
             \code compression = parameter; // 0 \< parameter \<= 9
             \endcode
-            where 0 stands for no compression and 9 for maximum compression.
+            where 0 stands for no compression and 9 for maximum compression
+            with 'zlib'. Pass <tt>LZ4</tt> to select the much faster LZ4 filter, and add
+            <tt>HDF5File::Shuffle</tt> (e.g. <tt>LZ4 | HDF5File::Shuffle</tt>) to group
+            the bytes of multi-byte elements before compression.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -1809,7 +2054,10 @@ class HDF5File
             Compression can be activated by setting
             \code compression = parameter; // 0 \< parameter \<= 9
             \endcode
-            where 0 stands for no compression and 9 for maximum compression.
+            where 0 stands for no compression and 9 for maximum compression
+            with 'zlib'. Pass <tt>LZ4</tt> to select the much faster LZ4 filter, and add
+            <tt>HDF5File::Shuffle</tt> (e.g. <tt>LZ4 | HDF5File::Shuffle</tt>) to group
+            the bytes of multi-byte elements before compression.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -1863,6 +2111,26 @@ class HDF5File
                            TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
     }
 
+#ifndef VIGRA_SINGLE_THREADED
+        /** \brief Write a multi array into a larger volume, compressing the chunks in parallel.
+
+            When the dataset is chunked, needs no type conversion, and is either
+            uncompressed or 'zlib' compressed, the chunks covered by the block are
+            assembled and compressed concurrently on <tt>options.getNumThreads()</tt>
+            threads and then stored by \ref writeChunkRaw(). Chunks that are only
+            partially covered by the block are read and decompressed first. Since the
+            HDF5 library is not thread-safe, all calls into HDF5 are serialized.
+            Otherwise, this is equivalent to the serial version of writeBlock().
+
+            Returns a negative value when a call to HDF5 failed.
+        */
+    template<unsigned int N, class T, class Stride>
+    herr_t writeBlock(HDF5HandleShared dataset,
+                      typename MultiArrayShape<N>::type blockOffset,
+                      const MultiArrayView<N, T, Stride> & array,
+                      ParallelOptions const & options);
+#endif
+
     // non-scalar (TinyVector) and unstrided multi arrays
     template<unsigned int N, class T, int SIZE, class Stride>
     inline void write(std::string datasetName,
@@ -1895,7 +2163,10 @@ class HDF5File
             Compression can be activated by setting
             \code compression = parameter; // 0 \< parameter \<= 9
             \endcode
-            where 0 stands for no compression and 9 for maximum compression.
+            where 0 stands for no compression and 9 for maximum compression
+            with 'zlib'. Pass <tt>LZ4</tt> to select the much faster LZ4 filter, and add
+            <tt>HDF5File::Shuffle</tt> (e.g. <tt>LZ4 | HDF5File::Shuffle</tt>) to group
+            the bytes of multi-byte elements before compression.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -2088,6 +2359,116 @@ class HDF5File
                           TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
     }
 
+#ifndef VIGRA_SINGLE_THREADED
+        /** \brief Read a block of data into a multi array, decompressing the chunks in parallel.
+
+            When the dataset is chunked, needs no type conversion, and is either
+            uncompressed or 'zlib' compressed, the chunks intersecting the block
+            are fetched by \ref readChunkRaw() and decompressed concurrently on
+            <tt>options.getNumThreads()</tt> threads. Since the HDF5 library is
+            not thread-safe, only the decompression and copying run in parallel,
+            whereas all calls into HDF5 are serialized. Otherwise, this is
+            equivalent to the serial version of readBlock().
+
+            Returns a negative value when a call to HDF5 failed.
+        */
+    template<unsigned int N, class T, class Stride>
+    herr_t readBlock(HDF5HandleShared dataset,
+                     typename MultiArrayShape<N>::type blockOffset,
+                     typename MultiArrayShape<N>::type blockShape,
+                     MultiArrayView<N, T, Stride> array,
+                     ParallelOptions const & options);
+#endif
+
+        /** \brief Read a single chunk of a dataset as stored in the file.
+
+            \a chunkStart is the coordinate (in VIGRA axis order, without the band
+            axis of multi-band datasets) of the chunk's first element and must be
+            a multiple of the dataset's chunk shape. On return, \a data holds the
+            chunk exactly as stored, i.e. still compressed if the dataset uses
+            filters, and bit <tt>i</tt> of \a filterMask is set when filter <tt>i</tt> of
+            the dataset's pipeline was skipped for this chunk. \a data is empty when
+            the chunk has never been written (it then contains the fill value).
+
+            This bypasses the chunk cache, the filter pipeline and datatype
+            conversion, so that chunk-aligned access avoids all of HDF5's
+            internal copies. Returns the result of the internal call to
+            <tt>H5Dread_chunk()</tt>, or -1 when VIGRA is compiled against
+            HDF5 prior to version 1.10.3.
+        */
+    template<int N>
+    herr_t readChunkRaw(HDF5HandleShared dataset,
+                        TinyVector<MultiArrayIndex, N> const & chunkStart,
+                        std::vector<char> & data,
+                        unsigned int & filterMask) const
+    {
+        data.clear();
+        filterMask = 0;
+    #ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        ArrayVector<hsize_t> offset = chunkOffset_(dataset, chunkStart);
+        if(offset.size() == 0)
+            return -1;
+        hsize_t size = 0;
+    #if VIGRA_HDF5_VERSION_GE(1, 10, 5)
+        haddr_t address = HADDR_UNDEF;
+        unsigned int storedMask = 0;
+        herr_t status = H5Dget_chunk_info_by_coord(dataset, offset.data(), &storedMask, &address, &size);
+        if(status < 0)
+            return status;
+        if(address == HADDR_UNDEF || size == 0)
+            return 0; // chunk not allocated
+    #else
+        herr_t status = 0;
+        // fails when the chunk is not allocated
+        H5E_BEGIN_TRY
+        {
+            status = H5Dget_chunk_storage_size(dataset, offset.data(), &size);
+        }
+        H5E_END_TRY
+        if(status < 0 || size == 0)
+            return 0;
+    #endif
+        data.resize(size);
+        uint32_t mask = 0;
+        status = H5Dread_chunk(dataset, H5P_DEFAULT, offset.data(), &mask, &data[0]);
+        filterMask = mask;
+        if(status < 0)
+            data.clear();
+        return status;
+    #else
+        return -1;
+    #endif
+    }
+
+        /** \brief Write a single chunk of a dataset as it is to be stored in the file.
+
+            \a data must already be processed by the dataset's filter pipeline (e.g.
+            compressed), except for the filters whose bits are set in \a filterMask.
+            Uncompressed chunks at the upper border of the dataset must nevertheless
+            have the full chunk size. See \ref readChunkRaw() for the meaning of
+            \a chunkStart.
+
+            Returns the result of the internal call to <tt>H5Dwrite_chunk()</tt>,
+            or -1 when VIGRA is compiled against HDF5 prior to version 1.10.3.
+        */
+    template<int N>
+    herr_t writeChunkRaw(HDF5HandleShared dataset,
+                         TinyVector<MultiArrayIndex, N> const & chunkStart,
+                         char const * data, std::size_t size,
+                         unsigned int filterMask = 0)
+    {
+        vigra_precondition(!isReadOnly(),
+            "HDF5File::writeChunkRaw(): file is read-only.");
+    #ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        ArrayVector<hsize_t> offset = chunkOffset_(dataset, chunkStart);
+        if(offset.size() == 0)
+            return -1;
+        return H5Dwrite_chunk(dataset, H5P_DEFAULT, filterMask, offset.data(), size, data);
+    #else
+        return -1;
+    #endif
+    }
+
     // non-scalar (TinyVector) and unstrided target MultiArrayView
     template<unsigned int N, class T, int SIZE, class Stride>
     inline void read(std::string datasetName, MultiArrayView<N, TinyVector<T, SIZE>, Stride> array)
@@ -2187,7 +2568,10 @@ class HDF5File
             Compression can be activated by setting
             \code compression = parameter; // 0 \< parameter \<= 9
             \endcode
-            where 0 stands for no compression and 9 for maximum compression. If
+            where 0 stands for no compression and 9 for maximum compression
+            with 'zlib'. Pass <tt>LZ4</tt> to select the much faster LZ4 filter, and add
+            <tt>HDF5File::Shuffle</tt> (e.g. <tt>LZ4 | HDF5File::Shuffle</tt>) to group
+            the bytes of multi-byte elements before compression. If
             a non-zero compression level is specified, but the chunk size is zero,
             a default chunk size will be chosen (compression always requires chunks).
 
@@ -2271,6 +2655,29 @@ class HDF5File
         }
     };
 
+        /* add the filters requested by 'compression' to a dataset creation property list
+         */
+    static void setFilters_(hid_t plist, int compression)
+    {
+        if(compression <= 0)
+            return;
+        int method = compression & ~(int)Shuffle;
+        if(compression & Shuffle)
+            H5Pset_shuffle(plist);
+        if(method == LZ4)
+        {
+            vigra_precondition(HDF5_register_lz4_filter(),
+                "HDF5File: unable to register the LZ4 filter.");
+            H5Pset_filter(plist, VIGRA_H5Z_FILTER_LZ4, H5Z_FLAG_MANDATORY, 0, NULL);
+        }
+        else if(method > 0)
+        {
+            vigra_precondition(method <= ZLIB_BEST,
+                "HDF5File: unsupported compression method.");
+            H5Pset_deflate(plist, method);
+        }
+    }
+
     template <class Shape>
     ArrayVector<hsize_t>
     defineChunks(Shape chunks, Shape const & shape, int numBands, int compression = 0)
@@ -2545,9 +2952,53 @@ class HDF5File
         // Open parent group
         HDF5Handle groupHandle(openGroup_(groupname), &H5Gclose, "HDF5File::getDatasetHandle_(): Internal error");
 
+    #ifdef VIGRA_HDF5_CHUNK_CACHE
+        std::map<std::string, ChunkCacheSettings>::const_iterator settings =
+                                            chunk_cache_settings_.find(datasetName);
+        if(settings == chunk_cache_settings_.end())
+            settings = chunk_cache_settings_.find("");
+        if(settings != chunk_cache_settings_.end())
+        {
+            HDF5Handle dapl(H5Pcreate(H5P_DATASET_ACCESS), &H5Pclose,
+                            "HDF5File::getDatasetHandle_(): unable to create property list.");
+            H5Pset_chunk_cache(dapl, settings->second.nslots, settings->second.nbytes,
+                               settings->second.w0);
+            return H5Dopen(groupHandle, setname.c_str(), dapl);
+        }
+    #endif
         return H5Dopen(groupHandle, setname.c_str(), H5P_DEFAULT);
     }
 
+    static bool isPrime_(std::size_t n)
+    {
+        if(n < 2)
+            return false;
+        for(std::size_t k=2; k*k <= n; ++k)
+            if(n % k == 0)
+                return false;
+        return true;
+    }
+
+        /* convert the start of a chunk from VIGRA to HDF5 coordinates,
+           adding the band axis if the dataset has one.
+           Returns an empty array when the dimensions don't match.
+         */
+    template<int N>
+    static ArrayVector<hsize_t>
+    chunkOffset_(HDF5HandleShared const & dataset, TinyVector<MultiArrayIndex, N> const & chunkStart)
+    {
+        HDF5Handle dataspace(H5Dget_space(dataset), &H5Sclose,
+                             "HDF5File::chunkOffset_(): unable to access dataspace.");
+        int dimensions = H5Sget_simple_extent_ndims(dataspace);
+        ArrayVector<hsize_t> offset;
+        if(dimensions != N && dimensions != N+1)
+            return offset;
+        offset.resize(dimensions, 0);
+        for(int k=0; k<N; ++k)
+            offset[N-1-k] = chunkStart[k];
+        return offset;
+    }
+
         /* get the type of an object specified by a string
          */
     H5O_type_t get_object_type_(std::string name) const
@@ -2717,7 +3168,7 @@ class HDF5File
            to <tt>H5Dwrite()</tt>.
        */
     template<unsigned int N, class T, class Stride>
-    herr_t writeBlock_(HDF5HandleShared dataset,
+    herr_t writeBlock_(HDF5HandleShared const & dataset,
                        typename MultiArrayShape<N>::type &blockOffset,
                        const MultiArrayView<N, T, Stride> & array,
                        const hid_t datatype,
@@ -2747,7 +3198,7 @@ class HDF5File
            to <tt>H5Dread()</tt>.
         */
     template<unsigned int N, class T, class Stride>
-    herr_t readBlock_(HDF5HandleShared dataset,
+    herr_t readBlock_(HDF5HandleShared const & dataset,
                       typename MultiArrayShape<N>::type &blockOffset,
                       typename MultiArrayShape<N>::type &blockShape,
                       MultiArrayView<N, T, Stride> array,
@@ -2815,10 +3266,7 @@ HDF5File::createDataset(std::string datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    setFilters_(plist, compressionParameter);
 
     //create the dataset.
     HDF5HandleShared datasetHandle(H5Dcreate(parent, setname.c_str(),
@@ -2881,10 +3329,7 @@ void HDF5File::write_(std::string &datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    setFilters_(plist, compressionParameter);
 
     // create dataset
     HDF5Handle datasetHandle(H5Dcreate(groupHandle, setname.c_str(), datatype, dataspace,H5P_DEFAULT, plist, H5P_DEFAULT),
@@ -2982,7 +3427,7 @@ void HDF5File::write_(std::string &datasetName,
 /********************************************************************/
 
 template<unsigned int N, class T, class Stride>
-herr_t HDF5File::writeBlock_(HDF5HandleShared datasetHandle,
+herr_t HDF5File::writeBlock_(HDF5HandleShared const & datasetHandle,
                              typename MultiArrayShape<N>::type &blockOffset,
                              const MultiArrayView<N, T, Stride> & array,
                              const hid_t datatype,
@@ -3235,7 +3680,7 @@ void HDF5File::read_(std::string datasetName,
 /********************************************************************/
 
 template<unsigned int N, class T, class Stride>
-herr_t HDF5File::readBlock_(HDF5HandleShared datasetHandle,
+herr_t HDF5File::readBlock_(HDF5HandleShared const & datasetHandle,
                             typename MultiArrayShape<N>::type &blockOffset,
                             typename MultiArrayShape<N>::type &blockShape,
                             MultiArrayView<N, T, Stride> array,
@@ -3301,6 +3746,177 @@ herr_t HDF5File::readBlock_(HDF5HandleShared datasetHandle,
 
 /********************************************************************/
 
+#ifndef VIGRA_SINGLE_THREADED
+
+template<unsigned int N, class T, class Stride>
+herr_t HDF5File::readBlock(HDF5HandleShared dataset,
+                           typename MultiArrayShape<N>::type blockOffset,
+                           typename MultiArrayShape<N>::type blockShape,
+                           MultiArrayView<N, T, Stride> array,
+                           ParallelOptions const & options)
+{
+    typedef detail::HDF5TypeTraits<T> TypeTraits;
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    vigra_precondition(blockShape == array.shape(),
+         "HDF5File::readBlock(): Array shape disagrees with block size.");
+
+    detail::HDF5ChunkLayout layout =
+        detail::hdf5ChunkLayout(dataset, TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+    if(!layout.direct_io || layout.shape.size() != N ||
+       options.getActualNumThreads() <= 1 || prod(blockShape) == 0)
+        return readBlock_(dataset, blockOffset, blockShape, array,
+                          TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+
+    Shape shape(layout.shape.begin()),
+          chunkShape(layout.chunk_shape.begin()),
+          blockEnd = blockOffset + blockShape;
+    vigra_precondition(allLessEqual(Shape(), blockOffset) && allLessEqual(blockEnd, shape),
+         "HDF5File::readBlock(): block exceeds the dataset.");
+
+    ArrayVector<Shape> chunks;
+    detail::hdf5ChunksInBlock(blockOffset, blockEnd, chunkShape, chunks);
+
+    ThreadPool pool(options);
+    std::size_t bytes = prod(chunkShape)*sizeof(T);
+    ArrayVector<std::vector<char> > raw(std::max<std::size_t>(pool.nThreads(), 1)),
+                                    buffers(raw.size());
+    threading::mutex hdf5_lock;
+    herr_t status = 0;
+
+    parallel_foreach(pool, chunks.begin(), chunks.end(),
+        [&](std::size_t thread_id, Shape const & chunkStart)
+        {
+            Shape begin = max(chunkStart, blockOffset),
+                  end   = min(chunkStart + chunkShape, blockEnd);
+            MultiArrayView<N, T, Stride> target = array.subarray(begin - blockOffset, end - blockOffset);
+            unsigned int filterMask = 0;
+            {
+                threading::lock_guard<threading::mutex> guard(hdf5_lock);
+                if(status < 0)
+                    return;
+                herr_t res = readChunkRaw(dataset, chunkStart, raw[thread_id], filterMask);
+                // unwritten chunks: let HDF5 provide the fill value
+                if(res >= 0 && raw[thread_id].size() == 0)
+                {
+                    Shape size = end - begin;
+                    res = readBlock_(dataset, begin, size, target,
+                                     TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+                }
+                if(res < 0)
+                    status = res;
+                if(res < 0 || raw[thread_id].size() == 0)
+                    return;
+            }
+            std::vector<char> & buffer = buffers[thread_id];
+            buffer.resize(bytes);
+            detail::hdf5DecodeChunk(raw[thread_id], filterMask, layout.deflate_level,
+                                    buffer.data(), bytes);
+            MultiArrayView<N, T> chunk(chunkShape, (T*)buffer.data());
+            target = chunk.subarray(begin - chunkStart, end - chunkStart);
+        },
+        chunks.size());
+    return status;
+}
+
+template<unsigned int N, class T, class Stride>
+herr_t HDF5File::writeBlock(HDF5HandleShared dataset,
+                            typename MultiArrayShape<N>::type blockOffset,
+                            const MultiArrayView<N, T, Stride> & array,
+                            ParallelOptions const & options)
+{
+    typedef detail::HDF5TypeTraits<T> TypeTraits;
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    vigra_precondition(!isReadOnly(),
+        "HDF5File::writeBlock(): file is read-only.");
+
+    detail::HDF5ChunkLayout layout =
+        detail::hdf5ChunkLayout(dataset, TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+    if(!layout.direct_io || layout.shape.size() != N ||
+       options.getActualNumThreads() <= 1 || array.size() == 0)
+        return writeBlock_(dataset, blockOffset, array,
+                           TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+
+    Shape shape(layout.shape.begin()),
+          chunkShape(layout.chunk_shape.begin()),
+          blockEnd = blockOffset + array.shape();
+    vigra_precondition(allLessEqual(Shape(), blockOffset) && allLessEqual(blockEnd, shape),
+         "HDF5File::writeBlock(): block exceeds the dataset.");
+
+    ArrayVector<Shape> chunks;
+    detail::hdf5ChunksInBlock(blockOffset, blockEnd, chunkShape, chunks);
+
+    ThreadPool pool(options);
+    std::size_t bytes = prod(chunkShape)*sizeof(T);
+    ArrayVector<std::vector<char> > raw(std::max<std::size_t>(pool.nThreads(), 1)),
+                                    buffers(raw.size());
+    threading::mutex hdf5_lock;
+    herr_t status = 0;
+
+    parallel_foreach(pool, chunks.begin(), chunks.end(),
+        [&](std::size_t thread_id, Shape const & chunkStart)
+        {
+            // HDF5 stores complete chunks, also at the dataset border
+            Shape chunkEnd = min(chunkStart + chunkShape, shape),
+                  begin    = max(chunkStart, blockOffset),
+                  end      = min(chunkEnd, blockEnd);
+            std::vector<char> & buffer = buffers[thread_id];
+            if(chunkEnd - chunkStart != chunkShape)
+                buffer.assign(bytes, 0);
+            else
+                buffer.resize(bytes);
+            MultiArrayView<N, T> chunk(chunkShape, (T*)buffer.data());
+
+            if(begin != chunkStart || end != chunkEnd)
+            {
+                // the block covers the chunk only partially: merge with the stored data
+                unsigned int filterMask = 0;
+                {
+                    threading::lock_guard<threading::mutex> guard(hdf5_lock);
+                    if(status < 0)
+                        return;
+                    herr_t res = readChunkRaw(dataset, chunkStart, raw[thread_id], filterMask);
+                    if(res >= 0 && raw[thread_id].size() == 0)
+                    {
+                        Shape start = chunkStart, size = chunkEnd - chunkStart;
+                        res = readBlock_(dataset, start, size, chunk.subarray(Shape(), size),
+                                         TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+                    }
+                    if(res < 0)
+                    {
+                        status = res;
+                        return;
+                    }
+                }
+                if(raw[thread_id].size() > 0)
+                    detail::hdf5DecodeChunk(raw[thread_id], filterMask, layout.deflate_level,
+                                            buffer.data(), bytes);
+            }
+            chunk.subarray(begin - chunkStart, end - chunkStart) =
+                array.subarray(begin - blockOffset, end - blockOffset);
+
+            char const * data = buffer.data();
+            std::size_t size = bytes;
+            if(layout.deflate_level >= 0)
+            {
+                detail::hdf5EncodeChunk(buffer.data(), bytes, layout.deflate_level, raw[thread_id]);
+                data = raw[thread_id].data();
+                size = raw[thread_id].size();
+            }
+            threading::lock_guard<threading::mutex> guard(hdf5_lock);
+            if(status < 0)
+                return;
+            herr_t res = writeChunkRaw(dataset, chunkStart, data, size);
+            if(res < 0)
+                status = res;
+        },
+        chunks.size());
+    return status;
+}
+
+#endif // VIGRA_SINGLE_THREADED
+
 template<unsigned int N, class T, class Stride>
 void HDF5File::read_attribute_(std::string datasetName,
                                std::string attributeName,
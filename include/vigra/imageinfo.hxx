@@ -361,12 +361,26 @@ class ImageExportInfo
          **/
     VIGRA_EXPORT ImageExportInfo & setICCProfile(const ICCProfile & profile);
 
+        /** Write the encoded file into the given buffer instead of the file
+            given by getFileName(). The file name is then only used to determine
+            the file type when none was set via setFileType(), and the mode is ignored.
+            Pass <tt>0</tt> to write to the file again.
+
+            The buffer must outlive the export. Currently only supported by TIFF files.
+         **/
+    VIGRA_EXPORT ImageExportInfo & setMemoryBuffer(std::vector<char> * buffer);
+
+        /** Returns the buffer set by setMemoryBuffer() or <tt>0</tt>.
+         **/
+    VIGRA_EXPORT std::vector<char> * getMemoryBuffer() const;
+
   private:
     std::string m_filename, m_filetype, m_pixeltype, m_comp, m_mode;
     float m_x_res, m_y_res;
     Diff2D m_pos;
     ICCProfile m_icc_profile;
     Size2D m_canvas_size;
+    std::vector<char> * m_memory;
     double fromMin_, fromMax_, toMin_, toMax_;
 };
 
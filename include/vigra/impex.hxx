@@ -52,6 +52,8 @@
 #include "imageinfo.hxx"
 #include "impexbase.hxx"
 #include "multi_shape.hxx"
+#include "multi_array.hxx"
+#include <cstring>
 
 namespace vigra
 {
@@ -60,23 +62,62 @@ namespace vigra
 */
     namespace detail
     {
+        // Restrict decoding to the given ROI, using the codec's native support if
+        // available and skipping the leading rows otherwise. Returns the index of
+        // the ROI's first column in the scanlines subsequently delivered by the decoder.
+        inline unsigned
+        prepare_roi(Decoder* decoder, const Rect2D& roi)
+        {
+            vigra_precondition(!roi.isEmpty() && roi.left() >= 0 && roi.top() >= 0 &&
+                               roi.right() <= static_cast<int>(decoder->getWidth()) &&
+                               roi.bottom() <= static_cast<int>(decoder->getHeight()),
+                               "importImage(): region of interest must be a non-empty rectangle inside the image.");
+
+            if (roi == Rect2D(Size2D(decoder->getWidth(), decoder->getHeight())) ||
+                decoder->setROI(roi))
+            {
+                return 0U;
+            }
+
+            for (int y = 0; y != roi.top(); ++y)
+            {
+                decoder->nextScanline();
+            }
+            return static_cast<unsigned>(roi.left());
+        }
+
+        // Codecs may expect that all scanlines have been read before close().
+        inline void
+        finish_roi(Decoder* decoder, const Rect2D& roi)
+        {
+            if (roi.bottom() == static_cast<int>(decoder->getHeight()))
+            {
+                decoder->close();
+            }
+            else
+            {
+                decoder->abort();
+            }
+        }
+
         template <class ValueType,
                   class ImageIterator, class ImageAccessor>
         void
-        read_image_band(Decoder* decoder,
+        read_image_band(Decoder* decoder, const Rect2D& roi,
                         ImageIterator image_iterator, ImageAccessor image_accessor)
         {
             typedef typename ImageIterator::row_iterator ImageRowIterator;
 
-            const unsigned width(decoder->getWidth());
-            const unsigned height(decoder->getHeight());
+            const unsigned width(roi.width());
+            const unsigned height(roi.height());
             const unsigned offset(decoder->getOffset());
+            const unsigned skip(prepare_roi(decoder, roi) * offset);
 
             for (unsigned y = 0U; y != height; ++y)
             {
                 decoder->nextScanline();
 
-                const ValueType* scanline = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0));
+                const ValueType* scanline = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0)) + skip;
 
                 ImageRowIterator is(image_iterator.rowIterator());
                 const ImageRowIterator is_end(is + width);
@@ -93,19 +134,69 @@ namespace vigra
         }
 
 
+        // Fast path for destinations whose pixels have the same type and memory
+        // layout as the file's scanlines: rows are decoded directly into the
+        // destination (or, if the codec doesn't support this, copied as a whole)
+        // without going through an accessor. Returns false (before reading
+        // anything) if not applicable.
+        template <class T, class S>
+        bool
+        read_image_direct(Decoder* decoder, const Rect2D& roi,
+                          MultiArrayView<2, T, S> image)
+        {
+            typedef typename ExpandElementResult<T>::type ElementType;
+            const unsigned bands = ExpandElementResult<T>::size;
+
+            if (sizeof(T) != bands * sizeof(ElementType) || image.stride(0) != 1 ||
+                roi.left() != 0 || roi.width() != static_cast<int>(decoder->getWidth()) ||
+                decoder->getNumBands() != bands || decoder->getOffset() != bands ||
+                TypeAsString<ElementType>::result() != decoder->getPixelType())
+            {
+                return false;
+            }
+
+            prepare_roi(decoder, roi);
+
+            const std::size_t row_size(roi.width() * sizeof(T));
+            bool zero_copy = true;
+            for (int y = 0; y != roi.height(); ++y)
+            {
+                T* row = &image(0, y);
+                if (!zero_copy || !(zero_copy = decoder->nextScanlineInto(row)))
+                {
+                    decoder->nextScanline();
+                    std::memcpy(row, decoder->currentScanlineOfBand(0), row_size);
+                }
+            }
+            return true;
+        }
+
+
         template <class ValueType,
                   class ImageIterator, class ImageAccessor>
         void
-        read_image_bands(Decoder* decoder,
+        read_image_band(Decoder* decoder,
+                        ImageIterator image_iterator, ImageAccessor image_accessor)
+        {
+            read_image_band<ValueType>(decoder, Rect2D(Size2D(decoder->getWidth(), decoder->getHeight())),
+                                       image_iterator, image_accessor);
+        }
+
+
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
+        void
+        read_image_bands(Decoder* decoder, const Rect2D& roi,
                          ImageIterator image_iterator, ImageAccessor image_accessor)
         {
             typedef typename ImageIterator::row_iterator ImageRowIterator;
 
-            const unsigned width(decoder->getWidth());
-            const unsigned height(decoder->getHeight());
+            const unsigned width(roi.width());
+            const unsigned height(roi.height());
             const unsigned bands(decoder->getNumBands());
             const unsigned offset(decoder->getOffset());
             const unsigned accessor_size(image_accessor.size(image_iterator));
+            const unsigned skip(prepare_roi(decoder, roi) * offset);
             
             // OPTIMIZATION: Specialization for the most common case
             // of an RGB-image, i.e. 3 channels.
@@ -119,7 +210,7 @@ namespace vigra
                 {
                     decoder->nextScanline();
 
-                    scanline_0 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0));
+                    scanline_0 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0)) + skip;
                     
                     if(bands == 1)
                     {
@@ -128,8 +219,8 @@ namespace vigra
                     }
                     else
                     {
-                        scanline_1 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(1));
-                        scanline_2 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(2));
+                        scanline_1 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(1)) + skip;
+                        scanline_2 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(2)) + skip;
                     }
                     
                     ImageRowIterator is(image_iterator.rowIterator());
@@ -159,7 +250,7 @@ namespace vigra
                 {
                     decoder->nextScanline();
                     
-                    scanlines[0] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0));
+                    scanlines[0] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0)) + skip;
 
                     if(bands == 1)
                     {
@@ -172,7 +263,7 @@ namespace vigra
                     {
                         for (unsigned i = 1U; i != accessor_size; ++i)
                         {
-                            scanlines[i] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(i));
+                            scanlines[i] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(i)) + skip;
                         }
                     }
                     
@@ -195,86 +286,112 @@ namespace vigra
         }
 
 
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
+        void
+        read_image_bands(Decoder* decoder,
+                         ImageIterator image_iterator, ImageAccessor image_accessor)
+        {
+            read_image_bands<ValueType>(decoder, Rect2D(Size2D(decoder->getWidth(), decoder->getHeight())),
+                                        image_iterator, image_accessor);
+        }
+
+
         template <class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
+        importImage(Decoder* decoder, const Rect2D& roi,
                     ImageIterator image_iterator, ImageAccessor image_accessor,
                     /* isScalar? */ VigraTrueType)
         {
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
-
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_band<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt8>(decoder, roi, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_band<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt16>(decoder, roi, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_band<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt32>(decoder, roi, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_band<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int16>(decoder, roi, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_band<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int32>(decoder, roi, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_band<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<float>(decoder, roi, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_band<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<double>(decoder, roi, image_iterator, image_accessor);
                 break;
             default:
                 vigra_fail("detail::importImage<scalar>: not reached");
             }
-
-            decoder->close();
         }
 
 
         template <class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
+        importImage(Decoder* decoder, const Rect2D& roi,
                     ImageIterator image_iterator, ImageAccessor image_accessor,
                     /* isScalar? */ VigraFalseType)
         {
-            vigra_precondition((static_cast<unsigned int>(import_info.numBands())
-                                == image_accessor.size(image_iterator)) ||
-                               import_info.numBands() == 1,
+            vigra_precondition(decoder->getNumBands() == image_accessor.size(image_iterator) ||
+                               decoder->getNumBands() == 1,
                 "importImage(): Number of channels in input and destination image don't match.");
 
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
-            
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_bands<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt8>(decoder, roi, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_bands<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt16>(decoder, roi, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_bands<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt32>(decoder, roi, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_bands<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int16>(decoder, roi, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_bands<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int32>(decoder, roi, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_bands<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<float>(decoder, roi, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_bands<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<double>(decoder, roi, image_iterator, image_accessor);
                 break;
             default:
                 vigra_fail("vigra::detail::importImage<non-scalar>: not reached");
             }
+        }
+
+
+        // decode the given ROI of the decoder's current image
+        template <class ImageIterator, class ImageAccessor>
+        void
+        importImage(Decoder* decoder, const Rect2D& roi,
+                    ImageIterator image_iterator, ImageAccessor image_accessor)
+        {
+            typedef typename ImageAccessor::value_type ImageValueType;
+            typedef typename NumericTraits<ImageValueType>::isScalar is_scalar;
+
+            importImage(decoder, roi, image_iterator, image_accessor, is_scalar());
+        }
 
-            decoder->close();
+        template <class T, class S>
+        void
+        importImage(Decoder* decoder, const Rect2D& roi,
+                    MultiArrayView<2, T, S> image)
+        {
+            vigra_precondition(Shape2(roi.width(), roi.height()) == image.shape(),
+                "importImage(): shape mismatch between region of interest and output.");
+            if (!read_image_direct(decoder, roi, image))
+                importImage(decoder, roi, destImage(image).first, destImage(image).second);
         }
 
         template<class ValueType,
@@ -642,6 +759,11 @@ namespace vigra
     image), all bands will receive the same data. When a multi-band file is read into a single-band 
     destination array, only the first band is read. Any other mismatch between the number of bands in
     input and output is an error and will throw a precondition exception.
+
+    When a region of interest (ROI) is passed, only this part of the image is read. 
+    TIFF files (stripped or tiled) support ROI access natively, i.e. only the strips 
+    and tiles overlapping the ROI are decoded. Other formats are decoded up to the 
+    ROI's last row, and the unwanted parts are skipped.
     
     <B>Declarations</B>
    
@@ -654,6 +776,14 @@ namespace vigra
         importImage(ImageImportInfo const & import_info,
                     MultiArrayView<2, T, S> image);
 
+        // read only the given region of interest, whose size must
+        // match the shape of the array view
+        template <class T, class S>
+        void
+        importImage(ImageImportInfo const & import_info,
+                    Rect2D const & roi,
+                    MultiArrayView<2, T, S> image);
+
         // resize the given array and then read the data
         template <class T, class A>
         void
@@ -721,6 +851,13 @@ namespace vigra
     // resize image and read the data
     importImage("myimage.png", image);
     \endcode
+    Read a 512x512 crop at position (1000, 2000) of a large image:
+    \code
+    ImageImportInfo info("slide.tif");
+    MultiArray<2, RGBValue<UInt8> > crop(512, 512);
+
+    importImage(info, Rect2D(Point2D(1000, 2000), Size2D(512, 512)), crop);
+    \endcode
 
     \deprecatedUsage{importImage}
     \code
@@ -791,12 +928,18 @@ namespace vigra
     importImage(const ImageImportInfo& import_info,
                 ImageIterator image_iterator, ImageAccessor image_accessor)
     {
-        typedef typename ImageAccessor::value_type ImageValueType;
-        typedef typename NumericTraits<ImageValueType>::isScalar is_scalar;
+        importImage(import_info, Rect2D(import_info.size()),
+                    image_iterator, image_accessor);
+    }
 
-        detail::importImage(import_info,
-                    image_iterator, image_accessor,
-                    is_scalar());
+    template <class ImageIterator, class ImageAccessor>
+    inline void
+    importImage(const ImageImportInfo& import_info, const Rect2D& roi,
+                ImageIterator image_iterator, ImageAccessor image_accessor)
+    {
+        VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
+        detail::importImage(decoder.get(), roi, image_iterator, image_accessor);
+        detail::finish_roi(decoder.get(), roi);
     }
 
 
@@ -809,6 +952,15 @@ namespace vigra
                     image.first, image.second);
     }
 
+    template <class ImageIterator, class ImageAccessor>
+    inline void
+    importImage(ImageImportInfo const & import_info, Rect2D const & roi,
+                pair<ImageIterator, ImageAccessor> image)
+    {
+        importImage(import_info, roi,
+                    image.first, image.second);
+    }
+
     template <class T, class S>
     inline void
     importImage(ImageImportInfo const & import_info,
@@ -816,7 +968,25 @@ namespace vigra
     {
         vigra_precondition(import_info.shape() == image.shape(),
             "importImage(): shape mismatch between input and output.");
-        importImage(import_info, destImage(image));
+        importImage(import_info, Rect2D(import_info.size()), image);
+    }
+
+    template <class T, class S>
+    inline void
+    importImage(ImageImportInfo const & import_info, Rect2D const & roi,
+                MultiArrayView<2, T, S> image)
+    {
+        VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
+        detail::importImage(decoder.get(), roi, image);
+        detail::finish_roi(decoder.get(), roi);
+    }
+
+    template <class T, class A>
+    inline void
+    importImage(ImageImportInfo const & import_info, Rect2D const & roi,
+                MultiArray<2, T, A> & image)
+    {
+        importImage(import_info, roi, static_cast<MultiArrayView<2, T> &>(image));
     }
 
     template <class T, class A>
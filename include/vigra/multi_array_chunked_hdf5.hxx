@@ -37,6 +37,7 @@
 #define VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
 
 #include <queue>
+#include <vector>
 
 #include "multi_array_chunked.hxx"
 #include "hdf5impex.hxx"
@@ -67,6 +68,14 @@ namespace vigra {
     This uses the native chunking and compression functionality provided by the
     HDF5 library. Note: This file must only be included when the HDF5 headers
     and libraries are installed on the system.
+
+    When the dataset's chunks coincide with the array's chunks, the data type
+    needs no conversion and the dataset is either uncompressed or 'zlib'
+    compressed (which is always the case for datasets created by this class),
+    chunks are transferred with HDF5's direct chunk I/O (requires HDF5 1.10.3).
+    This bypasses HDF5's chunk cache and filter pipeline, so that every chunk is
+    decompressed exactly once, directly into the array's memory. Otherwise, chunks
+    are transferred by HDF5File::readBlock() and HDF5File::writeBlock().
 */
 template <unsigned int N, class T, class Alloc = std::allocator<T> >
 class ChunkedArrayHDF5
@@ -117,7 +126,9 @@ class ChunkedArrayHDF5
             {
                 if(!array_->file_.isReadOnly())
                 {
-                    herr_t status = array_->file_.writeBlock(array_->dataset_, start_,
+                    herr_t status = array_->direct_chunk_io_
+                        ? array_->writeChunkDirect(start_, shape_, this->pointer_)
+                        : array_->file_.writeBlock(array_->dataset_, start_,
                                           MultiArrayView<N, T>(shape_, this->strides_, this->pointer_));
                     vigra_postcondition(status >= 0,
                         "ChunkedArrayHDF5: write to dataset failed.");
@@ -135,10 +146,16 @@ class ChunkedArrayHDF5
             if(this->pointer_ == 0)
             {
                 this->pointer_ = alloc_.allocate(this->size());
-                herr_t status = array_->file_.readBlock(array_->dataset_, start_, shape_,
-                                     MultiArrayView<N, T>(shape_, this->strides_, this->pointer_));
-                vigra_postcondition(status >= 0,
-                    "ChunkedArrayHDF5: read from dataset failed.");
+                // chunks that have never been written are read via
+                // readBlock() to get the fill value
+                if(!array_->direct_chunk_io_ ||
+                   !array_->readChunkDirect(start_, shape_, this->pointer_))
+                {
+                    herr_t status = array_->file_.readBlock(array_->dataset_, start_, shape_,
+                                         MultiArrayView<N, T>(shape_, this->strides_, this->pointer_));
+                    vigra_postcondition(status >= 0,
+                        "ChunkedArrayHDF5: read from dataset failed.");
+                }
             }
             return this->pointer_;
         }
@@ -181,6 +198,9 @@ class ChunkedArrayHDF5
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>LZ4: Very fast compression using VIGRA's LZ4 filter (combined with
+                 HDF5's shuffle filter). Other programs need an HDF5 LZ4 plugin
+                 to read such datasets.
         <li>DEFAULT_COMPRESSION: Same as ZLIB_FAST.
         </ul>
     */
@@ -195,7 +215,9 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
-      alloc_(alloc)
+      alloc_(alloc),
+      direct_chunk_io_(false),
+      deflate_level_(-1)
     {
         init(mode);
     }
@@ -219,6 +241,9 @@ class ChunkedArrayHDF5
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>LZ4: Very fast compression using VIGRA's LZ4 filter (combined with
+                 HDF5's shuffle filter). Other programs need an HDF5 LZ4 plugin
+                 to read such datasets.
         <li>DEFAULT_COMPRESSION: Same as ZLIB_FAST.
         </ul>
     */
@@ -233,7 +258,9 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
-      alloc_(alloc)
+      alloc_(alloc),
+      direct_chunk_io_(false),
+      deflate_level_(-1)
     {
         init(mode);
     }
@@ -245,7 +272,9 @@ class ChunkedArrayHDF5
     file_(src.file_),
     dataset_name_(src.dataset_name_),
     compression_(src.compression_),
-    alloc_(src.alloc_)
+    alloc_(src.alloc_),
+    direct_chunk_io_(false),
+    deflate_level_(-1)
     {
         if( file_.isReadOnly() )
             init(HDF5File::ReadOnly);
@@ -299,8 +328,10 @@ class ChunkedArrayHDF5
             // chunks as are needed for a single array chunk.
             if(compression_ == DEFAULT_COMPRESSION)
                 compression_ = ZLIB_FAST;
-            vigra_precondition(compression_ != LZ4,
-                "ChunkedArrayHDF5(): HDF5 does not support LZ4 compression.");
+            // LZ4 works best on shuffled bytes
+            int compression = compression_ == LZ4
+                                  ? LZ4 | HDF5File::Shuffle
+                                  : compression_;
 
             vigra_precondition(this->size() > 0,
                 "ChunkedArrayHDF5(): invalid shape.");
@@ -309,7 +340,7 @@ class ChunkedArrayHDF5
                                                  this->shape_,
                                                  init,
                                                  this->chunk_shape_,
-                                                 compression_);
+                                                 compression);
         }
         else
         {
@@ -358,7 +389,163 @@ class ChunkedArrayHDF5
                 i->chunk_state_.store(base_type::chunk_asleep);
             }
         }
+        initDirectChunkIO();
+    }
+
+    // check if chunks can be transferred by direct chunk I/O
+    void initDirectChunkIO()
+    {
+        typedef detail::HDF5TypeTraits<T> TypeTraits;
+
+        detail::HDF5ChunkLayout layout =
+            detail::hdf5ChunkLayout(dataset_, TypeTraits::getH5DataType(), TypeTraits::numberOfBands());
+        // file chunks must coincide with the array's chunks
+        direct_chunk_io_ = layout.direct_io && layout.chunk_shape.size() == N &&
+                           shape_type(layout.chunk_shape.begin()) == this->chunk_shape_;
+        deflate_level_ = direct_chunk_io_ ? layout.deflate_level : -1;
+    }
+
+    // read a chunk via direct chunk I/O and decompress it into 'dest',
+    // return false when the chunk doesn't exist in the file yet
+    bool readChunkDirect(shape_type const & start, shape_type const & shape, T * dest)
+    {
+        std::vector<char> raw;
+        unsigned int filterMask = 0;
+        herr_t status = file_.readChunkRaw(dataset_, start, raw, filterMask);
+        vigra_postcondition(status >= 0,
+            "ChunkedArrayHDF5: read from dataset failed.");
+        if(raw.size() == 0)
+            return false;
+
+        // HDF5 always stores complete chunks, also at the array border
+        std::size_t bytes = prod(this->chunk_shape_)*sizeof(T);
+        if(shape == this->chunk_shape_)
+        {
+            detail::hdf5DecodeChunk(raw, filterMask, deflate_level_, (char*)dest, bytes);
+        }
+        else
+        {
+            std::vector<char> buffer(bytes);
+            detail::hdf5DecodeChunk(raw, filterMask, deflate_level_, buffer.data(), bytes);
+            MultiArrayView<N, T> stored(this->chunk_shape_, (T*)buffer.data());
+            MultiArrayView<N, T>(shape, dest) = stored.subarray(shape_type(), shape);
+        }
+        return true;
+    }
+
+    // (compress and) write a chunk via direct chunk I/O
+    herr_t writeChunkDirect(shape_type const & start, shape_type const & shape, T const * src)
+    {
+        std::size_t bytes = prod(this->chunk_shape_)*sizeof(T);
+        char const * data = (char const *)src;
+        std::vector<char> padded;
+        if(shape != this->chunk_shape_)
+        {
+            // HDF5 expects complete chunks, also at the array border
+            padded.resize(bytes);
+            MultiArrayView<N, T>(this->chunk_shape_, (T*)padded.data()).subarray(shape_type(), shape) =
+                MultiArrayView<N, T>(shape, const_cast<T*>(src));
+            data = padded.data();
+        }
+        if(deflate_level_ < 0)
+            return file_.writeChunkRaw(dataset_, start, data, bytes);
+
+        std::vector<char> compressed;
+        detail::hdf5EncodeChunk(data, bytes, deflate_level_, compressed);
+        return file_.writeChunkRaw(dataset_, start, compressed.data(), compressed.size());
+    }
+
+    using base_type::checkoutSubarray;
+    using base_type::commitSubarray;
+
+#ifndef VIGRA_SINGLE_THREADED
+    /** \brief Copy an ROI of the chunked array into an ordinary MultiArrayView,
+        decompressing the chunks in parallel.
+
+        The ROI is read by HDF5File::readBlock() with the given 'options', i.e.
+        chunks are decompressed concurrently when the dataset supports direct
+        chunk I/O. Afterwards, chunks currently held in memory (which may be
+        newer than the file) are copied over the result. Chunks are not loaded
+        into the array's cache. The ROI must not be modified concurrently.
+    */
+    template <class U, class Stride>
+    void
+    checkoutSubarray(shape_type const & start,
+                     MultiArrayView<N, U, Stride> & subarray,
+                     ParallelOptions const & options) const
+    {
+        shape_type stop   = start + subarray.shape();
+
+        this->checkSubarrayBounds(start, stop, "ChunkedArrayHDF5::checkoutSubarray()");
+
+        ChunkedArrayHDF5 * self = const_cast<ChunkedArrayHDF5 *>(this);
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
+        herr_t status = self->file_.readBlock(dataset_, start, subarray.shape(), subarray, options);
+        vigra_postcondition(status >= 0,
+            "ChunkedArrayHDF5::checkoutSubarray(): read from dataset failed.");
+
+        shape_type chunkIndex = this->chunkStart(start);
+        MultiCoordinateIterator<N> i(this->chunkStop(stop) - chunkIndex),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            Chunk * chunk = static_cast<Chunk*>(self->handle_array_[chunkIndex + *i].pointer_);
+            if(chunk == 0 || chunk->pointer_ == 0)
+                continue;
+            shape_type chunkBegin = max(chunk->start_, start),
+                       chunkEnd   = min(chunk->start_ + chunk->shape_, stop);
+            subarray.subarray(chunkBegin - start, chunkEnd - start) =
+                MultiArrayView<N, T>(chunk->shape_, chunk->strides_, chunk->pointer_)
+                    .subarray(chunkBegin - chunk->start_, chunkEnd - chunk->start_);
+        }
+    }
+
+    /** \brief Copy an ordinary MultiArrayView into an ROI of the chunked array,
+        compressing the chunks in parallel.
+
+        The ROI is written by HDF5File::writeBlock() with the given 'options', i.e.
+        chunks are compressed concurrently when the dataset supports direct chunk
+        I/O. Chunks currently held in memory are updated accordingly. Chunks are
+        not loaded into the array's cache. The ROI must not be accessed concurrently.
+    */
+    template <class U, class Stride>
+    void
+    commitSubarray(shape_type const & start,
+                   MultiArrayView<N, U, Stride> const & subarray,
+                   ParallelOptions const & options)
+    {
+        shape_type stop   = start + subarray.shape();
+
+        vigra_precondition(!this->isReadOnly(),
+                           "ChunkedArrayHDF5::commitSubarray(): array is read-only.");
+        this->checkSubarrayBounds(start, stop, "ChunkedArrayHDF5::commitSubarray()");
+
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
+        herr_t status = file_.writeBlock(dataset_, start, subarray, options);
+        vigra_postcondition(status >= 0,
+            "ChunkedArrayHDF5::commitSubarray(): write to dataset failed.");
+
+        shape_type chunkIndex = this->chunkStart(start);
+        MultiCoordinateIterator<N> i(this->chunkStop(stop) - chunkIndex),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            SharedChunkHandle<N, T> & handle = this->handle_array_[chunkIndex + *i];
+            Chunk * chunk = static_cast<Chunk*>(handle.pointer_);
+            if(chunk != 0 && chunk->pointer_ != 0)
+            {
+                shape_type chunkBegin = max(chunk->start_, start),
+                           chunkEnd   = min(chunk->start_ + chunk->shape_, stop);
+                MultiArrayView<N, T>(chunk->shape_, chunk->strides_, chunk->pointer_)
+                    .subarray(chunkBegin - chunk->start_, chunkEnd - chunk->start_) =
+                        subarray.subarray(chunkBegin - start, chunkEnd - start);
+            }
+            // the file now holds the chunk's data
+            long state = base_type::chunk_uninitialized;
+            handle.chunk_state_.compare_exchange_strong(state, base_type::chunk_asleep);
+        }
     }
+#endif // VIGRA_SINGLE_THREADED
 
     ~ChunkedArrayHDF5()
     {
@@ -473,6 +660,8 @@ class ChunkedArrayHDF5
     HDF5HandleShared dataset_;
     CompressionMethod compression_;
     Alloc alloc_;
+    bool direct_chunk_io_;
+    int deflate_level_;   // -1: uncompressed
 };
 
 //@}
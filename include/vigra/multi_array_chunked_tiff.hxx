@@ -0,0 +1,239 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_TIFF_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_TIFF_HXX
+
+#include <string>
+
+#include "multi_array_chunked.hxx"
+#include "multi_impex.hxx"
+
+namespace vigra {
+
+/** \addtogroup ChunkedArrayClasses
+*/
+//@{
+
+/** \weakgroup ParallelProcessing
+    \sa ChunkedArrayTIFF
+*/
+
+/** Implement ChunkedArray as a read-only view of a multi-page TIFF file.
+
+    <b>\#include</b> \<vigra/multi_array_chunked_tiff.hxx\> <br/>
+    Namespace: vigra
+
+    The pages of the file (which may also be a BigTIFF) are the slices of a
+    3D volume of shape <tt>(width, height, numImages)</tt>. No data are read
+    upon construction. Instead, each chunk is decoded upon first access by
+    stepping through the chunk's pages with a single decoder and reading only
+    the chunk's region of interest (tiled TIFFs only decode the affected tiles).
+    Chunks that are sent asleep release their memory and are decoded again
+    when needed, so that volumes much larger than RAM can be processed.
+*/
+template <class T, class Alloc = std::allocator<T> >
+class ChunkedArrayTIFF
+: public ChunkedArray<3, T>
+{
+  public:
+
+    class Chunk
+    : public ChunkBase<3, T>
+    {
+      public:
+        typedef typename MultiArrayShape<3>::type  shape_type;
+        typedef T value_type;
+        typedef value_type * pointer;
+        typedef value_type & reference;
+
+        Chunk(shape_type const & shape, shape_type const & start,
+              ChunkedArrayTIFF * array, Alloc const & alloc)
+        : ChunkBase<3, T>(detail::defaultStride(shape))
+        , shape_(shape)
+        , start_(start)
+        , array_(array)
+        , alloc_(alloc)
+        {}
+
+        ~Chunk()
+        {
+            deallocate();
+        }
+
+        std::size_t size() const
+        {
+            return prod(shape_);
+        }
+
+        pointer read()
+        {
+            if(this->pointer_ == 0)
+            {
+                this->pointer_ = detail::alloc_initialize_n<T>(size(), T(), alloc_);
+                try
+                {
+                    detail::importPages(array_->filename_,
+                                        Rect2D(Point2D(start_[0], start_[1]), Size2D(shape_[0], shape_[1])),
+                                        start_[2],
+                                        MultiArrayView<3, T>(shape_, this->strides_, this->pointer_));
+                }
+                catch(...)
+                {
+                    deallocate();
+                    throw;
+                }
+            }
+            return this->pointer_;
+        }
+
+        void deallocate()
+        {
+            detail::destroy_dealloc_n(this->pointer_, size(), alloc_);
+            this->pointer_ = 0;
+        }
+
+        shape_type shape_, start_;
+        ChunkedArrayTIFF * array_;
+        Alloc alloc_;
+
+      private:
+        Chunk & operator=(Chunk const &);
+    };
+
+    typedef ChunkedArray<3, T> base_type;
+    typedef MultiArray<3, SharedChunkHandle<3, T> > ChunkStorage;
+    typedef typename ChunkStorage::difference_type  shape_type;
+    typedef T value_type;
+    typedef value_type * pointer;
+    typedef value_type & reference;
+
+    /** \brief Construct for the multi-page TIFF 'filename' with given
+        'chunk_shape' and 'options', using 'alloc' to manage the in-memory
+        version of the data.
+
+        The array's shape is determined from the file. When the pages of a
+        volume are always accessed as a whole, a chunk shape of
+        <tt>(width, height, k)</tt> avoids decoding any page more than once.
+    */
+    explicit ChunkedArrayTIFF(std::string const & filename,
+                              shape_type const & chunk_shape=shape_type(),
+                              ChunkedArrayOptions const & options = ChunkedArrayOptions(),
+                              Alloc const & alloc = Alloc())
+    : ChunkedArray<3, T>(fileShape(filename), chunk_shape, options),
+      filename_(filename),
+      alloc_(alloc)
+    {
+        // all data reside in the file
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            i->chunk_state_.store(base_type::chunk_asleep);
+        }
+    }
+
+    ~ChunkedArrayTIFF()
+    {
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                delete static_cast<Chunk*>(i->pointer_);
+            i->pointer_ = 0;
+        }
+    }
+
+    virtual bool isReadOnly() const
+    {
+        return true;
+    }
+
+    virtual pointer loadChunk(ChunkBase<3, T> ** p, shape_type const & index)
+    {
+        if(*p == 0)
+        {
+            *p = new Chunk(this->chunkShape(index), index*this->chunk_shape_, this, alloc_);
+            this->overhead_bytes_ += sizeof(Chunk);
+        }
+        return static_cast<Chunk *>(*p)->read();
+    }
+
+    virtual bool unloadChunk(ChunkBase<3, T> * chunk, bool /* destroy */)
+    {
+        // the data can always be decoded again
+        static_cast<Chunk *>(chunk)->deallocate();
+        return false;
+    }
+
+    virtual std::string backend() const
+    {
+        return "ChunkedArrayTIFF<'" + filename_ + "'>";
+    }
+
+    virtual std::size_t dataBytes(ChunkBase<3,T> * c) const
+    {
+        return c->pointer_ == 0
+                 ? 0
+                 : static_cast<Chunk*>(c)->size()*sizeof(T);
+    }
+
+    virtual std::size_t overheadBytesPerChunk() const
+    {
+        return sizeof(Chunk) + sizeof(SharedChunkHandle<3, T>);
+    }
+
+    std::string fileName() const
+    {
+        return filename_;
+    }
+
+  private:
+    static shape_type fileShape(std::string const & filename)
+    {
+        ImageImportInfo info(filename.c_str());
+        return shape_type(info.width(), info.height(), info.numImages());
+    }
+
+    std::string filename_;
+    Alloc alloc_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_TIFF_HXX
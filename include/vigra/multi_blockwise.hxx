@@ -312,7 +312,9 @@ namespace blockwise{
             typedef typename vigra::NumericTraits<typename S::value_type>::RealPromote RealType;
             vigra::MultiArray<DIM, TinyVector<RealType, int(DIM*(DIM+1)/2)> >  hessianOfGaussianRes(d.shape());
             vigra::hessianOfGaussianMultiArray(s, hessianOfGaussianRes, sharedOpt_);
-            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, d);
+            // closed-form batch kernel, serial because the blocks already run in parallel
+            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, d,
+                                               ParallelOptions().numThreads(ParallelOptions::NoThreads));
         }
         template<class S, class D,class SHAPE>
         void operator()(const S & s, D & d, const SHAPE & roiBegin, const SHAPE & roiEnd){
@@ -321,7 +323,9 @@ namespace blockwise{
             ConvOpt localOpt(sharedOpt_);
             localOpt.subarray(roiBegin, roiEnd);
             vigra::hessianOfGaussianMultiArray(s, hessianOfGaussianRes, localOpt);
-            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, d);
+            // closed-form batch kernel, serial because the blocks already run in parallel
+            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, d,
+                                               ParallelOptions().numThreads(ParallelOptions::NoThreads));
         }
     private:
         ConvOpt  sharedOpt_;
@@ -342,7 +346,9 @@ namespace blockwise{
             vigra::hessianOfGaussianMultiArray(s, hessianOfGaussianRes, sharedOpt_);
 
             vigra::MultiArray<DIM, TinyVector<RealType, DIM > >  allEigenvalues(s.shape());
-            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, allEigenvalues);
+            // closed-form batch kernel, serial because the blocks already run in parallel
+            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, allEigenvalues,
+                                               ParallelOptions().numThreads(ParallelOptions::NoThreads));
 
             d = allEigenvalues.bindElementChannel(EV);
         }
@@ -358,7 +364,9 @@ namespace blockwise{
             vigra::hessianOfGaussianMultiArray(s, hessianOfGaussianRes, localOpt);
 
             vigra::MultiArray<DIM, TinyVector<RealType, DIM > >  allEigenvalues(roiEnd-roiBegin);
-            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, allEigenvalues);
+            // closed-form batch kernel, serial because the blocks already run in parallel
+            vigra::tensorEigenvaluesMultiArray(hessianOfGaussianRes, allEigenvalues,
+                                               ParallelOptions().numThreads(ParallelOptions::NoThreads));
 
             d = allEigenvalues.bindElementChannel(EV);
         }
@@ -47,6 +47,7 @@
 #include "metaprogramming.hxx"
 #include "multi_pointoperators.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
 
 #include "multi_gridgraph.hxx"     //for boundaryGraph & boundaryMultiDistance
 #include "union_find.hxx"        //for boundaryGraph & boundaryMultiDistance
@@ -233,6 +234,204 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     internalSeparableMultiArrayDistTmp( si, shape, src, di, dest, sigmas, false );
 }
 
+/********************************************************/
+/*                                                      */
+/*              separableDistLinePass                   */
+/*                                                      */
+/********************************************************/
+
+    // threshold functor turning a mask into initial squared distances
+template <class SrcType, class Real>
+struct DistThreshold
+{
+    DistThreshold(bool background, Real maxDist)
+    : background_(background), maxDist_(maxDist)
+    {}
+
+    Real operator()(SrcType const & v) const
+    {
+        return ((v == NumericTraits<SrcType>::zero()) == background_)
+                   ? maxDist_
+                   : Real();
+    }
+
+    bool background_;
+    Real maxDist_;
+};
+
+template <class T>
+struct DistCast
+{
+    template <class V>
+    T operator()(V const & v) const
+    {
+        return detail::RequiresExplicitCast<T>::cast(v);
+    }
+};
+
+    // store the squared distance, then take its root (like separableMultiDistance())
+template <class T>
+struct DistSqrt
+{
+    template <class V>
+    T operator()(V const & v) const
+    {
+        using std::sqrt;
+        return detail::RequiresExplicitCast<T>::cast(sqrt(detail::RequiresExplicitCast<T>::cast(v)));
+    }
+};
+
+    // in-place lower envelope of parabolas on a buffered line
+struct DistParabolaKernel
+{
+    DistParabolaKernel(double sigma)
+    : sigma_(sigma)
+    {}
+
+    template <class Iterator>
+    void operator()(Iterator begin, Iterator end) const
+    {
+        typedef typename std::iterator_traits<Iterator>::value_type T;
+        distParabola(begin, end, StandardConstValueAccessor<T>(),
+                     begin, StandardValueAccessor<T>(), sigma_);
+    }
+
+    double sigma_;
+};
+
+    // Process the lines with scan-order indices [begin, end) along dimension 'd':
+    // copy each line through 'init' into 'buffer', run 'kernel' on the buffer,
+    // and write it back through 'finish'. 'in' and 'out' may refer to the same data.
+template <class Buffer, unsigned int N, class T1, class S1, class T2, class S2,
+          class Init, class Kernel, class Finish>
+void
+separableDistLines(MultiArrayView<N, T1, S1> const & in, MultiArrayView<N, T2, S2> out,
+                   int d, MultiArrayIndex begin, MultiArrayIndex end, Buffer & buffer,
+                   Init const & init, Kernel const & kernel, Finish const & finish)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape lineShape(in.shape());
+    lineShape[d] = 1;
+    MultiArrayIndex size = in.shape(d),
+                    instride = in.stride(d),
+                    outstride = out.stride(d);
+    buffer.resize(size);
+
+    for(MultiArrayIndex l = begin; l < end; ++l)
+    {
+        Shape p;
+        detail::ScanOrderToCoordinate<N>::exec(l, lineShape, p);
+        T1 const * s = &in[p];
+        T2 * t = &out[p];
+        for(MultiArrayIndex k = 0; k < size; ++k, s += instride)
+            buffer[k] = init(*s);
+        kernel(buffer.begin(), buffer.end());
+        for(MultiArrayIndex k = 0; k < size; ++k, t += outstride)
+            *t = finish(buffer[k]);
+    }
+}
+
+    // parallel version of the above, distributing all lines over the pool
+template <class Buffer, unsigned int N, class T1, class S1, class T2, class S2,
+          class Init, class Kernel, class Finish>
+void
+separableDistLinePass(MultiArrayView<N, T1, S1> const & in, MultiArrayView<N, T2, S2> out,
+                      int d, Init const & init, Kernel const & kernel, Finish const & finish,
+                      ThreadPool & pool)
+{
+    MultiArrayIndex lineCount = in.size() / in.shape(d);
+    std::vector<Buffer> buffers(std::max<std::size_t>(1, pool.nThreads()));
+
+    parallel_foreach(pool, lineCount,
+        [&](size_t thread_id, MultiArrayIndex l)
+        {
+            separableDistLines<Buffer>(in, out, d, l, l+1, buffers[thread_id],
+                                       init, kernel, finish);
+        });
+}
+
+    // Determine the initial distance and whether the destination type can hold
+    // intermediate results (cf. separableMultiDistSquared()).
+template <class DestType, class Shape, class Array>
+bool
+separableDistNeedsTmp(Shape const & shape, Array const & pixelPitch,
+                      typename NumericTraits<DestType>::RealPromote & maxDist)
+{
+    typedef typename NumericTraits<DestType>::RealPromote Real;
+
+    double dmax = 0.0;
+    bool pixelPitchIsReal = false;
+    for(int k=0; k<(int)shape.size(); ++k)
+    {
+        if(int(pixelPitch[k]) != pixelPitch[k])
+            pixelPitchIsReal = true;
+        dmax += sq(pixelPitch[k]*shape[k]);
+    }
+    bool needTmp = dmax > NumericTraits<DestType>::toRealPromote(NumericTraits<DestType>::max())
+                   || pixelPitchIsReal;
+    maxDist = needTmp
+                  ? (Real)dmax
+                  : (Real)DestType(std::ceil(dmax));
+    return needTmp;
+}
+
+template <unsigned int N, class T1, class S1, class TI, class SI, class T2, class S2,
+          class Array, class Finish>
+void
+separableMultiDistParallelImpl(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, TI, SI> inter,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background, Array const & pixelPitch,
+                               typename NumericTraits<T2>::RealPromote maxDist,
+                               Finish const & finish, ThreadPool & pool)
+{
+    typedef typename NumericTraits<T2>::RealPromote Real;
+    typedef ArrayVector<Real> Buffer;
+
+    DistThreshold<T1, Real> init(background, maxDist);
+    if(N == 1)
+    {
+        separableDistLinePass<Buffer>(source, dest, 0, init,
+                                      DistParabolaKernel(pixelPitch[0]), finish, pool);
+        return;
+    }
+    separableDistLinePass<Buffer>(source, inter, 0, init,
+                                  DistParabolaKernel(pixelPitch[0]), DistCast<TI>(), pool);
+    for(int d = 1; d < (int)N-1; ++d)
+        separableDistLinePass<Buffer>(inter, inter, d, DistCast<Real>(),
+                                      DistParabolaKernel(pixelPitch[d]), DistCast<TI>(), pool);
+    separableDistLinePass<Buffer>(inter, dest, N-1, DistCast<Real>(),
+                                  DistParabolaKernel(pixelPitch[N-1]), finish, pool);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2,
+          class Array, class Finish>
+void
+separableMultiDistParallel(MultiArrayView<N, T1, S1> const & source,
+                           MultiArrayView<N, T2, S2> dest,
+                           bool background, Array const & pixelPitch,
+                           Finish const & finish, ParallelOptions const & options)
+{
+    typedef typename NumericTraits<T2>::RealPromote Real;
+
+    ThreadPool pool(options);
+    Real maxDist;
+    if(separableDistNeedsTmp<T2>(source.shape(), pixelPitch, maxDist) && N > 1)
+    {
+        // need a temporary array to avoid overflows
+        MultiArray<N, Real> tmpArray(source.shape());
+        separableMultiDistParallelImpl(source, tmpArray, dest, background, pixelPitch,
+                                       maxDist, finish, pool);
+    }
+    else
+    {
+        // work directly on the destination array
+        separableMultiDistParallelImpl(source, dest, dest, background, pixelPitch,
+                                       maxDist, finish, pool);
+    }
+}
+
 } // namespace detail
 
 /** \addtogroup DistanceTransform
@@ -272,6 +471,17 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
         separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                   MultiArrayView<N, T2, S2> dest,
                                   bool background);
+
+        // process the lines along each axis in parallel
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class Array>
+        void
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest,
+                                  bool background,
+                                  Array const & pixelPitch,
+                                  ParallelOptions const & options);
     }
     \endcode
 
@@ -343,6 +553,13 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     <tt> NumericTraits<typename DestAccessor::value_type>::max() < N * M*M</tt>, where M is the
     size of the largest dimension of the array.
 
+    The lines along each axis are independent of each other. When
+    \ref vigra::ParallelOptions (or \ref vigra::BlockwiseOptions) are passed,
+    they are distributed over a \ref vigra::ThreadPool with the given number of threads,
+    and the thresholding of the mask is merged into the first pass.
+    The result is identical to the single-threaded version. A variant for
+    \ref vigra::ChunkedArray is provided in \<vigra/blockwise_distance.hxx\>.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_distance.hxx\><br/>
@@ -356,6 +573,10 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
 
     // Calculate Euclidean distance squared for all background pixels
     separableMultiDistSquared(source, dest, true);
+
+    // the same, using 8 threads
+    separableMultiDistSquared(source, dest, true, TinyVector<double, 3>(1.0),
+                              ParallelOptions().numThreads(8));
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistance()
@@ -479,6 +700,22 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class Array>
+inline void
+separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest, bool background,
+                          Array const & pixelPitch, ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistSquared(): shape mismatch between input and output.");
+    vigra_precondition(pixelPitch.size() == N,
+        "separableMultiDistSquared(): pixelPitch has wrong length.");
+    detail::separableMultiDistParallel(source, dest, background, pixelPitch,
+                                       detail::DistCast<T2>(), options);
+}
+
 /********************************************************/
 /*                                                      */
 /*             separableMultiDistance                   */
@@ -508,6 +745,16 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
         separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                                MultiArrayView<N, T2, S2> dest,
                                bool background);
+
+        // process the lines along each axis in parallel
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2, class Array>
+        void
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background,
+                               Array const & pixelPitch,
+                               ParallelOptions const & options);
     }
     \endcode
 
@@ -655,6 +902,24 @@ separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                             destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, class Array>
+inline void
+separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool background,
+                       Array const & pixelPitch,
+                       ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistance(): shape mismatch between input and output.");
+    vigra_precondition(pixelPitch.size() == N,
+        "separableMultiDistance(): pixelPitch has wrong length.");
+    // the square root is taken while writing the last pass
+    detail::separableMultiDistParallel(source, dest, background, pixelPitch,
+                                       detail::DistSqrt<T2>(), options);
+}
+
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% BoundaryDistanceTransform %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 //rewrite labeled data and work with separableMultiDist
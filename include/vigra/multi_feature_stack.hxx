@@ -0,0 +1,717 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_FEATURE_STACK_HXX
+#define VIGRA_MULTI_FEATURE_STACK_HXX
+
+#include <cmath>
+#include <algorithm>
+#include "multi_blockwise.hxx"
+#include "multi_array_chunked.hxx"
+#include "multi_math.hxx"
+
+namespace vigra {
+
+/** \addtogroup ConvolutionFilters
+*/
+//@{
+
+    /** \brief Features computed by \ref featureStackMultiArray().
+    */
+enum FeatureStackFeature
+{
+    GaussianSmoothingFeature,               ///< Gaussian smoothing (1 channel)
+    GaussianGradientMagnitudeFeature,       ///< Gaussian gradient magnitude (1 channel)
+    LaplacianOfGaussianFeature,             ///< Laplacian of Gaussian (1 channel)
+    StructureTensorEigenvaluesFeature,      ///< eigenvalues of the structure tensor (N channels)
+    HessianOfGaussianEigenvaluesFeature     ///< eigenvalues of the Hessian of Gaussian (N channels)
+};
+
+    /** \brief Options for \ref featureStackMultiArray().
+
+        Holds the list of requested (feature, scale) pairs in the order of the
+        output channels, plus the block shape and number of threads inherited
+        from \ref vigra::BlockwiseOptions.
+    */
+class FeatureStackOptions
+: public BlockwiseOptions
+{
+public:
+    struct Feature
+    {
+        FeatureStackFeature feature;
+        double scale;
+    };
+
+    FeatureStackOptions()
+    :   BlockwiseOptions()
+    ,   outer_scale_factor_(0.5)
+    ,   residual_scale_(1.0)
+    {}
+
+        /** Append a feature at the given scale to the stack. Its channels follow
+            those of all previously added features.
+        */
+    FeatureStackOptions & feature(FeatureStackFeature f, double scale)
+    {
+        vigra_precondition(scale > 0.0,
+            "FeatureStackOptions::feature(): scale must be positive.");
+        Feature feat = { f, scale };
+        features_.push_back(feat);
+        return *this;
+    }
+
+        /** The outer scale of the structure tensor is <tt>factor * scale</tt>.
+
+            Default: 0.5
+        */
+    FeatureStackOptions & structureTensorOuterScale(double factor)
+    {
+        vigra_precondition(factor > 0.0,
+            "FeatureStackOptions::structureTensorOuterScale(): factor must be positive.");
+        outer_scale_factor_ = factor;
+        return *this;
+    }
+
+        /** Scale of the filters that are applied on top of the shared, incrementally
+            smoothed image. Features at scale <tt>s</tt> are computed from the image
+            smoothed at <tt>sqrt(s*s - residual*residual)</tt>, so that derivative
+            filters are never applied with a smaller scale than this. Larger values
+            are more accurate (the result is mathematically identical, but short
+            Gaussian kernels are poorly sampled), smaller values share more work.
+
+            Default: 1.0
+        */
+    FeatureStackOptions & residualScale(double residual)
+    {
+        vigra_precondition(residual > 0.0,
+            "FeatureStackOptions::residualScale(): residual must be positive.");
+        residual_scale_ = residual;
+        return *this;
+    }
+
+    FeatureStackOptions & numThreads(const int n)
+    {
+        BlockwiseOptions::numThreads(n);
+        return *this;
+    }
+
+    FeatureStackOptions & blockShape(const Shape & blockShape)
+    {
+        BlockwiseOptions::blockShape(blockShape);
+        return *this;
+    }
+
+    template <class T, int N>
+    FeatureStackOptions & blockShape(const TinyVector<T, N> & blockShape)
+    {
+        BlockwiseOptions::blockShape(blockShape);
+        return *this;
+    }
+
+    FeatureStackOptions & blockShape(MultiArrayIndex blockShape)
+    {
+        BlockwiseOptions::blockShape(blockShape);
+        return *this;
+    }
+
+    ArrayVector<Feature> const & features() const
+    {
+        return features_;
+    }
+
+    double getStructureTensorOuterScale() const
+    {
+        return outer_scale_factor_;
+    }
+
+    double getResidualScale() const
+    {
+        return residual_scale_;
+    }
+
+        /** Number of channels of a single feature for N-dimensional data.
+        */
+    static unsigned int channelCount(FeatureStackFeature f, unsigned int N)
+    {
+        return (f == StructureTensorEigenvaluesFeature || f == HessianOfGaussianEigenvaluesFeature)
+                   ? N
+                   : 1;
+    }
+
+        /** Total number of output channels for N-dimensional data.
+        */
+    unsigned int numberOfChannels(unsigned int N) const
+    {
+        unsigned int res = 0;
+        for(unsigned int k = 0; k < features_.size(); ++k)
+            res += channelCount(features_[k].feature, N);
+        return res;
+    }
+
+private:
+    ArrayVector<Feature> features_;
+    double outer_scale_factor_, residual_scale_;
+};
+
+//@}
+
+namespace detail {
+
+    // shape of an N-D array with 'channels' appended as the last axis
+template <int N>
+inline TinyVector<MultiArrayIndex, N+1>
+featureStackShape(TinyVector<MultiArrayIndex, N> const & shape, MultiArrayIndex channels)
+{
+    TinyVector<MultiArrayIndex, N+1> res;
+    for(int d = 0; d < N; ++d)
+        res[d] = shape[d];
+    res[N] = channels;
+    return res;
+}
+
+    // kernel radius as chosen by Kernel1D::initGaussian() / initGaussianDerivative()
+inline MultiArrayIndex
+featureStackRadius(double sigma, int order)
+{
+    MultiArrayIndex radius = (MultiArrayIndex)((3.0 + 0.5*order)*sigma + 0.5);
+    return radius == 0 ? 1 : radius;
+}
+
+    // The scales of the stack in ascending order, together with the presmoothing
+    // step that leads to each scale and the filter scale applied on top of it.
+struct FeatureStackPlan
+{
+    struct Step
+    {
+        double scale, presmoothing, filterScale;
+        ArrayVector<unsigned int> features;   // indices into FeatureStackOptions::features()
+        ArrayVector<unsigned int> channels;   // first output channel of each feature
+        MultiArrayIndex margin;               // extra region needed by the structure tensor
+        bool smoothing, gradient, hessian;
+    };
+
+    FeatureStackPlan(FeatureStackOptions const & options, unsigned int N)
+    : border(0)
+    {
+        typedef FeatureStackOptions::Feature Feature;
+        ArrayVector<Feature> const & features = options.features();
+
+        ArrayVector<unsigned int> firstChannel(features.size());
+        ArrayVector<double> scales;
+        for(unsigned int k = 0, c = 0; k < features.size(); ++k)
+        {
+            firstChannel[k] = c;
+            c += FeatureStackOptions::channelCount(features[k].feature, N);
+            scales.push_back(features[k].scale);
+        }
+        std::sort(scales.begin(), scales.end());
+        scales.erase(std::unique(scales.begin(), scales.end()), scales.end());
+
+        double residual = options.getResidualScale(),
+               current = 0.0;
+        MultiArrayIndex presmoothingRadius = 0;
+        for(unsigned int s = 0; s < scales.size(); ++s)
+        {
+            Step step;
+            step.scale = scales[s];
+            step.smoothing = step.gradient = step.hessian = false;
+            step.margin = 0;
+
+            // smooth incrementally, but skip steps whose kernels would be too
+            // small to be sampled accurately
+            double target = std::sqrt(std::max(sq(scales[s]) - sq(residual), 0.0));
+            step.presmoothing = sq(target) - sq(current) >= sq(residual)
+                                    ? std::sqrt(sq(target) - sq(current))
+                                    : 0.0;
+            if(step.presmoothing > 0.0)
+            {
+                current = target;
+                presmoothingRadius += featureStackRadius(step.presmoothing, 0);
+            }
+            step.filterScale = std::sqrt(sq(scales[s]) - sq(current));
+
+            MultiArrayIndex radius = 0;
+            for(unsigned int k = 0; k < features.size(); ++k)
+            {
+                if(features[k].scale != scales[s])
+                    continue;
+                step.features.push_back(k);
+                step.channels.push_back(firstChannel[k]);
+                switch(features[k].feature)
+                {
+                  case GaussianSmoothingFeature:
+                    step.smoothing = true;
+                    radius = std::max(radius, featureStackRadius(step.filterScale, 0));
+                    break;
+                  case GaussianGradientMagnitudeFeature:
+                    step.gradient = true;
+                    radius = std::max(radius, featureStackRadius(step.filterScale, 1));
+                    break;
+                  case StructureTensorEigenvaluesFeature:
+                    step.gradient = true;
+                    step.margin = featureStackRadius(scales[s]*options.getStructureTensorOuterScale(), 0);
+                    radius = std::max(radius, featureStackRadius(step.filterScale, 1) + step.margin);
+                    break;
+                  case LaplacianOfGaussianFeature:
+                  case HessianOfGaussianEigenvaluesFeature:
+                    step.hessian = true;
+                    radius = std::max(radius, featureStackRadius(step.filterScale, 2));
+                    break;
+                }
+            }
+            border = std::max(border, presmoothingRadius + radius);
+            steps.push_back(step);
+        }
+    }
+
+    ArrayVector<Step> steps;
+    MultiArrayIndex border;   // total support of all filter chains
+};
+
+    // A partially filtered image in the derivative tree of featureStackBlock():
+    // 'orders' holds the derivative order applied along each axis processed so far.
+template <unsigned int N, class Real>
+struct FeatureStackComponent
+{
+    TinyVector<int, N> orders;
+    MultiArray<N, Real> image;
+};
+
+    // Compute all features of one block. 'current' holds the input block including
+    // its border and is overwritten by the incrementally smoothed images. 'out' receives
+    // the features of the block's core, with the channels along the last axis.
+    //
+    // The smoothed image, gradient and Hessian of each scale are obtained from a tree
+    // of 1D convolutions, so that partial results (e.g. the first derivative along x)
+    // are shared between all components that need them. Each pass is restricted to
+    // the core plus the margin required by the structure tensor.
+template <unsigned int N, class Real, class T2>
+void
+featureStackBlock(MultiArrayView<N, Real> current,
+                  typename MultiArrayShape<N>::type const & coreBegin,
+                  typename MultiArrayShape<N>::type const & coreEnd,
+                  FeatureStackOptions const & options,
+                  FeatureStackPlan const & plan,
+                  MultiArrayView<N+1, T2> out)
+{
+    using namespace multi_math;
+    typedef FeatureStackPlan::Step Step;
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef TinyVector<int, N> Orders;
+    typedef FeatureStackComponent<N, Real> Component;
+    static const int M = N*(N+1)/2;
+
+    ParallelOptions serial = ParallelOptions().numThreads(ParallelOptions::NoThreads);
+    Shape coreShape = coreEnd - coreBegin;
+    MultiArray<N, Real> tmp(coreShape);
+    MultiArray<N, TinyVector<Real, int(N)> > eigenvalues(coreShape);
+    MultiArray<N, TinyVector<Real, M> > hessian;
+
+    for(unsigned int s = 0; s < plan.steps.size(); ++s)
+    {
+        Step const & step = plan.steps[s];
+        if(step.presmoothing > 0.0)
+            gaussianSmoothMultiArray(current, current, step.presmoothing);
+
+        // derivative orders of the required components
+        ArrayVector<Orders> leaves;
+        if(step.smoothing)
+            leaves.push_back(Orders());
+        for(unsigned int i = 0; i < N; ++i)
+        {
+            if(step.gradient)
+                leaves.push_back(Orders()), leaves.back()[i] = 1;
+            for(unsigned int j = i; j < N && step.hessian; ++j)
+                leaves.push_back(Orders()), leaves.back()[i] += 1, leaves.back()[j] += 1;
+        }
+
+        Kernel1D<double> kernels[3];
+        kernels[0].initGaussian(step.filterScale);
+        kernels[1].initGaussianDerivative(step.filterScale, 1);
+        kernels[2].initGaussianDerivative(step.filterScale, 2);
+
+        Shape roiBegin = max(coreBegin - Shape(step.margin), Shape()),
+              roiEnd   = min(coreEnd + Shape(step.margin), current.shape());
+
+        ArrayVector<Component> level, next;
+        level.reserve(leaves.size());
+        next.reserve(leaves.size());
+        level.push_back(Component());
+        for(unsigned int d = 0; d < N; ++d)
+        {
+            next.clear();
+            for(unsigned int c = 0; c < level.size(); ++c)
+            {
+                for(int o = 0; o < 3; ++o)
+                {
+                    Orders orders(level[c].orders);
+                    orders[d] = o;
+                    bool needed = false;
+                    for(unsigned int l = 0; l < leaves.size() && !needed; ++l)
+                    {
+                        needed = true;
+                        for(unsigned int k = 0; k <= d; ++k)
+                            needed = needed && leaves[l][k] == orders[k];
+                    }
+                    if(!needed)
+                        continue;
+
+                    MultiArrayView<N, Real> src = d == 0
+                                                      ? current
+                                                      : MultiArrayView<N, Real>(level[c].image);
+                    Shape start, stop(src.shape());
+                    start[d] = roiBegin[d];
+                    stop[d]  = roiEnd[d];
+                    next.push_back(Component());
+                    next.back().orders = orders;
+                    next.back().image.reshape(stop - start);
+                    convolveMultiArrayOneDimension(src, next.back().image, d, kernels[o], start, stop);
+                }
+            }
+            level.swap(next);
+        }
+
+        // the components now cover the ROI
+        Shape cb = coreBegin - roiBegin, ce = coreEnd - roiBegin;
+        auto component = [&](Orders const & orders) -> MultiArrayView<N, Real>
+        {
+            for(unsigned int c = 0; c < level.size(); ++c)
+                if(level[c].orders == orders)
+                    return level[c].image;
+            vigra_fail("featureStackMultiArray(): internal error, component not found.");
+            return MultiArrayView<N, Real>();
+        };
+        auto unit = [](unsigned int i, unsigned int j) -> Orders
+        {
+            Orders res;
+            res[i] += 1;
+            res[j] += 1;
+            return res;
+        };
+        auto firstDerivative = [&](unsigned int i) -> MultiArrayView<N, Real>
+        {
+            Orders res;
+            res[i] = 1;
+            return component(res);
+        };
+
+        if(step.hessian)
+        {
+            hessian.reshape(coreShape);
+            for(unsigned int i = 0, k = 0; i < N; ++i)
+                for(unsigned int j = i; j < N; ++j, ++k)
+                    hessian.bindElementChannel(k) = component(unit(i, j)).subarray(cb, ce);
+        }
+
+        for(unsigned int k = 0; k < step.features.size(); ++k)
+        {
+            FeatureStackFeature feature = options.features()[step.features[k]].feature;
+            MultiArrayView<N, T2, StridedArrayTag> channel = out.bindOuter(step.channels[k]);
+            switch(feature)
+            {
+              case GaussianSmoothingFeature:
+              {
+                channel = component(Orders()).subarray(cb, ce);
+                break;
+              }
+              case GaussianGradientMagnitudeFeature:
+              {
+                tmp = 0;
+                for(unsigned int i = 0; i < N; ++i)
+                    tmp += sq(firstDerivative(i).subarray(cb, ce));
+                channel = sqrt(tmp);
+                break;
+              }
+              case LaplacianOfGaussianFeature:
+              {
+                tmp = 0;
+                for(unsigned int i = 0; i < N; ++i)
+                    tmp += component(unit(i, i)).subarray(cb, ce);
+                channel = tmp;
+                break;
+              }
+              case HessianOfGaussianEigenvaluesFeature:
+              {
+                tensorEigenvaluesMultiArray(hessian, eigenvalues, serial);
+                for(unsigned int d = 0; d < N; ++d)
+                    out.bindOuter(step.channels[k] + d) = eigenvalues.bindElementChannel(d);
+                break;
+              }
+              case StructureTensorEigenvaluesFeature:
+              {
+                MultiArray<N, TinyVector<Real, M> > structure(roiEnd - roiBegin);
+                for(unsigned int i = 0, l = 0; i < N; ++i)
+                    for(unsigned int j = i; j < N; ++j, ++l)
+                        structure.bindElementChannel(l) = firstDerivative(i) * firstDerivative(j);
+                gaussianSmoothMultiArray(structure, structure,
+                                         step.scale*options.getStructureTensorOuterScale());
+                tensorEigenvaluesMultiArray(structure.subarray(cb, ce), eigenvalues, serial);
+                for(unsigned int d = 0; d < N; ++d)
+                    out.bindOuter(step.channels[k] + d) = eigenvalues.bindElementChannel(d);
+                break;
+              }
+            }
+        }
+    }
+}
+
+template <unsigned int N, class T, class S, class U>
+inline void
+featureStackRead(MultiArrayView<N, T, S> const & source,
+                 typename MultiArrayShape<N>::type const & start,
+                 MultiArrayView<N, U> block)
+{
+    block = source.subarray(start, start + block.shape());
+}
+
+template <unsigned int N, class T, class U>
+inline void
+featureStackRead(ChunkedArray<N, T> const & source,
+                 typename MultiArrayShape<N>::type const & start,
+                 MultiArrayView<N, U> block)
+{
+    source.checkoutSubarray(start, block);
+}
+
+template <unsigned int N, class T, class S, class U>
+inline void
+featureStackWrite(MultiArrayView<N, T, S> dest,
+                  typename MultiArrayShape<N>::type const & start,
+                  MultiArrayView<N, U> const & block)
+{
+    dest.subarray(start, start + block.shape()) = block;
+}
+
+template <unsigned int N, class T, class U>
+inline void
+featureStackWrite(ChunkedArray<N, T> & dest,
+                  typename MultiArrayShape<N>::type const & start,
+                  MultiArrayView<N, U> const & block)
+{
+    dest.commitSubarray(start, block);
+}
+
+template <unsigned int N, class T1, class T2, class Source, class Dest>
+void
+featureStackImpl(Source const & source, Dest & dest,
+                 TinyVector<MultiArrayIndex, N> const & shape,
+                 TinyVector<MultiArrayIndex, N> const & chunkShape,
+                 FeatureStackOptions const & options)
+{
+    typedef typename NumericTraits<T1>::RealPromote Real;
+    typedef MultiBlocking<N, MultiArrayIndex> Blocking;
+    typedef typename Blocking::Shape Shape;
+    typedef typename Blocking::BlockWithBorder BlockWithBorder;
+
+    FeatureStackPlan plan(options, N);
+    unsigned int channels = options.numberOfChannels(N);
+    if(channels == 0 || prod(shape) == 0)
+        return;
+
+    // The border is recomputed for every block, so the default blocks are chosen
+    // large compared to the border: multiples of the chunk shape for chunked output,
+    // one slab per thread along the last axis otherwise.
+    Shape blockShape;
+    if(options.getBlockShape().size() > 0)
+    {
+        blockShape = options.template getBlockShapeN<N>();
+    }
+    else if(prod(chunkShape) > 0)
+    {
+        for(unsigned int d = 0; d < N; ++d)
+            blockShape[d] = std::min(shape[d],
+                                     chunkShape[d]*((4*plan.border + chunkShape[d] - 1) / chunkShape[d]));
+    }
+    else
+    {
+        blockShape = shape;
+        MultiArrayIndex threads = std::max(options.getActualNumThreads(), 1);
+        blockShape[N-1] = std::max((shape[N-1] + threads - 1) / threads,
+                                   std::min(shape[N-1], 2*plan.border));
+    }
+
+    Blocking blocking(shape, blockShape);
+    parallel_foreach(options.getNumThreads(),
+        blocking.blockWithBorderBegin(Shape(plan.border)),
+        blocking.blockWithBorderEnd(Shape(plan.border)),
+        [&](const int /*threadId*/, const BlockWithBorder bwb)
+        {
+            MultiArray<N, Real> block(bwb.border().size());
+            featureStackRead(source, bwb.border().begin(), block);
+
+            MultiArray<N+1, T2> out(featureStackShape(bwb.core().size(), channels));
+            featureStackBlock(MultiArrayView<N, Real>(block), bwb.localCore().begin(),
+                              bwb.localCore().end(), options, plan, MultiArrayView<N+1, T2>(out));
+
+            featureStackWrite(dest, featureStackShape(bwb.core().begin(), 0), MultiArrayView<N+1, T2>(out));
+        },
+        blocking.numBlocks()
+    );
+}
+
+} // namespace detail
+
+/** \addtogroup ConvolutionFilters
+*/
+//@{
+
+    /** \brief Compute a stack of filter features at several scales in a single blockwise pass.
+
+        <b> Declarations:</b>
+
+        \code
+        namespace vigra {
+            template <unsigned int N, class T1, class S1,
+                                      class T2, class S2>
+            void
+            featureStackMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                   MultiArrayView<N+1, T2, S2> dest,
+                                   FeatureStackOptions const & options);
+
+            template <unsigned int N, class T1, class S1, class T2>
+            void
+            featureStackMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                   ChunkedArray<N+1, T2> & dest,
+                                   FeatureStackOptions const & options);
+
+            template <unsigned int N, class T1, class T2>
+            void
+            featureStackMultiArray(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N+1, T2> & dest,
+                                   FeatureStackOptions const & options);
+        }
+        \endcode
+
+        The features requested in \ref vigra::FeatureStackOptions are written to
+        consecutive channels along the last axis of <tt>dest</tt>, in the order in which they were added to the options. Its shape must
+        equal <tt>source.shape()</tt> with <tt>options.numberOfChannels(N)</tt> appended.
+        Eigenvalues are sorted in descending order.
+
+        Instead of calling the individual filter functions, which re-read and re-smooth
+        the input for every feature, the data are processed block by block, and all
+        features of a block are derived from shared intermediate results:
+        <ul>
+        <li> The block is smoothed incrementally from one scale to the next, using the
+             semi-group property of the Gaussian. Each feature at scale <tt>s</tt> only
+             applies a filter of scale \ref FeatureStackOptions::residualScale() "residual"
+             on top of this.
+        <li> The smoothed image, gradient and Hessian of a scale are computed together
+             by a tree of 1D convolutions that shares partial results between the
+             components. Gradient magnitude and structure tensor use the same gradient,
+             Laplacian of Gaussian and Hessian eigenvalues the same Hessian.
+        </ul>
+        Blocks are enlarged by the total support of the filter chains, so that the result
+        does not depend on the block shape. It differs from the individual filters (e.g.
+        \ref gaussianSmoothMultiArray()) only by kernel truncation and sampling effects.
+        In the worst case (white noise input), these amount to about 1% of the signal
+        range with the default residual scale, and they decrease quickly for smoother
+        data or a larger residual scale.
+
+        Since each block is enlarged by the filter support, blocks should be large
+        compared to the largest scale. When no block shape is given, a \ref ChunkedArray
+        <tt>dest</tt> is processed in blocks of whole chunks that are at least four times
+        the border width, and a plain array is split into one slab per thread along
+        its last axis.
+
+        <b> Usage:</b>
+
+        <b>\#include</b> \<vigra/multi_feature_stack.hxx\><br/>
+        Namespace: vigra
+
+        \code
+        MultiArray<3, float> volume(shape);
+        ...
+        FeatureStackOptions options;
+        double scales[] = { 0.7, 1.0, 1.6, 3.5, 5.0 };
+        for(int k=0; k<5; ++k)
+            options.feature(GaussianSmoothingFeature, scales[k])
+                   .feature(GaussianGradientMagnitudeFeature, scales[k])
+                   .feature(HessianOfGaussianEigenvaluesFeature, scales[k]);
+        options.numThreads(8).blockShape(64);
+
+        MultiArray<4, float> features(Shape4(shape[0], shape[1], shape[2],
+                                             options.numberOfChannels(3)));
+        featureStackMultiArray(volume, features, options);
+        \endcode
+
+        <b> Preconditions:</b>
+
+        <tt>N == 2</tt> or <tt>N == 3</tt>
+    */
+doxygen_overloaded_function(template <...> void featureStackMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+featureStackMultiArray(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N+1, T2, S2> dest,
+                       FeatureStackOptions const & options)
+{
+    vigra_precondition(dest.shape() == detail::featureStackShape(source.shape(), options.numberOfChannels(N)),
+        "featureStackMultiArray(): shape mismatch between input and output.");
+    detail::featureStackImpl<N, T1, T2>(source, dest, source.shape(),
+                                        typename MultiArrayShape<N>::type(), options);
+}
+
+template <unsigned int N, class T1, class S1, class T2>
+void
+featureStackMultiArray(MultiArrayView<N, T1, S1> const & source,
+                       ChunkedArray<N+1, T2> & dest,
+                       FeatureStackOptions const & options)
+{
+    vigra_precondition(dest.shape() == detail::featureStackShape(source.shape(), options.numberOfChannels(N)),
+        "featureStackMultiArray(): shape mismatch between input and output.");
+    detail::featureStackImpl<N, T1, T2>(source, dest, source.shape(),
+                                        dest.chunkShape().dropIndex(N), options);
+}
+
+template <unsigned int N, class T1, class T2>
+void
+featureStackMultiArray(ChunkedArray<N, T1> const & source,
+                       ChunkedArray<N+1, T2> & dest,
+                       FeatureStackOptions const & options)
+{
+    vigra_precondition(dest.shape() == detail::featureStackShape(source.shape(), options.numberOfChannels(N)),
+        "featureStackMultiArray(): shape mismatch between input and output.");
+    detail::featureStackImpl<N, T1, T2>(source, dest, source.shape(),
+                                        dest.chunkShape().dropIndex(N), options);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_FEATURE_STACK_HXX
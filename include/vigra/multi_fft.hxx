@@ -43,6 +43,12 @@
 #include "navigator.hxx"
 #include "copyimage.hxx"
 #include "threading.hxx"
+#include <vigra/config_fftw.hxx>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace vigra {
 
@@ -398,6 +404,213 @@ fftwPlanExecute(fftwl_plan plan, FFTWComplex<long double> * in,  long double * o
     fftwl_execute_dft_c2r(plan, (fftwl_complex *)in, out);
 }
 
+    // process-wide FFTW settings, modified by fftwSetNumThreads(), fftwEnablePlanCache(),
+    // and fftwSetPlanCacheCapacity()
+template <int DUMMY=0>
+struct FFTWSettings
+{
+    static int         nThreads;
+    static bool        cachePlans;
+    static std::size_t cacheCapacity;
+};
+
+template <int DUMMY>
+int FFTWSettings<DUMMY>::nThreads = 1;
+
+template <int DUMMY>
+bool FFTWSettings<DUMMY>::cachePlans = true;
+
+template <int DUMMY>
+std::size_t FFTWSettings<DUMMY>::cacheCapacity = 128;
+
+    // Multi-threaded execution requires the fftw3_threads libraries (see fftwSetNumThreads()).
+    // The PlanType argument only selects the precision. The flags are defined in the
+    // generated header config_fftw.hxx.
+template <class PlanType>
+inline void fftwPlannerThreads(PlanType, int)
+{}
+
+#ifdef VIGRA_FFTW_THREADS
+
+inline void fftwPlannerThreads(fftw_plan, int nThreads)
+{
+    static const bool initialized = fftw_init_threads() != 0;
+    if(initialized)
+        fftw_plan_with_nthreads(nThreads);
+}
+
+inline void fftwPlannerThreads(fftwf_plan, int nThreads)
+{
+    static const bool initialized = fftwf_init_threads() != 0;
+    if(initialized)
+        fftwf_plan_with_nthreads(nThreads);
+}
+
+#endif // VIGRA_FFTW_THREADS
+
+#ifdef VIGRA_FFTWL_THREADS
+
+inline void fftwPlannerThreads(fftwl_plan, int nThreads)
+{
+    static const bool initialized = fftwl_init_threads() != 0;
+    if(initialized)
+        fftwl_plan_with_nthreads(nThreads);
+}
+
+#endif // VIGRA_FFTWL_THREADS
+
+inline int fftwAlignmentOf(double * p)
+{
+    return fftw_alignment_of(p);
+}
+
+inline int fftwAlignmentOf(float * p)
+{
+    return fftwf_alignment_of(p);
+}
+
+inline int fftwAlignmentOf(long double * p)
+{
+    return fftwl_alignment_of(p);
+}
+
+template <class Real>
+inline int fftwAlignmentOf(FFTWComplex<Real> * p)
+{
+    return fftwAlignmentOf((Real *)p);
+}
+
+    // Owns an FFTW plan. The plan is shared between the plan cache and
+    // all FFTWPlan objects using it, and destroyed with the last reference.
+template <class PlanType>
+class FFTWPlanHandle
+{
+  public:
+    explicit FFTWPlanHandle(PlanType plan)
+    : plan_(plan)
+    {}
+
+    ~FFTWPlanHandle()
+    {
+        FFTWLock<> lock;
+        fftwPlanDestroy(plan_);
+    }
+
+    PlanType get() const
+    {
+        return plan_;
+    }
+
+  private:
+    FFTWPlanHandle(FFTWPlanHandle const &);
+    FFTWPlanHandle & operator=(FFTWPlanHandle const &);
+
+    PlanType plan_;
+};
+
+template <class PlanType>
+struct FFTWPlanCache
+{
+    typedef std::shared_ptr<FFTWPlanHandle<PlanType> >  Handle;
+    typedef std::vector<long>                           Key;
+    typedef std::map<Key, Handle>                       Map;
+
+        // Never destroyed, because plans must not outlive the FFTW library
+        // (whose state may already be gone when static destructors run).
+        // Must only be accessed while holding FFTWLock.
+    static Map & plans()
+    {
+        static Map * m = new Map;
+        return *m;
+    }
+
+        // keys of the cached plans, oldest first
+    static std::deque<Key> & insertionOrder()
+    {
+        static std::deque<Key> * o = new std::deque<Key>;
+        return *o;
+    }
+
+        // Remove the oldest plans until at most 'capacity' remain. The removed handles
+        // are appended to 'removed', so that the caller can destroy them after
+        // releasing the lock. Must only be called while holding FFTWLock.
+    static void shrink(std::size_t capacity, std::vector<Handle> & removed)
+    {
+        Map & m = plans();
+        std::deque<Key> & order = insertionOrder();
+        while(m.size() > capacity)
+        {
+            typename Map::iterator i = m.find(order.front());
+            removed.push_back(i->second);
+            m.erase(i);
+            order.pop_front();
+        }
+    }
+
+    static void clear(Map & removed)
+    {
+        removed.swap(plans());
+        insertionOrder().clear();
+    }
+};
+
+    // Create a plan or get it from the cache. Plans are reusable for all arrays with the
+    // same layout and alignment (new-array execute functions), so the cache key consists of
+    // the transform type, shape, strides, sign, planner flags, number of threads, alignment,
+    // and whether the transform is in-place.
+template <class PlanType, class T1, class T2>
+std::shared_ptr<FFTWPlanHandle<PlanType> >
+fftwPlanCreateShared(unsigned int N, int* shape,
+                     T1 * in,  int* instrides,  int instep,
+                     T2 * out, int* outstrides, int outstep,
+                     int sign, unsigned int planner_flags)
+{
+    typedef typename FFTWPlanCache<PlanType>::Handle Handle;
+
+    // plans removed from the cache must not be destroyed while we hold the lock
+    std::vector<Handle> removed;
+    FFTWLock<> lock;
+
+    const int nThreads = FFTWSettings<>::nThreads;
+    std::vector<long> key;
+    if(FFTWSettings<>::cachePlans)
+    {
+        key.push_back(sizeof(T1));
+        key.push_back(sizeof(T2));
+        key.push_back(N);
+        key.push_back(sign);
+        key.push_back(planner_flags);
+        key.push_back(nThreads);
+        key.push_back((void *)in == (void *)out);
+        key.push_back(fftwAlignmentOf(in));
+        key.push_back(fftwAlignmentOf(out));
+        key.insert(key.end(), shape, shape+N);
+        key.insert(key.end(), instrides, instrides+N);
+        key.push_back(instep);
+        key.insert(key.end(), outstrides, outstrides+N);
+        key.push_back(outstep);
+
+        typename FFTWPlanCache<PlanType>::Map::const_iterator i = FFTWPlanCache<PlanType>::plans().find(key);
+        if(i != FFTWPlanCache<PlanType>::plans().end())
+            return i->second;
+    }
+
+    fftwPlannerThreads(PlanType(), nThreads);
+    PlanType plan = fftwPlanCreate(N, shape, in, instrides, instep,
+                                   out, outstrides, outstep, sign, planner_flags);
+    if(plan == 0)
+        return Handle();
+    // the handle must not be destroyed while we hold the lock
+    Handle handle(new FFTWPlanHandle<PlanType>(plan));
+    if(FFTWSettings<>::cachePlans && FFTWSettings<>::cacheCapacity > 0)
+    {
+        FFTWPlanCache<PlanType>::shrink(FFTWSettings<>::cacheCapacity - 1, removed);
+        FFTWPlanCache<PlanType>::plans()[key] = handle;
+        FFTWPlanCache<PlanType>::insertionOrder().push_back(key);
+    }
+    return handle;
+}
+
 template <int DUMMY>
 struct FFTWPaddingSize
 {
@@ -815,6 +1028,194 @@ fftwCorrespondingShapeC2R(TinyVector<T, N> shape, bool oddDimension0 = false)
     return shape;
 }
 
+/********************************************************/
+/*                                                      */
+/*                   FFTW configuration                 */
+/*                                                      */
+/********************************************************/
+
+/** \brief Set the number of threads FFTW uses to execute subsequently created plans.
+
+    Multi-threaded execution is only available when VIGRA's CMake scripts found FFTW's
+    threads libraries (<tt>fftw3_threads</tt> and <tt>fftw3f_threads</tt>, and
+    <tt>fftw3l_threads</tt> for long double transforms). This is recorded by the flags
+    <tt>VIGRA_FFTW_THREADS</tt> and <tt>VIGRA_FFTWL_THREADS</tt> in the generated header
+    \<vigra/config_fftw.hxx\>, and programs must then link the respective threads
+    libraries in addition to FFTW (VIGRA adds them to <tt>FFTW3_LIBRARIES</tt> and
+    <tt>FFTW3F_LIBRARIES</tt>). Otherwise, the setting has no effect.
+    Plans that already exist keep their number of threads.
+
+    Default: 1
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+inline void fftwSetNumThreads(int n)
+{
+    detail::FFTWLock<> lock;
+    detail::FFTWSettings<>::nThreads = std::max(1, n);
+}
+
+    /** \brief Number of threads set by fftwSetNumThreads().
+    */
+inline int fftwGetNumThreads()
+{
+    detail::FFTWLock<> lock;
+    return detail::FFTWSettings<>::nThreads;
+}
+
+/** \brief Switch the process-wide FFTW plan cache on or off.
+
+    FFTWPlan (and thus FFTWConvolvePlan, \ref fourierTransform(), and \ref convolveFFT())
+    looks up plans in a cache keyed by transform type, shape, strides, planner flags, number of
+    threads, and memory alignment, so that the planning cost (e.g. of <tt>FFTW_MEASURE</tt>)
+    is paid only once per array layout. In contrast to a new plan, a cached plan doesn't
+    overwrite the arrays passed to FFTWPlan::init(). Switching the cache off does not remove
+    plans that are already cached, call fftwClearPlanCache() for this purpose. The number of
+    cached plans is limited by fftwSetPlanCacheCapacity().
+
+    Default: <tt>true</tt>
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+inline void fftwEnablePlanCache(bool enable)
+{
+    detail::FFTWLock<> lock;
+    detail::FFTWSettings<>::cachePlans = enable;
+}
+
+/** \brief Remove all plans from the cache.
+
+    Plans that are still used by an FFTWPlan object will be destroyed together with
+    this object.
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+inline void fftwClearPlanCache()
+{
+    detail::FFTWPlanCache<fftw_plan>::Map  plans;
+    detail::FFTWPlanCache<fftwf_plan>::Map plansf;
+    detail::FFTWPlanCache<fftwl_plan>::Map plansl;
+    {
+        detail::FFTWLock<> lock;
+        detail::FFTWPlanCache<fftw_plan>::clear(plans);
+        detail::FFTWPlanCache<fftwf_plan>::clear(plansf);
+        detail::FFTWPlanCache<fftwl_plan>::clear(plansl);
+    }
+    // plans are destroyed here, after the lock has been released
+}
+
+/** \brief Set the maximum number of plans in the cache.
+
+    The capacity applies to each precision (<tt>float</tt>, <tt>double</tt>,
+    <tt>long double</tt>) separately. When a new plan is added to a full cache,
+    the oldest plan is removed. Reducing the capacity removes the oldest plans immediately,
+    a capacity of zero effectively disables the cache. Plans that are still used by an
+    FFTWPlan object will be destroyed together with this object.
+
+    Default: 128
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+inline void fftwSetPlanCacheCapacity(std::size_t capacity)
+{
+    std::vector<detail::FFTWPlanCache<fftw_plan>::Handle>  plans;
+    std::vector<detail::FFTWPlanCache<fftwf_plan>::Handle> plansf;
+    std::vector<detail::FFTWPlanCache<fftwl_plan>::Handle> plansl;
+    {
+        detail::FFTWLock<> lock;
+        detail::FFTWSettings<>::cacheCapacity = capacity;
+        detail::FFTWPlanCache<fftw_plan>::shrink(capacity, plans);
+        detail::FFTWPlanCache<fftwf_plan>::shrink(capacity, plansf);
+        detail::FFTWPlanCache<fftwl_plan>::shrink(capacity, plansl);
+    }
+    // plans are destroyed here, after the lock has been released
+}
+
+    /** \brief Capacity set by fftwSetPlanCacheCapacity().
+    */
+inline std::size_t fftwGetPlanCacheCapacity()
+{
+    detail::FFTWLock<> lock;
+    return detail::FFTWSettings<>::cacheCapacity;
+}
+
+namespace detail {
+
+inline bool fftwImportWisdom(double *, const char * filename)
+{
+    return fftw_import_wisdom_from_filename(filename) != 0;
+}
+
+inline bool fftwImportWisdom(float *, const char * filename)
+{
+    return fftwf_import_wisdom_from_filename(filename) != 0;
+}
+
+inline bool fftwImportWisdom(long double *, const char * filename)
+{
+    return fftwl_import_wisdom_from_filename(filename) != 0;
+}
+
+inline bool fftwExportWisdom(double *, const char * filename)
+{
+    return fftw_export_wisdom_to_filename(filename) != 0;
+}
+
+inline bool fftwExportWisdom(float *, const char * filename)
+{
+    return fftwf_export_wisdom_to_filename(filename) != 0;
+}
+
+inline bool fftwExportWisdom(long double *, const char * filename)
+{
+    return fftwl_export_wisdom_to_filename(filename) != 0;
+}
+
+} // namespace detail
+
+/** \brief Load FFTW <a href="http://www.fftw.org/doc/Wisdom.html">wisdom</a> from a file.
+
+    Wisdom stores the results of previous <tt>FFTW_MEASURE</tt> (or <tt>FFTW_PATIENT</tt>)
+    planning, so that subsequent planning with these flags is fast. Wisdom is specific to
+    the floating point precision given by the template parameter <tt>Real</tt>
+    (<tt>double</tt>, <tt>float</tt>, or <tt>long double</tt>).
+    Returns <tt>false</tt> if the file could not be read.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    fftwImportWisdom<float>("fftwf_wisdom.dat");  // failure is ok on the first run
+
+    ... // plan and execute transforms with FFTW_MEASURE
+
+    fftwExportWisdom<float>("fftwf_wisdom.dat");
+    \endcode
+*/
+template <class Real>
+bool fftwImportWisdom(std::string const & filename)
+{
+    detail::FFTWLock<> lock;
+    return detail::fftwImportWisdom((Real *)0, filename.c_str());
+}
+
+/** \brief Save the accumulated FFTW wisdom to a file.
+
+    See fftwImportWisdom() for details. Returns <tt>false</tt> if the file could not be written.
+*/
+template <class Real>
+bool fftwExportWisdom(std::string const & filename)
+{
+    detail::FFTWLock<> lock;
+    return detail::fftwExportWisdom((Real *)0, filename.c_str());
+}
+
 /********************************************************/
 /*                                                      */
 /*                       FFTWPlan                       */
@@ -854,8 +1255,9 @@ class FFTWPlan
     typedef ArrayVector<int> Shape;
     typedef typename FFTWReal2Complex<Real>::plan_type PlanType;
     typedef typename FFTWComplex<Real>::complex_type Complex;
+    typedef std::shared_ptr<detail::FFTWPlanHandle<PlanType> > PlanHandle;
 
-    PlanType plan;
+    PlanHandle plan;
     Shape shape, instrides, outstrides;
     int sign;
 
@@ -865,7 +1267,6 @@ class FFTWPlan
             The plan can be initialized later by one of the init() functions.
         */
     FFTWPlan()
-    : plan(0)
     {}
 
         /** \brief Create a plan for a complex-to-complex transform.
@@ -880,7 +1281,6 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, FFTWComplex<Real>, C1> in,
              MultiArrayView<N, FFTWComplex<Real>, C2> out,
              int SIGN, unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
     {
         init(in, out, SIGN, planner_flags);
     }
@@ -900,7 +1300,6 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, Real, C1> in,
              MultiArrayView<N, FFTWComplex<Real>, C2> out,
              unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
     {
         init(in, out, planner_flags);
     }
@@ -920,7 +1319,6 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, FFTWComplex<Real>, C1> in,
              MultiArrayView<N, Real, C2> out,
              unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
     {
         init(in, out, planner_flags);
     }
@@ -935,7 +1333,7 @@ class FFTWPlan
         shape.swap(o.shape);
         instrides.swap(o.instrides);
         outstrides.swap(o.outstrides);
-        o.plan = 0; // act like std::auto_ptr
+        o.plan.reset(); // act like std::auto_ptr
     }
 
         /** \brief Copy assigment.
@@ -950,18 +1348,18 @@ class FFTWPlan
             instrides.swap(o.instrides);
             outstrides.swap(o.outstrides);
             sign = o.sign;
-            o.plan = 0; // act like std::auto_ptr
+            o.plan.reset(); // act like std::auto_ptr
         }
         return *this;
     }
 
         /** \brief Destructor.
+
+            The underlying FFTW plan is destroyed when it is neither used by
+            another FFTWPlan nor held by the plan cache (see fftwEnablePlanCache()).
         */
     ~FFTWPlan()
-    {
-        detail::FFTWLock<> lock;
-        detail::fftwPlanDestroy(plan);
-    }
+    {}
 
         /** \brief Init a complex-to-complex transform.
 
@@ -1112,15 +1510,10 @@ FFTWPlan<N, Real>::initImpl(MI ins, MO outs, int SIGN, unsigned int planner_flag
         ototal[j] = outs.stride(j-1) / outs.stride(j);
     }
 
-    {
-        detail::FFTWLock<> lock;
-        PlanType newPlan = detail::fftwPlanCreate(N, newShape.begin(),
-                                      ins.data(), itotal.begin(), ins.stride(N-1),
-                                      outs.data(), ototal.begin(), outs.stride(N-1),
-                                      SIGN, planner_flags);
-        detail::fftwPlanDestroy(plan);
-        plan = newPlan;
-    }
+    plan = detail::fftwPlanCreateShared<PlanType>(N, newShape.begin(),
+                        ins.data(), itotal.begin(), ins.stride(N-1),
+                        outs.data(), ototal.begin(), outs.stride(N-1),
+                        SIGN, planner_flags);
 
     shape.swap(newShape);
     instrides.swap(newIStrides);
@@ -1145,7 +1538,7 @@ void FFTWPlan<N, Real>::executeImpl(MI ins, MO outs) const
     vigra_precondition((outs.stride() == TinyVectorView<int, N>(outstrides.data())),
         "FFTWPlan::execute(): strides mismatch between plan and output data.");
 
-    detail::fftwPlanExecute(plan, ins.data(), outs.data());
+    detail::fftwPlanExecute(plan->get(), ins.data(), outs.data());
 
     typedef typename MO::value_type V;
     if(sign == FFTW_BACKWARD)
@@ -38,10 +38,12 @@
 #define VIGRA_MULTI_IMPEX_HXX
 
 #include <memory>
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <fstream>
 
 #include "config.hxx"
@@ -50,6 +52,10 @@
 #include "multi_array.hxx"
 #include "multi_pointoperators.hxx"
 #include "sifImport.hxx"
+#include "tiff_page_writer.hxx"
+#ifndef VIGRA_SINGLE_THREADED
+# include "threadpool.hxx"
+#endif
 
 #ifdef _MSC_VER
 # include <direct.h>
@@ -225,7 +231,18 @@ class VolumeImportInfo
     template <class T, class Stride>
     void importImpl(MultiArrayView <3, T, Stride> &volume) const;
 
+#ifndef VIGRA_SINGLE_THREADED
+        // decode the slices of image stacks and multi-page files concurrently
+    template <class T, class Stride>
+    void importImpl(MultiArrayView <3, T, Stride> &volume,
+                    ParallelOptions const & options) const;
+#endif
+
   protected:
+        // import slice 'k' of an image stack
+    template <class T, class Stride>
+    void importSlice(MultiArrayView <3, T, Stride> &volume, MultiArrayIndex k) const;
+
     void getVolumeInfoFromFirstSlice(const std::string &filename);
 
     size_type shape_;
@@ -484,6 +501,31 @@ readVolumeImpl(DestIterator d, Shape const & shape, std::ifstream & s, ArrayVect
     }
 }
 
+// Decode the region 'roi' of the pages [first_page, first_page+dest.shape(2))
+// of a multi-page file into 'dest'. A single decoder steps through the pages
+// in order, which avoids reopening the file and searching for each page's
+// directory from the beginning.
+template <class T, class Stride>
+void
+importPages(std::string const & filename, Rect2D const & roi,
+            MultiArrayIndex first_page, MultiArrayView<3, T, Stride> dest)
+{
+    VIGRA_UNIQUE_PTR<Decoder> decoder(getDecoder(filename, "undefined", (unsigned int)first_page));
+    const unsigned int width = decoder->getWidth(), height = decoder->getHeight();
+
+    for(MultiArrayIndex k=0; k<dest.shape(2); ++k)
+    {
+        if(k > 0)
+        {
+            decoder->setImageIndex((unsigned int)(first_page + k));
+            vigra_precondition(decoder->getWidth() == width && decoder->getHeight() == height,
+                "importVolume(): the images have inconsistent sizes.");
+        }
+        importImage(decoder.get(), roi, dest.bindOuter(k));
+    }
+    finish_roi(decoder.get(), roi);
+}
+
 } // namespace detail
 
 template <class T, class Stride>
@@ -542,31 +584,12 @@ void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
     }
     else if(fileType_ == "STACK")
     {
-        for (unsigned int i = 0; i < numbers_.size(); ++i)
-        {
-            // build the filename
-            std::string filename = baseName_ + numbers_[i] + extension_;
-
-            // import the image
-            ImageImportInfo info (filename.c_str ());
-
-            // generate a basic image view to the current layer
-            MultiArrayView <2, T, Stride> view (volume.bindOuter (i));
-            vigra_precondition(view.shape() == info.shape(),
-                "importVolume(): the images have inconsistent sizes.");
-
-            importImage (info, destImage(view));
-        }
+        for(MultiArrayIndex k=0; k<volume.shape(2); ++k)
+            importSlice(volume, k);
     }
     else if(fileType_ == "MULTIPAGE")
     {
-        ImageImportInfo info(baseName_.c_str());
-
-        for(int k=0; k<info.numImages(); ++k)
-        {
-            info.setImageIndex(k);
-            importImage(info, volume.bindOuter(k));
-        }
+        detail::importPages(baseName_, Rect2D(Size2D(shape_[0], shape_[1])), 0, volume);
     }
     // else if(fileType_ == "HDF5")
     // {
@@ -581,6 +604,62 @@ void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
 }
 
 
+#ifndef VIGRA_SINGLE_THREADED
+template <class T, class Stride>
+void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume,
+                                  ParallelOptions const & options) const
+{
+    vigra_precondition(this->shape() == volume.shape(), "importVolume(): Output array must be shaped according to VolumeImportInfo.");
+
+    if(fileType_ == "STACK")
+    {
+        // every task opens its own decoder, so memory consumption is bounded
+        // by the number of threads, not by the number of slices
+        parallel_foreach(options.getNumThreads(), volume.shape(2),
+            [this, &volume](int /* thread_id */, MultiArrayIndex k)
+            {
+                importSlice(volume, k);
+            });
+    }
+    else if(fileType_ == "MULTIPAGE")
+    {
+        // pages are cheapest to reach sequentially, so every task decodes
+        // a contiguous range of pages with its own decoder
+        const MultiArrayIndex depth = volume.shape(2),
+                              ranges = std::min<MultiArrayIndex>(options.getActualNumThreads(), depth);
+        const Rect2D roi(Size2D(shape_[0], shape_[1]));
+        parallel_foreach(options.getNumThreads(), ranges,
+            [this, &volume, &roi, depth, ranges](int /* thread_id */, MultiArrayIndex r)
+            {
+                const MultiArrayIndex begin = r*depth / ranges, end = (r+1)*depth / ranges;
+                detail::importPages(baseName_, roi, begin,
+                                    volume.subarray(Shape3(0, 0, begin), Shape3(shape_[0], shape_[1], end)));
+            });
+    }
+    else
+    {
+        importImpl(volume);
+    }
+}
+#endif
+
+template <class T, class Stride>
+void VolumeImportInfo::importSlice(MultiArrayView <3, T, Stride> &volume, MultiArrayIndex k) const
+{
+    // build the filename
+    std::string filename = baseName_ + numbers_[k] + extension_;
+
+    // import the image
+    ImageImportInfo info (filename.c_str ());
+
+    // generate a basic image view to the current layer
+    MultiArrayView <2, T, Stride> view (volume.bindOuter (k));
+    vigra_precondition(view.shape() == info.shape(),
+        "importVolume(): the images have inconsistent sizes.");
+
+    importImage (info, destImage(view));
+}
+
 VIGRA_EXPORT void findImageSequence(const std::string &name_base,
                        const std::string &name_ext,
                        std::vector<std::string> & numbers);
@@ -615,6 +694,13 @@ VIGRA_EXPORT void findImageSequence(const std::string &name_base,
         importVolume(MultiArray <3, T, Allocator> & volume,
                      const std::string &name_base,
                      const std::string &name_ext);
+
+        // variant 4: like variant 1, but decode several slices concurrently
+        template <class T, class Stride>
+        void
+        importVolume(VolumeImportInfo const & info,
+                     MultiArrayView <3, T, Stride> &volume,
+                     ParallelOptions const & options);
     }
     \endcode
 
@@ -641,6 +727,11 @@ VIGRA_EXPORT void findImageSequence(const std::string &name_base,
     importVolume(info, volume);    // call variant 1
     \endcode
 
+    Variant 4 reads the slices of an image stack or multi-page TIFF file in parallel,
+    using the number of threads given in \ref vigra::ParallelOptions. Each thread decodes
+    one slice at a time directly into the destination, so that the additional memory
+    is independent of the number of slices. Other file types are read sequentially.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_impex.hxx\> <br/>
@@ -656,6 +747,11 @@ VIGRA_EXPORT void findImageSequence(const std::string &name_base,
     VolumeImportInfo info("my_data", ".png");  // looks for files 'my_data0.png', 'my_data1.png' etc.
     MultiArray<3, float> volume(info.shape());
     importVolume(info, volume);
+
+    // read a large stack with 8 threads, using variant 4
+    VolumeImportInfo info("my_data", ".tif");
+    MultiArray<3, UInt16> volume(info.shape());
+    importVolume(info, volume, ParallelOptions().numThreads(8));
     \endcode
     Notice that slice numbers in a stack need not be consecutive (i.e. gaps are allowed) and
     will be interpreted according to their numerical order (i.e. "009", "010", "011"
@@ -672,6 +768,17 @@ importVolume(VolumeImportInfo const & info,
     info.importImpl(volume);
 }
 
+#ifndef VIGRA_SINGLE_THREADED
+template <class T, class Stride>
+void
+importVolume(VolumeImportInfo const & info,
+             MultiArrayView <3, T, Stride> &volume,
+             ParallelOptions const & options)
+{
+    info.importImpl(volume, options);
+}
+#endif
+
 template <class T, class Allocator>
 void
 importVolume(MultiArray <3, T, Allocator> &volume,
@@ -796,6 +903,13 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
         exportVolume (MultiArrayView <3, T, Tag> const & volume,
                       const std::string &name_base,
                       const std::string &name_ext);
+
+        // variant 4: like variant 1, but encode several slices concurrently
+        template <class T, class Tag>
+        void
+        exportVolume (MultiArrayView <3, T, Tag> const & volume,
+                      const VolumeExportInfo & info,
+                      ParallelOptions const & options);
     }
     \endcode
 
@@ -809,6 +923,12 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
     an already constructed \ref vigra::VolumeExportInfo object. The other two are just abbreviations
     that construct the VolumeExportInfo object internally.
 
+    Variant 4 writes the files of an image stack in parallel, using the number of threads
+    given in \ref vigra::ParallelOptions. The range mapping (if needed) is still determined
+    from the entire volume, so the result is identical to variant 1. The pages of a multi-page
+    TIFF file are encoded concurrently into memory and appended to the file in order by the
+    calling thread; at most twice as many pages as there are threads are held in memory.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_impex.hxx\> <br/>
@@ -822,10 +942,136 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
     VolumeExportInfo info("my_data", ".jpg");
     info.setCompression("JPEG QUALITY=95");
     exportVolume(volume, info);
+
+    // the same, using 8 threads
+    exportVolume(volume, info, ParallelOptions().numThreads(8));
     \endcode
 */
 doxygen_overloaded_function(template <...> void exportVolume)
 
+namespace detail {
+
+    // settings of a single page of a multi-page TIFF file
+inline ImageExportInfo
+multipageExportInfo(const VolumeExportInfo & volinfo, char const * mode,
+                    ImageExportInfo const * range_mapping = 0)
+{
+    std::string compression = "LZW";
+    if(volinfo.getCompression() != std::string())
+        compression = volinfo.getCompression();
+
+    ImageExportInfo info(volinfo.getFileNameBase(), mode);
+    info.setFileType("TIFF");
+    info.setCompression(compression.c_str());
+    info.setPixelType(volinfo.getPixelType());
+    if(range_mapping != 0 && range_mapping->hasForcedRangeMapping())
+        info.setForcedRangeMapping(range_mapping->getFromMin(), range_mapping->getFromMax(),
+                                   range_mapping->getToMin(), range_mapping->getToMax());
+    return info;
+}
+
+template <class T, class Tag>
+void exportMultipage(MultiArrayView <3, T, Tag> const & volume,
+                     const VolumeExportInfo & volinfo)
+{
+    // the range mapping is determined once for the entire volume
+    ImageExportInfo first(multipageExportInfo(volinfo, "w"));
+    detail::setRangeMapping(volume, first, typename NumericTraits<T>::isScalar());
+    ImageExportInfo next(multipageExportInfo(volinfo, "a", &first));
+
+    for(MultiArrayIndex k=0; k<volume.shape(2); ++k)
+        exportImage(volume.bindOuter(k), k == 0 ? first : next);
+}
+
+#ifndef VIGRA_SINGLE_THREADED
+    // Encode the pages concurrently into memory buffers, while the calling
+    // thread appends finished pages to the file in order. At most
+    // 2*nThreads pages are kept in memory at any time.
+template <class T, class Tag>
+void exportMultipage(MultiArrayView <3, T, Tag> const & volume,
+                     const VolumeExportInfo & volinfo,
+                     ParallelOptions const & options)
+{
+    const MultiArrayIndex depth = volume.shape(2);
+    if(options.getActualNumThreads() <= 1 || depth <= 1)
+    {
+        exportMultipage(volume, volinfo);
+        return;
+    }
+
+    ImageExportInfo info(multipageExportInfo(volinfo, "w"));
+    detail::setRangeMapping(volume, info, typename NumericTraits<T>::isScalar());
+
+    const MultiArrayIndex capacity = std::min<MultiArrayIndex>(2*options.getActualNumThreads(), depth);
+
+    // everything the tasks refer to must outlive the pool, whose destructor
+    // waits for pending tasks (e.g. when writing a page throws)
+    std::vector<std::vector<char> > pages(capacity);
+    std::vector<threading::future<void> > done(capacity);
+    auto encode = [&volume, &info, &pages](int /* thread_id */, MultiArrayIndex k)
+    {
+        ImageExportInfo page_info(info);
+        page_info.setMemoryBuffer(&pages[k % pages.size()]);
+        exportImage(volume.bindOuter(k), page_info);
+    };
+    ThreadPool pool(options);
+    TIFFPageWriter writer(volinfo.getFileNameBase());
+
+    for(MultiArrayIndex k=0; k<capacity; ++k)
+        done[k] = pool.enqueue([&encode, k](int thread_id) { encode(thread_id, k); });
+
+    for(MultiArrayIndex k=0; k<depth; ++k)
+    {
+        const MultiArrayIndex slot = k % capacity;
+        done[slot].get();
+        writer.append(pages[slot]);
+        std::vector<char>().swap(pages[slot]);
+        if(k + capacity < depth)
+            done[slot] = pool.enqueue([&encode, k, capacity](int thread_id) { encode(thread_id, k + capacity); });
+    }
+}
+#endif
+
+    // common settings of all slices of an image stack
+template <class T, class Tag>
+ImageExportInfo stackExportInfo(MultiArrayView <3, T, Tag> const & volume,
+                                const VolumeExportInfo & volinfo)
+{
+    std::string name = std::string(volinfo.getFileNameBase()) + std::string(volinfo.getFileNameExt());
+    ImageExportInfo info(name.c_str());
+    info.setCompression(volinfo.getCompression());
+    info.setPixelType(volinfo.getPixelType());
+    detail::setRangeMapping(volume, info, typename NumericTraits<T>::isScalar());
+    return info;
+}
+
+template <class T, class Tag>
+void exportStackSlice(MultiArrayView <3, T, Tag> const & volume,
+                      const VolumeExportInfo & volinfo,
+                      ImageExportInfo & info, MultiArrayIndex k)
+{
+    const unsigned int depth = volume.shape (2);
+    int numlen = static_cast <int> (std::ceil (std::log10 ((double)depth)));
+
+    // build the filename
+    std::stringstream stream;
+    stream << std::setfill ('0') << std::setw (numlen) << k;
+    std::string name_num;
+    stream >> name_num;
+    std::string sliceFilename =
+        std::string(volinfo.getFileNameBase()) +
+        name_num +
+        std::string(volinfo.getFileNameExt());
+
+    MultiArrayView <2, T, Tag> view (volume.bindOuter (k));
+
+    // export the image
+    info.setFileName(sliceFilename.c_str ());
+    exportImage(srcImageRange(view), info);
+}
+
+} // namespace detail
+
 template <class T, class Tag>
 void
 exportVolume (MultiArrayView <3, T, Tag> const & volume,
@@ -833,52 +1079,41 @@ exportVolume (MultiArrayView <3, T, Tag> const & volume,
 {
     if(volinfo.getFileType() == std::string("MULTIPAGE"))
     {
-        char const * mode = "w";
-        std::string compression = "LZW";
-        if(volinfo.getCompression() != std::string())
-            compression = volinfo.getCompression();
-
+        detail::exportMultipage(volume, volinfo);
+    }
+    else
+    {
+        ImageExportInfo info(detail::stackExportInfo(volume, volinfo));
         for(MultiArrayIndex k=0; k<volume.shape(2); ++k)
-        {
-            ImageExportInfo info(volinfo.getFileNameBase(), mode);
-            info.setFileType("TIFF");
-            info.setCompression(compression.c_str());
-            info.setPixelType(volinfo.getPixelType());
-            detail::setRangeMapping(volume, info, typename NumericTraits<T>::isScalar());
-            exportImage(volume.bindOuter(k), info);
-            mode = "a";
-        }
+            detail::exportStackSlice(volume, volinfo, info, k);
+    }
+}
+
+#ifndef VIGRA_SINGLE_THREADED
+template <class T, class Tag>
+void
+exportVolume (MultiArrayView <3, T, Tag> const & volume,
+              const VolumeExportInfo & volinfo,
+              ParallelOptions const & options)
+{
+    if(volinfo.getFileType() == std::string("MULTIPAGE"))
+    {
+        detail::exportMultipage(volume, volinfo, options);
     }
     else
     {
-        std::string name = std::string(volinfo.getFileNameBase()) + std::string(volinfo.getFileNameExt());
-        ImageExportInfo info(name.c_str());
-        info.setCompression(volinfo.getCompression());
-        info.setPixelType(volinfo.getPixelType());
-        detail::setRangeMapping(volume, info, typename NumericTraits<T>::isScalar());
-
-        const unsigned int depth = volume.shape (2);
-        int numlen = static_cast <int> (std::ceil (std::log10 ((double)depth)));
-        for (unsigned int i = 0; i < depth; ++i)
-        {
-            // build the filename
-            std::stringstream stream;
-            stream << std::setfill ('0') << std::setw (numlen) << i;
-            std::string name_num;
-            stream >> name_num;
-            std::string sliceFilename =
-                std::string(volinfo.getFileNameBase()) +
-                name_num +
-                std::string(volinfo.getFileNameExt());
-
-            MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
-
-            // export the image
-            info.setFileName(sliceFilename.c_str ());
-            exportImage(srcImageRange(view), info);
-        }
+        // the range mapping is determined once for the entire volume,
+        // afterwards each slice goes to a file of its own
+        const ImageExportInfo info(detail::stackExportInfo(volume, volinfo));
+        parallel_foreach(options.getNumThreads(), volume.shape(2),
+            [&volume, &volinfo, &info](int /* thread_id */, MultiArrayIndex k)
+            {
+                ImageExportInfo slice_info(info);
+                detail::exportStackSlice(volume, volinfo, slice_info, k);
+            });
     }
 }
+#endif
 
 template <class T, class Tag>
 inline void
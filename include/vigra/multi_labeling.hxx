@@ -40,6 +40,14 @@
 #include "multi_gridgraph.hxx"
 #include "union_find.hxx"
 #include "any.hxx"
+#include "visit_border.hxx"
+#include "blockify.hxx"
+
+#ifndef VIGRA_SINGLE_THREADED
+# include <vector>
+# include <algorithm>
+# include "threadpool.hxx"
+#endif
 
 namespace vigra{
 
@@ -310,6 +318,7 @@ class LabelOptions
 {
     Any background_value_;
     NeighborhoodType neighborhood_;
+    int num_threads_;
 
   public:
 
@@ -317,6 +326,7 @@ class LabelOptions
         */
     LabelOptions()
     : neighborhood_(DirectNeighborhood)
+    , num_threads_(0)
     {}
 
         /** \brief Choose direct or indirect neighborhood.
@@ -375,8 +385,191 @@ class LabelOptions
             "LabelOptions::getBackgroundValue<T>(): stored background value is not convertible to T.");
         return background_value_.template read<T>();
     }
+
+        /** \brief Set the number of threads used by labelMultiArray().
+
+            The argument has the same meaning as in \ref vigra::ParallelOptions::numThreads(),
+            i.e. it is either a positive number or one of the constants
+            <tt>ParallelOptions::Auto</tt>, <tt>ParallelOptions::Nice</tt> and
+            <tt>ParallelOptions::NoThreads</tt>. If multi-threading is enabled,
+            the array is split into slabs along its last dimension, the slabs are
+            labeled concurrently, and the slab labels are merged by means of a
+            lock-free union-find structure. The resulting labeling is identical
+            to the one of the sequential algorithm. If the preprocessor flag
+            <tt>VIGRA_SINGLE_THREADED</tt> is defined, this setting is ignored.
+
+            Default: <tt>ParallelOptions::NoThreads</tt> (i.e. sequential labeling)
+        */
+    LabelOptions & numThreads(const int n)
+    {
+        num_threads_ = n;
+        return *this;
+    }
+
+        /** \brief Query the desired number of threads.
+        */
+    int getNumThreads() const
+    {
+        return num_threads_;
+    }
+};
+
+#ifndef VIGRA_SINGLE_THREADED
+
+namespace labeling_detail {
+
+template <class Equal, class Index, class UnionFind>
+struct BorderVisitor
+{
+    Index u_label_offset;
+    Index v_label_offset;
+    UnionFind* global_unions;
+    Equal* equal;
+
+    template <class Data, class Label, class Shape>
+    void operator()(const Data& u_data, Label& u_label, const Data& v_data, Label& v_label, const Shape& diff)
+    {
+        if(labeling_equality::callEqual(*equal, u_data, v_data, diff))
+        {
+            global_unions->makeUnion(Index(u_label + u_label_offset), Index(v_label + v_label_offset));
+        }
+    }
 };
 
+    // Merge the local labels of adjacent blocks whose border pixels are equal.
+    // Local label 'l' of block 'b' refers to entry 'l + label_offsets[b]' of 'global_unions',
+    // which must be a ConcurrentUnionFindArray. Block pairs are processed in parallel.
+template <class DataBlocksIterator, class LabelBlocksIterator,
+          unsigned int N, class Index, class S,
+          class Equal, class UnionFind>
+void
+mergeBlockBorders(ThreadPool & pool,
+                  DataBlocksIterator data_blocks_begin,
+                  LabelBlocksIterator label_blocks_begin,
+                  MultiArrayView<N, Index, S> const & label_offsets,
+                  NeighborhoodType neighborhood,
+                  Equal & equal,
+                  UnionFind & global_unions)
+{
+    typedef GridGraph<N, undirected_tag>        Graph;
+    typedef typename Graph::edge_iterator       EdgeIterator;
+    typedef typename Graph::shape_type          Shape;
+    typedef typename Graph::Edge                Edge;
+
+    Graph blocks_graph(label_offsets.shape(), neighborhood);
+    std::vector<Edge> block_edges;
+    block_edges.reserve(blocks_graph.edgeNum());
+    for(EdgeIterator it = blocks_graph.get_edge_iterator(); it != blocks_graph.get_edge_end_iterator(); ++it)
+        block_edges.push_back(*it);
+
+    parallel_foreach(pool, block_edges.size(),
+        [&](const int /*threadId*/, const uint64_t k)
+        {
+            Shape u = blocks_graph.u(block_edges[k]);
+            Shape v = blocks_graph.v(block_edges[k]);
+
+            BorderVisitor<Equal, Index, UnionFind> border_visitor;
+            border_visitor.u_label_offset = label_offsets[u];
+            border_visitor.v_label_offset = label_offsets[v];
+            border_visitor.global_unions = &global_unions;
+            border_visitor.equal = &equal;
+            visitBorder(data_blocks_begin[u], label_blocks_begin[u],
+                        data_blocks_begin[v], label_blocks_begin[v],
+                        v - u, neighborhood, border_visitor);
+        }
+    );
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+Label
+labelMultiArrayParallel(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        LabelOptions const & options,
+                        Equal equal)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef MultiArrayIndex                   Index;
+
+    ThreadPool pool(options.getNumThreads());
+
+    // Split the array into slabs along the last dimension. Since the slabs
+    // follow each other in scan order, the slab-local labels (offset by the
+    // label counts of the preceding slabs) are ordered by first occurrence,
+    // and merging towards the smallest index reproduces the sequential result.
+    Index extent = data.shape(N-1),
+          slab_count = std::min<Index>(extent, std::max<Index>(1, pool.nThreads()));
+    Shape slab_shape(data.shape());
+    slab_shape[N-1] = (extent + slab_count - 1) / slab_count;
+
+    MultiArray<N, MultiArrayView<N, T, S1> >     data_slabs  = blockify(data, slab_shape);
+    MultiArray<N, MultiArrayView<N, Label, S2> > label_slabs = blockify(labels, slab_shape);
+    slab_count = data_slabs.size();
+
+    bool has_background = options.hasBackgroundValue();
+    T background_value = options.template getBackgroundValue<T>();
+
+    // pass 1: label each slab independently
+    std::vector<Label> slab_label_count(slab_count);
+    parallel_foreach(pool, slab_count,
+        [&](const int /*threadId*/, const uint64_t k)
+        {
+            GridGraph<N, undirected_tag> graph(data_slabs[k].shape(), options.getNeighborhood());
+            if(has_background)
+                slab_label_count[k] = lemon_graph::labelGraphWithBackground(graph, data_slabs[k], label_slabs[k],
+                                                                            background_value, equal);
+            else
+                slab_label_count[k] = lemon_graph::labelGraph(graph, data_slabs[k], label_slabs[k], equal);
+        }
+    );
+
+    // local label 'l' of slab 'k' becomes global index 'l + label_offsets[k]'
+    // (with background, each slab's label 0 gets its own index, otherwise
+    //  index 0 is unused because local labels start at 1)
+    MultiArray<N, Index> label_offsets(data_slabs.shape());
+    Index index_count = 0;
+    for(Index k=0; k<slab_count; ++k)
+    {
+        label_offsets[k] = index_count;
+        index_count += slab_label_count[k];
+        if(has_background)
+            ++index_count;
+    }
+    if(!has_background)
+        ++index_count;
+
+    // pass 2: merge regions across slab borders
+    ConcurrentUnionFindArray<Index> global_unions(index_count);
+    if(has_background)
+    {
+        for(Index k=1; k<slab_count; ++k)
+            global_unions.makeUnion(0, label_offsets[k]);
+    }
+    mergeBlockBorders(pool, data_slabs.begin(), label_slabs.begin(), label_offsets,
+                      options.getNeighborhood(), equal, global_unions);
+
+    Index count = global_unions.makeContiguous();
+    vigra_invariant(count <= (Index)NumericTraits<Label>::max(),
+        "labelMultiArray(): Need more labels than can be represented in the destination type.");
+
+    // pass 3: replace slab-local labels with global labels
+    parallel_foreach(pool, slab_count,
+        [&](const int /*threadId*/, const uint64_t k)
+        {
+            Index offset = label_offsets[k];
+            typedef typename MultiArrayView<N, Label, S2>::iterator LabelIterator;
+            for(LabelIterator it = label_slabs[k].begin(), end = label_slabs[k].end(); it != end; ++it)
+                *it = (Label)global_unions.findLabel(*it + offset);
+        }
+    );
+    return (Label)count;
+}
+
+} // namespace labeling_detail
+
+#endif // VIGRA_SINGLE_THREADED
+
 /********************************************************/
 /*                                                      */
 /*                     labelMultiArray                  */
@@ -389,6 +582,8 @@ class LabelOptions
 
     By specifying a background value in the \ref vigra::LabelOptions, this function
     can also realize the behavior of \ref labelMultiArrayWithBackground().
+    When a thread count is set in the \ref vigra::LabelOptions, the array is labeled
+    in parallel without the need to choose a block shape.
 
     <b> Declaration:</b>
 
@@ -455,6 +650,11 @@ class LabelOptions
     max_region_label = labelMultiArray(src, dest,
                                        LabelOptions().neighborhood(DirectNeighborhood)
                                                      .ignoreBackgroundValue(0));
+
+    // find 26-connected regions using 8 threads (same result as sequential labeling)
+    max_region_label = labelMultiArray(src, dest,
+                                       LabelOptions().neighborhood(IndirectNeighborhood)
+                                                     .numThreads(8));
     \endcode
 
     <b> Required Interface:</b>
@@ -502,11 +702,7 @@ labelMultiArray(MultiArrayView<N, T, S1> const & data,
                 MultiArrayView<N, Label, S2> labels,
                 LabelOptions const & options)
 {
-    if(options.hasBackgroundValue())
-        return labelMultiArrayWithBackground(data, labels, options.getNeighborhood(),
-                                             options.template getBackgroundValue<T>());
-    else
-        return labelMultiArray(data, labels, options.getNeighborhood());
+    return labelMultiArray(data, labels, options, std::equal_to<T>());
 }
 
 template <unsigned int N, class T, class S1,
@@ -518,6 +714,14 @@ labelMultiArray(MultiArrayView<N, T, S1> const & data,
                 LabelOptions const & options,
                 Equal equal)
 {
+#ifndef VIGRA_SINGLE_THREADED
+    if(options.getNumThreads() != 0 && data.size() > 0)
+    {
+        vigra_precondition(data.shape() == labels.shape(),
+            "labelMultiArray(): shape mismatch between input and output.");
+        return labeling_detail::labelMultiArrayParallel(data, labels, options, equal);
+    }
+#endif
     if(options.hasBackgroundValue())
         return labelMultiArrayWithBackground(data, labels, options.getNeighborhood(),
                                              options.template getBackgroundValue<T>(),
@@ -38,9 +38,11 @@
 #define VIGRA_MULTI_RESIZE_HXX
 
 #include <vector>
+#include <algorithm>
 #include "resizeimage.hxx"
 #include "navigator.hxx"
 #include "multi_shape.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -101,6 +103,144 @@ internalResizeMultiArrayOneDimension(
     }
 }
 
+    // Resampling weights and (reflected) source indices of all target points
+    // along one axis. Every target point gets 'kernelSize' entries, shorter kernels
+    // are padded with zero weights, so that the inner loop has no border checks.
+template <class Real>
+struct SplineResizeTable
+{
+    template <class Kernel>
+    SplineResizeTable(Kernel const & spline, int ssize, int dsize)
+    : prefilterCoeffs(spline.prefilterCoefficients()),
+      kernelSize(0)
+    {
+        vigra_precondition(ssize > 1,
+                     "resizeMultiArraySplineInterpolation(): "
+                     "Source array too small.\n");
+
+        Rational<int> ratio(dsize - 1, ssize - 1);
+        Rational<int> offset(0);
+        resampling_detail::MapTargetToSourceCoordinate mapCoordinate(ratio, offset);
+        int period = lcm(ratio.numerator(), ratio.denominator());
+
+        ArrayVector<Kernel1D<double> > kernels(period);
+        createResamplingKernels(spline, mapCoordinate, kernels);
+        for(int k = 0; k < period; ++k)
+            kernelSize = std::max(kernelSize, kernels[k].size());
+
+        indices.resize(dsize*kernelSize, 0);
+        weights.resize(dsize*kernelSize, Real(0));
+
+        int ssize2 = 2*ssize - 2;
+        for(int i = 0; i < dsize; ++i)
+        {
+            Kernel1D<double> const & kernel = kernels[i % period];
+            int is = mapCoordinate(i);
+            int lbound = is - kernel.right(),
+                hbound = is - kernel.left();
+            vigra_precondition(-lbound < ssize && ssize2 - hbound >= 0,
+                "resizeMultiArraySplineInterpolation(): kernel or offset larger than image.");
+
+            int * index = indices.begin() + i*kernelSize;
+            Real * weight = weights.begin() + i*kernelSize;
+            for(int m = lbound, k = 0; m <= hbound; ++m, ++k)
+            {
+                index[k] = (m < 0) ?
+                              -m :
+                              (m >= ssize) ?
+                                  ssize2 - m :
+                                  m;
+                weight[k] = Real(kernel[is - m]);
+            }
+        }
+    }
+
+    ArrayVector<double> prefilterCoeffs;
+    int kernelSize;
+    ArrayVector<int> indices;
+    ArrayVector<Real> weights;
+};
+
+    // Resize along axis 'd'. Lines are processed in blocks of up to 16 neighbors
+    // along a second axis, so that the strided lines are read and written in
+    // contiguous runs, and the blocks are distributed over the threads of 'pool'.
+template <class TmpType, unsigned int N, class T1, class S1,
+                                         class T2, class S2, class Real>
+void
+resizeMultiArrayOneDimensionParallel(MultiArrayView<N, T1, S1> const & source,
+                                     MultiArrayView<N, T2, S2> dest,
+                                     SplineResizeTable<Real> const & table,
+                                     unsigned int d, ThreadPool & pool)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+
+    const int ssize = source.shape(d),
+              dsize = dest.shape(d),
+              kernelSize = table.kernelSize;
+    const unsigned int c = (d == 0) ? N-1 : 0;
+    const MultiArrayIndex blockSize = (d == 0) ? 1 : 16;
+
+    Shape blocks(dest.shape());
+    blocks[d] = 1;
+    blocks[c] = (blocks[c] + blockSize - 1) / blockSize;
+
+    std::vector<ArrayVector<TmpType> > buffers(std::max<size_t>(1, pool.nThreads()));
+
+    parallel_foreach(pool, prod(blocks),
+        [&](size_t threadId, MultiArrayIndex b)
+        {
+            Shape start;
+            detail::ScanOrderToCoordinate<N>::exec(b, blocks, start);
+            start[c] *= blockSize;
+            const MultiArrayIndex count = std::min(blockSize, dest.shape(c) - start[c]);
+
+            ArrayVector<TmpType> & buffer = buffers[threadId];
+            buffer.resize(count*(ssize + dsize));
+            TmpType * lines = buffer.begin(),
+                    * results = lines + count*ssize;
+
+            // copy the lines to contiguous memory
+            T1 const * s = &source[start];
+            const MultiArrayIndex sstride = source.stride(d),
+                                  sblock  = source.stride(c);
+            for(int k = 0; k < ssize; ++k, s += sstride)
+                for(MultiArrayIndex j = 0; j < count; ++j)
+                    lines[j*ssize + k] = TmpType(s[j*sblock]);
+
+            TmpAccessor ta;
+            for(MultiArrayIndex j = 0; j < count; ++j)
+            {
+                TmpType * line = lines + j*ssize,
+                        * result = results + j*dsize;
+
+                for(unsigned int p = 0; p < table.prefilterCoeffs.size(); ++p)
+                {
+                    recursiveFilterLine(line, line + ssize, ta, line, ta,
+                                        table.prefilterCoeffs[p], BORDER_TREATMENT_REFLECT);
+                }
+
+                int const * index = table.indices.begin();
+                Real const * weight = table.weights.begin();
+                for(int i = 0; i < dsize; ++i, index += kernelSize, weight += kernelSize)
+                {
+                    TmpType sum = weight[0] * line[index[0]];
+                    for(int k = 1; k < kernelSize; ++k)
+                        sum += weight[k] * line[index[k]];
+                    result[i] = sum;
+                }
+            }
+
+            T2 * t = &dest[start];
+            const MultiArrayIndex dstride = dest.stride(d),
+                                  dblock  = dest.stride(c);
+            for(int i = 0; i < dsize; ++i, t += dstride)
+                for(MultiArrayIndex j = 0; j < count; ++j)
+                    t[j*dblock] = detail::RequiresExplicitCast<T2>::cast(results[j*dsize + i]);
+        }
+    );
+}
+
 } // namespace detail
 
 /** \addtogroup GeometricTransformations
@@ -128,6 +268,16 @@ internalResizeMultiArrayOneDimension(
         resizeMultiArraySplineInterpolation(MultiArrayView<N, T1, S1> const & source,
                                             MultiArrayView<N, T2, S2> dest,
                                             Kernel const & spline = BSpline<3, double>());
+
+        // parallel version
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class Kernel>
+        void
+        resizeMultiArraySplineInterpolation(MultiArrayView<N, T1, S1> const & source,
+                                            MultiArrayView<N, T2, S2> dest,
+                                            Kernel const & spline,
+                                            ParallelOptions const & options);
     }
     \endcode
 
@@ -186,6 +336,14 @@ internalResizeMultiArrayOneDimension(
     real number and \ref NumericTraits "NumericTraits".
     The function uses accessors.
 
+    The variant with \ref ParallelOptions distributes the lines of each axis over
+    <tt>options.getActualNumThreads()</tt> threads. It precomputes the resampling weights
+    and source indices of every axis once, skips axes whose size doesn't change,
+    resizes shrinking axes first, and needs at most two intermediate arrays. All
+    computations (including the weights) use <tt>NumericTraits<T2>::RealPromote</tt>,
+    i.e. <tt>float</tt> for a <tt>float</tt> destination. Because of the different order
+    of operations, its result agrees with the sequential variant only up to rounding.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_resize.hxx\><br>
@@ -200,6 +358,10 @@ internalResizeMultiArrayOneDimension(
 
     // use linear interpolator
     resizeMultiArraySplineInterpolation(src, dest, BSpline<1, double>());
+
+    // use cubic spline interpolator and 4 threads
+    resizeMultiArraySplineInterpolation(src, dest, BSpline<3, double>(),
+                                        ParallelOptions().numThreads(4));
     \endcode
 
     \deprecatedUsage{resizeMultiArraySplineInterpolation}
@@ -321,6 +483,76 @@ resizeMultiArraySplineInterpolation(MultiArrayView<N, T1, S1>  const & source,
                                         destMultiArrayRange(dest));
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class Kernel>
+void
+resizeMultiArraySplineInterpolation(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    Kernel const & spline,
+                                    ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename NumericTraits<T2>::RealPromote TmpType;
+    typedef typename NumericTraits<TmpType>::ValueType Real;
+    typedef MultiArrayView<N, TmpType> TmpView;
+
+    // only resize axes whose size changes, and shrink first to keep
+    // the intermediate arrays small
+    ArrayVector<unsigned int> axes;
+    for(unsigned int d = 0; d < N; ++d)
+        if(source.shape(d) != dest.shape(d))
+            axes.push_back(d);
+    std::stable_sort(axes.begin(), axes.end(),
+        [&](unsigned int a, unsigned int b)
+        {
+            return dest.shape(a)*source.shape(b) < dest.shape(b)*source.shape(a);
+        });
+
+    if(axes.size() == 0)
+    {
+        dest = source;
+        return;
+    }
+
+    // at most two intermediate arrays are needed, the last pass writes to 'dest'
+    Shape shape(source.shape());
+    MultiArrayIndex bufferSize = 0;
+    for(unsigned int k = 0; k + 1 < axes.size(); ++k)
+    {
+        shape[axes[k]] = dest.shape(axes[k]);
+        bufferSize = std::max(bufferSize, prod(shape));
+    }
+    ArrayVector<TmpType> buffer1(bufferSize),
+                         buffer2(axes.size() > 2 ? bufferSize : 0);
+    TmpType * buffers[2] = { buffer1.begin(), buffer2.begin() };
+
+    ThreadPool pool(options);
+    shape = source.shape();
+    for(unsigned int k = 0; k < axes.size(); ++k)
+    {
+        unsigned int d = axes[k];
+        detail::SplineResizeTable<Real> table(spline, source.shape(d), dest.shape(d));
+
+        Shape newShape(shape);
+        newShape[d] = dest.shape(d);
+        TmpView previous(shape, buffers[(k+1) % 2]),
+                current(newShape, buffers[k % 2]);
+
+        bool first = (k == 0),
+             last  = (k + 1 == axes.size());
+        if(first && last)
+            detail::resizeMultiArrayOneDimensionParallel<TmpType>(source, dest, table, d, pool);
+        else if(first)
+            detail::resizeMultiArrayOneDimensionParallel<TmpType>(source, current, table, d, pool);
+        else if(last)
+            detail::resizeMultiArrayOneDimensionParallel<TmpType>(previous, dest, table, d, pool);
+        else
+            detail::resizeMultiArrayOneDimensionParallel<TmpType>(previous, current, table, d, pool);
+        shape = newShape;
+    }
+}
+
 //@}
 
 } // namespace vigra
@@ -0,0 +1,329 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_SPLINEVIEW_HXX
+#define VIGRA_MULTI_SPLINEVIEW_HXX
+
+#include "splineimageview.hxx"
+#include "navigator.hxx"
+
+namespace vigra {
+
+namespace detail {
+
+    // Tensor product sum over the kernel taps of axes 0...D. The weight of tap 'i'
+    // along axis 'd' is w[(d*KSIZE + i)*stride], its memory offset is o[d*KSIZE + i].
+template <unsigned int D, int KSIZE, class RealPromote>
+struct MultiSplineViewSum
+{
+    template <class T>
+    static RealPromote
+    exec(T const * p, double const * w, int stride, MultiArrayIndex const * o)
+    {
+        RealPromote sum = NumericTraits<RealPromote>::zero();
+        for(int i = 0; i < KSIZE; ++i)
+            sum += RealPromote(w[(D*KSIZE + i)*stride] *
+                     MultiSplineViewSum<D-1, KSIZE, RealPromote>::exec(p + o[D*KSIZE + i], w, stride, o));
+        return sum;
+    }
+};
+
+template <int KSIZE, class RealPromote>
+struct MultiSplineViewSum<0, KSIZE, RealPromote>
+{
+    template <class T>
+    static RealPromote
+    exec(T const * p, double const * w, int stride, MultiArrayIndex const * o)
+    {
+        RealPromote sum = NumericTraits<RealPromote>::zero();
+        for(int i = 0; i < KSIZE; ++i)
+            sum += RealPromote(w[i*stride] * p[o[i]]);
+        return sum;
+    }
+};
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*                    MultiSplineView                   */
+/*                                                      */
+/********************************************************/
+/** \brief Create a continuous view onto a discrete N-dimensional array using splines.
+
+    This is the N-dimensional counterpart of \ref vigra::SplineImageView, e.g. for
+    volumes: values and derivatives at arbitrary real-valued coordinates are computed by
+    interpolating the given array with a spline of the specified <tt>ORDER</TT>, and
+    reflective boundary conditions are applied near the array border.
+    All access functions are <tt>const</tt> and do not cache anything, so that a single view
+    can be shared by several threads. To evaluate many points in parallel, use <tt>sample()</tt>.
+
+    <b>Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_splineview.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> volume(Shape3(100, 120, 80));
+    ... // fill volume
+
+    // cubic interpolation
+    MultiSplineView<3, 3, float> view(volume);
+
+    float v = view(TinyVector<double, 3>(10.2, 5.5, 31.7));
+
+    // derivative in z-direction
+    float dz = view(TinyVector<double, 3>(10.2, 5.5, 31.7), Shape3(0, 0, 1));
+
+    // evaluate many points with 4 threads
+    MultiArray<1, TinyVector<double, 3> > points(Shape1(1000000));
+    MultiArray<1, float> values(points.shape());
+    ... // fill points
+    view.sample(points, values, ParallelOptions().numThreads(4));
+    \endcode
+*/
+template <unsigned int N, int ORDER, class VALUETYPE>
+class MultiSplineView
+{
+    typedef typename NumericTraits<VALUETYPE>::RealPromote InternalValue;
+
+  public:
+
+        /** The view's value type (return type of access and derivative functions).
+        */
+    typedef VALUETYPE value_type;
+
+        /** The view's shape type.
+        */
+    typedef typename MultiArrayShape<N>::type shape_type;
+
+        /** The view's coordinate type.
+        */
+    typedef TinyVector<double, N> difference_type;
+
+        /** The order of the spline used.
+        */
+    enum StaticOrder { order = ORDER };
+
+        /** The type of the internal array holding the spline coefficients.
+        */
+    typedef MultiArray<N, InternalValue> InternalArray;
+
+  private:
+    typedef BSpline<ORDER, double> Spline;
+    typedef detail::MultiSplineViewSum<N-1, ORDER+1, InternalValue> Sum;
+
+    enum { ksize_ = ORDER + 1, kcenter_ = ORDER / 2 };
+
+  public:
+
+        /** Construct MultiSplineView for an N-dimensional MultiArrayView.
+
+            If <tt>skipPrefiltering = true</tt> (default: <tt>false</tt>), the recursive
+            prefilter of the cardinal spline function is not applied, resulting
+            in an approximating (smoothing) rather than interpolating spline.
+        */
+    template <class U, class S>
+    MultiSplineView(MultiArrayView<N, U, S> const & s, bool skipPrefiltering = false)
+    : array_(s)
+    {
+        for(unsigned int d = 0; d < N; ++d)
+        {
+            shape1_[d] = (int)s.shape(d) - 1;
+            lower_[d] = kcenter_;
+            upper_[d] = s.shape(d) - kcenter_ - 2;
+        }
+        if(!skipPrefiltering)
+            init();
+    }
+
+        /** Access interpolated function at real-valued coordinate <tt>x</tt>.
+            If <tt>x</tt> is near the array border or outside the array, the value
+            is calculated with reflective boundary conditions. An exception is thrown if the
+            coordinate is outside the first reflection.
+        */
+    value_type operator()(difference_type const & x) const
+    {
+        double u[N], w[N*ksize_];
+        MultiArrayIndex o[N*ksize_];
+        calculateOffsets(x, u, o);
+        for(unsigned int d = 0; d < N; ++d)
+            detail::splineViewWeights<ORDER>(Spline::weights(), u + d, 1, w + d*ksize_, 1);
+        return detail::RequiresExplicitCast<VALUETYPE>::cast(Sum::exec(array_.data(), w, 1, o));
+    }
+
+        /** Access derivative of order <tt>derivativeOrder[d]</tt> along each axis <tt>d</tt>
+            at real-valued coordinate <tt>x</tt>.
+        */
+    value_type operator()(difference_type const & x, shape_type const & derivativeOrder) const
+    {
+        double u[N], w[N*ksize_];
+        MultiArrayIndex o[N*ksize_];
+        calculateOffsets(x, u, o);
+        for(unsigned int d = 0; d < N; ++d)
+            for(int i = 0; i < ksize_; ++i)
+                w[d*ksize_ + i] = k_(u[d] + kcenter_ - i, derivativeOrder[d]);
+        return detail::RequiresExplicitCast<VALUETYPE>::cast(Sum::exec(array_.data(), w, 1, o));
+    }
+
+        /** Access interpolated function at many real-valued coordinates at once.
+            Equivalent to <tt>res(k) = splineView(coords(k))</tt> for all <tt>k</tt>.
+
+            The points are processed in batches which are distributed over
+            <tt>options.getActualNumThreads()</tt> threads.
+        */
+    template <class U, class S1, class T, class S2>
+    void sample(MultiArrayView<1, TinyVector<U, N>, S1> const & coords,
+                MultiArrayView<1, T, S2> res,
+                ParallelOptions const & options = ParallelOptions()) const;
+
+        /** The shape of the array.
+            <tt>0 <= x[d] <= shape()[d]-1</tt> is required for all access functions.
+        */
+    shape_type const & shape() const
+        { return array_.shape(); }
+
+        /** The internal array holding the spline coefficients.
+        */
+    InternalArray const & array() const
+        { return array_; }
+
+        /** Check if <tt>x</tt> is in the original array range.
+            Equivalent to <tt>0 <= x[d] <= shape()[d]-1</tt> for all <tt>d</tt>.
+        */
+    bool isInside(difference_type const & x) const
+    {
+        for(unsigned int d = 0; d < N; ++d)
+            if(!(x[d] >= 0.0 && x[d] <= shape1_[d]))
+                return false;
+        return true;
+    }
+
+        /** Check if <tt>x</tt> is in the valid range. Points outside the original range are computed
+            by reflective boundary conditions, but only within the first reflection.
+        */
+    bool isValid(difference_type const & x) const
+    {
+        for(unsigned int d = 0; d < N; ++d)
+            if(!(x[d] < shape1_[d] + upper_[d] && x[d] > -upper_[d]))
+                return false;
+        return true;
+    }
+
+  protected:
+
+    void init()
+    {
+        typedef typename InternalArray::traverser Traverser;
+        typedef MultiArrayNavigator<Traverser, N> Navigator;
+        typename AccessorTraits<InternalValue>::default_accessor a;
+
+        ArrayVector<double> const & b = k_.prefilterCoefficients();
+        for(unsigned int i = 0; i < b.size(); ++i)
+        {
+            for(unsigned int d = 0; d < N; ++d)
+            {
+                Navigator nav(array_.traverser_begin(), array_.shape(), d);
+                for(; nav.hasMore(); nav++)
+                    recursiveFilterLine(nav.begin(), nav.end(), a, nav.begin(), a,
+                                        b[i], BORDER_TREATMENT_REFLECT);
+            }
+        }
+    }
+
+        // facet coordinates 'u' and memory offsets 'o' of all kernel taps
+    void calculateOffsets(difference_type const & x, double * u, MultiArrayIndex * o) const
+    {
+        vigra_precondition(isValid(x),
+            "MultiSplineView::operator(): coordinates out of range.");
+        int ix[ksize_];
+        for(unsigned int d = 0; d < N; ++d)
+        {
+            u[d] = detail::splineViewIndices<ORDER>(x[d], lower_[d], upper_[d], shape1_[d], ix);
+            for(int i = 0; i < ksize_; ++i)
+                o[d*ksize_ + i] = ix[i] * array_.stride(d);
+        }
+    }
+
+    InternalArray array_;
+    TinyVector<int, N> shape1_;
+    TinyVector<double, N> lower_, upper_;
+    Spline k_;
+};
+
+template <unsigned int N, int ORDER, class VALUETYPE>
+template <class U, class S1, class T, class S2>
+void
+MultiSplineView<N, ORDER, VALUETYPE>::sample(MultiArrayView<1, TinyVector<U, N>, S1> const & coords,
+                                             MultiArrayView<1, T, S2> res,
+                                             ParallelOptions const & options) const
+{
+    enum { batchSize = 64 };
+
+    vigra_precondition(coords.shape() == res.shape(),
+        "MultiSplineView::sample(): shape mismatch between coordinates and results.");
+
+    const MultiArrayIndex size = coords.size(),
+                          batches = (size + batchSize - 1) / batchSize;
+
+    parallel_foreach(options.getNumThreads(), batches,
+        [&](size_t /*threadId*/, MultiArrayIndex batch)
+        {
+            const MultiArrayIndex begin = batch*batchSize;
+            const int count = (int)std::min<MultiArrayIndex>(batchSize, size - begin);
+
+            double u[N*batchSize], w[N*ksize_*batchSize], uk[N];
+            MultiArrayIndex o[batchSize*N*ksize_];
+
+            for(int k = 0; k < count; ++k)
+            {
+                calculateOffsets(difference_type(coords(begin + k)), uk, o + k*N*ksize_);
+                for(unsigned int d = 0; d < N; ++d)
+                    u[d*batchSize + k] = uk[d];
+            }
+
+            for(unsigned int d = 0; d < N; ++d)
+                detail::splineViewWeights<ORDER>(Spline::weights(), u + d*batchSize, count,
+                                                 w + d*ksize_*batchSize, batchSize);
+
+            for(int k = 0; k < count; ++k)
+                res(begin + k) = detail::RequiresExplicitCast<VALUETYPE>::cast(
+                                     Sum::exec(array_.data(), w + k, batchSize, o + k*N*ksize_));
+        });
+}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_SPLINEVIEW_HXX
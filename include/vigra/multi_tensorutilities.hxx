@@ -42,6 +42,7 @@
 #include "metaprogramming.hxx"
 #include "multi_shape.hxx"
 #include "multi_pointoperators.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -142,6 +143,287 @@ public:
 };
 
 
+    // Closed-form eigenvalues of 'n' consecutive symmetric 2x2 tensors (a00, a01, a11),
+    // in descending order. The loops contain no data-dependent branches, so that the
+    // compiler can vectorize them.
+template <class Real, class SrcIterator, class DestIterator>
+void
+symmetric2x2EigenvaluesBatch(SrcIterator s, DestIterator d, MultiArrayIndex n)
+{
+    for(MultiArrayIndex k = 0; k < n; ++k, ++s, ++d)
+    {
+        double a00 = (*s)[0], a01 = (*s)[1], a11 = (*s)[2];
+        double t = a00 + a11,
+               r = std::sqrt(sq(a00 - a11) + 4.0*a01*a01);
+        (*d)[0] = static_cast<Real>(0.5*(t + r));
+        (*d)[1] = static_cast<Real>(0.5*(t - r));
+    }
+}
+
+    // Closed-form eigenvalues of 'n' consecutive symmetric 3x3 tensors
+    // (a00, a01, a02, a11, a12, a22) in descending order, using the same formula as
+    // symmetric3x3Eigenvalues(). Since the angle is in [0, pi/3], the order of the
+    // roots is known in advance and no sorting is needed.
+template <class Real, class SrcIterator, class DestIterator>
+void
+symmetric3x3EigenvaluesBatch(SrcIterator s, DestIterator d, MultiArrayIndex n)
+{
+    const double inv3 = 1.0 / 3.0, root3 = std::sqrt(3.0);
+
+    for(MultiArrayIndex k = 0; k < n; ++k, ++s, ++d)
+    {
+        double a00 = (*s)[0], a01 = (*s)[1], a02 = (*s)[2],
+               a11 = (*s)[3], a12 = (*s)[4], a22 = (*s)[5];
+        double c0 = a00*a11*a22 + 2.0*a01*a02*a12 - a00*a12*a12 - a11*a02*a02 - a22*a01*a01;
+        double c1 = a00*a11 - a01*a01 + a00*a22 - a02*a02 + a11*a22 - a12*a12;
+        double c2 = a00 + a11 + a22;
+        double c2Div3 = c2*inv3;
+        double aDiv3 = std::min((c1 - c2*c2Div3)*inv3, 0.0);
+        double mbDiv2 = 0.5*(c0 + c2Div3*(2.0*c2Div3*c2Div3 - c1));
+        // std::max(0.0, x) rather than -std::min(x, 0.0) avoids a negative zero,
+        // which would flip the angle to -pi/3 and spoil the ordering
+        double mq = std::max(0.0, -(mbDiv2*mbDiv2 + aDiv3*aDiv3*aDiv3));
+        double magnitude = std::sqrt(-aDiv3);
+        double angle = std::atan2(std::sqrt(mq), mbDiv2)*inv3;
+        double cs = std::cos(angle);
+        double sn = std::sin(angle);
+        (*d)[0] = static_cast<Real>(c2Div3 + 2.0*magnitude*cs);
+        (*d)[1] = static_cast<Real>(c2Div3 - magnitude*(cs - root3*sn));
+        (*d)[2] = static_cast<Real>(c2Div3 - magnitude*(cs + root3*sn));
+    }
+}
+
+    // Unit eigenvectors of a symmetric 2x2 tensor with eigenvalues l0 >= l1:
+    // the first eigenvector is orthogonal to the longer row of (A - l0*I).
+inline void
+symmetric2x2Eigenvectors(double a00, double a01, double a11, double l0,
+                         double * v0, double * v1)
+{
+    double r00 = a00 - l0, r11 = a11 - l0;
+    double n0 = r00*r00 + a01*a01,
+           n1 = a01*a01 + r11*r11;
+    if(n0 >= n1 && n0 > 0.0)
+    {
+        n0 = 1.0 / std::sqrt(n0);
+        v0[0] = -a01*n0;
+        v0[1] = r00*n0;
+    }
+    else if(n1 > 0.0)
+    {
+        n1 = 1.0 / std::sqrt(n1);
+        v0[0] = -r11*n1;
+        v0[1] = a01*n1;
+    }
+    else
+    {
+        // A = l0*I
+        v0[0] = 1.0;
+        v0[1] = 0.0;
+    }
+    v1[0] = -v0[1];
+    v1[1] = v0[0];
+}
+
+inline void
+symmetric3x3Cross(double const * a, double const * b, double * c)
+{
+    c[0] = a[1]*b[2] - a[2]*b[1];
+    c[1] = a[2]*b[0] - a[0]*b[2];
+    c[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+    // Unit eigenvector of a simple eigenvalue 'l': the longest cross product
+    // of two rows of (A - l*I).
+inline void
+symmetric3x3Eigenvector0(double const (&a)[3][3], double l, double * v)
+{
+    double r0[3] = { a[0][0] - l, a[0][1], a[0][2] },
+           r1[3] = { a[1][0], a[1][1] - l, a[1][2] },
+           r2[3] = { a[2][0], a[2][1], a[2][2] - l };
+    double c[3][3];
+    symmetric3x3Cross(r0, r1, c[0]);
+    symmetric3x3Cross(r0, r2, c[1]);
+    symmetric3x3Cross(r1, r2, c[2]);
+
+    int best = 0;
+    double nbest = 0.0;
+    for(int i = 0; i < 3; ++i)
+    {
+        double n = c[i][0]*c[i][0] + c[i][1]*c[i][1] + c[i][2]*c[i][2];
+        if(n > nbest)
+        {
+            nbest = n;
+            best = i;
+        }
+    }
+    if(nbest == 0.0)
+    {
+        v[0] = 1.0;
+        v[1] = v[2] = 0.0;
+        return;
+    }
+    nbest = 1.0 / std::sqrt(nbest);
+    for(int i = 0; i < 3; ++i)
+        v[i] = c[best][i]*nbest;
+}
+
+    // Unit eigenvector of eigenvalue 'l' orthogonal to the known unit eigenvector 'w',
+    // found by solving the 2x2 problem in the orthogonal complement of 'w'
+    // (robust for repeated eigenvalues, see D. Eberly: "A Robust Eigensolver for
+    // 3 x 3 Symmetric Matrices", Geometric Tools, 2014).
+inline void
+symmetric3x3Eigenvector1(double const (&a)[3][3], double const * w, double l, double * v)
+{
+    double u0[3], u1[3];
+    if(std::abs(w[0]) > std::abs(w[1]))
+    {
+        double s = 1.0 / std::sqrt(w[0]*w[0] + w[2]*w[2]);
+        u0[0] = -w[2]*s; u0[1] = 0.0; u0[2] = w[0]*s;
+    }
+    else
+    {
+        double s = 1.0 / std::sqrt(w[1]*w[1] + w[2]*w[2]);
+        u0[0] = 0.0; u0[1] = w[2]*s; u0[2] = -w[1]*s;
+    }
+    symmetric3x3Cross(w, u0, u1);
+
+    double au0[3], au1[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        au0[i] = a[i][0]*u0[0] + a[i][1]*u0[1] + a[i][2]*u0[2];
+        au1[i] = a[i][0]*u1[0] + a[i][1]*u1[1] + a[i][2]*u1[2];
+    }
+    double m00 = u0[0]*au0[0] + u0[1]*au0[1] + u0[2]*au0[2] - l,
+           m01 = u0[0]*au1[0] + u0[1]*au1[1] + u0[2]*au1[2],
+           m11 = u1[0]*au1[0] + u1[1]*au1[1] + u1[2]*au1[2] - l;
+
+    double c0 = 1.0, c1 = 0.0;   // v = c0*u0 + c1*u1
+    double am00 = std::abs(m00), am01 = std::abs(m01), am11 = std::abs(m11);
+    if(am00 >= am11)
+    {
+        if(std::max(am00, am01) > 0.0)
+        {
+            if(am00 >= am01)
+            {
+                m01 /= m00;
+                m00 = 1.0 / std::sqrt(1.0 + m01*m01);
+                m01 *= m00;
+            }
+            else
+            {
+                m00 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m00*m00);
+                m00 *= m01;
+            }
+            c0 = m01;
+            c1 = -m00;
+        }
+    }
+    else
+    {
+        if(std::max(am11, am01) > 0.0)
+        {
+            if(am11 >= am01)
+            {
+                m01 /= m11;
+                m11 = 1.0 / std::sqrt(1.0 + m01*m01);
+                m01 *= m11;
+            }
+            else
+            {
+                m11 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m11*m11);
+                m11 *= m01;
+            }
+            c0 = m11;
+            c1 = -m01;
+        }
+    }
+    for(int i = 0; i < 3; ++i)
+        v[i] = c0*u0[i] + c1*u1[i];
+}
+
+    // Unit eigenvectors of a symmetric 3x3 tensor with eigenvalues l[0] >= l[1] >= l[2],
+    // stored consecutively in 'v'.
+inline void
+symmetric3x3Eigenvectors(double a00, double a01, double a02, double a11, double a12, double a22,
+                         double const * l, double * v)
+{
+    if(a01 == 0.0 && a02 == 0.0 && a12 == 0.0)
+    {
+        // diagonal tensor: eigenvectors are the coordinate axes, sorted like the eigenvalues
+        double diag[3] = { a00, a11, a22 };
+        int order[3] = { 0, 1, 2 };
+        if(diag[order[0]] < diag[order[1]])
+            std::swap(order[0], order[1]);
+        if(diag[order[0]] < diag[order[2]])
+            std::swap(order[0], order[2]);
+        if(diag[order[1]] < diag[order[2]])
+            std::swap(order[1], order[2]);
+        for(int i = 0; i < 9; ++i)
+            v[i] = 0.0;
+        for(int i = 0; i < 3; ++i)
+            v[3*i + order[i]] = 1.0;
+        return;
+    }
+
+    double a[3][3] = { { a00, a01, a02 }, { a01, a11, a12 }, { a02, a12, a22 } };
+    if(l[0] - l[1] >= l[1] - l[2])
+    {
+        // l[0] is the best separated eigenvalue
+        symmetric3x3Eigenvector0(a, l[0], v);
+        symmetric3x3Eigenvector1(a, v, l[1], v + 3);
+        symmetric3x3Cross(v, v + 3, v + 6);
+    }
+    else
+    {
+        symmetric3x3Eigenvector0(a, l[2], v + 6);
+        symmetric3x3Eigenvector1(a, v + 6, l[1], v + 3);
+        symmetric3x3Cross(v + 3, v + 6, v);
+    }
+}
+
+    // eigenvalues and eigenvectors of 'n' consecutive symmetric 2x2 tensors
+template <class Real, class SrcIterator, class ValueIterator, class VectorIterator>
+void
+symmetric2x2EigensystemBatch(SrcIterator s, ValueIterator d, VectorIterator e, MultiArrayIndex n)
+{
+    symmetric2x2EigenvaluesBatch<Real>(s, d, n);
+    for(MultiArrayIndex k = 0; k < n; ++k, ++s, ++d, ++e)
+    {
+        double v[4];
+        symmetric2x2Eigenvectors((*s)[0], (*s)[1], (*s)[2], (*d)[0], v, v + 2);
+        for(int i = 0; i < 4; ++i)
+            (*e)[i] = static_cast<Real>(v[i]);
+    }
+}
+
+    // eigenvalues and eigenvectors of 'n' consecutive symmetric 3x3 tensors
+template <class Real, class SrcIterator, class ValueIterator, class VectorIterator>
+void
+symmetric3x3EigensystemBatch(SrcIterator s, ValueIterator d, VectorIterator e, MultiArrayIndex n)
+{
+    symmetric3x3EigenvaluesBatch<Real>(s, d, n);
+    for(MultiArrayIndex k = 0; k < n; ++k, ++s, ++d, ++e)
+    {
+        double a00 = (*s)[0], a01 = (*s)[1], a02 = (*s)[2],
+               a11 = (*s)[3], a12 = (*s)[4], a22 = (*s)[5];
+        double l[3] = { (double)(*d)[0], (double)(*d)[1], (double)(*d)[2] }, v[9];
+        symmetric3x3Eigenvectors(a00, a01, a02, a11, a12, a22, l, v);
+        for(int i = 0; i < 9; ++i)
+            (*e)[i] = static_cast<Real>(v[i]);
+        // The trigonometric formula loses half the digits for (nearly) repeated
+        // eigenvalues, whereas the eigenvectors are accurate. Their Rayleigh
+        // quotients restore full precision.
+        for(int i = 0; i < 3; ++i)
+        {
+            double const * w = v + 3*i;
+            (*d)[i] = static_cast<Real>(a00*w[0]*w[0] + a11*w[1]*w[1] + a22*w[2]*w[2] +
+                                        2.0*(a01*w[0]*w[1] + a02*w[0]*w[2] + a12*w[1]*w[2]));
+        }
+    }
+}
+
 template <int N, class ArgumentVector>
 class DeterminantFunctor
 {
@@ -179,6 +461,135 @@ public:
     }
 };
 
+    // Splits the scan order of an array into blocks and calls f(start, count) for each
+    // block, distributing the blocks over the threads given in 'options'.
+template <class F>
+void
+tensorBatchForeach(MultiArrayIndex size, ParallelOptions const & options, F f)
+{
+    static const MultiArrayIndex blockSize = 4096;
+    MultiArrayIndex nBlocks = (size + blockSize - 1) / blockSize;
+    int nThreads = options.getActualNumThreads();
+    if(nThreads <= 1 || nBlocks <= 1)
+    {
+        f(0, size);
+        return;
+    }
+    parallel_foreach(nThreads, nBlocks,
+        [&](size_t, MultiArrayIndex b)
+        {
+            MultiArrayIndex start = b*blockSize;
+            f(start, std::min(blockSize, size - start));
+        });
+}
+
+template <class View>
+inline typename View::const_pointer
+tensorBatchBegin(View const & v, MultiArrayIndex start, VigraTrueType /* unstrided */)
+{
+    return v.data() + start;
+}
+
+template <class View>
+inline typename View::const_iterator
+tensorBatchBegin(View const & v, MultiArrayIndex start, VigraFalseType /* strided */)
+{
+    return v.begin() + start;
+}
+
+template <class View>
+inline typename View::pointer
+tensorBatchBegin(View & v, MultiArrayIndex start, VigraTrueType /* unstrided */)
+{
+    return v.data() + start;
+}
+
+template <class View>
+inline typename View::iterator
+tensorBatchBegin(View & v, MultiArrayIndex start, VigraFalseType /* strided */)
+{
+    return v.begin() + start;
+}
+
+template <class Real, class SrcIterator, class DestIterator>
+inline void
+symmetricEigenvaluesBatch(SrcIterator s, DestIterator d, MultiArrayIndex n, MetaInt<2>)
+{
+    symmetric2x2EigenvaluesBatch<Real>(s, d, n);
+}
+
+template <class Real, class SrcIterator, class DestIterator>
+inline void
+symmetricEigenvaluesBatch(SrcIterator s, DestIterator d, MultiArrayIndex n, MetaInt<3>)
+{
+    symmetric3x3EigenvaluesBatch<Real>(s, d, n);
+}
+
+template <class Real, class SrcIterator, class ValueIterator, class VectorIterator>
+inline void
+symmetricEigensystemBatch(SrcIterator s, ValueIterator d, VectorIterator e, MultiArrayIndex n, MetaInt<2>)
+{
+    symmetric2x2EigensystemBatch<Real>(s, d, e, n);
+}
+
+template <class Real, class SrcIterator, class ValueIterator, class VectorIterator>
+inline void
+symmetricEigensystemBatch(SrcIterator s, ValueIterator d, VectorIterator e, MultiArrayIndex n, MetaInt<3>)
+{
+    symmetric3x3EigensystemBatch<Real>(s, d, e, n);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+void
+tensorEigenvaluesBatch(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> & dest,
+                       ParallelOptions const & options)
+{
+    typedef typename T2::value_type Real;
+    vigra_precondition(N*(N+1)/2 == (int)T1::static_size,
+        "tensorEigenvaluesMultiArray(): Wrong number of channels in input array.");
+    vigra_precondition(N == (int)T2::static_size,
+        "tensorEigenvaluesMultiArray(): Wrong number of channels in output array.");
+    bool unstrided = source.isUnstrided() && dest.isUnstrided();
+    tensorBatchForeach(source.size(), options,
+        [&](MultiArrayIndex start, MultiArrayIndex count)
+        {
+            if(unstrided)
+                symmetricEigenvaluesBatch<Real>(tensorBatchBegin(source, start, VigraTrueType()),
+                                                tensorBatchBegin(dest, start, VigraTrueType()),
+                                                count, MetaInt<N>());
+            else
+                symmetricEigenvaluesBatch<Real>(tensorBatchBegin(source, start, VigraFalseType()),
+                                                tensorBatchBegin(dest, start, VigraFalseType()),
+                                                count, MetaInt<N>());
+        });
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class T3, class S3>
+void
+tensorEigensystemBatch(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> & values,
+                       MultiArrayView<N, T3, S3> & vectors,
+                       ParallelOptions const & options)
+{
+    typedef typename T3::value_type Real;
+    bool unstrided = source.isUnstrided() && values.isUnstrided() && vectors.isUnstrided();
+    tensorBatchForeach(source.size(), options,
+        [&](MultiArrayIndex start, MultiArrayIndex count)
+        {
+            if(unstrided)
+                symmetricEigensystemBatch<Real>(tensorBatchBegin(source, start, VigraTrueType()),
+                                                tensorBatchBegin(values, start, VigraTrueType()),
+                                                tensorBatchBegin(vectors, start, VigraTrueType()),
+                                                count, MetaInt<N>());
+            else
+                symmetricEigensystemBatch<Real>(tensorBatchBegin(source, start, VigraFalseType()),
+                                                tensorBatchBegin(values, start, VigraFalseType()),
+                                                tensorBatchBegin(vectors, start, VigraFalseType()),
+                                                count, MetaInt<N>());
+        });
+}
+
 } // namespace detail
 
 
@@ -431,8 +842,20 @@ tensorTraceMultiArray(MultiArrayView<N, T1, S1> const & source,
         void 
         tensorEigenvaluesMultiArray(MultiArrayView<N, T1, S1> const & source,
                                     MultiArrayView<N, T2, S2> dest);
+
+        // closed-form batch computation, parallelized over the array
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void 
+        tensorEigenvaluesMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    ParallelOptions const & options);
     }
     \endcode
+    
+    The version with \ref vigra::ParallelOptions evaluates the closed-form solutions
+    in blocks of consecutive elements and distributes the blocks over multiple threads. 
+    Use \ref tensorEigensystemMultiArray() to get the eigenvectors as well.
 
     \deprecatedAPI{tensorEigenvaluesMultiArray}
     pass \ref MultiIteratorPage "MultiIterators" and \ref DataAccessors :
@@ -522,6 +945,94 @@ tensorEigenvaluesMultiArray(MultiArrayView<N, T1, S1> const & source,
     tensorEigenvaluesMultiArray(srcMultiArrayRange(source), destMultiArray(dest));
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void 
+tensorEigenvaluesMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "tensorEigenvaluesMultiArray(): shape mismatch between input and output.");
+    detail::tensorEigenvaluesBatch(source, dest, options);
+}
+
+/********************************************************/
+/*                                                      */
+/*             tensorEigensystemMultiArray              */
+/*                                                      */
+/********************************************************/
+
+/** \brief Calculate the tensor eigenvalues and eigenvectors for every element of a N-D tensor array.
+
+    The source array holds the upper triangular part of a symmetric tensor as in 
+    \ref tensorEigenvaluesMultiArray(). For every element, the eigenvalues are written
+    to <tt>eigenvalues</tt> in descending order, and the corresponding unit eigenvectors
+    are written to <tt>eigenvectors</tt>, whose value_type must be a vector of length N*N: 
+    the k-th eigenvector occupies the components <tt>[k*N, (k+1)*N)</tt>. The sign of
+    each eigenvector is arbitrary.
+    
+    The computation uses closed-form solutions (see D. Eberly: "A Robust Eigensolver for
+    3 x 3 Symmetric Matrices", Geometric Tools, 2014) that remain accurate for repeated 
+    eigenvalues. The array is split into blocks that are processed in parallel according 
+    to the given \ref vigra::ParallelOptions. The same kernels are used by the
+    three-argument version of \ref tensorEigenvaluesMultiArray().
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                                  class T3, class S3>
+        void 
+        tensorEigensystemMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> eigenvalues,
+                                    MultiArrayView<N, T3, S3> eigenvectors,
+                                    ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_tensorutilities.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float>                  vol(shape);
+    MultiArray<3, TinyVector<float, 6> >  hessian(shape);
+    MultiArray<3, TinyVector<float, 3> >  eigenvalues(shape);
+    MultiArray<3, TinyVector<float, 9> >  eigenvectors(shape);
+    
+    hessianOfGaussianMultiArray(vol, hessian, 2.0);
+    tensorEigensystemMultiArray(hessian, eigenvalues, eigenvectors,
+                                ParallelOptions().numThreads(4));
+    \endcode
+
+    <b> Preconditions:</b>
+
+    <tt>N == 2</tt> or <tt>N == 3</tt>
+*/
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+                          class T3, class S3>
+void 
+tensorEigensystemMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> eigenvalues,
+                            MultiArrayView<N, T3, S3> eigenvectors,
+                            ParallelOptions const & options = ParallelOptions())
+{
+    vigra_precondition(source.shape() == eigenvalues.shape() && source.shape() == eigenvectors.shape(),
+        "tensorEigensystemMultiArray(): shape mismatch between input and output.");
+    vigra_precondition(N*(N+1)/2 == (int)T1::static_size,
+        "tensorEigensystemMultiArray(): Wrong number of channels in input array.");
+    vigra_precondition(N == (int)T2::static_size,
+        "tensorEigensystemMultiArray(): Wrong number of channels in eigenvalue array.");
+    vigra_precondition(N*N == (int)T3::static_size,
+        "tensorEigensystemMultiArray(): Wrong number of channels in eigenvector array.");
+    detail::tensorEigensystemBatch(source, eigenvalues, eigenvectors, options);
+}
+
 /********************************************************/
 /*                                                      */
 /*             tensorDeterminantMultiArray              */
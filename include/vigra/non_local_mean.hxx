@@ -61,7 +61,9 @@
 #include "multi_convolution.hxx"
 #include "error.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
 #include "gaussians.hxx"
+#include "integral_image.hxx"
 
 namespace vigra{
 
@@ -75,7 +77,8 @@ struct NonLocalMeanParameter{
         const int stepSize = 2,
         const int iterations=1,
         const int nThreads = 8,
-        const bool verbose = true
+        const bool verbose = true,
+        const bool useIntegralImage = false
     ):
     sigmaSpatial_(sigmaSpatial),
     searchRadius_(searchRadius),
@@ -84,7 +87,8 @@ struct NonLocalMeanParameter{
     stepSize_(stepSize),
     iterations_(iterations),
     nThreads_(nThreads),
-    verbose_(verbose){
+    verbose_(verbose),
+    useIntegralImage_(useIntegralImage){
     }
     double sigmaSpatial_;
     int searchRadius_;
@@ -94,6 +98,11 @@ struct NonLocalMeanParameter{
     int iterations_;
     int nThreads_;
     bool verbose_;
+    // compute patch distances in O(1) from an integral image of squared
+    // differences per search offset. This denoises every pixel with
+    // uniformly weighted (box) patches, so 'sigmaSpatial_' and
+    // 'stepSize_' are ignored.
+    bool useIntegralImage_;
 };
 
 
@@ -832,6 +841,199 @@ inline void gaussianMeanAndVariance(
 
 namespace detail_non_local_means{
 
+// memory offsets of the mirrored coordinates begin, ..., begin+length-1 along one axis
+// (mirrored like BorderHelper::mirrorIfIsOutsidePoint())
+inline void mirroredOffsets(MultiArrayIndex begin, MultiArrayIndex length,
+                            MultiArrayIndex size, MultiArrayIndex stride,
+                            std::vector<MultiArrayIndex> & offsets)
+{
+    offsets.resize(length);
+    for(MultiArrayIndex k=0; k<length; ++k){
+        MultiArrayIndex c = begin + k;
+        if(c < 0)
+            c = -c;
+        else if(c >= size)
+            c = 2*size - c - 1;
+        // guard against patches larger than the image
+        c = std::min(std::max(c, MultiArrayIndex(0)), size-1);
+        offsets[k] = c*stride;
+    }
+}
+
+template<int DIM, class PIXEL_TYPE_IN,class PIXEL_TYPE_OUT,class SMOOTH_POLICY>
+void nonLocalMeanIntegral1Run(
+    const vigra::MultiArrayView<DIM,PIXEL_TYPE_IN> & image,
+    const SMOOTH_POLICY & smoothPolicy,
+    const NonLocalMeanParameter param,
+    vigra::MultiArrayView<DIM,PIXEL_TYPE_OUT> outImage
+){
+    typedef PIXEL_TYPE_IN       PixelTypeIn;
+    typedef typename vigra::NumericTraits<PixelTypeIn>::RealPromote         RealPromotePixelType;
+    typedef typename vigra::NumericTraits<RealPromotePixelType>::ValueType RealPromoteScalarType;
+    typedef typename MultiArrayShape<DIM>::type Coordinate;
+
+    vigra_precondition(param.searchRadius_>=1, "NonLocalMean Parameter: \"searchRadius >=1\" violated");
+    vigra_precondition(param.patchRadius_>=1,"NonLocalMean Parameter: \"patchRadius >=1\" violated");
+
+    const Coordinate shape = image.shape();
+    const int f = param.patchRadius_;
+    const int r = param.searchRadius_;
+    const double patchSize = std::pow(2.0*f+1.0, DIM);
+
+    vigra::MultiArray<DIM,RealPromotePixelType> meanImage(shape);
+    vigra::MultiArray<DIM,RealPromotePixelType> varImage(shape);
+    gaussianMeanAndVariance<DIM,PixelTypeIn,RealPromotePixelType>(image,param.sigmaMean_,meanImage,varImage);
+
+    vigra::MultiArray<DIM,UInt8> useImage(shape);
+    for(int scanOrderIndex=0; scanOrderIndex<image.size(); ++scanOrderIndex)
+        useImage[scanOrderIndex] = smoothPolicy.usePixel(meanImage[scanOrderIndex],varImage[scanOrderIndex]);
+
+    // accumulated estimates and weights, each pixel is owned by exactly one block
+    // (all these arrays have the same strides)
+    vigra::MultiArray<DIM,RealPromotePixelType>  estimateImage(shape);
+    vigra::MultiArray<DIM,RealPromoteScalarType> weightImage(shape);
+    vigra::MultiArray<DIM,RealPromoteScalarType> wmaxImage(shape);
+    const Coordinate stride = meanImage.stride();
+
+    // search offsets (the center is handled separately)
+    std::vector<Coordinate> offsets;
+    MultiCoordinateIterator<DIM> o(Coordinate(2*r+1)), oend(o.getEndIterator());
+    for(; o != oend; ++o)
+        if(*o != Coordinate(r))
+            offsets.push_back(*o - Coordinate(r));
+
+    // blocks along the last axis
+    const int nThreads = std::max(param.nThreads_, 1);
+    const MultiArrayIndex nBlocks = std::min<MultiArrayIndex>(shape[DIM-1], 4*nThreads);
+
+    threading::mutex progressMutex;
+    MultiArrayIndex blocksDone = 0;
+    if(param.verbose_)
+        std::cout<<"progress";
+
+    parallel_foreach(nThreads, nBlocks,
+        [&](size_t /*threadId*/, MultiArrayIndex block)
+        {
+            SMOOTH_POLICY policy(smoothPolicy);
+
+            Coordinate blockBegin, blockShape(shape);
+            blockBegin[DIM-1] = (block * shape[DIM-1]) / nBlocks;
+            blockShape[DIM-1] = ((block+1) * shape[DIM-1]) / nBlocks - blockBegin[DIM-1];
+
+            // squared differences of the block with a halo of 'f', preceded
+            // by a zero layer such that box sums need no special cases
+            const Coordinate paddedShape = blockShape + Coordinate(2*f);
+            vigra::MultiArray<DIM,double> integral(paddedShape + Coordinate(1));
+            vigra::MultiArrayView<DIM,double> diff = integral.subarray(Coordinate(1), paddedShape + Coordinate(1));
+
+            // corners of the box [x, x+2f] in the integral image and their signs
+            const int nCorners = 1 << DIM;
+            MultiArrayIndex cornerOffsets[1 << DIM];
+            double cornerSigns[1 << DIM];
+            for(int c=0; c<nCorners; ++c){
+                Coordinate corner;
+                int bits = 0;
+                for(int d=0; d<DIM; ++d){
+                    if(c & (1 << d)){
+                        corner[d] = 2*f+1;
+                        ++bits;
+                    }
+                }
+                cornerOffsets[c] = dot(corner, integral.stride());
+                cornerSigns[c] = ((DIM - bits) % 2 == 0) ? 1.0 : -1.0;
+            }
+
+            std::vector<MultiArrayIndex> mirrorA[DIM], mirrorB[DIM];
+            for(int d=0; d<DIM; ++d)
+                mirroredOffsets(blockBegin[d] - f, paddedShape[d], shape[d], image.stride(d), mirrorA[d]);
+
+            // iterate over rows along axis 0
+            Coordinate paddedRows(paddedShape), blockRows(blockShape);
+            paddedRows[0] = 1;
+            blockRows[0] = 1;
+
+            for(size_t k=0; k<offsets.size(); ++k){
+                const Coordinate & offset = offsets[k];
+                for(int d=0; d<DIM; ++d)
+                    mirroredOffsets(blockBegin[d] - f + offset[d], paddedShape[d], shape[d], image.stride(d), mirrorB[d]);
+
+                MultiCoordinateIterator<DIM> p(paddedRows), pend(p.getEndIterator());
+                for(; p != pend; ++p){
+                    const PixelTypeIn * rowA = image.data();
+                    const PixelTypeIn * rowB = image.data();
+                    for(int d=1; d<DIM; ++d){
+                        rowA += mirrorA[d][(*p)[d]];
+                        rowB += mirrorB[d][(*p)[d]];
+                    }
+                    double * out = &diff[*p];
+                    for(MultiArrayIndex i=0; i<paddedShape[0]; ++i, out += diff.stride(0)){
+                        const RealPromotePixelType vA = rowA[mirrorA[0][i]];
+                        const RealPromotePixelType vB = rowB[mirrorB[0][i]];
+                        *out = vigra::sizeDividedSquaredNorm(vA-vB);
+                    }
+                }
+                integralMultiArray(diff, diff);
+
+                // pixels whose neighbor at 'offset' is inside the image
+                Coordinate xBegin = max(blockBegin, -offset),
+                           xEnd   = min(blockBegin + blockShape, shape - offset);
+                if(!allLess(xBegin, xEnd))
+                    continue;
+                Coordinate rows = xEnd - xBegin;
+                rows[0] = 1;
+                const MultiArrayIndex neighbor = dot(offset, stride),
+                                      imageNeighbor = dot(offset, image.stride());
+
+                MultiCoordinateIterator<DIM> x(rows), xend(x.getEndIterator());
+                for(; x != xend; ++x){
+                    const Coordinate xyz = xBegin + *x;
+                    MultiArrayIndex i = dot(xyz, stride);
+                    const PixelTypeIn * pixel = &image[xyz];
+                    const double * box = integral.data() + dot(xyz - blockBegin, integral.stride());
+                    for(MultiArrayIndex x0=xBegin[0]; x0<xEnd[0]; ++x0, ++i, pixel += image.stride(0), box += integral.stride(0)){
+                        const MultiArrayIndex n = i + neighbor;
+                        if(!useImage[i] || !useImage[n] ||
+                           !policy.usePixelPair(meanImage[i],varImage[i],meanImage[n],varImage[n]))
+                            continue;
+                        double boxSum = 0.0;
+                        for(int c=0; c<nCorners; ++c)
+                            boxSum += cornerSigns[c]*box[cornerOffsets[c]];
+                        // same normalization as patchDistance() with uniform weights
+                        const RealPromoteScalarType distance =
+                            static_cast<RealPromoteScalarType>(boxSum / (patchSize*patchSize));
+                        const RealPromoteScalarType w =
+                            policy.distanceToWeight(meanImage[i],varImage[i],distance);
+                        estimateImage[i] += RealPromotePixelType(pixel[imageNeighbor])*w;
+                        weightImage[i] += w;
+                        wmaxImage[i] = std::max(w, wmaxImage[i]);
+                    }
+                }
+            }
+
+            if(param.verbose_){
+                threading::lock_guard<threading::mutex> guard(progressMutex);
+                ++blocksDone;
+                std::cout<<"\rprogress "<<std::setw(10)<<(100.0*blocksDone)/nBlocks<<" %%"<<std::flush;
+            }
+        }
+    );
+    if(param.verbose_)
+        std::cout<<"\n";
+
+    // give each pixel as much weight as its best matching neighbor
+    for(int scanOrderIndex=0; scanOrderIndex<image.size(); ++scanOrderIndex){
+        if(!useImage[scanOrderIndex]){
+            outImage[scanOrderIndex]=image[scanOrderIndex];
+            continue;
+        }
+        RealPromoteScalarType wmax = wmaxImage[scanOrderIndex];
+        if(wmax == 0.0)
+            wmax = 1.0;
+        outImage[scanOrderIndex]=(estimateImage[scanOrderIndex] + RealPromotePixelType(image[scanOrderIndex])*wmax) /
+                                 (weightImage[scanOrderIndex] + wmax);
+    }
+}
+
 template<int DIM, class PIXEL_TYPE_IN,class PIXEL_TYPE_OUT,class SMOOTH_POLICY>
 void nonLocalMean1Run(
     const vigra::MultiArrayView<DIM,PIXEL_TYPE_IN> & image,
@@ -847,6 +1049,10 @@ void nonLocalMean1Run(
 
     typedef BlockWiseNonLocalMeanThreadObject<DIM,PixelTypeIn,SmoothPolicyType> ThreadObjectType;
 
+    if(param.useIntegralImage_){
+        nonLocalMeanIntegral1Run<DIM,PIXEL_TYPE_IN,PIXEL_TYPE_OUT,SMOOTH_POLICY>(image,smoothPolicy,param,outImage);
+        return;
+    }
 
     // inspect parameter
     vigra_precondition(param.stepSize_>=1,"NonLocalMean Parameter: \"stepSize>=1\" violated");
@@ -45,6 +45,8 @@
 #include "bordertreatment.hxx"
 #include "array_vector.hxx"
 #include "multi_shape.hxx"
+#include "multi_array.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -359,6 +361,29 @@ void recursiveFilterLine(SrcIterator is, SrcIterator isend, SrcAccessor as,
     }
 }
             
+namespace detail {
+
+    // Coefficients of the third order recursive Gaussian filter by Young and van Vliet,
+    // taken from Luigi Rosa's implementation for Matlab.
+struct RecursiveGaussianCoefficients
+{
+    explicit RecursiveGaussianCoefficients(double sigma)
+    {
+        double q = 1.31564 * (std::sqrt(1.0 + 0.490811 * sigma*sigma) - 1.0);
+        double qq = q*q;
+        double qqq = qq*q;
+        double b0 = 1.0/(1.57825 + 2.44413*q + 1.4281*qq + 0.422205*qqq);
+        b1 = (2.44413*q + 2.85619*qq + 1.26661*qqq)*b0;
+        b2 = (-1.4281*qq - 1.26661*qqq)*b0;
+        b3 = 0.422205*qqq*b0;
+        B = 1.0 - (b1 + b2 + b3);
+    }
+
+    double b1, b2, b3, B;
+};
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*              recursiveGaussianFilterLine             */
@@ -448,15 +473,8 @@ recursiveGaussianFilterLine(SrcIterator is, SrcIterator isend, SrcAccessor as,
                             DestIterator id, DestAccessor ad, 
                             double sigma)
 {
-    //coefficients taken out Luigi Rosa's implementation for Matlab
-    double q = 1.31564 * (std::sqrt(1.0 + 0.490811 * sigma*sigma) - 1.0);
-    double qq = q*q;
-    double qqq = qq*q;
-    double b0 = 1.0/(1.57825 + 2.44413*q + 1.4281*qq + 0.422205*qqq);
-    double b1 = (2.44413*q + 2.85619*qq + 1.26661*qqq)*b0;
-    double b2 = (-1.4281*qq - 1.26661*qqq)*b0;
-    double b3 = 0.422205*qqq*b0;
-    double B = 1.0 - (b1 + b2 + b3);
+    detail::RecursiveGaussianCoefficients coeffs(sigma);
+    double b1 = coeffs.b1, b2 = coeffs.b2, b3 = coeffs.b3, B = coeffs.B;
     
     int w = isend - is;
     vigra_precondition(w >= 4,
@@ -2221,6 +2239,358 @@ recursiveSecondDerivativeY(MultiArrayView<2, T1, S1> const & src,
     recursiveSecondDerivativeY(srcImageRange(src),
                                destImage(dest), scale);
 }
+
+
+/********************************************************/
+/*                                                      */
+/*              recursiveGaussianMultiArray             */
+/*                                                      */
+/********************************************************/
+
+namespace detail {
+
+    // Young / van Vliet filter on 'count' interleaved lines of length 'w': position x
+    // of line j is line[x*stride + j]. This performs exactly the same operations as
+    // recursiveGaussianFilterLine() for every line, but the innermost loops run over
+    // independent lines and can be vectorized. 'backward' must have the same size
+    // as 'line', the result is written to 'backward'.
+template <class T>
+void
+recursiveGaussianInterleaved(T * line, T * backward, int w, int stride, int count,
+                             RecursiveGaussianCoefficients const & c, double sigma)
+{
+    const double b1 = c.b1, b2 = c.b2, b3 = c.b3, B = c.B;
+    int kernelw = std::min(w-4, (int)(4.0*sigma));
+    int x, j;
+
+    // initialise the filter for reflective boundary conditions
+    for(x = kernelw+1; x < std::min(w, kernelw+4); ++x)
+        for(j = 0; j < count; ++j)
+            backward[x*stride + j] = T();
+    for(x = kernelw; x >= 0; --x)
+    {
+        T * b = backward + x*stride;
+        T const * l = line + x*stride;
+        for(j = 0; j < count; ++j)
+            b[j] = RequiresExplicitCast<T>::cast(B*l[j] + (b1*b[j+stride] + b2*b[j+2*stride] + b3*b[j+3*stride]));
+    }
+
+    // from left to right - causal - forward (in place)
+    for(j = 0; j < count; ++j)
+    {
+        T * l = line + j;
+        T const * b = backward + j;
+        l[0]        = RequiresExplicitCast<T>::cast(B*l[0] + (b1*b[stride] + b2*b[2*stride] + b3*b[3*stride]));
+        l[stride]   = RequiresExplicitCast<T>::cast(B*l[stride] + (b1*l[0] + b2*b[stride] + b3*b[2*stride]));
+        l[2*stride] = RequiresExplicitCast<T>::cast(B*l[2*stride] + (b1*l[stride] + b2*l[0] + b3*b[stride]));
+    }
+    for(x = 3; x < w; ++x)
+    {
+        T * l = line + x*stride;
+        for(j = 0; j < count; ++j)
+            l[j] = RequiresExplicitCast<T>::cast(B*l[j] + (b1*l[j-stride] + b2*l[j-2*stride] + b3*l[j-3*stride]));
+    }
+
+    // from right to left - anticausal - backward
+    for(j = 0; j < count; ++j)
+    {
+        T const * l = line + j;
+        T * b = backward + j;
+        b[(w-1)*stride] = RequiresExplicitCast<T>::cast(B*l[(w-1)*stride] +
+                              (b1*l[(w-2)*stride] + b2*l[(w-3)*stride] + b3*l[(w-4)*stride]));
+        b[(w-2)*stride] = RequiresExplicitCast<T>::cast(B*l[(w-2)*stride] +
+                              (b1*b[(w-1)*stride] + b2*l[(w-2)*stride] + b3*l[(w-3)*stride]));
+        b[(w-3)*stride] = RequiresExplicitCast<T>::cast(B*l[(w-3)*stride] +
+                              (b1*b[(w-2)*stride] + b2*b[(w-1)*stride] + b3*l[(w-2)*stride]));
+    }
+    for(x = w-4; x >= 0; --x)
+    {
+        T * b = backward + x*stride;
+        T const * l = line + x*stride;
+        for(j = 0; j < count; ++j)
+            b[j] = RequiresExplicitCast<T>::cast(B*l[j] + (b1*b[j+stride] + b2*b[j+2*stride] + b3*b[j+3*stride]));
+    }
+}
+
+    // Filter all lines of 'source' along axis 'd' with a recursive Gaussian, followed
+    // by a central difference of the given order (0, 1, or 2) with reflective boundary
+    // conditions. Lines are processed in blocks of up to 16 neighbors along a second
+    // axis, which are interleaved in the line buffer, and the blocks are distributed
+    // over the threads of 'pool'.
+template <class TmpType, unsigned int N, class T1, class S1, class T2, class S2>
+void
+recursiveGaussianOneDimension(MultiArrayView<N, T1, S1> const & source,
+                              MultiArrayView<N, T2, S2> dest,
+                              unsigned int d, double sigma, int order,
+                              ThreadPool & pool)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    const int w = source.shape(d);
+    const unsigned int c = (d == 0) ? N-1 : 0;
+    const MultiArrayIndex blockSize = (N == 1) ? 1 : 16;
+    RecursiveGaussianCoefficients coeffs(sigma);
+
+    Shape blocks(source.shape());
+    blocks[d] = 1;
+    blocks[c] = (blocks[c] + blockSize - 1) / blockSize;
+
+    std::vector<ArrayVector<TmpType> > buffers(std::max<size_t>(1, pool.nThreads()));
+
+    parallel_foreach(pool, prod(blocks),
+        [&](size_t threadId, MultiArrayIndex b)
+        {
+            Shape start;
+            detail::ScanOrderToCoordinate<N>::exec(b, blocks, start);
+            start[c] *= blockSize;
+            const int count = (int)std::min(blockSize, source.shape(c) - start[c]);
+
+            ArrayVector<TmpType> & buffer = buffers[threadId];
+            buffer.resize(2*blockSize*w);
+            TmpType * line = buffer.begin(),
+                    * result = line + blockSize*w;
+
+            // copy the lines to interleaved memory
+            T1 const * s = &source[start];
+            const MultiArrayIndex sstride = source.stride(d),
+                                  sblock  = source.stride(c);
+            for(int x = 0; x < w; ++x, s += sstride)
+                for(int j = 0; j < count; ++j)
+                    line[x*blockSize + j] = TmpType(s[j*sblock]);
+
+            recursiveGaussianInterleaved(line, result, w, (int)blockSize, count, coeffs, sigma);
+
+            T2 * t = &dest[start];
+            const MultiArrayIndex dstride = dest.stride(d),
+                                  dblock  = dest.stride(c);
+            TmpType const * r = result;
+            if(order == 0)
+            {
+                for(int x = 0; x < w; ++x, t += dstride, r += blockSize)
+                    for(int j = 0; j < count; ++j)
+                        t[j*dblock] = RequiresExplicitCast<T2>::cast(r[j]);
+            }
+            else
+            {
+                // central differences, the reflected neighbors of x = 0 and x = w-1
+                // are x = 1 and x = w-2
+                for(int x = 0; x < w; ++x, t += dstride, r += blockSize)
+                {
+                    TmpType const * left  = x == 0   ? r + blockSize : r - blockSize,
+                                  * right = x == w-1 ? r - blockSize : r + blockSize;
+                    if(order == 1)
+                        for(int j = 0; j < count; ++j)
+                            t[j*dblock] = RequiresExplicitCast<T2>::cast(0.5*(right[j] - left[j]));
+                    else
+                        for(int j = 0; j < count; ++j)
+                            t[j*dblock] = RequiresExplicitCast<T2>::cast(right[j] - 2.0*r[j] + left[j]);
+                }
+            }
+        }
+    );
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+void
+recursiveGaussianMultiArrayImpl(MultiArrayView<N, T1, S1> const & source,
+                                MultiArrayView<N, T2, S2> dest,
+                                TinyVector<double, int(N)> sigma,
+                                TinyVector<int, int(N)> const & order,
+                                ParallelOptions const & options,
+                                const char * function_name)
+{
+    typedef typename NumericTraits<T2>::RealPromote TmpType;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        std::string(function_name) + "(): shape mismatch between input and output.");
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        sigma[d] = std::abs(sigma[d]);
+        vigra_precondition(order[d] >= 0 && order[d] <= 2,
+            std::string(function_name) + "(): derivative order must be 0, 1, or 2.");
+        vigra_precondition(sigma[d] == 0.0 || source.shape(d) >= 4,
+            std::string(function_name) + "(): array must have at least length 4 along filtered axes.");
+    }
+    if(source.size() == 0)
+        return;
+
+    unsigned int axes = 0;
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        if(sigma[d] == 0.0 && order[d] == 0)
+            continue;
+        vigra_precondition(sigma[d] > 0.0,
+            std::string(function_name) + "(): derivatives require a positive scale.");
+        ++axes;
+    }
+    if(axes == 0)
+    {
+        dest = source;
+        return;
+    }
+
+    ThreadPool pool(options);
+
+    // intermediate results are kept in TmpType (like separableConvolveMultiArray()),
+    // unless 'dest' can hold them without loss
+    MultiArray<N, TmpType> tmp;
+    if(!IsSameType<TmpType, T2>::value && axes > 1)
+        tmp.reshape(source.shape());
+
+    for(unsigned int d = 0, k = 0; d < N; ++d)
+    {
+        if(sigma[d] == 0.0 && order[d] == 0)
+            continue;
+        if(!tmp.hasData())
+        {
+            if(k == 0)
+                recursiveGaussianOneDimension<TmpType>(source, dest, d, sigma[d], order[d], pool);
+            else
+                recursiveGaussianOneDimension<TmpType>(dest, dest, d, sigma[d], order[d], pool);
+        }
+        else if(k == 0)
+        {
+            recursiveGaussianOneDimension<TmpType>(source, tmp, d, sigma[d], order[d], pool);
+        }
+        else if(k == axes-1)
+        {
+            recursiveGaussianOneDimension<TmpType>(tmp, dest, d, sigma[d], order[d], pool);
+        }
+        else
+        {
+            recursiveGaussianOneDimension<TmpType>(tmp, tmp, d, sigma[d], order[d], pool);
+        }
+        ++k;
+    }
+}
+
+} // namespace detail
+
+/** \brief Recursive Gaussian smoothing and derivatives of N-D arrays.
+
+    These functions apply the third order recursive approximation of the Gaussian
+    filter by Young and van Vliet (see \ref recursiveGaussianFilterLine()) along every
+    axis of a multi-dimensional array. In contrast to \ref gaussianSmoothMultiArray(),
+    the cost per pixel does not depend on <tt>sigma</tt>, which makes these functions
+    attractive for large scales. Along each axis, the result is identical to
+    \ref recursiveGaussianFilterLine().
+
+    Derivatives are computed by central differences of the smoothed data (as proposed
+    by Young and van Vliet): <tt>(f(x+1) - f(x-1)) / 2</tt> for the first and
+    <tt>f(x+1) - 2 f(x) + f(x-1)</tt> for the second derivative, with reflective
+    boundary conditions. <tt>derivativeOrders[d]</tt> specifies the order along axis
+    <tt>d</tt>. An axis with <tt>sigma == 0</tt> and derivative order 0 is left
+    unfiltered.
+
+    Lines are filtered in blocks of 16 neighboring lines that are interleaved in
+    memory, so that the recursions of different lines run in the same (vectorizable)
+    inner loop. The blocks are distributed over the threads given by the
+    \ref vigra::ParallelOptions. Intermediate results are stored with the precision of
+    <tt>NumericTraits<T2>::RealPromote</tt>. In-place operation is allowed.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // isotropic smoothing
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        recursiveGaussianMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    double sigma,
+                                    ParallelOptions const & options = ParallelOptions());
+
+        // anisotropic smoothing and derivatives
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        recursiveGaussianMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    TinyVector<double, N> const & sigma,
+                                    TinyVector<int, N> const & derivativeOrders = TinyVector<int, N>(),
+                                    ParallelOptions const & options = ParallelOptions());
+
+        // gradient
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        recursiveGaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                            MultiArrayView<N, TinyVector<T2, N>, S2> dest,
+                                            double sigma,
+                                            ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/recursiveconvolution.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> volume(Shape3(400, 400, 300)), smoothed(volume.shape()),
+                         dz(volume.shape());
+    MultiArray<3, TinyVector<float, 3> > gradient(volume.shape());
+    ...
+    recursiveGaussianMultiArray(volume, smoothed, 20.0, ParallelOptions().numThreads(8));
+
+    // derivative along z
+    recursiveGaussianMultiArray(volume, dz, TinyVector<double, 3>(5.0), TinyVector<int, 3>(0, 0, 1));
+
+    recursiveGaussianGradientMultiArray(volume, gradient, 5.0);
+    \endcode
+
+    <b> Preconditions:</b>
+
+    The array must have at least length 4 along every filtered axis.
+*/
+doxygen_overloaded_function(template <...> void recursiveGaussianMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+recursiveGaussianMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            TinyVector<double, int(N)> const & sigma,
+                            TinyVector<int, int(N)> const & derivativeOrders = TinyVector<int, int(N)>(),
+                            ParallelOptions const & options = ParallelOptions())
+{
+    detail::recursiveGaussianMultiArrayImpl(source, dest, sigma, derivativeOrders, options,
+                                            "recursiveGaussianMultiArray");
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+recursiveGaussianMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            double sigma,
+                            ParallelOptions const & options = ParallelOptions())
+{
+    detail::recursiveGaussianMultiArrayImpl(source, dest, TinyVector<double, int(N)>(sigma),
+                                            TinyVector<int, int(N)>(), options,
+                                            "recursiveGaussianMultiArray");
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+recursiveGaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, TinyVector<T2, int(N)>, S2> dest,
+                                    double sigma,
+                                    ParallelOptions const & options = ParallelOptions())
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "recursiveGaussianGradientMultiArray(): shape mismatch between input and output.");
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        TinyVector<int, int(N)> order;
+        order[d] = 1;
+        detail::recursiveGaussianMultiArrayImpl(source, dest.bindElementChannel(d),
+                                                TinyVector<double, int(N)>(sigma), order, options,
+                                                "recursiveGaussianGradientMultiArray");
+    }
+}
             
 //@}
 
@@ -42,6 +42,8 @@
 #include "numerictraits.hxx"
 #include "accumulator.hxx"
 #include "array_vector.hxx"
+#include "threadpool.hxx"
+#include <vector>
 
 namespace vigra {
 
@@ -155,15 +157,19 @@ generateSlicSeeds(MultiArrayView<N, T, S1> const & boundaryIndicatorImage,
     see slicSuperpixels() for detailed examples.
 */
 struct SlicOptions
+: public ParallelOptions
 {
         /** \brief Create options object with default settings.
 
-            Defaults are: perform 10 iterations, determine a size limit for superpixels automatically.
+            Defaults are: perform 10 iterations, determine a size limit for superpixels automatically,
+            run single-threaded.
         */
     SlicOptions()
     : iter(10),
       sizeLimit(0)
-    {}
+    {
+        ParallelOptions::numThreads(ParallelOptions::NoThreads);
+    }
 
         /** \brief Number of iterations.
 
@@ -187,6 +193,24 @@ struct SlicOptions
         return *this;
     }
 
+        /** \brief Number of threads (see ParallelOptions::numThreads()).
+
+            Sequential execution (<tt>ParallelOptions::NoThreads</tt> or a single thread)
+            gives the same result as previous versions. With several threads, cluster
+            statistics of images with more than 2<sup>14</sup> pixels are accumulated
+            in slabs along the last axis and merged afterwards. The floating-point
+            summation order then differs from sequential execution, which may cause small
+            differences in the resulting labeling. The result does not depend on the
+            number of threads as long as it is greater than one.
+
+            Default: <tt>ParallelOptions::NoThreads</tt>
+        */
+    SlicOptions & numThreads(const int n)
+    {
+        ParallelOptions::numThreads(n);
+        return *this;
+    }
+
     unsigned int iter;
     unsigned int sizeLimit;
 };
@@ -215,9 +239,20 @@ class Slic
     unsigned int execute();
 
   private:
-    void updateAssigments();
+    void updateClusters(ThreadPool & pool);
+    void updateAssigments(ThreadPool & pool);
     unsigned int postProcessing();
 
+    // begin and end of slab k when the last axis is split into n slabs
+    void slabBounds(MultiArrayIndex k, MultiArrayIndex n,
+                    ShapeType & begin, ShapeType & end) const
+    {
+        begin = ShapeType(0);
+        end = shape_;
+        begin[N-1] = (k * shape_[N-1]) / n;
+        end[N-1] = ((k+1) * shape_[N-1]) / n;
+    }
+
     typedef MultiArray<N,DistanceType>  DistanceImageType;
 
     ShapeType                       shape_;
@@ -256,15 +291,16 @@ Slic<N, T, Label>::Slic(
 template <unsigned int N, class T, class Label>
 unsigned int Slic<N, T, Label>::execute()
 {
+    ThreadPool pool(options_);
+
     // Do SLIC
     for(size_t i=0; i<options_.iter; ++i)
     {
         // update mean for each cluster
-        clusters_.reset();
-        extractFeatures(dataImage_, labelImage_, clusters_);
+        updateClusters(pool);
 
         // update which pixels get assigned to which cluster
-        updateAssigments();
+        updateAssigments(pool);
     }
 
     return postProcessing();
@@ -272,45 +308,151 @@ unsigned int Slic<N, T, Label>::execute()
 
 template <unsigned int N, class T, class Label>
 void
-Slic<N, T, Label>::updateAssigments()
+Slic<N, T, Label>::updateClusters(ThreadPool & pool)
 {
     using namespace acc;
-    distance_.init(NumericTraits<DistanceType>::max());
-    for(unsigned int c=1; c<=clusters_.maxRegionLabel(); ++c)
+    clusters_.reset();
+
+    // The slab decomposition only depends on the data size (not on the actual number
+    // of threads), and slabs are merged in fixed order, so that the cluster means
+    // are reproducible. Sequential execution uses a single slab, which reproduces
+    // the summation order of previous versions.
+    const MultiArrayIndex minSlabSize = 1 << 14;
+    const MultiArrayIndex slabCount = pool.nThreads() <= 1
+                ? 1
+                : std::max<MultiArrayIndex>(1,
+                      std::min<MultiArrayIndex>(shape_[N-1], labelImage_.size() / minSlabSize));
+    if(slabCount == 1)
     {
-        if(get<Count>(clusters_, c) == 0) // label doesn't exist
-            continue;
+        extractFeatures(dataImage_, labelImage_, clusters_);
+        return;
+    }
 
-        typedef typename LookupTag<RegionCenter, RegionFeatures>::value_type CenterType;
-        CenterType center = get<RegionCenter>(clusters_, c);
+    // Each slab is labeled locally such that memory consumption is proportional to
+    // the number of clusters in the slab. slabLabels[k] maps local to global labels.
+    std::vector<RegionFeatures>         slabFeatures(slabCount);
+    std::vector<std::vector<Label> >    slabLabels(slabCount);
+    std::vector<std::vector<Label> >    globalToLocal(std::max<size_t>(1, pool.nThreads()));
 
-        // get ROI limits around region center
-        ShapeType pixelCenter(round(center)),
-                  startCoord(max(ShapeType(0), pixelCenter - ShapeType(max_radius_))),
-                  endCoord(min(shape_, pixelCenter + ShapeType(max_radius_+1)));
-        center -= startCoord; // need center relative to ROI
+    parallel_foreach(pool, slabCount,
+        [&](size_t threadId, MultiArrayIndex k)
+        {
+            ShapeType begin, end;
+            slabBounds(k, slabCount, begin, end);
+
+            std::vector<Label> & toLocal  = globalToLocal[threadId];
+            std::vector<Label> & toGlobal = slabLabels[k];
+            toGlobal.push_back(0);
+
+            MultiArrayView<N, Label, StridedArrayTag> labels = labelImage_.subarray(begin, end);
+            MultiArray<N, Label> localLabels(labels.shape());
+            typename MultiArrayView<N, Label, StridedArrayTag>::iterator l = labels.begin();
+            typename MultiArray<N, Label>::iterator ll = localLabels.begin(),
+                                                    llend = localLabels.end();
+            for(; ll != llend; ++l, ++ll)
+            {
+                Label label = *l;
+                if(label == 0)
+                    continue;
+                if(label >= (Label)toLocal.size())
+                    toLocal.resize(label+1, 0);
+                if(toLocal[label] == 0)
+                {
+                    toLocal[label] = static_cast<Label>(toGlobal.size());
+                    toGlobal.push_back(label);
+                }
+                *ll = toLocal[label];
+            }
+            for(size_t j=1; j<toGlobal.size(); ++j)
+                toLocal[toGlobal[j]] = 0;
+
+            slabFeatures[k].ignoreLabel(0);
+            slabFeatures[k].setCoordinateOffset(begin);
+            extractFeatures(dataImage_.subarray(begin, end), localLabels, slabFeatures[k]);
+        }
+    );
+
+    Label maxLabel = 0;
+    for(MultiArrayIndex k=0; k<slabCount; ++k)
+        for(size_t j=1; j<slabLabels[k].size(); ++j)
+            maxLabel = std::max(maxLabel, slabLabels[k][j]);
+    clusters_.setMaxRegionLabel(maxLabel);
+    for(MultiArrayIndex k=0; k<slabCount; ++k)
+        clusters_.merge(slabFeatures[k], slabLabels[k]);
+}
 
-        // setup iterators for ROI
-        typedef typename CoupledArrays<N, T, Label, DistanceType>::IteratorType Iterator;
-        Iterator iter = createCoupledIterator(dataImage_, labelImage_, distance_).
-                            restrictToSubarray(startCoord, endCoord),
-                 end = iter.getEndIterator();
+template <unsigned int N, class T, class Label>
+void
+Slic<N, T, Label>::updateAssigments(ThreadPool & pool)
+{
+    using namespace acc;
 
-        // only pixels within the ROI can be assigned to a cluster
-        for(; iter != end; ++iter)
+    // Every slab visits the clusters in the same order as the sequential
+    // algorithm, so the assignment does not depend on the number of threads.
+    const MultiArrayIndex slabCount = std::min<MultiArrayIndex>(shape_[N-1],
+                                          4*std::max<MultiArrayIndex>(1, pool.nThreads()));
+
+    // read the (lazily computed) statistics before the threads start
+    typedef typename LookupTag<RegionCenter, RegionFeatures>::value_type CenterType;
+    typedef typename LookupTag<Mean, RegionFeatures>::value_type         MeanType;
+    const unsigned int clusterCount = clusters_.maxRegionLabel() + 1;
+    std::vector<CenterType>     centers(clusterCount);
+    std::vector<MeanType>       means(clusterCount);
+    std::vector<unsigned char>  exists(clusterCount, false);
+    for(unsigned int c=1; c<clusterCount; ++c)
+    {
+        if(get<Count>(clusters_, c) == 0) // label doesn't exist
+            continue;
+        exists[c] = true;
+        centers[c] = get<RegionCenter>(clusters_, c);
+        means[c] = get<Mean>(clusters_, c);
+    }
+
+    parallel_foreach(pool, slabCount,
+        [&](size_t /*threadId*/, MultiArrayIndex k)
         {
-            // compute distance between cluster center and pixel
-            DistanceType spatialDist   = squaredNorm(center-iter.point());
-            DistanceType colorDist     = squaredNorm(get<Mean>(clusters_, c)-iter.template get<1>());
-            DistanceType dist =  colorDist + normalization_*spatialDist;
-            // update label?
-            if(dist < iter.template get<3>())
+            ShapeType slabBegin, slabEnd;
+            slabBounds(k, slabCount, slabBegin, slabEnd);
+            distance_.subarray(slabBegin, slabEnd).init(NumericTraits<DistanceType>::max());
+
+            for(unsigned int c=1; c<clusterCount; ++c)
             {
-                iter.template get<2>() = static_cast<Label>(c);
-                iter.template get<3>() = dist;
+                if(!exists[c])
+                    continue;
+
+                CenterType center = centers[c];
+
+                // get ROI limits around region center, restricted to the current slab
+                ShapeType pixelCenter(round(center)),
+                          startCoord(max(slabBegin, pixelCenter - ShapeType(max_radius_))),
+                          endCoord(min(slabEnd, pixelCenter + ShapeType(max_radius_+1)));
+                if(!allLess(startCoord, endCoord))
+                    continue;
+                center -= startCoord; // need center relative to ROI
+
+                // setup iterators for ROI
+                typedef typename CoupledArrays<N, T, Label, DistanceType>::IteratorType Iterator;
+                Iterator iter = createCoupledIterator(dataImage_, labelImage_, distance_).
+                                    restrictToSubarray(startCoord, endCoord),
+                         end = iter.getEndIterator();
+
+                // only pixels within the ROI can be assigned to a cluster
+                for(; iter != end; ++iter)
+                {
+                    // compute distance between cluster center and pixel
+                    DistanceType spatialDist   = squaredNorm(center-iter.point());
+                    DistanceType colorDist     = squaredNorm(means[c]-iter.template get<1>());
+                    DistanceType dist =  colorDist + normalization_*spatialDist;
+                    // update label?
+                    if(dist < iter.template get<3>())
+                    {
+                        iter.template get<2>() = static_cast<Label>(c);
+                        iter.template get<3>() = dist;
+                    }
+                }
             }
         }
-    }
+    );
 }
 
 template <unsigned int N, class T, class Label>
@@ -408,9 +550,10 @@ Slic<N, T, Label>::postProcessing()
     before it is compared with the spatial distance. This corresponds to parameter <i>m</i> in equation
     (2) of the paper.
 
-    The options object can be used to specify the number of iterations (<tt>SlicOptions::iterations()</tt>)
-    and an explicit minimal superpixel size (<tt>SlicOptions::minSize()</tt>). By default, the algorithm
-    merges all regions that are smaller than 1/4 of the average superpixel size.
+    The options object can be used to specify the number of iterations (<tt>SlicOptions::iterations()</tt>),
+    an explicit minimal superpixel size (<tt>SlicOptions::minSize()</tt>), and the number of threads
+    (<tt>SlicOptions::numThreads()</tt>). By default, the algorithm merges all regions that are smaller
+    than 1/4 of the average superpixel size. The result is the same for any number of threads.
 
     The function returns the number of superpixels, which equals the largest label
     because labeling starts at 1.
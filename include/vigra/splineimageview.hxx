@@ -45,6 +45,7 @@
 #include "tinyvector.hxx"
 #include "fixedpoint.hxx"
 #include "multi_array.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -515,6 +516,21 @@ class SplineImageView
          return x0 == x1 && y0 == y1;
     }
 
+        /** Access interpolated function at many real-valued coordinates at once.
+            Equivalent to <tt>res(k) = splineView(coords(k)[0], coords(k)[1])</tt> for all <tt>k</tt>.
+
+            In contrast to the single-point access functions, this function does not use
+            the view's internal cache and can therefore be called from several threads.
+            The points are processed in batches which are distributed over
+            <tt>options.getActualNumThreads()</tt> threads. Single-threaded, this is about as
+            fast as calling the single-point access function in a loop.
+            An exception is thrown if a coordinate is outside the first reflection.
+        */
+    template <class U, class S1, class T, class S2>
+    void sample(MultiArrayView<1, TinyVector<U, 2>, S1> const & coords,
+                MultiArrayView<1, T, S2> res,
+                ParallelOptions const & options = ParallelOptions()) const;
+
   protected:
 
     void init();
@@ -590,6 +606,79 @@ struct SplineImageViewUnrollLoop2<0, ValueType>
     }
 };
 
+    // Compute the kernel indices 'ix' of coordinate 'x' along an axis with
+    // largest index 'w1' (applying reflective boundary conditions outside the
+    // range (x0, x1)), and return the coordinate relative to the facet center.
+template <int ORDER>
+double
+splineViewIndices(double x, double x0, double x1, int w1, int * ix)
+{
+    enum { ksize = ORDER + 1, kcenter = ORDER / 2 };
+
+    if(x > x0 && x < x1)
+    {
+        SplineImageViewUnrollLoop1<ORDER>::exec(
+                                (ORDER % 2) ? int(x - kcenter) : int(x + 0.5 - kcenter), ix);
+        return x - ix[kcenter];
+    }
+
+    int center = (ORDER % 2) ?
+                 (int)VIGRA_CSTD::floor(x) :
+                 (int)VIGRA_CSTD::floor(x + 0.5);
+    if(x >= x1)
+    {
+        for(int i = 0; i < ksize; ++i)
+            ix[i] = w1 - vigra::abs(w1 - center - (i - kcenter));
+    }
+    else
+    {
+        for(int i = 0; i < ksize; ++i)
+            ix[i] = vigra::abs(center - (kcenter - i));
+    }
+    return x - center;
+}
+
+    // Evaluate the spline weights of 'count' facet coordinates 'u' by means of
+    // the spline's polynomial weight matrix. The weight of kernel tap 'i' at
+    // point 'k' is stored in w[i*stride + k].
+template <int ORDER, class WeightMatrix>
+void
+splineViewWeights(WeightMatrix const & weights, double const * u, int count,
+                  double * w, int stride)
+{
+    for(int i = 0; i <= ORDER; ++i, w += stride)
+    {
+        double c[ORDER+1];
+        for(int p = 0; p <= ORDER; ++p)
+            c[p] = weights[p][i];
+        for(int k = 0; k < count; ++k)
+        {
+            double r = c[ORDER];
+            for(int p = ORDER-1; p >= 0; --p)
+                r = r*u[k] + c[p];
+            w[k] = r;
+        }
+    }
+}
+
+    // evaluate the (stateless) view at all 'coords' in parallel
+template <class View, class U, class S1, class T, class S2>
+void
+splineViewSample(View const & view,
+                 MultiArrayView<1, TinyVector<U, 2>, S1> const & coords,
+                 MultiArrayView<1, T, S2> res,
+                 ParallelOptions const & options)
+{
+    vigra_precondition(coords.shape() == res.shape(),
+        "SplineImageView::sample(): shape mismatch between coordinates and results.");
+
+    parallel_foreach(options.getNumThreads(), coords.size(),
+        [&](size_t /*threadId*/, MultiArrayIndex k)
+        {
+            res(k) = view(coords(k)[0], coords(k)[1]);
+        });
+}
+
 } // namespace detail
 
 template <int ORDER, class VALUETYPE>
@@ -599,51 +688,13 @@ SplineImageView<ORDER, VALUETYPE>::calculateIndices(double x, double y) const
     if(x == x_ && y == y_)
         return;   // still in cache
 
-    if(x > x0_ && x < x1_ && y > y0_ && y < y1_)
-    {
-        detail::SplineImageViewUnrollLoop1<ORDER>::exec(
-                                (ORDER % 2) ? int(x - kcenter_) : int(x + 0.5 - kcenter_), ix_);
-        detail::SplineImageViewUnrollLoop1<ORDER>::exec(
-                                (ORDER % 2) ? int(y - kcenter_) : int(y + 0.5 - kcenter_), iy_);
-
-        u_ = x - ix_[kcenter_];
-        v_ = y - iy_[kcenter_];
-    }
-    else
+    if(!(x > x0_ && x < x1_ && y > y0_ && y < y1_))
     {
         vigra_precondition(isValid(x,y),
                     "SplineImageView::calculateIndices(): coordinates out of range.");
-
-        int xCenter = (ORDER % 2) ?
-                      (int)VIGRA_CSTD::floor(x) :
-                      (int)VIGRA_CSTD::floor(x + 0.5);
-        int yCenter = (ORDER % 2) ?
-                      (int)VIGRA_CSTD::floor(y) :
-                      (int)VIGRA_CSTD::floor(y + 0.5);
-
-        if(x >= x1_)
-        {
-            for(int i = 0; i < ksize_; ++i)
-                ix_[i] = w1_ - vigra::abs(w1_ - xCenter - (i - kcenter_));
-        }
-        else
-        {
-            for(int i = 0; i < ksize_; ++i)
-                ix_[i] = vigra::abs(xCenter - (kcenter_ - i));
-        }
-        if(y >= y1_)
-        {
-            for(int i = 0; i < ksize_; ++i)
-                iy_[i] = h1_ - vigra::abs(h1_ - yCenter - (i - kcenter_));
-        }
-        else
-        {
-            for(int i = 0; i < ksize_; ++i)
-                iy_[i] = vigra::abs(yCenter - (kcenter_ - i));
-        }
-        u_ = x - xCenter;
-        v_ = y - yCenter;
     }
+    u_ = detail::splineViewIndices<ORDER>(x, x0_, x1_, w1_, ix_);
+    v_ = detail::splineViewIndices<ORDER>(y, y0_, y1_, h1_, iy_);
     x_ = x;
     y_ = y;
 }
@@ -734,6 +785,61 @@ VALUETYPE SplineImageView<ORDER, VALUETYPE>::operator()(double x, double y,
     return convolve();
 }
 
+template <int ORDER, class VALUETYPE>
+template <class U, class S1, class T, class S2>
+void
+SplineImageView<ORDER, VALUETYPE>::sample(MultiArrayView<1, TinyVector<U, 2>, S1> const & coords,
+                                          MultiArrayView<1, T, S2> res,
+                                          ParallelOptions const & options) const
+{
+    typedef typename NumericTraits<VALUETYPE>::RealPromote RealPromote;
+    enum { batchSize = 64 };
+
+    vigra_precondition(coords.shape() == res.shape(),
+        "SplineImageView::sample(): shape mismatch between coordinates and results.");
+
+    const MultiArrayIndex size = coords.size(),
+                          batches = (size + batchSize - 1) / batchSize;
+
+    parallel_foreach(options.getNumThreads(), batches,
+        [&](size_t /*threadId*/, MultiArrayIndex batch)
+        {
+            const MultiArrayIndex begin = batch*batchSize;
+            const int count = (int)std::min<MultiArrayIndex>(batchSize, size - begin);
+
+            int ix[batchSize][ksize_], iy[batchSize][ksize_];
+            double u[batchSize], v[batchSize],
+                   kx[ksize_*batchSize], ky[ksize_*batchSize];
+
+            for(int k = 0; k < count; ++k)
+            {
+                double x = coords(begin + k)[0],
+                       y = coords(begin + k)[1];
+                vigra_precondition(isValid(x, y),
+                    "SplineImageView::sample(): coordinates out of range.");
+                u[k] = detail::splineViewIndices<ORDER>(x, x0_, x1_, w1_, ix[k]);
+                v[k] = detail::splineViewIndices<ORDER>(y, y0_, y1_, h1_, iy[k]);
+            }
+
+            detail::splineViewWeights<ORDER>(Spline::weights(), u, count, kx, batchSize);
+            detail::splineViewWeights<ORDER>(Spline::weights(), v, count, ky, batchSize);
+
+            for(int k = 0; k < count; ++k)
+            {
+                RealPromote sum = NumericTraits<RealPromote>::zero();
+                for(int j = 0; j < ksize_; ++j)
+                {
+                    InternalValue const * row = image_[iy[k][j]];
+                    RealPromote rowSum = NumericTraits<RealPromote>::zero();
+                    for(int i = 0; i < ksize_; ++i)
+                        rowSum += RealPromote(kx[i*batchSize + k] * row[ix[k][i]]);
+                    sum += RealPromote(ky[j*batchSize + k] * rowSum);
+                }
+                res(begin + k) = detail::RequiresExplicitCast<VALUETYPE>::cast(sum);
+            }
+        });
+}
+
 template <int ORDER, class VALUETYPE>
 typename SplineImageView<ORDER, VALUETYPE>::SquaredNormType
 SplineImageView<ORDER, VALUETYPE>::g2(double x, double y) const
@@ -1024,6 +1130,14 @@ class SplineImageView0Base
          return x0 == x1 && y0 == y1;
     }
 
+    template <class U, class S1, class T, class S2>
+    void sample(MultiArrayView<1, TinyVector<U, 2>, S1> const & coords,
+                MultiArrayView<1, T, S2> res,
+                ParallelOptions const & options = ParallelOptions()) const
+    {
+        detail::splineViewSample(*this, coords, res, options);
+    }
+
   protected:
     unsigned int w_, h_;
     INTERNAL_INDEXER internalIndexer_;
@@ -1595,6 +1709,14 @@ class SplineImageView1Base
          return x0 == x1 && y0 == y1;
     }
 
+    template <class U, class S1, class T, class S2>
+    void sample(MultiArrayView<1, TinyVector<U, 2>, S1> const & coords,
+                MultiArrayView<1, T, S2> res,
+                ParallelOptions const & options = ParallelOptions()) const
+    {
+        detail::splineViewSample(*this, coords, res, options);
+    }
+
   protected:
     unsigned int w_, h_;
     INTERNAL_INDEXER internalIndexer_;
@@ -0,0 +1,70 @@
+/************************************************************************/
+/*                                                                      */
+/*    Copyright 2026 by Ullrich Koethe                                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_TIFF_PAGE_WRITER_HXX
+#define VIGRA_TIFF_PAGE_WRITER_HXX
+
+#include <string>
+#include <vector>
+
+#include "config.hxx"
+
+namespace vigra {
+
+namespace detail {
+
+    // implementation detail of the parallel exportVolume() in multi_impex.hxx:
+    // appends TIFF files created by a memory encoder (see getMemoryEncoder())
+    // as pages to a multi-page TIFF file, without decoding them again
+    class VIGRA_EXPORT TIFFPageWriter
+    {
+        void * tiff;
+
+        TIFFPageWriter( const TIFFPageWriter & );
+        TIFFPageWriter & operator=( const TIFFPageWriter & );
+
+    public:
+
+        TIFFPageWriter( const std::string & filename );
+        ~TIFFPageWriter();
+
+        void append( const std::vector<char> & page );
+    };
+
+} // namespace detail
+
+} // namespace vigra
+
+#endif // VIGRA_TIFF_PAGE_WRITER_HXX
@@ -46,6 +46,12 @@
 #include "array_vector.hxx"
 #include "iteratoradapter.hxx"
 
+#ifndef VIGRA_SINGLE_THREADED
+# include <vector>
+# include <algorithm>
+# include "threading.hxx"
+#endif
+
 namespace vigra {
 
 namespace detail {
@@ -321,6 +327,100 @@ class UnionFindArray
     }
 };
 
+#ifndef VIGRA_SINGLE_THREADED
+
+    /** \brief Lock-free union-find for a fixed number of labels.
+
+        In contrast to \ref UnionFindArray, <tt>findIndex()</tt> and <tt>makeUnion()</tt>
+        may be called concurrently from several threads. Roots are always linked
+        to the smaller index, so that the representative of each set is its minimal
+        element, independent of the order in which the unions were performed.
+        After all unions are done, <tt>makeContiguous()</tt> (which must be called
+        from a single thread) replaces each entry by its final, contiguous label.
+    */
+template <class T>
+class ConcurrentUnionFindArray
+{
+    typedef std::vector<threading::atomic_long> LabelArray;
+
+    mutable LabelArray labels_;
+
+  public:
+    ConcurrentUnionFindArray(T size = 0)
+    : labels_((std::size_t)size)
+    {
+        vigra_precondition((double)size <= (double)NumericTraits<long>::max(),
+           "ConcurrentUnionFindArray(): Need more labels than can be represented "
+           "in the index type.");
+        for(T k=0; k < size; ++k)
+            labels_[(std::size_t)k].store((long)k);
+    }
+
+    T size() const
+    {
+        return (T)labels_.size();
+    }
+
+    T findIndex(T index) const
+    {
+        long current = (long)index;
+        long parent  = labels_[current].load();
+        while(parent != current)
+        {
+            // path halving: let 'current' point to its grandparent
+            long grandparent = labels_[parent].load();
+            if(grandparent != parent)
+                labels_[current].compare_exchange_weak(parent, grandparent);
+            current = grandparent;
+            parent  = labels_[current].load();
+        }
+        return (T)current;
+    }
+
+    T makeUnion(T l1, T l2)
+    {
+        for(;;)
+        {
+            long i1 = (long)findIndex(l1);
+            long i2 = (long)findIndex(l2);
+            if(i1 == i2)
+                return (T)i1;
+            if(i1 < i2)
+                std::swap(i1, i2);
+            // link the larger root to the smaller one, retry if i1 is no longer a root
+            long expected = i1;
+            if(labels_[i1].compare_exchange_strong(expected, i2))
+                return (T)i2;
+            l1 = (T)i1;
+            l2 = (T)i2;
+        }
+    }
+
+        // not thread-safe, call after all unions are completed
+    T makeContiguous()
+    {
+        long count = 0;
+        for(long i=0; i<(long)labels_.size(); ++i)
+        {
+            long parent = labels_[i].load();
+            if(parent == i)
+                labels_[i].store(count++);
+            else
+                // parent < i always holds, so its final label is already known
+                labels_[i].store(labels_[parent].load());
+        }
+        return (T)(count-1);
+    }
+
+        // only valid after makeContiguous()
+    T findLabel(T index) const
+    {
+        return (T)labels_[(std::size_t)index].load();
+    }
+};
+
+#endif // VIGRA_SINGLE_THREADED
+
 } // namespace vigra
 
 #endif // VIGRA_UNION_FIND_HXX
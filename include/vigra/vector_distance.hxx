@@ -104,7 +104,7 @@ vectorialDistParabola(MultiArrayIndex dimension,
                       SrcIterator is, SrcIterator iend,
                       Array const & pixel_pitch )
 {
-    typedef typename SrcIterator::value_type SrcType;
+    typedef typename std::iterator_traits<SrcIterator>::value_type SrcType;
     typedef VectorialDistParabolaStackEntry<SrcType, double> Influence;
 
     double sigma = pixel_pitch[dimension],
@@ -156,6 +156,24 @@ vectorialDistParabola(MultiArrayIndex dimension,
     }
 }
 
+    // vectorialDistParabola() as a kernel for separableDistLinePass()
+template <class Array>
+struct VectorialDistParabolaKernel
+{
+    VectorialDistParabolaKernel(MultiArrayIndex dimension, Array const & pixel_pitch)
+    : dimension_(dimension), pixel_pitch_(pixel_pitch)
+    {}
+
+    template <class Iterator>
+    void operator()(Iterator begin, Iterator end) const
+    {
+        vectorialDistParabola(dimension_, begin, end, pixel_pitch_);
+    }
+
+    MultiArrayIndex dimension_;
+    Array const & pixel_pitch_;
+};
+
 template <class DestIterator,
           class LabelIterator,
           class Array1, class Array2>
@@ -335,6 +353,16 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
                                     MultiArrayView<N, T2, S2> dest,
                                     bool background,
                                     Array const & pixelPitch=TinyVector<double, N>(1));
+
+            // process the lines along each axis in parallel
+            template <unsigned int N, class T1, class S1,
+                      class T2, class S2, class Array>
+            void
+            separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    bool background,
+                                    Array const & pixelPitch,
+                                    ParallelOptions const & options);
         }
         \endcode
 
@@ -342,6 +370,9 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
         but returns in each pixel the <i>vector</i> to the nearest background pixel
         rather than the scalar distance. This enables much more powerful applications.
 
+        When \ref vigra::ParallelOptions are passed, the lines along each axis are
+        processed in parallel, see \ref separableMultiDistSquared().
+
         <b> Usage:</b>
 
         <b>\#include</b> \<vigra/vector_distance.hxx\><br/>
@@ -408,6 +439,37 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
     separableVectorDistance(source, dest, background, pixelPitch);
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, class Array>
+void
+separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        bool background,
+                        Array const & pixelPitch,
+                        ParallelOptions const & options)
+{
+    typedef ArrayVector<T2> Buffer;
+
+    VIGRA_STATIC_ASSERT((Error_output_pixel_type_must_be_TinyVector_of_appropriate_length<N == T2::static_size>));
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableVectorDistance(): shape mismatch between input and output.");
+    vigra_precondition(pixelPitch.size() == N,
+        "separableVectorDistance(): pixelPitch has wrong length.");
+
+    ThreadPool pool(options);
+    T2 maxDist(2*sum(source.shape()*pixelPitch));
+
+    // the first pass also thresholds the mask
+    detail::separableDistLinePass<Buffer>(source, dest, 0,
+        detail::DistThreshold<T1, T2>(background, maxDist),
+        detail::VectorialDistParabolaKernel<Array>(0, pixelPitch),
+        detail::DistCast<T2>(), pool);
+    for(unsigned d = 1; d < N; ++d )
+        detail::separableDistLinePass<Buffer>(dest, dest, d, detail::DistCast<T2>(),
+            detail::VectorialDistParabolaKernel<Array>(d, pixelPitch),
+            detail::DistCast<T2>(), pool);
+}
+
 
     /** \brief Compute the vector distance transform to the implicit boundaries of a
                multi-dimensional label array.
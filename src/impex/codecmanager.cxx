@@ -296,6 +296,25 @@ namespace vigra
         return enc;
     }
 
+    // look up encoder from the list and let it write into a buffer
+    VIGRA_UNIQUE_PTR<Encoder>
+    CodecManager::getMemoryEncoder( std::vector<char> & buffer,
+                                    const std::string & filename,
+                                    const std::string & fType ) const
+    {
+        std::string fileType = getEncoderType(filename, fType);
+
+        std::map< std::string, CodecFactory * >::const_iterator search
+            = factoryMap.find( fileType );
+        vigra_precondition( search != factoryMap.end(),
+        "did not find a matching codec for the given filetype" );
+
+        VIGRA_UNIQUE_PTR<Encoder> enc = search->second->getEncoder();
+        vigra_precondition( enc->initMemory(buffer),
+        "the codec for the given filetype cannot write into memory" );
+        return enc;
+    }
+
     // get a decoder
     VIGRA_UNIQUE_PTR<Decoder>
     getDecoder( const std::string & filename, const std::string & filetype, unsigned int imageindex )
@@ -317,6 +336,13 @@ namespace vigra
         return codecManager().getEncoder( filename, filetype, mode );
     }
 
+    // get an encoder writing into a buffer
+    VIGRA_UNIQUE_PTR<Encoder>
+    getMemoryEncoder( std::vector<char> & buffer, const std::string & filename, const std::string & filetype )
+    {
+        return codecManager().getMemoryEncoder( buffer, filename, filetype );
+    }
+
     std::vector<std::string>
     queryCodecPixelTypes( const std::string & codecname )
     {
@@ -93,6 +93,12 @@ namespace vigra
                     const std::string & fileType = "undefined",
                     const std::string & mode = "w" ) const;
 
+        // look up encoder from the list and let it write into a buffer
+        VIGRA_UNIQUE_PTR<Encoder>
+        getMemoryEncoder( std::vector<char> & buffer,
+                          const std::string & fileName,
+                          const std::string & fileType = "undefined" ) const;
+
         // try to figure out the correct file type
         std::string getFileTypeByMagicString( const std::string & filename ) const;
 
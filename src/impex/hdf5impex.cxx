@@ -37,14 +37,182 @@
 
 #include "vigra/hdf5impex.hxx"
 #include "vigra/multi_array.hxx"
+#include "lz4.h"
 #include <iostream>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 
 namespace vigra {
 
+namespace {
+
+/* HDF5 filter for LZ4 compression, compatible with the reference
+   implementation registered under VIGRA_H5Z_FILTER_LZ4:
+
+   - 8 bytes: size of the uncompressed data (big endian)
+   - 4 bytes: block size (big endian)
+   - for each block: 4 bytes compressed block size (big endian), followed by
+     the compressed block, or by the raw block when compression didn't pay off.
+*/
+const std::size_t lz4DefaultBlockSize = 1 << 30;
+
+void lz4WriteBigEndian(char * p, UInt64 value, int bytes)
+{
+    for(int k=bytes-1; k>=0; --k, value >>= 8)
+        p[k] = (char)(value & 0xff);
+}
+
+UInt64 lz4ReadBigEndian(char const * p, int bytes)
+{
+    UInt64 value = 0;
+    for(int k=0; k<bytes; ++k)
+        value = (value << 8) | (unsigned char)p[k];
+    return value;
+}
+
+void * lz4Allocate(std::size_t size)
+{
+#if VIGRA_HDF5_VERSION_GE(1, 8, 13)
+    return H5allocate_memory(size, false);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void lz4Free(void * p)
+{
+#if VIGRA_HDF5_VERSION_GE(1, 8, 13)
+    H5free_memory(p);
+#else
+    std::free(p);
+#endif
+}
+
+size_t lz4Filter(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[],
+                 size_t nbytes, size_t * buf_size, void ** buf)
+{
+    char const * in = (char const *)*buf;
+    char * out = 0;
+    std::size_t outSize = 0;
+
+    if(flags & H5Z_FLAG_REVERSE)
+    {
+        // decompress
+        if(nbytes < 12)
+            return 0;
+        std::size_t origSize  = (std::size_t)lz4ReadBigEndian(in, 8),
+                    blockSize = (std::size_t)lz4ReadBigEndian(in + 8, 4);
+        if(blockSize > origSize)
+            blockSize = origSize;
+        if(blockSize == 0 && origSize > 0)
+            return 0;
+        out = (char *)lz4Allocate(origSize > 0 ? origSize : 1);
+        if(out == 0)
+            return 0;
+        char const * rpos = in + 12,
+                   * rend = in + nbytes;
+        for(std::size_t decompressed = 0; decompressed < origSize; decompressed += blockSize)
+        {
+            if(origSize - decompressed < blockSize)
+                blockSize = origSize - decompressed;
+            if(rend - rpos < 4)
+            {
+                lz4Free(out);
+                return 0;
+            }
+            std::size_t compressedBlockSize = (std::size_t)lz4ReadBigEndian(rpos, 4);
+            rpos += 4;
+            if((std::size_t)(rend - rpos) < compressedBlockSize)
+            {
+                lz4Free(out);
+                return 0;
+            }
+            if(compressedBlockSize == blockSize)
+            {
+                std::memcpy(out + decompressed, rpos, blockSize);
+            }
+            else if(LZ4_decompress_safe(rpos, out + decompressed, (int)compressedBlockSize,
+                                        (int)blockSize) != (int)blockSize)
+            {
+                lz4Free(out);
+                return 0;
+            }
+            rpos += compressedBlockSize;
+        }
+        outSize = origSize;
+    }
+    else
+    {
+        // compress
+        std::size_t blockSize = (cd_nelmts > 0 && cd_values[0] > 0)
+                                    ? cd_values[0]
+                                    : lz4DefaultBlockSize;
+        if(blockSize > nbytes)
+            blockSize = nbytes;
+        std::size_t blocks = nbytes > 0 ? (nbytes - 1) / blockSize + 1 : 0;
+        std::size_t maxSize = 12 + blocks*(4 + LZ4_compressBound((int)blockSize));
+        out = (char *)lz4Allocate(maxSize);
+        if(out == 0)
+            return 0;
+        lz4WriteBigEndian(out, nbytes, 8);
+        lz4WriteBigEndian(out + 8, blockSize, 4);
+        char * wpos = out + 12;
+        for(std::size_t compressed = 0; compressed < nbytes; compressed += blockSize)
+        {
+            if(nbytes - compressed < blockSize)
+                blockSize = nbytes - compressed;
+            int size = LZ4_compress_default(in + compressed, wpos + 4, (int)blockSize,
+                                            LZ4_compressBound((int)blockSize));
+            if(size <= 0)
+            {
+                lz4Free(out);
+                return 0;
+            }
+            if((std::size_t)size >= blockSize)
+            {
+                // store incompressible blocks as is
+                std::memcpy(wpos + 4, in + compressed, blockSize);
+                size = (int)blockSize;
+            }
+            lz4WriteBigEndian(wpos, size, 4);
+            wpos += 4 + size;
+        }
+        outSize = wpos - out;
+    }
+
+    lz4Free(*buf);
+    *buf = out;
+    *buf_size = outSize;
+    return outSize;
+}
+
+bool registerLZ4Filter()
+{
+    H5Z_class2_t filter_class = {
+        H5Z_CLASS_T_VERS,
+        (H5Z_filter_t)VIGRA_H5Z_FILTER_LZ4,
+        1, 1,
+        "HDF5 lz4 filter; see http://www.hdfgroup.org/services/contributions.html",
+        NULL,
+        NULL,
+        &lz4Filter
+    };
+    return H5Zregister(&filter_class) >= 0;
+}
+
+} // anonymous namespace
+
+bool HDF5_register_lz4_filter()
+{
+    static const bool registered = registerLZ4Filter();
+    return registered;
+}
+
 HDF5ImportInfo::HDF5ImportInfo(const char* filePath, const char* pathInFile)
 {
+    HDF5_register_lz4_filter();
+
     m_file_handle = HDF5HandleShared(H5Fopen(filePath, H5F_ACC_RDONLY, H5P_DEFAULT),
                                      &H5Fclose, "HDF5ImportInfo(): Unable to open file.");
 
@@ -334,7 +334,7 @@ bool isImage(char const * filename)
 
 ImageExportInfo::ImageExportInfo( const char * filename, const char * mode )
     : m_filename(filename), m_mode(mode),
-      m_x_res(0), m_y_res(0),
+      m_x_res(0), m_y_res(0), m_memory(0),
       fromMin_(0.0), fromMax_(0.0), toMin_(0.0), toMax_(0.0)
 {}
 
@@ -482,13 +482,31 @@ ImageExportInfo & ImageExportInfo::setICCProfile(
     return *this;
 }
 
+ImageExportInfo & ImageExportInfo::setMemoryBuffer(std::vector<char> * buffer)
+{
+    m_memory = buffer;
+    return *this;
+}
+
+std::vector<char> * ImageExportInfo::getMemoryBuffer() const
+{
+    return m_memory;
+}
+
 // return an encoder for a given ImageExportInfo object
 VIGRA_UNIQUE_PTR<Encoder> encoder( const ImageExportInfo & info )
 {
     VIGRA_UNIQUE_PTR<Encoder> enc;
 
     std::string filetype = info.getFileType();
-    if ( filetype != "" ) {
+    if ( info.getMemoryBuffer() ) {
+        if ( filetype != "" )
+            validate_filetype(filetype);
+        else
+            filetype = "undefined";
+        VIGRA_UNIQUE_PTR<Encoder> enc2 = getMemoryEncoder( *info.getMemoryBuffer(), std::string( info.getFileName() ), filetype );
+        std::swap(enc, enc2);
+    } else if ( filetype != "" ) {
         validate_filetype(filetype);
         VIGRA_UNIQUE_PTR<Encoder> enc2 = getEncoder( std::string( info.getFileName() ), filetype, std::string( info.getMode() ) );
         std::swap(enc, enc2);
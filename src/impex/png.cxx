@@ -180,6 +180,7 @@ namespace vigra {
         // methods
         void init();
         void nextScanline();
+        void nextScanline( png_bytep dest );
     };
 
     PngDecoderImpl::PngDecoderImpl( const std::string & filename )
@@ -376,12 +377,17 @@ namespace vigra {
     }
 
     void PngDecoderImpl::nextScanline()
+    {
+        nextScanline(row_data.begin());
+    }
+
+    void PngDecoderImpl::nextScanline( png_bytep dest )
     {
         if (setjmp(png_jmpbuf(png)))
             vigra_postcondition( false,png_error_message.insert(0, "error in png_read_row(): ").c_str());        
         for (int i=0; i < n_interlace_passes; i++) 
         {
-            png_read_row(png, row_data.begin(), NULL);
+            png_read_row(png, dest, NULL);
         }
     }
 
@@ -483,6 +489,15 @@ namespace vigra {
         pimpl->nextScanline();
     }
 
+    bool PngDecoder::nextScanlineInto( void * dest )
+    {
+        // interlaced images are assembled in the internal row buffer
+        if ( pimpl->n_interlace_passes != 1 )
+            return false;
+        pimpl->nextScanline(static_cast< png_bytep >(dest));
+        return true;
+    }
+
     void PngDecoder::close() {}
 
     void PngDecoder::abort() {}
@@ -91,6 +91,7 @@ namespace vigra {
 
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
+        bool nextScanlineInto( void * );
     };
 
     class PngEncoder : public Encoder
@@ -136,10 +136,11 @@ namespace vigra {
         void read_ascii_scanline();
         void read_bilevel_raw_scanline();
         void read_raw_scanline();
+        void read_raw_scanline( void * data );
 
-        void read_raw_scanline_uchar();
-        void read_raw_scanline_ushort();
-        void read_raw_scanline_uint();
+        void read_raw_scanline_uchar( void * data );
+        void read_raw_scanline_ushort( void * data );
+        void read_raw_scanline_uint( void * data );
 
         // skip whitespace and comment blocks
         void skip();
@@ -216,49 +217,42 @@ namespace vigra {
     }
 
     void PnmDecoderImpl::read_raw_scanline()
+    {
+        read_raw_scanline( bands.data() );
+    }
+
+    void PnmDecoderImpl::read_raw_scanline( void * data )
     {
         if ( pixeltype == std::string("UINT8") ) {
-            read_raw_scanline_uchar();
+            read_raw_scanline_uchar( data );
         }
         if ( pixeltype == std::string("UINT16") ) {
-            read_raw_scanline_ushort();
+            read_raw_scanline_ushort( data );
         }
         if ( pixeltype == std::string("UINT32") ) {
-            read_raw_scanline_uint();
+            read_raw_scanline_uint( data );
         }
     }
 
-    void PnmDecoderImpl::read_raw_scanline_uchar()
+    void PnmDecoderImpl::read_raw_scanline_uchar( void * data )
     {
-        // cast the bands to the correct type
-        typedef void_vector< UInt8 > vector_type;
-        vector_type & cbands = static_cast< vector_type & >(bands);
-
         // read and store
-        stream.read( reinterpret_cast< char * >(cbands.data()),
+        stream.read( reinterpret_cast< char * >(data),
                      width * components );
     }
 
-    void PnmDecoderImpl::read_raw_scanline_ushort()
+    void PnmDecoderImpl::read_raw_scanline_ushort( void * data )
     {
-        // cast the bands to the correct type
-        typedef void_vector< UInt16 > vector_type;
-        vector_type & cbands = static_cast< vector_type & >(bands);
-
         // read and store, need to swap bytes.
         byteorder bo( "big endian" );
-        read_array( stream, bo, reinterpret_cast< UInt16 * >(cbands.data()),
+        read_array( stream, bo, reinterpret_cast< UInt16 * >(data),
                     width * components );
     }
 
-    void PnmDecoderImpl::read_raw_scanline_uint()
+    void PnmDecoderImpl::read_raw_scanline_uint( void * data )
     {
-        // cast the bands to the correct type
-        typedef void_vector< UInt32 > vector_type;
-        vector_type & cbands = static_cast< vector_type & >(bands);
-
         byteorder bo( "big endian" );
-        read_array( stream, bo, reinterpret_cast< UInt32 * >(cbands.data()),
+        read_array( stream, bo, reinterpret_cast< UInt32 * >(data),
                     width * components );
     }
 
@@ -473,6 +467,15 @@ namespace vigra {
         }
     }
 
+    bool PnmDecoder::nextScanlineInto( void * dest )
+    {
+        // ASCII and bilevel files need the intermediate buffer
+        if ( !pimpl->raw || pimpl->bilevel )
+            return false;
+        pimpl->read_raw_scanline( dest );
+        return true;
+    }
+
     void PnmDecoder::close()
     {}
 
@@ -76,6 +76,7 @@ namespace vigra {
 
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
+        bool nextScanlineInto( void * );
     };
 
     class PnmEncoder : public Encoder
@@ -61,9 +61,13 @@
 #include "vigra/sized_int.hxx"
 #include "error.hxx"
 #include "tiff.hxx"
+#include "vigra/tiff_page_writer.hxx"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 
 extern "C"
 {
@@ -126,7 +130,7 @@ namespace vigra {
 
         // init magic strings
 #if TIFFLIB_VERSION > 20070712
-        desc.magicStrings.resize(3);
+        desc.magicStrings.resize(4);
 #else
         desc.magicStrings.resize(2);
 #endif
@@ -147,6 +151,11 @@ namespace vigra {
         desc.magicStrings[2][1] = '\111';
         desc.magicStrings[2][2] = '\053';
         desc.magicStrings[2][3] = '\000';
+        desc.magicStrings[3].resize(4);
+        desc.magicStrings[3][0] = '\115';
+        desc.magicStrings[3][1] = '\115';
+        desc.magicStrings[3][2] = '\000';
+        desc.magicStrings[3][3] = '\053';
 #endif
 
         // init file extensions
@@ -176,6 +185,81 @@ namespace vigra {
         return VIGRA_UNIQUE_PTR<Encoder>( new TIFFEncoder() );
     }
 
+    // a TIFF file held in a std::vector<char>, accessed via TIFFClientOpen()
+    struct TIFFMemoryStream
+    {
+        std::vector<char> * buffer;
+        toff_t pos;
+
+        TIFFMemoryStream( std::vector<char> * b = 0 )
+            : buffer(b), pos(0)
+        {}
+    };
+
+    static tsize_t tiffMemoryRead( thandle_t handle, tdata_t data, tsize_t size )
+    {
+        TIFFMemoryStream * stream = (TIFFMemoryStream *)handle;
+        if ( stream->pos >= stream->buffer->size() )
+            return 0;
+        size = (tsize_t)std::min<toff_t>( size, stream->buffer->size() - stream->pos );
+        std::memcpy( data, &(*stream->buffer)[stream->pos], size );
+        stream->pos += size;
+        return size;
+    }
+
+    static tsize_t tiffMemoryWrite( thandle_t handle, tdata_t data, tsize_t size )
+    {
+        TIFFMemoryStream * stream = (TIFFMemoryStream *)handle;
+        if ( stream->pos + size > stream->buffer->size() )
+            stream->buffer->resize( stream->pos + size );
+        std::memcpy( &(*stream->buffer)[stream->pos], data, size );
+        stream->pos += size;
+        return size;
+    }
+
+    static toff_t tiffMemorySeek( thandle_t handle, toff_t offset, int whence )
+    {
+        TIFFMemoryStream * stream = (TIFFMemoryStream *)handle;
+        switch ( whence ) {
+        case SEEK_SET:
+            stream->pos = offset;
+            break;
+        case SEEK_CUR:
+            stream->pos += offset;
+            break;
+        case SEEK_END:
+            stream->pos = stream->buffer->size() + offset;
+            break;
+        }
+        return stream->pos;
+    }
+
+    static int tiffMemoryClose( thandle_t )
+    {
+        return 0;
+    }
+
+    static toff_t tiffMemorySize( thandle_t handle )
+    {
+        return ((TIFFMemoryStream *)handle)->buffer->size();
+    }
+
+    static int tiffMemoryMap( thandle_t, tdata_t *, toff_t * )
+    {
+        return 0;
+    }
+
+    static void tiffMemoryUnmap( thandle_t, tdata_t, toff_t )
+    {}
+
+    static TIFF * tiffMemoryOpen( TIFFMemoryStream & stream, const char * mode )
+    {
+        return TIFFClientOpen( "memory", mode, (thandle_t)&stream,
+                               &tiffMemoryRead, &tiffMemoryWrite, &tiffMemorySeek,
+                               &tiffMemoryClose, &tiffMemorySize,
+                               &tiffMemoryMap, &tiffMemoryUnmap );
+    }
+
     class TIFFCodecImpl
     {
 
@@ -201,6 +285,8 @@ namespace vigra {
 
         TIFFCodecImpl();
         ~TIFFCodecImpl();
+
+        void freeStripBuffers();
     };
 
     TIFFCodecImpl::TIFFCodecImpl()
@@ -217,6 +303,14 @@ namespace vigra {
    }
 
     TIFFCodecImpl::~TIFFCodecImpl()
+    {
+        freeStripBuffers();
+
+        if ( tiff != 0 )
+            TIFFClose(tiff);
+    }
+
+    void TIFFCodecImpl::freeStripBuffers()
     {
         if ( planarconfig == PLANARCONFIG_SEPARATE ) {
             if ( stripbuffer != 0 ) {
@@ -232,9 +326,7 @@ namespace vigra {
                 delete[] stripbuffer;
             }
         }
-
-        if ( tiff != 0 )
-            TIFFClose(tiff);
+        stripbuffer = 0;
     }
 
     class TIFFDecoderImpl : public TIFFCodecImpl
@@ -243,9 +335,26 @@ namespace vigra {
 
         unsigned int scanline;
 
+        // tiled TIFFs are decoded one row of tiles at a time
+        bool tiled;
+        uint32 tile_width, tile_height;
+        uint32 buffer_row_begin, buffer_row_end;
+        std::vector<UInt8> tile_buffer;
+
+        // number of pages (0 until determined by getNumImages())
+        unsigned int num_images;
+
+        // region to be decoded and its position in the scanline buffers
+        Rect2D roi;
+        uint32 row_pitch, column_offset;
+
         std::string get_pixeltype_by_sampleformat() const;
         std::string get_pixeltype_by_datatype() const;
 
+        void allocateBuffers();
+        void readTileRow( uint32 row );
+        void invertMinIsWhite( void * scanline_buffer ) const;
+
     public:
 
         TIFFDecoderImpl( const std::string & filename );
@@ -258,6 +367,9 @@ namespace vigra {
 
         const void * currentScanlineOfBand( unsigned int band ) const;
         void nextScanline();
+        bool nextScanlineInto( void * dest );
+
+        bool setROI( const Rect2D & r );
     };
 
     TIFFDecoderImpl::TIFFDecoderImpl( const std::string & filename )
@@ -272,6 +384,11 @@ namespace vigra {
         }
 
         scanline = 0;
+        num_images = 0;
+        tiled = false;
+        tile_width = tile_height = 0;
+        buffer_row_begin = buffer_row_end = 0;
+        row_pitch = column_offset = 0;
     }
 
     std::string TIFFDecoderImpl::get_pixeltype_by_sampleformat() const
@@ -349,10 +466,18 @@ namespace vigra {
 
     void TIFFDecoderImpl::init(unsigned int imageIndex)
     {
-        // set image directory, if necessary:
-        if (imageIndex != TIFFCurrentDirectory(tiff))
+        // release the buffers of a previously decoded image
+        freeStripBuffers();
+
+        // set image directory, if necessary. TIFFSetDirectory() rewinds to the
+        // first page, so step forward directly when pages are read in order.
+        const unsigned int currentIndex = TIFFCurrentDirectory(tiff);
+        if (imageIndex != currentIndex)
         {
-            if (!TIFFSetDirectory( tiff, (tdir_t)(imageIndex)) )
+            const int ok = imageIndex == currentIndex + 1
+                               ? TIFFReadDirectory( tiff )
+                               : TIFFSetDirectory( tiff, (tdir_t)(imageIndex) );
+            if (!ok)
                 vigra_fail( "Invalid TIFF image index" );
         }
 
@@ -361,15 +486,12 @@ namespace vigra {
         TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &height );
 
         // check for tiled TIFFs
-        uint32 tileWidth, tileHeight;
-        if( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ) &&
-            TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileHeight ) )
-            vigra_precondition( (tileWidth == width) && (tileHeight == height),
-                                "TIFFDecoder: "
-                                "Cannot read tiled TIFFs (not implemented)." );
-
-        // find out strip heights
-        stripheight = 1; // now using scanline interface instead of strip interface
+        tiled = TIFFIsTiled( tiff ) != 0;
+        if ( tiled ) {
+            if( !TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tile_width ) ||
+                !TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tile_height ) )
+                vigra_fail( "TIFFDecoder: Tile size of tiled TIFF not set." );
+        }
 
         // get samples_per_pixel
         samples_per_pixel = 0;
@@ -596,8 +718,36 @@ namespace vigra {
             iccProfile.swap(iccData);
         }
 
+        vigra_precondition( !tiled || bits_per_sample % 8 == 0,
+                            "TIFFDecoder: Cannot read tiled TIFFs with less than 8 bits per sample." );
+
+        // decode the entire image unless setROI() is called
+        roi = Rect2D( Size2D( width, height ) );
+        allocateBuffers();
+    }
+
+    void TIFFDecoderImpl::allocateBuffers()
+    {
+        freeStripBuffers();
+
+        // strips are read scanline by scanline at full width, tiles
+        // are assembled into a buffer holding one row of tiles of the ROI
+        tsize_t stripsize;
+        if ( tiled ) {
+            stripheight = tile_height;
+            row_pitch = roi.width();
+            column_offset = 0;
+            stripsize = (tsize_t)tile_height * row_pitch * ( bits_per_sample / 8 ) *
+                        ( planarconfig == PLANARCONFIG_SEPARATE ? 1 : samples_per_pixel );
+            tile_buffer.resize( TIFFTileSize(tiff) );
+        } else {
+            stripheight = 1; // now using scanline interface instead of strip interface
+            row_pitch = width;
+            column_offset = roi.left();
+            stripsize = TIFFScanlineSize(tiff);
+        }
+
         // allocate data buffers
-        const unsigned int stripsize = TIFFScanlineSize(tiff);
         if ( planarconfig == PLANARCONFIG_SEPARATE ) {
             stripbuffer = new tdata_t[samples_per_pixel];
             for( unsigned int i = 0; i < samples_per_pixel; ++i ) {
@@ -611,13 +761,73 @@ namespace vigra {
         } else {
             stripbuffer = new tdata_t[1];
             stripbuffer[0] = 0;
-            stripbuffer[0] = _TIFFmalloc(stripsize < width ? width : stripsize);
+            stripbuffer[0] = _TIFFmalloc(stripsize < (tsize_t)width ? (tsize_t)width : stripsize);
             if(stripbuffer[0] == 0)
                 throw std::bad_alloc();
         }
 
-        // let the codec read a new strip
+        // let the codec read a new strip, starting at the ROI's first row
+        scanline = roi.top();
+        if ( !tiled ) {
+            // compressed strips can only be decoded from their first row on
+            uint32 rows_per_strip = height;
+            TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rows_per_strip );
+            scanline -= scanline % rows_per_strip;
+            while ( scanline < (uint32)roi.top() )
+                nextScanline();
+        }
         stripindex = stripheight;
+        buffer_row_begin = buffer_row_end = 0;
+    }
+
+    bool TIFFDecoderImpl::setROI( const Rect2D & r )
+    {
+        vigra_precondition( !r.isEmpty() && r.left() >= 0 && r.top() >= 0 &&
+                            (uint32)r.right() <= width && (uint32)r.bottom() <= height,
+                            "TIFFDecoder::setROI(): ROI must be a non-empty rectangle inside the image." );
+        roi = r;
+        allocateBuffers();
+        return true;
+    }
+
+    void TIFFDecoderImpl::readTileRow( uint32 row )
+    {
+        const unsigned int num_buffers = planarconfig == PLANARCONFIG_SEPARATE ?
+            samples_per_pixel : 1;
+        const unsigned int pixel_size = ( bits_per_sample / 8 ) *
+            ( planarconfig == PLANARCONFIG_SEPARATE ? 1 : samples_per_pixel );
+        const uint32 rows = std::min( tile_height, height - row );
+        const uint32 roi_begin = roi.left(), roi_end = roi.right();
+
+        // only decode the tiles that intersect the ROI
+        for( unsigned int sample = 0; sample < num_buffers; ++sample ) {
+            UInt8 * const buf = static_cast< UInt8 * >(stripbuffer[sample]);
+            for( uint32 x = roi_begin - roi_begin % tile_width; x < roi_end; x += tile_width ) {
+                if ( TIFFReadTile( tiff, &tile_buffer[0], x, row, 0, (tsample_t)sample ) < 0 )
+                    vigra_fail( "TIFFDecoder: Unable to read tile." );
+
+                const uint32 begin = std::max( x, roi_begin ),
+                             end   = std::min( x + tile_width, roi_end );
+                for( uint32 r = 0; r < rows; ++r )
+                    std::memcpy( buf + ( r * row_pitch + begin - roi_begin ) * pixel_size,
+                                 &tile_buffer[0] + ( r * tile_width + begin - x ) * pixel_size,
+                                 ( end - begin ) * pixel_size );
+            }
+        }
+        buffer_row_begin = row;
+        buffer_row_end = row + rows;
+
+        // invert grayscale images that interpret 0 as white
+        if ( photometric == PHOTOMETRIC_MINISWHITE &&
+             samples_per_pixel == 1 && pixeltype == "UINT8" ) {
+
+            UInt8 * buf = static_cast< UInt8 * >(stripbuffer[0]);
+            const unsigned int n = rows * row_pitch;
+
+            // invert every pixel
+            for ( unsigned int i = 0; i < n; ++i, ++buf )
+                *buf = 0xff - *buf;
+        }
     }
 
     const void *
@@ -649,16 +859,16 @@ namespace vigra {
                 }
             }
             // XXX probably right
-            return startpointer + ( stripindex * width ) / 8;
+            return startpointer + column_offset + ( stripindex * width ) / 8;
         } else {
             if ( planarconfig == PLANARCONFIG_SEPARATE ) {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[band]);
-                return buf + ( stripindex * width ) * ( bits_per_sample / 8 );
+                return buf + ( column_offset + stripindex * row_pitch ) * ( bits_per_sample / 8 );
             } else {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[0]);
-                return buf + ( band + stripindex * width * samples_per_pixel )
+                return buf + ( band + ( column_offset + stripindex * row_pitch ) * samples_per_pixel )
                     * ( bits_per_sample / 8 );
             }
         }
@@ -666,6 +876,14 @@ namespace vigra {
 
     void TIFFDecoderImpl::nextScanline()
     {
+        if ( tiled ) {
+            // eventually read a new row of tiles
+            if ( scanline < buffer_row_begin || scanline >= buffer_row_end )
+                readTileRow( scanline - scanline % tile_height );
+            stripindex = scanline++ - buffer_row_begin;
+            return;
+        }
+
         // eventually read a new strip
         if ( ++stripindex >= stripheight ) {
             stripindex = 0;
@@ -680,17 +898,36 @@ namespace vigra {
 
             // XXX handle bilevel images
 
-            // invert grayscale images that interpret 0 as white
-            if ( photometric == PHOTOMETRIC_MINISWHITE &&
-                 samples_per_pixel == 1 && pixeltype == "UINT8" ) {
+            invertMinIsWhite( stripbuffer[0] );
+        }
+    }
+
+    bool TIFFDecoderImpl::nextScanlineInto( void * dest )
+    {
+        // only whole, interleaved scanlines of byte-sized samples can be
+        // handed to libtiff directly
+        if ( tiled || planarconfig != PLANARCONFIG_CONTIG || bits_per_sample % 8 != 0 ||
+             column_offset != 0 || (uint32)roi.width() != width )
+            return false;
+
+        if ( TIFFReadScanline( tiff, dest, scanline++, 0 ) < 0 )
+            vigra_fail( "TIFFDecoder: Unable to read scanline." );
+        invertMinIsWhite( dest );
+        return true;
+    }
 
-                UInt8 * buf = static_cast< UInt8 * >(stripbuffer[0]);
-                const unsigned int n = TIFFScanlineSize(tiff);
+    void TIFFDecoderImpl::invertMinIsWhite( void * scanline_buffer ) const
+    {
+        // invert grayscale images that interpret 0 as white
+        if ( photometric == PHOTOMETRIC_MINISWHITE &&
+             samples_per_pixel == 1 && pixeltype == "UINT8" ) {
 
-                // invert every pixel
-                for ( unsigned int i = 0; i < n; ++i, ++buf )
-                    *buf = 0xff - *buf;
-            }
+            UInt8 * buf = static_cast< UInt8 * >(scanline_buffer);
+            const unsigned int n = TIFFScanlineSize(tiff);
+
+            // invert every pixel
+            for ( unsigned int i = 0; i < n; ++i, ++buf )
+                *buf = 0xff - *buf;
         }
     }
 
@@ -780,12 +1017,17 @@ namespace vigra {
     unsigned int
     TIFFDecoderImpl::getNumImages()
     {
-        unsigned int currIndex = getImageIndex();
-        TIFFSetDirectory(tiff, 0);
-        int numPages = 1;
-        while (TIFFReadDirectory(tiff)) numPages++;
-        TIFFSetDirectory(tiff, currIndex);
-        return numPages;
+        // counting requires a pass over all page directories, so do it only once
+        if (num_images == 0)
+        {
+            unsigned int currIndex = getImageIndex();
+            TIFFSetDirectory(tiff, 0);
+            int numPages = 1;
+            while (TIFFReadDirectory(tiff)) numPages++;
+            TIFFSetDirectory(tiff, currIndex);
+            num_images = numPages;
+        }
+        return num_images;
     }
 
     void
@@ -810,6 +1052,16 @@ namespace vigra {
         pimpl->nextScanline();
     }
 
+    bool TIFFDecoder::nextScanlineInto( void * dest )
+    {
+        return pimpl->nextScanlineInto(dest);
+    }
+
+    bool TIFFDecoder::setROI( const Rect2D & roi )
+    {
+        return pimpl->setROI(roi);
+    }
+
     void TIFFDecoder::close() {}
     void TIFFDecoder::abort() {}
 
@@ -822,6 +1074,7 @@ namespace vigra {
 
         unsigned short tiffcomp;
         bool finalized;
+        TIFFMemoryStream memory;
 
     public:
 
@@ -842,6 +1095,24 @@ namespace vigra {
             planarconfig = PLANARCONFIG_CONTIG;
         }
 
+        TIFFEncoderImpl( std::vector<char> & buffer )
+            : tiffcomp(COMPRESSION_LZW), finalized(false), memory(&buffer)
+        {
+            buffer.clear();
+            tiff = tiffMemoryOpen( memory, "w" );
+            vigra_precondition( tiff != 0, "Unable to create TIFF in memory." );
+
+            planarconfig = PLANARCONFIG_CONTIG;
+        }
+
+        ~TIFFEncoderImpl()
+        {
+            // the file must be complete before 'memory' goes away
+            if ( tiff != 0 )
+                TIFFClose(tiff);
+            tiff = 0;
+        }
+
         // methods
 
         void setCompressionType( const std::string &, int );
@@ -1018,6 +1289,12 @@ namespace vigra {
         pimpl = new TIFFEncoderImpl(filename, mode);
     }
 
+    bool TIFFEncoder::initMemory( std::vector<char> & buffer )
+    {
+        pimpl = new TIFFEncoderImpl(buffer);
+        return true;
+    }
+
     TIFFEncoder::~TIFFEncoder()
     {
         delete pimpl;
@@ -1111,6 +1388,105 @@ namespace vigra {
 
     void TIFFEncoder::close() {}
     void TIFFEncoder::abort() {}
+
+    detail::TIFFPageWriter::TIFFPageWriter( const std::string & filename )
+    {
+        tiff = TIFFOpen( filename.c_str(), "w" );
+        if ( !tiff )
+        {
+            std::string msg("Unable to open file '");
+            msg += filename;
+            msg += "'.";
+            vigra_precondition( false, msg.c_str() );
+        }
+    }
+
+    detail::TIFFPageWriter::~TIFFPageWriter()
+    {
+        TIFFClose( (TIFF *)tiff );
+    }
+
+    template <class T>
+    static void copyTIFFTag( TIFF * in, TIFF * out, ttag_t tag )
+    {
+        T value;
+        if ( TIFFGetField( in, tag, &value ) )
+            TIFFSetField( out, tag, value );
+    }
+
+    void detail::TIFFPageWriter::append( const std::vector<char> & page )
+    {
+        TIFF * out = (TIFF *)tiff;
+        TIFFMemoryStream stream( const_cast<std::vector<char> *>(&page) );
+        TIFF * in = tiffMemoryOpen( stream, "rm" );
+        vigra_precondition( in != 0,
+            "TIFFPageWriter::append(): page is not a valid TIFF file." );
+
+        // copy the tags written by TIFFEncoderImpl::finalizeSettings()
+        copyTIFFTag<uint32>( in, out, TIFFTAG_SUBFILETYPE );
+        copyTIFFTag<uint32>( in, out, TIFFTAG_IMAGEWIDTH );
+        copyTIFFTag<uint32>( in, out, TIFFTAG_IMAGELENGTH );
+        copyTIFFTag<uint32>( in, out, TIFFTAG_ROWSPERSTRIP );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_PLANARCONFIG );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_SAMPLESPERPIXEL );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_ORIENTATION );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_COMPRESSION );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_SAMPLEFORMAT );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_BITSPERSAMPLE );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_PHOTOMETRIC );
+        copyTIFFTag<float>( in, out, TIFFTAG_XRESOLUTION );
+        copyTIFFTag<float>( in, out, TIFFTAG_YRESOLUTION );
+        copyTIFFTag<uint16>( in, out, TIFFTAG_RESOLUTIONUNIT );
+        copyTIFFTag<float>( in, out, TIFFTAG_XPOSITION );
+        copyTIFFTag<float>( in, out, TIFFTAG_YPOSITION );
+        copyTIFFTag<uint32>( in, out, TIFFTAG_PIXAR_IMAGEFULLWIDTH );
+        copyTIFFTag<uint32>( in, out, TIFFTAG_PIXAR_IMAGEFULLLENGTH );
+
+        uint16 extra_samples = 0, * extra_sample_types = 0;
+        if ( TIFFGetField( in, TIFFTAG_EXTRASAMPLES, &extra_samples, &extra_sample_types ) )
+            TIFFSetField( out, TIFFTAG_EXTRASAMPLES, extra_samples, extra_sample_types );
+
+        uint32 icc_size = 0;
+        void * icc_data = 0;
+        if ( TIFFGetField( in, TIFFTAG_ICCPROFILE, &icc_size, &icc_data ) )
+            TIFFSetField( out, TIFFTAG_ICCPROFILE, icc_size, icc_data );
+
+        // the strips are already encoded and can be copied verbatim
+        std::vector<char> strip_data;
+        bool success = true;
+        for ( tstrip_t s = 0; success && s < TIFFNumberOfStrips(in); ++s )
+        {
+            tsize_t size = TIFFRawStripSize( in, s );
+            strip_data.resize( size > 0 ? size : 1 );
+            success = size >= 0 &&
+                      TIFFReadRawStrip( in, s, &strip_data[0], size ) == size &&
+                      TIFFWriteRawStrip( out, s, &strip_data[0], size ) == size;
+        }
+        TIFFClose( in );
+
+        vigra_postcondition( success && TIFFWriteDirectory( out ),
+            "TIFFPageWriter::append(): Unable to write TIFF data." );
+    }
+}
+
+#else // HasTIFF
+
+#include "vigra/tiff_page_writer.hxx"
+#include "vigra/error.hxx"
+
+namespace vigra {
+
+    detail::TIFFPageWriter::TIFFPageWriter( const std::string & )
+    : tiff(0)
+    {
+        vigra_fail( "TIFFPageWriter: VIGRA was compiled without TIFF support." );
+    }
+
+    detail::TIFFPageWriter::~TIFFPageWriter()
+    {}
+
+    void detail::TIFFPageWriter::append( const std::vector<char> & )
+    {}
 }
 
 #endif // HasTIFF
@@ -91,6 +91,9 @@ namespace vigra {
 
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
+        bool nextScanlineInto( void * );
+
+        bool setROI( const Rect2D & );
 
         std::string getPixelType() const;
         unsigned int getOffset() const;
@@ -142,6 +145,7 @@ namespace vigra {
         {
             init(fileName, "w");
         }
+        bool initMemory( std::vector<char> & );
 
         void close();
         void abort();
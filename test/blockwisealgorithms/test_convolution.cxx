@@ -5,6 +5,7 @@
 #include <vigra/unittest.hxx>
 #include <vigra/multi_blocking.hxx>
 #include <vigra/multi_blockwise.hxx>
+#include <vigra/multi_feature_stack.hxx>
 
 #include <iostream>
 #include "utils.hxx"
@@ -104,6 +105,143 @@ struct BlockwiseConvolutionTest
         );
 
     }
+
+    template <class Array1, class Array2>
+    static double maxRelativeDifference(Array1 const & a, Array2 const & b)
+    {
+        double diff = 0.0, range = 0.0;
+        for(int k = 0; k < a.size(); ++k)
+        {
+            diff = std::max(diff, std::abs((double)a[k] - (double)b[k]));
+            range = std::max(range, std::abs((double)b[k]));
+        }
+        return diff / range;
+    }
+
+    void testHessianEigenvalues()
+    {
+        typedef MultiArray<3, double> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(30, 25, 20);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        BlockwiseConvolutionOptions<3> opt;
+        opt.setStdDev(TinyVector<double, 3>(1.0));
+        opt.blockShape(Shape(16, 13, 10)).numThreads(4);
+
+        // reference: global Hessian and the per-element eigenvalue solver
+        MultiArray<3, TinyVector<double, 6> > hessian(shape);
+        MultiArray<3, TinyVector<double, 3> > ref(shape), ev(shape);
+        hessianOfGaussianMultiArray(data, hessian, 1.0);
+        tensorEigenvaluesMultiArray(hessian, ref);
+
+        hessianOfGaussianEigenvaluesMultiArray(data, ev, opt);
+        for(int d = 0; d < 3; ++d)
+            should(maxRelativeDifference(ev.bindElementChannel(d), ref.bindElementChannel(d)) < 1e-10);
+
+        Array first(shape), last(shape);
+        hessianOfGaussianFirstEigenvalueMultiArray(data, first, opt);
+        hessianOfGaussianLastEigenvalueMultiArray(data, last, opt);
+        should(maxRelativeDifference(first, ref.bindElementChannel(0)) < 1e-10);
+        should(maxRelativeDifference(last, ref.bindElementChannel(2)) < 1e-10);
+    }
+
+    void testFeatureStack()
+    {
+        typedef MultiArray<2, double> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(90, 110);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        double scales[] = { 0.7, 1.6, 3.5 };
+        FeatureStackOptions opt;
+        for(int k = 0; k < 3; ++k)
+            opt.feature(GaussianSmoothingFeature, scales[k])
+               .feature(GaussianGradientMagnitudeFeature, scales[k])
+               .feature(LaplacianOfGaussianFeature, scales[k])
+               .feature(StructureTensorEigenvaluesFeature, scales[k])
+               .feature(HessianOfGaussianEigenvaluesFeature, scales[k]);
+        shouldEqual(opt.numberOfChannels(2), 21u);
+
+        MultiArray<3, double> features(Shape3(shape[0], shape[1], 21)),
+                              single(features.shape());
+        opt.numThreads(4).blockShape(Shape(16, 23));
+        featureStackMultiArray(data, features, opt);
+
+        // the result must not depend on the blocking
+        opt.numThreads(0).blockShape(shape);
+        featureStackMultiArray(data, single, opt);
+        shouldEqualSequenceTolerance(features.begin(), features.end(), single.begin(), 1e-10);
+
+        // compare with the individual filters: scales below the residual scale are
+        // computed directly, larger ones deviate by kernel sampling effects, which are
+        // largest for white noise
+        for(int k = 0, c = 0; k < 3; ++k, c += 7)
+        {
+            double scale = scales[k],
+                   tolerance = scale < opt.getResidualScale() ? 1e-12 : 0.02;
+            Array smooth(shape), ggm(shape), log(shape);
+            MultiArray<2, TinyVector<double, 3> > tensor(shape);
+            MultiArray<2, TinyVector<double, 2> > ev(shape);
+
+            gaussianSmoothMultiArray(data, smooth, scale);
+            should(maxRelativeDifference(features.bindOuter(c), smooth) < tolerance);
+
+            gaussianGradientMagnitude(data, ggm, scale);
+            should(maxRelativeDifference(features.bindOuter(c+1), ggm) < tolerance);
+
+            laplacianOfGaussianMultiArray(data, log, scale);
+            should(maxRelativeDifference(features.bindOuter(c+2), log) < tolerance);
+
+            structureTensorMultiArray(data, tensor, scale, 0.5*scale);
+            tensorEigenvaluesMultiArray(tensor, ev);
+            for(int d = 0; d < 2; ++d)
+                should(maxRelativeDifference(features.bindOuter(c+3+d), ev.bindElementChannel(d)) < tolerance);
+
+            hessianOfGaussianMultiArray(data, tensor, scale);
+            tensorEigenvaluesMultiArray(tensor, ev);
+            for(int d = 0; d < 2; ++d)
+                should(maxRelativeDifference(features.bindOuter(c+5+d), ev.bindElementChannel(d)) < tolerance);
+        }
+    }
+
+    void testFeatureStackChunked()
+    {
+        typedef MultiArray<3, float> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(40, 35, 30);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        FeatureStackOptions opt;
+        opt.feature(GaussianGradientMagnitudeFeature, 1.0)
+           .feature(HessianOfGaussianEigenvaluesFeature, 2.0)
+           .feature(GaussianSmoothingFeature, 2.0)
+           .numThreads(4);
+
+        MultiArray<4, float> features(Shape4(shape[0], shape[1], shape[2], 5));
+        featureStackMultiArray(data, features, opt.blockShape(16));
+
+        ChunkedArrayLazy<3, float> chunkedData(shape, Shape(16));
+        chunkedData.commitSubarray(Shape(0), data);
+        ChunkedArrayLazy<4, float> chunkedFeatures(features.shape(), Shape4(16, 16, 16, 1));
+
+        // the default block shape is the chunk shape
+        featureStackMultiArray(chunkedData, chunkedFeatures, FeatureStackOptions(opt).blockShape(BlockwiseOptions::Shape()));
+        MultiArray<4, float> checkedOut(features.shape());
+        chunkedFeatures.checkoutSubarray(Shape4(0), checkedOut);
+        shouldEqualSequenceTolerance(features.begin(), features.end(), checkedOut.begin(), 1e-4f);
+
+        chunkedFeatures.commitSubarray(Shape4(0), MultiArray<4, float>(features.shape()));
+        featureStackMultiArray(data, chunkedFeatures, opt);
+        chunkedFeatures.checkoutSubarray(Shape4(0), checkedOut);
+        shouldEqualSequenceTolerance(features.begin(), features.end(), checkedOut.begin(), 1e-4f);
+    }
 };
 
 struct BlockwiseConvolutionTestSuite
@@ -115,6 +253,9 @@ struct BlockwiseConvolutionTestSuite
         add(testCase(&BlockwiseConvolutionTest::simpleTest));
         add(testCase(&BlockwiseConvolutionTest::chunkedTest));
         add(testCase(&BlockwiseConvolutionTest::testParallel));
+        add(testCase(&BlockwiseConvolutionTest::testHessianEigenvalues));
+        add(testCase(&BlockwiseConvolutionTest::testFeatureStack));
+        add(testCase(&BlockwiseConvolutionTest::testFeatureStackChunked));
     }
 };
 
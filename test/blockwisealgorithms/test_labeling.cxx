@@ -267,6 +267,50 @@ struct BlockwiseLabelingTest
                                      oldschool_label_array.begin(), oldschool_label_array.end()), true);
     }
 
+    template <class Array>
+    void testParallelLabeling(vector<Array> const & arrays)
+    {
+        for(unsigned int k = 0; k != arrays.size(); ++k)
+        {
+            Array const & data = arrays[k];
+            for(int n = 0; n < 2; ++n)
+            {
+                NeighborhoodType neighborhood = n == 0 ? DirectNeighborhood : IndirectNeighborhood;
+                for(int threads = 1; threads <= 5; threads += 2)
+                {
+                    Array expected(data.shape()), labels(data.shape());
+
+                    unsigned int expected_count = labelMultiArray(data, expected, neighborhood);
+                    unsigned int count = labelMultiArray(data, labels,
+                                                         LabelOptions().neighborhood(neighborhood)
+                                                                       .numThreads(threads));
+                    shouldEqual(count, expected_count);
+                    shouldEqualSequence(labels.begin(), labels.end(), expected.begin());
+
+                    expected_count = labelMultiArrayWithBackground(data, expected, neighborhood, 1u);
+                    count = labelMultiArray(data, labels,
+                                            LabelOptions().neighborhood(neighborhood)
+                                                          .ignoreBackgroundValue(1u)
+                                                          .numThreads(threads));
+                    shouldEqual(count, expected_count);
+                    shouldEqualSequence(labels.begin(), labels.end(), expected.begin());
+                }
+            }
+        }
+    }
+
+    void parallelLabelingTest()
+    {
+        testParallelLabeling(array_ones);
+        testParallelLabeling(array_twos);
+        testParallelLabeling(array_fives);
+
+        typedef MultiArray<3, unsigned int> Array3;
+        vector<Array3> array_threes(1, Array3(Shape3(40, 30, 20)));
+        fillRandom(array_threes[0].begin(), array_threes[0].end(), 2);
+        testParallelLabeling(array_threes);
+    }
+
     void fiveDimensionalRandomTest()
     {
         testOnData(array_fives.begin(), array_fives.end(),
@@ -295,6 +339,7 @@ struct BlockwiseLabelingTestSuite
         add(testCase(&BlockwiseLabelingTest::fiveDimensionalRandomTest));
         add(testCase(&BlockwiseLabelingTest::debugTest));
         add(testCase(&BlockwiseLabelingTest::chunkedArrayTest));
+        add(testCase(&BlockwiseLabelingTest::parallelLabelingTest));
     }
 };
 
@@ -15,6 +15,8 @@
 #include "vigra/medianfilter.hxx"
 #include "vigra/shockfilter.hxx"
 #include "vigra/specklefilters.hxx"
+#include "vigra/non_local_mean.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -452,6 +454,122 @@ struct SpeckleFilterTestSuite
     }
 };
 
+/********************************************************************/
+/*                                                                  */
+/*                        Non-local means                           */
+/*                                                                  */
+/********************************************************************/
+
+struct NonLocalMeanTest
+{
+    // straightforward non-local means with uniformly weighted patches
+    // and mirrored borders, as computed by the integral image mode
+    template <int N, class POLICY>
+    static void uniformPatchReference(MultiArrayView<N, float> const & image,
+                                      POLICY policy, NonLocalMeanParameter const & param,
+                                      MultiArrayView<N, float> res)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        const int f = param.patchRadius_, r = param.searchRadius_;
+        const Shape shape = image.shape();
+        const double patchSize = std::pow(2.0*f+1.0, N);
+
+        MultiArray<N, float> meanImage(shape), varImage(shape);
+        gaussianMeanAndVariance<N, float, float>(image, param.sigmaMean_, meanImage, varImage);
+
+        MultiCoordinateIterator<N> x(shape), xend(x.getEndIterator());
+        for(; x != xend; ++x)
+        {
+            if(!policy.usePixel(meanImage[*x], varImage[*x]))
+            {
+                res[*x] = image[*x];
+                continue;
+            }
+            double estimate = 0.0, weights = 0.0, wmax = 0.0;
+            MultiCoordinateIterator<N> o(Shape(2*r+1)), oend(o.getEndIterator());
+            for(; o != oend; ++o)
+            {
+                const Shape offset = *o - Shape(r), y = *x + offset;
+                if(offset == Shape() || !image.isInside(y) ||
+                   !policy.usePixel(meanImage[y], varImage[y]) ||
+                   !policy.usePixelPair(meanImage[*x], varImage[*x], meanImage[y], varImage[y]))
+                    continue;
+                double distance = 0.0;
+                MultiCoordinateIterator<N> p(Shape(2*f+1)), pend(p.getEndIterator());
+                for(; p != pend; ++p)
+                {
+                    Shape a = *x + *p - Shape(f), b = y + *p - Shape(f);
+                    for(int d = 0; d < N; ++d)
+                    {
+                        a[d] = a[d] < 0 ? -a[d] : a[d] >= shape[d] ? 2*shape[d] - a[d] - 1 : a[d];
+                        b[d] = b[d] < 0 ? -b[d] : b[d] >= shape[d] ? 2*shape[d] - b[d] - 1 : b[d];
+                    }
+                    distance += sq(image[a] - image[b]);
+                }
+                const double w = policy.distanceToWeight(meanImage[*x], varImage[*x],
+                                                         (float)(distance / (patchSize*patchSize)));
+                estimate += w*image[y];
+                weights += w;
+                wmax = std::max(w, wmax);
+            }
+            if(wmax == 0.0)
+                wmax = 1.0;
+            res[*x] = (float)((estimate + wmax*image[*x]) / (weights + wmax));
+        }
+    }
+
+    template <int N>
+    void testIntegral(typename MultiArrayShape<N>::type const & shape)
+    {
+        MultiArray<N, float> image(shape);
+        MersenneTwister random;
+        for(int k = 0; k < image.size(); ++k)
+            image[k] = 10.0f + 5.0f*random.normal();
+        // a flat region, whose pixels are left unchanged
+        image.subarray(typename MultiArrayShape<N>::type(),
+                       typename MultiArrayShape<N>::type(4)) = 50.0f;
+
+        NormPolicyParameter policyParam(4.0, 1000.0, 0.1, 0.00001);
+        NormPolicy<float> policy(policyParam);
+
+        MultiArray<N, float> expected(shape);
+        uniformPatchReference<N>(image, policy,
+                              NonLocalMeanParameter(1.0, 3, 2, 1.0, 1, 1, 1, false, true),
+                              expected);
+
+        int threads[] = { 1, 2, 5 };
+        for(int t = 0; t < 3; ++t)
+        {
+            NonLocalMeanParameter param(1.0, 3, 2, 1.0, 1, 1, threads[t], false, true);
+            MultiArray<N, float> res(shape);
+            nonLocalMean<N, float, float>(image, policy, param, res);
+            for(int k = 0; k < image.size(); ++k)
+                shouldEqualTolerance(res[k], expected[k], 1e-4f);
+        }
+    }
+
+    void testIntegral2D()
+    {
+        testIntegral<2>(Shape2(23, 19));
+    }
+
+    void testIntegral3D()
+    {
+        testIntegral<3>(Shape3(11, 9, 8));
+    }
+};
+
+struct NonLocalMeanTestSuite
+: public vigra::test_suite
+{
+    NonLocalMeanTestSuite()
+    : vigra::test_suite("NonLocalMeanTestSuite")
+    {
+        add( testCase( &NonLocalMeanTest::testIntegral2D));
+        add( testCase( &NonLocalMeanTest::testIntegral3D));
+    }
+};
+
 struct FilterTestCollection
 : public vigra::test_suite
 {
@@ -461,6 +579,7 @@ struct FilterTestCollection
         add( new MedianFilterTestSuite);
         add( new ShockFilterTestSuite);
         add( new SpeckleFilterTestSuite);
+        add( new NonLocalMeanTestSuite);
    }
 };
 
@@ -45,6 +45,8 @@
 #include <vigra/inspectimage.hxx>
 #include <vigra/gaborfilter.hxx>
 #include <vigra/multi_fft.hxx>
+#include <vigra/blockwise_fft_convolution.hxx>
+#include <vigra/random.hxx>
 #include <vigra/multi_pointoperators.hxx>
 #include <vigra/convolution.hxx>
 #include "test.hxx"
@@ -469,6 +471,66 @@ struct MultiFFTTest
         shouldEqualTolerance(minmax.max, 0.0, 1e-10);
     }
 
+    void testPlanCache()
+    {
+        Shape2 s(64, 48);
+        DArray2 a(s), b(s), bcopy(s);
+        CArray2 fa(fftwCorrespondingShapeR2C(s)), fb(fa.shape()), ref(fa.shape());
+        for(int k=0; k<b.size(); ++k)
+            b[k] = rand()/(double)RAND_MAX;
+        bcopy = b;
+
+        fftwClearPlanCache();
+        FFTWPlan<2, R> plan1(a, fa, FFTW_MEASURE);
+
+        // a cached plan is reused and doesn't overwrite the arrays
+        FFTWPlan<2, R> plan2(b, fb, FFTW_MEASURE);
+        should(b == bcopy);
+
+        plan2.execute(b, fb);
+        fourierTransform(bcopy, ref);
+        shouldEqualSequence(fb.data(), fb.data()+fb.size(), ref.data());
+
+        plan1.execute(b, fa);
+        shouldEqualSequence(fa.data(), fa.data()+fa.size(), ref.data());
+
+        // plans in use survive clearing the cache
+        fftwClearPlanCache();
+        plan2.execute(b, fb);
+        shouldEqualSequence(fb.data(), fb.data()+fb.size(), ref.data());
+
+        fftwEnablePlanCache(false);
+        FFTWPlan<2, R> plan3(a, fa, FFTW_ESTIMATE);
+        fftwEnablePlanCache(true);
+        plan3.execute(b, fa);
+        shouldEqualSequence(fa.data(), fa.data()+fa.size(), ref.data());
+
+        // a full cache removes the oldest plans, plans in use stay valid
+        shouldEqual(fftwGetPlanCacheCapacity(), 128u);
+        fftwSetPlanCacheCapacity(1);
+        shouldEqual(fftwGetPlanCacheCapacity(), 1u);
+        FFTWPlan<2, R> plan4(a, fa, FFTW_ESTIMATE);
+        DArray2 c(Shape2(16, 12));
+        CArray2 fc(fftwCorrespondingShapeR2C(c.shape()));
+        FFTWPlan<2, R> plan5(c, fc, FFTW_ESTIMATE);
+        fftwSetPlanCacheCapacity(0);
+        plan4.execute(b, fa);
+        shouldEqualSequence(fa.data(), fa.data()+fa.size(), ref.data());
+        fourierTransform(b, fa);
+        shouldEqualSequence(fa.data(), fa.data()+fa.size(), ref.data());
+        fftwSetPlanCacheCapacity(128);
+
+        fftwSetNumThreads(2);
+        shouldEqual(fftwGetNumThreads(), 2);
+        fourierTransform(b, fa);
+        shouldEqualSequence(fa.data(), fa.data()+fa.size(), ref.data());
+        fftwSetNumThreads(1);
+
+        should(fftwExportWisdom<double>("fftw_wisdom.dat"));
+        should(fftwImportWisdom<double>("fftw_wisdom.dat"));
+        should(!fftwImportWisdom<double>("no_such_dir/fftw_wisdom.dat"));
+    }
+
     void testPadding()
     {
         shouldEqual(0, detail::FFTWPaddingSize<0>::find(0));
@@ -523,6 +585,59 @@ struct MultiFFTTest
                                      ref2.data(), 1e-14);
     }
 
+    void testConvolveFFTBlockwise()
+    {
+        typedef MultiArrayView<2, double> MV;
+        ImageImportInfo info("ghouse.gif");
+        Shape2 s(info.width(), info.height());
+        DArray2 in(s), out(s), ref(s);
+        importImage(info, destImage(in));
+
+        Kernel2D<double> gauss;
+        gauss.initGaussian(2.0);
+        MV kernel(Shape2(gauss.width(), gauss.height()), &gauss[gauss.upperLeft()]);
+        convolveFFT(in, kernel, ref);
+
+        convolveFFTBlockwise(in, kernel, out, BlockwiseOptions().blockShape(Shape2(20, 17)));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        out.init(0.0);
+        convolveFFTBlockwise(in, kernel, out,
+                             BlockwiseOptions().blockShape(Shape2(32, 40)).numThreads(4));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // non-symmetric kernel of even size
+        MersenneTwister random;
+        DArray2 even(Shape2(4, 6));
+        for(int k=0; k<even.size(); ++k)
+            even[k] = random.uniform();
+        convolveFFT(in, even, ref);
+        out.init(0.0);
+        convolveFFTBlockwise(in, even, out,
+                             BlockwiseOptions().blockShape(Shape2(25)).numThreads(3));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // 3D chunked arrays
+        Shape3 s3(50, 41, 37);
+        MultiArray<3, double> in3(s3), ref3(s3), out3(s3);
+        for(int k=0; k<in3.size(); ++k)
+            in3[k] = random.uniform();
+        MultiArray<3, double> kernel3(Shape3(5, 4, 3));
+        for(int k=0; k<kernel3.size(); ++k)
+            kernel3[k] = random.uniform();
+        convolveFFT(in3, kernel3, ref3);
+
+        ChunkedArrayLazy<3, double> csrc(s3, Shape3(16)), cdest(s3, Shape3(16));
+        csrc.commitSubarray(Shape3(), in3);
+        convolveFFTBlockwise(csrc, kernel3, cdest, BlockwiseOptions().numThreads(2));
+        cdest.checkoutSubarray(Shape3(), out3);
+        shouldEqualSequenceTolerance(out3.data(), out3.data()+out3.size(),
+                                     ref3.data(), 1e-12);
+    }
+
     void testConvolveFFTComplex()
     {
         typedef MultiArrayView<2, double> MV;
@@ -711,8 +826,10 @@ struct FFTWTestSuite
         add( testCase(&MultiFFTTest::testFFTShift));
         add( testCase(&MultiFFTTest::testFFT2D));
         add( testCase(&MultiFFTTest::testFFT3D));
+        add( testCase(&MultiFFTTest::testPlanCache));
         add( testCase(&MultiFFTTest::testPadding));
         add( testCase(&MultiFFTTest::testConvolveFFT));
+        add( testCase(&MultiFFTTest::testConvolveFFTBlockwise));
         add( testCase(&MultiFFTTest::testConvolveFFTComplex));
         add( testCase(&MultiFFTTest::testConvolveFourierKernel));
     }
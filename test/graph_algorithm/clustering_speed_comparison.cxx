@@ -0,0 +1,72 @@
+//We need to undefine NDEBUG so that we have TIC, TOC available!
+#undef NDEBUG
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <vigra/timing.hxx>
+USETICTOC;
+#include <vigra/multi_gridgraph.hxx>
+#include <vigra/hierarchical_clustering.hxx>
+#include <vigra/random.hxx>
+
+using namespace vigra;
+
+// compare the MergeGraphAdaptor-based clustering with the flat
+// agglomeration engine (ClusteringOptions::fastAgglomeration())
+// on identical inputs
+int main(int /*argc*/, char ** /*argv*/)
+{
+    typedef GridGraph<2, boost_graph::undirected_tag> Graph;
+    typedef TinyVector<float, 3>                      FeatureVector;
+
+    Graph graph(Shape2(400, 400), DirectNeighborhood);
+    Graph::EdgeMap<float>         edgeWeights(graph), edgeLengths(graph);
+    Graph::NodeMap<FeatureVector> nodeFeatures(graph);
+    Graph::NodeMap<float>         nodeSizes(graph);
+
+    RandomMT19937 random(1);
+    for(Graph::EdgeIt e(graph); e != lemon::INVALID; ++e)
+    {
+        edgeWeights[*e] = random.uniform();
+        edgeLengths[*e] = 1.0f;
+    }
+    for(Graph::NodeIt n(graph); n != lemon::INVALID; ++n)
+    {
+        nodeFeatures[*n] = FeatureVector(random.uniform(), random.uniform(), random.uniform());
+        nodeSizes[*n] = 1.0f;
+    }
+
+    ClusteringOptions options;
+    options.minRegionCount(100);
+
+    Graph::NodeMap<UInt32> labels(graph), fastLabels(graph);
+
+    std::cerr << "Clustering " << graph.nodeNum() << " nodes and "
+              << graph.edgeNum() << " edges with MergeGraphAdaptor:" << std::endl;
+    TIC;
+    hierarchicalClustering(graph, edgeWeights, edgeLengths, nodeFeatures, nodeSizes,
+                           labels, options);
+    TOC;
+    std::cerr << "Clustering with fast agglomeration:" << std::endl;
+    TIC;
+    hierarchicalClustering(graph, edgeWeights, edgeLengths, nodeFeatures, nodeSizes,
+                           fastLabels, ClusteringOptions(options).fastAgglomeration());
+    TOC;
+
+    // the clusterings agree up to the choice of representatives, except
+    // when merges of exactly equal distance are performed in a different order
+    std::map<UInt32, UInt32> toFast, fromFast;
+    std::size_t mismatches = 0;
+    for(Graph::NodeIt n(graph); n != lemon::INVALID; ++n)
+    {
+        if(toFast.find(labels[*n]) == toFast.end())
+            toFast[labels[*n]] = fastLabels[*n];
+        if(fromFast.find(fastLabels[*n]) == fromFast.end())
+            fromFast[fastLabels[*n]] = labels[*n];
+        if(toFast[labels[*n]] != fastLabels[*n] || fromFast[fastLabels[*n]] != labels[*n])
+            ++mismatches;
+    }
+    std::cerr << "Nodes assigned to a different cluster: " << mismatches << std::endl;
+    return 0;
+}
@@ -34,12 +34,17 @@
 /************************************************************************/
 
 #include <iostream>
+#include <map>
 #include "vigra/unittest.hxx"
 #include "vigra/stdimage.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/adjacency_list_graph.hxx"
 #include "vigra/graph_algorithms.hxx"
+#include "vigra/graph_rag_features.hxx"
+#include "vigra/graph_rag_project_back.hxx"
+#include "vigra/hierarchical_clustering.hxx"
 #include "vigra/multi_resize.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -453,6 +458,534 @@ struct GraphAlgorithmTest{
     }
 
 
+    void testRegionAdjacencyGraphParallel(){
+        typedef GridGraph<3, boost_graph::undirected_tag> GridGraph3d;
+        typedef GridGraph3d::Edge                         GridEdge;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffEdges;
+
+        // blocky labeling with some gaps in the label range
+        MultiArray<3, UInt32> labels(Shape3(20, 17, 13));
+        MersenneTwister random;
+        MultiArray<3, UInt32> blocks(Shape3(5, 5, 4));
+        for(int k=0; k<blocks.size(); ++k)
+            blocks[k] = random.uniformInt(40) * 2;
+        for(int k=0; k<labels.size(); ++k){
+            const Shape3 p = labels.scanOrderIndexToCoordinate(k);
+            labels[k] = blocks(p[0]/4, p[1]/4, p[2]/4);
+        }
+
+        for(int neighborhood=0; neighborhood<2; ++neighborhood){
+            GridGraph3d g(labels.shape(), neighborhood == 0 ? DirectNeighborhood : IndirectNeighborhood);
+            for(Int64 ignoreLabel=-1; ignoreLabel<=blocks[0]; ignoreLabel+=blocks[0]+1){
+                GraphType rag, parRag;
+                AffEdges affEdges, parAffEdges;
+                makeRegionAdjacencyGraph(g, labels, rag, affEdges, ignoreLabel);
+                makeRegionAdjacencyGraph(g, labels, parRag, parAffEdges, ignoreLabel,
+                                         ParallelOptions().numThreads(4));
+
+                shouldEqual(parRag.nodeNum(), rag.nodeNum());
+                shouldEqual(parRag.maxNodeId(), rag.maxNodeId());
+                shouldEqual(parRag.edgeNum(), rag.edgeNum());
+                for(NodeIt n(rag); n!=lemon::INVALID; ++n)
+                    should(parRag.nodeFromId(rag.id(*n))!=lemon::INVALID);
+
+                for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+                    const Edge pe = parRag.findEdge(parRag.nodeFromId(rag.id(rag.u(*e))),
+                                                    parRag.nodeFromId(rag.id(rag.v(*e))));
+                    should(pe!=lemon::INVALID);
+
+                    std::vector<MultiArrayIndex> ids, parIds;
+                    for(std::size_t k=0; k<affEdges[*e].size(); ++k)
+                        ids.push_back(g.id(affEdges[*e][k]));
+                    for(std::size_t k=0; k<parAffEdges[pe].size(); ++k)
+                        parIds.push_back(g.id(parAffEdges[pe][k]));
+                    std::sort(ids.begin(), ids.end());
+                    shouldEqual(parIds.size(), ids.size());
+                    shouldEqualSequence(parIds.begin(), parIds.end(), ids.begin());
+                }
+            }
+        }
+    }
+
+    void testCompressedAffiliatedEdges(){
+        typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+        typedef GridGraph2d::Edge                         GridEdge;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffEdges;
+        typedef CompressedAffiliatedEdges<GridGraph2d, UInt32> CompressedAffEdges;
+
+        MultiArray<2, UInt32> labels(Shape2(23, 19));
+        for(int k=0; k<labels.size(); ++k){
+            const Shape2 p = labels.scanOrderIndexToCoordinate(k);
+            labels[k] = (p[0]/5 + 3*(p[1]/6)) % 7;
+        }
+        GridGraph2d g(labels.shape(), IndirectNeighborhood);
+
+        GraphType rag;
+        AffEdges affEdges;
+        makeRegionAdjacencyGraph(g, labels, rag, affEdges);
+
+        // conversion from the vector-based representation
+        CompressedAffEdges converted(g, rag, affEdges);
+        shouldEqual(converted.offsets().size(), (size_t)rag.maxEdgeId()+2);
+        shouldEqual(converted.ids().size(), converted.offsets().back());
+        for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+            shouldEqual(converted[*e].size(), affEdges[*e].size());
+            for(size_t k=0; k<affEdges[*e].size(); ++k)
+                should(converted[*e][k] == affEdges[*e][k]);
+        }
+
+        // direct construction
+        GraphType parRag;
+        CompressedAffEdges compressed;
+        makeRegionAdjacencyGraph(g, labels, parRag, compressed, -1, ParallelOptions().numThreads(3));
+        shouldEqual(parRag.edgeNum(), rag.edgeNum());
+        for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+            const Edge pe = parRag.findEdge(parRag.nodeFromId(rag.id(rag.u(*e))),
+                                            parRag.nodeFromId(rag.id(rag.v(*e))));
+            should(pe!=lemon::INVALID);
+            std::vector<UInt32> ids(converted[*e].idsBegin(), converted[*e].idsEnd());
+            std::sort(ids.begin(), ids.end());
+            shouldEqual(compressed[pe].size(), ids.size());
+            shouldEqualSequence(compressed[pe].idsBegin(), compressed[pe].idsEnd(), ids.begin());
+        }
+
+        // serialization is compatible with the vector-based representation
+        std::vector<Int64> serialized(affiliatedEdgesSerializationSize(g, rag, affEdges)),
+                           compressedSerialized(affiliatedEdgesSerializationSize(g, rag, converted));
+        serializeAffiliatedEdges(g, rag, affEdges, serialized.begin());
+        serializeAffiliatedEdges(g, rag, converted, compressedSerialized.begin());
+        shouldEqualSequence(serialized.begin(), serialized.end(), compressedSerialized.begin());
+
+        CompressedAffEdges deserialized;
+        deserializeAffiliatedEdges(g, rag, deserialized, serialized.begin(), serialized.end());
+        shouldEqual(deserialized.offsets().size(), converted.offsets().size());
+        shouldEqualSequence(deserialized.offsets().begin(), deserialized.offsets().end(),
+                            converted.offsets().begin());
+        shouldEqualSequence(deserialized.ids().begin(), deserialized.ids().end(),
+                            converted.ids().begin());
+        should(converted.memoryBytes() < converted.ids().size()*sizeof(GridEdge));
+    }
+
+    void testRagFeatures(){
+        typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+        typedef GridGraph2d::Edge                         GridEdge;
+        typedef GridGraph2d::EdgeIt                       GridEdgeIt;
+        typedef GridGraph2d::NodeIt                       GridNodeIt;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffEdges;
+        typedef CompressedAffiliatedEdges<GridGraph2d>    CompressedAffEdges;
+        typedef TinyVector<double, 2>                     Vector2;
+
+        MultiArray<2, UInt32> labels(Shape2(31, 27));
+        for(int k=0; k<labels.size(); ++k){
+            const Shape2 p = labels.scanOrderIndexToCoordinate(k);
+            labels[k] = (p[0]/6 + 2*(p[1]/5)) % 9;
+        }
+        GridGraph2d g(labels.shape(), DirectNeighborhood);
+
+        GraphType rag;
+        AffEdges affEdges;
+        makeRegionAdjacencyGraph(g, labels, rag, affEdges);
+        CompressedAffEdges compressed(g, rag, affEdges);
+
+        MersenneTwister random;
+        GridGraph2d::EdgeMap<float>   edgeFeatures(g), edgeSizes(g);
+        GridGraph2d::EdgeMap<Vector2> edgeFeaturesMb(g);
+        for(GridEdgeIt e(g); e!=lemon::INVALID; ++e){
+            edgeFeatures[*e]   = random.uniform();
+            edgeSizes[*e]      = 1.0 + random.uniformInt(3);
+            edgeFeaturesMb[*e] = Vector2(random.uniform(), random.uniform());
+        }
+
+        const std::string accumulators[4] = {"mean", "sum", "min", "max"};
+        for(int a=0; a<4; ++a){
+            // "mean" and "sum" add to the initial result, "min" and "max" overwrite it
+            const double offset = 0.5;
+
+            // serial reference
+            GraphType::EdgeMap<double> expected(rag);
+            GraphType::EdgeMap<Vector2> expectedMb(rag);
+            for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+                const std::vector<GridEdge> & aff = affEdges[*e];
+                double res = a == 2 ? 1e10 : a == 3 ? -1e10 : offset, weightSum = 0.0;
+                Vector2 resMb(res);
+                for(size_t k=0; k<aff.size(); ++k){
+                    const double w = a == 0 ? edgeSizes[aff[k]] : 1.0;
+                    for(int c=0; c<2; ++c){
+                        if(a < 2)
+                            resMb[c] += w*edgeFeaturesMb[aff[k]][c];
+                        else if(a == 2)
+                            resMb[c] = std::min(resMb[c], edgeFeaturesMb[aff[k]][c]);
+                        else
+                            resMb[c] = std::max(resMb[c], edgeFeaturesMb[aff[k]][c]);
+                    }
+                    if(a < 2)
+                        res += w*edgeFeatures[aff[k]];
+                    else if(a == 2)
+                        res = std::min<double>(res, edgeFeatures[aff[k]]);
+                    else
+                        res = std::max<double>(res, edgeFeatures[aff[k]]);
+                    weightSum += w;
+                }
+                if(a == 0){
+                    res /= weightSum;
+                    resMb /= weightSum;
+                }
+                expected[*e] = res;
+                expectedMb[*e] = resMb;
+            }
+
+            GraphType::EdgeMap<double> result(rag), compressedResult(rag);
+            GraphType::EdgeMap<Vector2> resultMb(rag);
+            std::fill(result.begin(), result.end(), offset);
+            std::fill(compressedResult.begin(), compressedResult.end(), offset);
+            std::fill(resultMb.begin(), resultMb.end(), Vector2(offset));
+            ragEdgeFeatures(rag, affEdges, edgeFeatures, edgeSizes, accumulators[a], result,
+                            ParallelOptions().numThreads(4));
+            ragEdgeFeatures(rag, compressed, edgeFeatures, edgeSizes, accumulators[a], compressedResult,
+                            ParallelOptions().numThreads(2));
+            ragEdgeFeatures(rag, affEdges, edgeFeaturesMb, edgeSizes, accumulators[a], resultMb,
+                            ParallelOptions().numThreads(3));
+            for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+                shouldEqualTolerance(result[*e], expected[*e], 1e-6);
+                shouldEqualTolerance(compressedResult[*e], expected[*e], 1e-6);
+                shouldEqualTolerance(resultMb[*e][0], expectedMb[*e][0], 1e-6);
+                shouldEqualTolerance(resultMb[*e][1], expectedMb[*e][1], 1e-6);
+            }
+        }
+
+        // edge statistics
+        MultiArray<2, float> statistics(Shape2(rag.maxEdgeId()+1, 12));
+        ragEdgeStatistics(rag, affEdges, edgeFeatures, statistics, ParallelOptions().numThreads(3));
+        for(EdgeIt e(rag); e!=lemon::INVALID; ++e){
+            const std::vector<GridEdge> & aff = affEdges[*e];
+            double sum = 0.0, minVal = 1e10, maxVal = -1e10;
+            for(size_t k=0; k<aff.size(); ++k){
+                sum += edgeFeatures[aff[k]];
+                minVal = std::min<double>(minVal, edgeFeatures[aff[k]]);
+                maxVal = std::max<double>(maxVal, edgeFeatures[aff[k]]);
+            }
+            shouldEqualTolerance(statistics(rag.id(*e), 0), sum / aff.size(), 1e-5);
+            shouldEqualTolerance(statistics(rag.id(*e), 1), sum, 1e-4);
+            shouldEqualTolerance(statistics(rag.id(*e), 2), minVal, 1e-6);
+            shouldEqualTolerance(statistics(rag.id(*e), 3), maxVal, 1e-6);
+
+            // the quantile histogram has a bin count depending on the number of rag edges
+            using namespace vigra::acc;
+            typedef StandardQuantiles<AutoRangeHistogram<0> > Quantiles;
+            AccumulatorChain<double, Select<Quantiles> > q;
+            size_t nBins = static_cast<size_t>(std::pow(rag.maxEdgeId()+1.0, 1.0 / 2.5));
+            q.setHistogramOptions(HistogramOptions().setBinCount(std::max<size_t>(2, std::min<size_t>(nBins, 64))));
+            for(unsigned int pass=1; pass <= q.passesRequired(); ++pass)
+                for(size_t k=0; k<aff.size(); ++k)
+                    q.updatePassN(static_cast<double>(edgeFeatures[aff[k]]), pass);
+            for(int k=0; k<5; ++k)
+                shouldEqualTolerance(statistics(rag.id(*e), 7+k), get<Quantiles>(q)[1+k], 1e-5);
+        }
+
+        // node features, with and without ignore label
+        MultiArray<2, float>   nodeFeatures(labels.shape()), nodeSizes(labels.shape());
+        MultiArray<2, Vector2> nodeFeaturesMb(labels.shape());
+        for(int k=0; k<labels.size(); ++k){
+            nodeFeatures[k]   = random.uniform();
+            nodeSizes[k]      = 1.0 + random.uniformInt(3);
+            nodeFeaturesMb[k] = Vector2(random.uniform(), random.uniform());
+        }
+        for(Int64 ignoreLabel=-1; ignoreLabel<=3; ignoreLabel+=4){
+            for(int a=0; a<4; ++a){
+                const double init = a == 2 ? 1e10 : a == 3 ? -1e10 : 0.0;
+                GraphType::NodeMap<double>  expected(rag), weights(rag);
+                GraphType::NodeMap<Vector2> expectedMb(rag);
+                std::fill(expected.begin(), expected.end(), init);
+                std::fill(weights.begin(), weights.end(), 0.0);
+                std::fill(expectedMb.begin(), expectedMb.end(), Vector2(init));
+                for(GridNodeIt n(g); n!=lemon::INVALID; ++n){
+                    const Int64 l = labels[*n];
+                    if(l == ignoreLabel)
+                        continue;
+                    const Node rn = rag.nodeFromId(l);
+                    const double w = a == 0 ? nodeSizes[*n] : 1.0;
+                    for(int c=0; c<2; ++c){
+                        if(a < 2)
+                            expectedMb[rn][c] += w*nodeFeaturesMb[*n][c];
+                        else if(a == 2)
+                            expectedMb[rn][c] = std::min(expectedMb[rn][c], nodeFeaturesMb[*n][c]);
+                        else
+                            expectedMb[rn][c] = std::max(expectedMb[rn][c], nodeFeaturesMb[*n][c]);
+                    }
+                    if(a < 2)
+                        expected[rn] += w*nodeFeatures[*n];
+                    else if(a == 2)
+                        expected[rn] = std::min<double>(expected[rn], nodeFeatures[*n]);
+                    else
+                        expected[rn] = std::max<double>(expected[rn], nodeFeatures[*n]);
+                    weights[rn] += w;
+                }
+
+                // "min" and "max" leave empty rag nodes unchanged
+                const double unchanged = a < 2 ? 0.0 : 42.0;
+                GraphType::NodeMap<double>  result(rag);
+                GraphType::NodeMap<Vector2> resultMb(rag);
+                std::fill(result.begin(), result.end(), unchanged);
+                std::fill(resultMb.begin(), resultMb.end(), Vector2(unchanged));
+                ragNodeFeatures(rag, g, labels, nodeFeatures, nodeSizes, accumulators[a],
+                                ignoreLabel, result, ParallelOptions().numThreads(4));
+                ragNodeFeatures(rag, g, labels, nodeFeaturesMb, nodeSizes, accumulators[a],
+                                ignoreLabel, resultMb, ParallelOptions().numThreads(3));
+                for(NodeIt n(rag); n!=lemon::INVALID; ++n){
+                    if(weights[*n] == 0.0){
+                        // the mean of an empty rag node is 0/0
+                        if(a == 0)
+                            should(std::isnan(result[*n]) && std::isnan(resultMb[*n][0]));
+                        else
+                            should(result[*n] == unchanged && resultMb[*n][1] == unchanged);
+                        continue;
+                    }
+                    const double norm = a == 0 ? weights[*n] : 1.0;
+                    shouldEqualTolerance(result[*n], expected[*n] / norm, 1e-6);
+                    shouldEqualTolerance(resultMb[*n][0], expectedMb[*n][0] / norm, 1e-6);
+                    shouldEqualTolerance(resultMb[*n][1], expectedMb[*n][1] / norm, 1e-6);
+                }
+            }
+        }
+    }
+
+    void testRagProjectBack(){
+        typedef GridGraph<3, boost_graph::undirected_tag> GridGraph3d;
+        typedef GridGraph3d::Edge                         GridEdge;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffEdges;
+
+        MultiArray<3, UInt32> labels(Shape3(9, 8, 7));
+        for(int k=0; k<labels.size(); ++k){
+            const Shape3 p = labels.scanOrderIndexToCoordinate(k);
+            labels[k] = p[0]/3 + 3*(p[1]/4) + 6*(p[2]/3);
+        }
+        GridGraph3d g(labels.shape(), DirectNeighborhood);
+        GraphType rag;
+        AffEdges affEdges;
+        makeRegionAdjacencyGraph(g, labels, rag, affEdges);
+
+        GraphType::NodeMap<float> ragFeatures(rag);
+        for(NodeIt n(rag); n!=lemon::INVALID; ++n)
+            ragFeatures[*n] = 10.0f*rag.id(*n) + 1.0f;
+
+        for(Int64 ignoreLabel=-1; ignoreLabel<=4; ignoreLabel+=5){
+            MultiArray<3, float> projected(labels.shape());
+            projectBack(rag, g, ignoreLabel, labels, ragFeatures, projected,
+                        ParallelOptions().numThreads(3));
+            for(int k=0; k<labels.size(); ++k){
+                if(labels[k] == ignoreLabel)
+                    shouldEqual(projected[k], 0.0f);
+                else
+                    shouldEqual(projected[k], 10.0f*labels[k] + 1.0f);
+            }
+
+            // sequential by default
+            MultiArray<3, float> sequential(labels.shape());
+            projectBack(rag, g, ignoreLabel, labels, ragFeatures, sequential);
+            should(sequential == projected);
+        }
+    }
+
+    void testBidirectionalShortestPath(){
+        typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+        typedef GridGraph2d::Node                         GridNode;
+        typedef GridGraph2d::EdgeIt                       GridEdgeIt;
+        typedef ShortestPathDijkstra<GridGraph2d, float>              Sp;
+        typedef BidirectionalShortestPathDijkstra<GridGraph2d, float> BiSp;
+
+        GridGraph2d g(Shape2(31, 23), IndirectNeighborhood);
+        GridGraph2d::EdgeMap<float> weights(g);
+
+        MersenneTwister random;
+        for(GridEdgeIt e(g); e!=lemon::INVALID; ++e)
+            weights[*e] = 0.1f + random.uniform();
+
+        std::vector<GridNode> sources, targets;
+        for(int k=0; k<40; ++k){
+            sources.push_back(GridNode(random.uniformInt(31), random.uniformInt(23)));
+            targets.push_back(GridNode(random.uniformInt(31), random.uniformInt(23)));
+        }
+        sources.push_back(GridNode(4, 5));
+        targets.push_back(GridNode(4, 5));
+
+        Sp   sp(g);
+        BiSp bisp(g);
+        std::vector<float> expected;
+        for(size_t k=0; k<sources.size(); ++k){
+            sp.run(weights, sources[k]);
+            expected.push_back(sp.distances()[targets[k]]);
+
+            // the same workspace is reused for all queries
+            float d = bisp.run(weights, sources[k], targets[k]);
+            should(bisp.hasPath());
+            shouldEqualTolerance(d, expected[k], 1e-4);
+            shouldEqualTolerance(bisp.distance(), expected[k], 1e-4);
+
+            BiSp::Path path = bisp.path();
+            should(path.front() == sources[k]);
+            should(path.back() == targets[k]);
+            float length = 0.0f;
+            for(size_t i=1; i<path.size(); ++i){
+                GridGraph2d::Edge e = g.findEdge(path[i-1], path[i]);
+                should(e != lemon::INVALID);
+                length += weights[e];
+            }
+            shouldEqualTolerance(length, expected[k], 1e-4);
+        }
+
+        // early termination at maxDistance
+        float d = bisp.run(weights, sources[0], targets[0], 0.5f * expected[0]);
+        if(expected[0] > 0.0f){
+            should(!bisp.hasPath());
+            shouldEqual(d, NumericTraits<float>::max());
+            shouldEqual(bisp.path().size(), 0u);
+        }
+
+        // batched queries must agree with the sequential ones
+        std::vector<float> distances, distancesOnly;
+        std::vector<BiSp::Path> paths;
+        shortestPathBatch(g, weights, sources, targets, distances, paths, ParallelOptions().numThreads(3));
+        shortestPathBatch(g, weights, sources, targets, distancesOnly, ParallelOptions().numThreads(3));
+        shouldEqual(distances.size(), sources.size());
+        shouldEqual(paths.size(), sources.size());
+        for(size_t k=0; k<sources.size(); ++k){
+            shouldEqualTolerance(distances[k], expected[k], 1e-4);
+            shouldEqualTolerance(distancesOnly[k], expected[k], 1e-4);
+            should(paths[k].front() == sources[k]);
+            should(paths[k].back() == targets[k]);
+        }
+    }
+
+    void testImplicitEdgeMap(){
+        typedef GridGraph<3, boost_graph::undirected_tag> GridGraph3d;
+        typedef GridGraph3d::Node                         GridNode;
+        typedef GridGraph3d::NodeIt                       GridNodeIt;
+        typedef GridGraph3d::EdgeIt                       GridEdgeIt;
+        typedef GridGraph3d::EdgeMap<float>               ExplicitEdgeMap;
+        typedef TinyVector<MultiArrayIndex, 3>            Shape3;
+
+        MultiArray<3, float> data(Shape3(9, 11, 7));
+        MersenneTwister random;
+        for(MultiArrayIndex k=0; k<data.size(); ++k)
+            data[k] = random.uniform();
+        // strided view with the same shape as the array
+        MultiArray<3, float> transposedData(data.transpose());
+        MultiArrayView<3, float, StridedArrayTag> strided = transposedData.transpose();
+
+        for(int neighborhood=0; neighborhood<2; ++neighborhood){
+            GridGraph3d g(data.shape(), neighborhood == 0 ? DirectNeighborhood : IndirectNeighborhood);
+
+            ExplicitEdgeMap meanWeights(g), maxWeights(g), diffWeights(g);
+            for(GridEdgeIt e(g); e!=lemon::INVALID; ++e){
+                const float a = data[g.u(*e)], b = data[g.v(*e)];
+                meanWeights[*e] = (a + b) / 2.0f;
+                maxWeights[*e]  = std::max(a, b);
+                diffWeights[*e] = std::abs(a - b);
+            }
+
+            GridGraphImplicitEdgeMap<3, boost_graph::undirected_tag, float, UnstridedArrayTag, MeanFunctor<float> >
+                implicitMean(g, data);
+            GridGraphImplicitEdgeMap<3, boost_graph::undirected_tag, float, StridedArrayTag, MaxFunctor<float> >
+                implicitMax = makeImplicitEdgeMap(g, strided, MaxFunctor<float>());
+            GridGraphImplicitEdgeMap<3, boost_graph::undirected_tag, float, StridedArrayTag, AbsDifferenceFunctor<float> >
+                implicitDiff = makeImplicitEdgeMap(g, data, AbsDifferenceFunctor<float>());
+
+            for(GridEdgeIt e(g); e!=lemon::INVALID; ++e){
+                shouldEqualTolerance(implicitMean[*e], meanWeights[*e], 1e-6);
+                shouldEqual(implicitMax[*e], maxWeights[*e]);
+                shouldEqualTolerance(implicitDiff[*e], diffWeights[*e], 1e-6);
+            }
+
+            // the algorithms must give the same results with implicit and explicit weights
+            {
+                ShortestPathDijkstra<GridGraph3d, float> sp(g), implicitSp(g);
+                sp.run(maxWeights, GridNode(1, 2, 3));
+                implicitSp.run(implicitMax, GridNode(1, 2, 3));
+                for(GridNodeIt n(g); n!=lemon::INVALID; ++n)
+                    shouldEqual(sp.distances()[*n], implicitSp.distances()[*n]);
+            }
+            {
+                GridGraph3d::NodeMap<UInt32> seeds(g), labels(g), implicitLabels(g);
+                seeds[GridNode(0, 0, 0)] = 1;
+                seeds[GridNode(8, 10, 6)] = 2;
+                seeds[GridNode(4, 5, 3)] = 3;
+                edgeWeightedWatershedsSegmentation(g, diffWeights, seeds, labels);
+                edgeWeightedWatershedsSegmentation(g, implicitDiff, seeds, implicitLabels);
+                should(labels == implicitLabels);
+            }
+            {
+                GridGraph3d::NodeMap<float>  nodeSizes(g, 1.0f);
+                GridGraph3d::NodeMap<UInt32> labels(g), implicitLabels(g);
+                std::fill(nodeSizes.begin(), nodeSizes.end(), 1.0f);
+                felzenszwalbSegmentation(g, meanWeights, nodeSizes, 0.5f, labels);
+                felzenszwalbSegmentation(g, implicitMean, nodeSizes, 0.5f, implicitLabels);
+                should(labels == implicitLabels);
+            }
+        }
+    }
+
+    void testHierarchicalClusteringFast(){
+        typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+        typedef GridGraph2d::EdgeIt                       GridEdgeIt;
+        typedef GridGraph2d::NodeIt                       GridNodeIt;
+        typedef TinyVector<float, 3>                      FeatureVector;
+
+        GridGraph2d g(Shape2(37, 29), DirectNeighborhood);
+        GridGraph2d::EdgeMap<float>         edgeWeights(g), edgeLengths(g);
+        GridGraph2d::NodeMap<FeatureVector> nodeFeatures(g);
+        GridGraph2d::NodeMap<float>         nodeSizes(g);
+
+        MersenneTwister random;
+        for(GridEdgeIt e(g); e!=lemon::INVALID; ++e){
+            edgeWeights[*e] = random.uniform();
+            edgeLengths[*e] = 1.0f + random.uniformInt(2);
+        }
+        for(GridNodeIt n(g); n!=lemon::INVALID; ++n){
+            nodeFeatures[*n] = FeatureVector(random.uniform(), random.uniform(), random.uniform());
+            nodeSizes[*n] = 1.0f;
+        }
+
+        for(int k=0; k<3; ++k){
+            ClusteringOptions options;
+            options.minRegionCount(k == 0 ? 1 : 25).nodeFeatureImportance(0.3 * k);
+            if(k == 2)
+                options.maxMergeDistance(0.5).nodeFeatureMetric(metrics::SquaredNormMetric);
+
+            GridGraph2d::NodeMap<UInt32> labels(g), fastLabels(g);
+            hierarchicalClustering(g, edgeWeights, edgeLengths, nodeFeatures, nodeSizes,
+                                   labels, options);
+            hierarchicalClustering(g, edgeWeights, edgeLengths, nodeFeatures, nodeSizes,
+                                   fastLabels, ClusteringOptions(options).fastAgglomeration());
+
+            // the clusterings must agree up to the choice of representatives
+            std::map<UInt32, UInt32> toFast, fromFast;
+            for(GridNodeIt n(g); n!=lemon::INVALID; ++n){
+                if(toFast.find(labels[*n]) == toFast.end())
+                    toFast[labels[*n]] = fastLabels[*n];
+                if(fromFast.find(fastLabels[*n]) == fromFast.end())
+                    fromFast[fastLabels[*n]] = labels[*n];
+                shouldEqual(toFast[labels[*n]], fastLabels[*n]);
+                shouldEqual(fromFast[fastLabels[*n]], labels[*n]);
+            }
+            if(k == 1)
+                shouldEqual(toFast.size(), 25u);
+        }
+
+        try
+        {
+            GridGraph2d::NodeMap<UInt32> labels(g);
+            hierarchicalClustering(g, edgeWeights, edgeLengths, nodeFeatures, nodeSizes,
+                                   labels, ClusteringOptions().buildMergeTreeEncoding().fastAgglomeration());
+            failTest("no exception thrown");
+        }
+        catch(vigra::PreconditionViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nhierarchicalClustering(): fastAgglomeration() cannot build the merge tree encoding.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
     void testEdgeSort(){
         {
             GraphType g(0,0);
@@ -504,6 +1037,75 @@ struct GraphAlgorithmTest{
             should(edgeVec[0]==e24);
 
         }
+        {
+            typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+            typedef GridGraph2d::Edge                         GridEdge;
+            typedef GridGraph2d::EdgeIt                       GridEdgeIt;
+
+            GridGraph2d g(Shape2(123, 97), IndirectNeighborhood);
+            GridGraph2d::EdgeMap<float> weights(g);
+            std::map<GridEdge, size_t>  order;
+            MersenneTwister random;
+            size_t c = 0;
+            for(GridEdgeIt e(g); e!=lemon::INVALID; ++e, ++c){
+                // many ties
+                weights[*e] = (float)random.uniformInt(50);
+                order[*e] = c;
+            }
+
+            for(int nThreads=1; nThreads<=4; nThreads+=3){
+                std::vector<GridEdge> edgeVec;
+                edgeSort(g, weights, std::less<float>(), edgeVec, ParallelOptions().numThreads(nThreads));
+                shouldEqual(edgeVec.size(), g.edgeNum());
+                for(size_t i=1; i<edgeVec.size(); ++i){
+                    should(weights[edgeVec[i-1]] <= weights[edgeVec[i]]);
+                    // ties are kept in iteration order
+                    if(weights[edgeVec[i-1]] == weights[edgeVec[i]])
+                        should(order[edgeVec[i-1]] < order[edgeVec[i]]);
+                }
+            }
+        }
+    }
+
+    void testFelzenszwalbParallel(){
+        typedef GridGraph<2, boost_graph::undirected_tag> GridGraph2d;
+        typedef GridGraph2d::EdgeIt                       GridEdgeIt;
+        typedef GridGraph2d::NodeIt                       GridNodeIt;
+
+        GridGraph2d g(Shape2(93, 71), DirectNeighborhood);
+        GridGraph2d::EdgeMap<float>  weights(g);
+        GridGraph2d::NodeMap<float>  nodeSizes(g);
+        std::fill(nodeSizes.begin(), nodeSizes.end(), 1.0f);
+
+        MersenneTwister random;
+        for(GridEdgeIt e(g); e!=lemon::INVALID; ++e)
+            weights[*e] = random.uniform();
+
+        GridGraph2d::NodeMap<UInt32> labels(g), parallelLabels(g), blockLabels(g);
+        felzenszwalbSegmentation(g, weights, nodeSizes, 2.0f, labels);
+        felzenszwalbSegmentation(g, weights, nodeSizes, 2.0f, parallelLabels, -1, ParallelOptions().numThreads(4));
+        should(labels == parallelLabels);
+
+        // a single block is equivalent to the global algorithm
+        felzenszwalbSegmentationBlockwise(g, weights, nodeSizes, 2.0f, blockLabels, Shape2(100, 100),
+                                          ParallelOptions().numThreads(4));
+        should(labels == blockLabels);
+
+        felzenszwalbSegmentationBlockwise(g, weights, nodeSizes, 2.0f, blockLabels, Shape2(20, 16),
+                                          ParallelOptions().numThreads(4));
+        // labels are dense and every region is connected
+        UInt32 maxLabel = *std::max_element(blockLabels.begin(), blockLabels.end());
+        UnionFindArray<UInt32> components(g.nodeNum());
+        for(GridEdgeIt e(g); e!=lemon::INVALID; ++e)
+            if(blockLabels[g.u(*e)] == blockLabels[g.v(*e)])
+                components.makeUnion(g.id(g.u(*e)), g.id(g.v(*e)));
+        std::set<UInt32> usedLabels, roots;
+        for(GridNodeIt n(g); n!=lemon::INVALID; ++n){
+            usedLabels.insert(blockLabels[*n]);
+            roots.insert(components.findIndex(g.id(*n)));
+        }
+        shouldEqual(usedLabels.size(), maxLabel + 1u);
+        shouldEqual(roots.size(), usedLabels.size());
     }
 
     void testEdgeWeightComputation()
@@ -555,8 +1157,16 @@ struct GraphAlgorithmTestSuite
     {   
         add( testCase( &GraphAlgorithmTest::testShortestPathAdjacencyListGraph));
         add( testCase( &GraphAlgorithmTest::testShortestPathGridGraph));
+        add( testCase( &GraphAlgorithmTest::testBidirectionalShortestPath));
+        add( testCase( &GraphAlgorithmTest::testImplicitEdgeMap));
         add( testCase( &GraphAlgorithmTest::testRegionAdjacencyGraph));
+        add( testCase( &GraphAlgorithmTest::testRegionAdjacencyGraphParallel));
+        add( testCase( &GraphAlgorithmTest::testCompressedAffiliatedEdges));
+        add( testCase( &GraphAlgorithmTest::testRagFeatures));
+        add( testCase( &GraphAlgorithmTest::testRagProjectBack));
+        add( testCase( &GraphAlgorithmTest::testHierarchicalClusteringFast));
         add( testCase( &GraphAlgorithmTest::testEdgeSort));
+        add( testCase( &GraphAlgorithmTest::testFelzenszwalbParallel));
         add( testCase( &GraphAlgorithmTest::testEdgeWeightComputation));
         add( testCase( &GraphAlgorithmTest::testShortestPathGridGraph2));
     }
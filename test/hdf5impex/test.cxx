@@ -1015,6 +1015,293 @@ public:
 
 
 
+    void testHDF5FileChunkCache()
+    {
+        std::string file_name( "testfile_HDF5File_chunk_cache.hdf5");
+
+        MultiArray<3, float> out_data(Shape3(40, 30, 20));
+        for(int i = 0; i < out_data.size(); ++i)
+            out_data[i] = i + 0.5f;
+
+        HDF5File file (file_name, HDF5File::New);
+        file.write("dataset", out_data, Shape3(16, 16, 8), 1);
+        file.write("group/other", out_data, Shape3(16, 16, 8), 1);
+
+        file.setChunkCache("dataset", 8*1024*1024, 0, 1.0);
+        file.setChunkCache("", 0);
+#ifdef VIGRA_HDF5_CHUNK_CACHE
+        {
+            HDF5Handle dataset = file.getDatasetHandle("dataset");
+            HDF5Handle dapl(H5Dget_access_plist(dataset), &H5Pclose, "");
+            size_t nslots = 0, nbytes = 0;
+            double w0 = 0.0;
+            H5Pget_chunk_cache(dapl, &nslots, &nbytes, &w0);
+            shouldEqual(nbytes, 8u*1024u*1024u);
+            should(nslots >= 521);
+            shouldEqual(w0, 1.0);
+
+            // the default applies to all other datasets
+            file.cd("group");
+            HDF5Handle other = file.getDatasetHandle("other");
+            HDF5Handle dapl2(H5Dget_access_plist(other), &H5Pclose, "");
+            H5Pget_chunk_cache(dapl2, &nslots, &nbytes, &w0);
+            shouldEqual(nbytes, 0u);
+            file.cd("/");
+        }
+#endif
+        // the settings don't change the data
+        MultiArray<3, float> in_data(Shape3(17, 13, 9));
+        file.readBlock("dataset", Shape3(5, 7, 3), in_data.shape(), in_data);
+        should(in_data == out_data.subarray(Shape3(5, 7, 3), Shape3(22, 20, 12)));
+        file.readBlock("/group/other", Shape3(5, 7, 3), in_data.shape(), in_data);
+        should(in_data == out_data.subarray(Shape3(5, 7, 3), Shape3(22, 20, 12)));
+
+        file.resetChunkCache("dataset");
+        file.resetChunkCache();
+        file.readBlock("dataset", Shape3(5, 7, 3), in_data.shape(), in_data);
+        should(in_data == out_data.subarray(Shape3(5, 7, 3), Shape3(22, 20, 12)));
+    }
+
+    void testHDF5FileDirectChunkIO()
+    {
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        std::string file_name( "testfile_HDF5File_direct_chunks.hdf5");
+
+        MultiArray<3, int> out_data(Shape3(20, 12, 10));
+        for(int i = 0; i < out_data.size(); ++i)
+            out_data[i] = i - 100;
+
+        HDF5File file (file_name, HDF5File::New);
+        file.createDataset<3, int>("raw", out_data.shape(), 7, Shape3(8, 4, 5));
+        file.write("compressed", out_data, Shape3(8, 4, 5), 6);
+        file.createDataset<3, int>("copy", out_data.shape(), 0, Shape3(8, 4, 5), 6);
+
+        HDF5HandleShared raw = file.getDatasetHandleShared("raw"),
+                         compressed = file.getDatasetHandleShared("compressed"),
+                         copy = file.getDatasetHandleShared("copy");
+
+        // unwritten chunks are empty
+        std::vector<char> data;
+        unsigned int filterMask = 1;
+        should(file.readChunkRaw(raw, Shape3(8, 4, 5), data, filterMask) >= 0);
+        shouldEqual(data.size(), 0u);
+
+        // write an uncompressed chunk directly
+        MultiArray<3, int> chunk(Shape3(8, 4, 5));
+        for(int i = 0; i < chunk.size(); ++i)
+            chunk[i] = 3*i;
+        should(file.writeChunkRaw(raw, Shape3(8, 4, 5), (char const *)chunk.data(),
+                                  chunk.size()*sizeof(int)) >= 0);
+        MultiArray<3, int> in_data(out_data.shape());
+        file.readBlock(raw, Shape3(), in_data.shape(), in_data);
+        should(in_data.subarray(Shape3(8, 4, 5), Shape3(16, 8, 10)) == chunk);
+        shouldEqual(in_data(0,0,0), 7);
+        shouldEqual(in_data(19,11,9), 7);
+
+        should(file.readChunkRaw(raw, Shape3(8, 4, 5), data, filterMask) >= 0);
+        shouldEqual(data.size(), chunk.size()*sizeof(int));
+        shouldEqual(filterMask, 0u);
+        should(std::equal(data.begin(), data.end(), (char const *)chunk.data()));
+
+        // copy compressed chunks (including the incomplete ones at the border)
+        // without decompressing them
+        for(int z = 0; z < 10; z += 5)
+            for(int y = 0; y < 12; y += 4)
+                for(int x = 0; x < 20; x += 8)
+                {
+                    should(file.readChunkRaw(compressed, Shape3(x, y, z), data, filterMask) >= 0);
+                    should(data.size() > 0);
+                    should(data.size() < 8*4*5*sizeof(int));
+                    should(file.writeChunkRaw(copy, Shape3(x, y, z), &data[0], data.size(), filterMask) >= 0);
+                }
+        file.readBlock(copy, Shape3(), in_data.shape(), in_data);
+        should(in_data == out_data);
+#endif
+    }
+
+    void testHDF5FileParallelBlocks()
+    {
+        std::string file_name( "testfile_HDF5File_parallel_blocks.hdf5");
+
+        MultiArray<3, float> out_data(Shape3(40, 30, 20));
+        for(int i = 0; i < out_data.size(); ++i)
+            out_data[i] = i + 0.5f;
+        MultiArray<2, TinyVector<int, 3> > out_vector(Shape2(35, 22));
+        for(int i = 0; i < out_vector.size(); ++i)
+            out_vector[i] = TinyVector<int, 3>(i, -i, 2*i);
+        ParallelOptions options = ParallelOptions().numThreads(4);
+
+        HDF5File file (file_name, HDF5File::New);
+        for(int compression = 0; compression <= 6; compression += 6)
+        {
+            file.createDataset<3, float>("data", out_data.shape(), 1.0f, Shape3(16, 16, 8), compression);
+            file.createDataset<2, TinyVector<int, 3> >("vector", out_vector.shape(), 0, Shape2(8, 8), compression);
+            HDF5HandleShared data = file.getDatasetHandleShared("data"),
+                             vector = file.getDatasetHandleShared("vector");
+
+            // partially covered chunks are merged with the fill value
+            MultiArray<3, float> block(Shape3(17, 13, 9));
+            for(int i = 0; i < block.size(); ++i)
+                block[i] = -i - 0.25f;
+            should(file.writeBlock(data, Shape3(5, 7, 3), block, options) >= 0);
+            MultiArray<3, float> expected(out_data.shape(), 1.0f);
+            expected.subarray(Shape3(5, 7, 3), Shape3(22, 20, 12)) = block;
+            MultiArray<3, float> in_data(out_data.shape());
+            file.readBlock(data, Shape3(), in_data.shape(), in_data);
+            should(in_data == expected);
+            in_data = 0.0f;
+            should(file.readBlock(data, Shape3(), in_data.shape(), in_data, options) >= 0);
+            should(in_data == expected);
+
+            // complete chunks and border chunks
+            should(file.writeBlock(data, Shape3(), out_data, options) >= 0);
+            file.readBlock(data, Shape3(), in_data.shape(), in_data);
+            should(in_data == out_data);
+
+            // partially covered chunks are merged with stored data
+            should(file.writeBlock(data, Shape3(23, 17, 11), block, options) >= 0);
+            expected = out_data;
+            expected.subarray(Shape3(23, 17, 11), Shape3(40, 30, 20)) = block;
+            file.readBlock(data, Shape3(), in_data.shape(), in_data);
+            should(in_data == expected);
+
+            // strided target
+            MultiArray<3, float> transposed(Shape3(20, 30, 40));
+            MultiArrayView<3, float, StridedArrayTag> view = transposed.transpose();
+            should(file.readBlock(data, Shape3(), view.shape(), view, options) >= 0);
+            should(view == expected);
+            MultiArray<3, float> in_block(Shape3(30, 21, 15));
+            should(file.readBlock(data, Shape3(3, 4, 5), in_block.shape(), in_block, options) >= 0);
+            should(in_block == expected.subarray(Shape3(3, 4, 5), Shape3(33, 25, 20)));
+
+            // multi-band data
+            should(file.writeBlock(vector, Shape2(), out_vector, options) >= 0);
+            MultiArray<2, TinyVector<int, 3> > in_vector(Shape2(30, 17));
+            should(file.readBlock(vector, Shape2(5, 5), in_vector.shape(), in_vector, options) >= 0);
+            should(in_vector == out_vector.subarray(Shape2(5, 5), Shape2(35, 22)));
+            file.readBlock(vector, Shape2(5, 5), in_vector.shape(), in_vector);
+            should(in_vector == out_vector.subarray(Shape2(5, 5), Shape2(35, 22)));
+
+            file.flushToDisk();
+        }
+    }
+
+    void testHDF5FileFastCompression()
+    {
+        std::string file_name( "testfile_HDF5File_fast_compression.hdf5");
+
+        MultiArray<3, float> out_data(Shape3(40, 30, 20));
+        for(int i = 0; i < out_data.size(); ++i)
+            out_data[i] = (i % 1000) * 0.5f;
+        MultiArray<2, TinyVector<UInt16, 3> > out_vector(Shape2(35, 22));
+        for(int i = 0; i < out_vector.size(); ++i)
+            out_vector[i] = TinyVector<UInt16, 3>(i, i % 10, 7);
+
+        int methods[] = { LZ4, LZ4 | HDF5File::Shuffle, ZLIB_FAST | HDF5File::Shuffle };
+        H5Z_filter_t expected[][2] = { { VIGRA_H5Z_FILTER_LZ4, -1 },
+                                       { H5Z_FILTER_SHUFFLE, VIGRA_H5Z_FILTER_LZ4 },
+                                       { H5Z_FILTER_SHUFFLE, H5Z_FILTER_DEFLATE } };
+        {
+            HDF5File file (file_name, HDF5File::New);
+            for(int k = 0; k < 3; ++k)
+            {
+                std::string name = std::string("data") + asString(k);
+                file.write(name, out_data, Shape3(16, 16, 8), methods[k]);
+                file.write(name + "vector", out_vector, Shape2(16, 16), methods[k]);
+                file.createDataset<3, float>(name + "block", out_data.shape(), 1.0f,
+                                             Shape3(16, 16, 8), methods[k]);
+                file.writeBlock(name + "block", Shape3(10, 10, 10), out_data.subarray(Shape3(), Shape3(30, 20, 10)));
+
+                HDF5Handle dataset = file.getDatasetHandle(name);
+                HDF5Handle plist(H5Dget_create_plist(dataset), &H5Pclose, "");
+                int filters = H5Pget_nfilters(plist);
+                shouldEqual(filters, expected[k][1] < 0 ? 1 : 2);
+                for(int f = 0; f < filters; ++f)
+                {
+                    unsigned int flags = 0, values[4];
+                    std::size_t nvalues = 4;
+                    char filter_name[64];
+                    shouldEqual(H5Pget_filter2(plist, f, &flags, &nvalues, values, 64, filter_name, 0),
+                                expected[k][f]);
+                }
+                should(H5Dget_storage_size(dataset) < out_data.size()*sizeof(float));
+            }
+        }
+
+        HDF5File file (file_name, HDF5File::OpenReadOnly);
+        for(int k = 0; k < 3; ++k)
+        {
+            std::string name = std::string("data") + asString(k);
+            MultiArray<3, float> in_data;
+            file.readAndResize(name, in_data);
+            should(in_data == out_data);
+
+            MultiArray<2, TinyVector<UInt16, 3> > in_vector;
+            file.readAndResize(name + "vector", in_vector);
+            should(in_vector == out_vector);
+
+            MultiArray<3, float> in_block(Shape3(20, 20, 20));
+            file.readBlock(name + "block", Shape3(10, 10, 0), in_block.shape(), in_block);
+            should(in_block.subarray(Shape3(0, 0, 10), Shape3(20, 20, 20)) ==
+                   out_data.subarray(Shape3(), Shape3(20, 20, 10)));
+            shouldEqual(in_block(0, 0, 0), 1.0f);
+        }
+
+        // the free functions can read LZ4 datasets as well
+        HDF5ImportInfo info(file_name.c_str(), "/data0");
+        MultiArray<3, float> in_data(out_data.shape());
+        shouldEqual(info.numDimensions(), 3);
+        readHDF5(info, in_data);
+        should(in_data == out_data);
+    }
+
+    void testHDF5FileCorruptLZ4Chunk()
+    {
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        std::string file_name( "testfile_HDF5File_corrupt_lz4.hdf5");
+
+        HDF5File file (file_name, HDF5File::New);
+        file.createDataset<3, float>("data", Shape3(16, 8, 8), 0.0f, Shape3(8, 8, 8), LZ4);
+        HDF5HandleShared dataset = file.getDatasetHandleShared("data");
+
+        // header: original size (8 bytes) and block size (4 bytes), big endian
+        const UInt32 chunkBytes = 8*8*8*sizeof(float);
+        std::vector<char> chunk(16, 0);
+        chunk[6] = (char)(chunkBytes >> 8);
+        chunk[7] = (char)(chunkBytes & 0xff);
+
+        // a block size of zero must be rejected instead of looping forever
+        should(file.writeChunkRaw(dataset, Shape3(0, 0, 0), &chunk[0], chunk.size()) >= 0);
+
+        // a block size larger than the remaining data must be rejected as well
+        chunk[10] = chunk[6];
+        chunk[11] = chunk[7];
+        chunk[14] = 0x7f;
+        should(file.writeChunkRaw(dataset, Shape3(8, 0, 0), &chunk[0], chunk.size()) >= 0);
+        file.flushToDisk();
+
+        H5E_BEGIN_TRY
+        {
+            for(int x = 0; x < 16; x += 8)
+            {
+                MultiArray<3, float> in_data(Shape3(8, 8, 8));
+                try
+                {
+                    file.readBlock("data", Shape3(x, 0, 0), in_data.shape(), in_data);
+                    failTest("no exception thrown");
+                }
+                catch(vigra::PostconditionViolation & c)
+                {
+                    std::string expected("\nPostcondition violation!\nHDF5File::readBlock(): read from dataset '/data' via H5Dread() failed.");
+                    std::string message(c.what());
+                    should(0 == expected.compare(message.substr(0,expected.size())));
+                }
+            }
+        }
+        H5E_END_TRY;
+#endif
+    }
+
     void testHDF5FileCompression()
     {
         //write some data and read it again. Only spot test general functionality.
@@ -1406,6 +1693,11 @@ struct HDF5ImportExportTestSuite : public vigra::test_suite
         add(testCase(&HDF5ExportImportTest::testHDF5FileBlockAccess));
         add(testCase(&HDF5ExportImportTest::testHDF5FileChunks));
         add(testCase(&HDF5ExportImportTest::testHDF5FileCompression));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileChunkCache));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileDirectChunkIO));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileParallelBlocks));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileFastCompression));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileCorruptLZ4Chunk));
         add(testCase(&HDF5ExportImportTest::testHDF5FileBrowsing));
         add(testCase(&HDF5ExportImportTest::testHDF5FileAttributes));
         add(testCase(&HDF5ExportImportTest::testHDF5FileTutorial));
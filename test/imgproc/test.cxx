@@ -42,6 +42,7 @@
 #include "vigra/stdimage.hxx"
 #include "vigra/stdimagefunctions.hxx"
 #include "vigra/splineimageview.hxx"
+#include "vigra/multi_splineview.hxx"
 #include "vigra/basicgeometry.hxx"
 #include "vigra/affinegeometry.hxx"
 #include "vigra/impex.hxx"
@@ -1570,7 +1571,7 @@ struct SplineImageViewTest
             view(2*view.width(), 0);
             failTest("Out-of-range coordinate failed to throw exception");
         }
-        catch(vigra::PreconditionViolation) {}
+        catch(vigra::PreconditionViolation &) {}
     }
 
     void testVectorSIV()
@@ -1581,6 +1582,88 @@ struct SplineImageViewTest
         (void)view(4.5, 1.3);
     }
 
+    void testSample()
+    {
+        SplineImageView<N, double> view(srcImageRange(img));
+        int w = view.width(), h = view.height();
+
+        // include points near the border and in the first reflection
+        MultiArray<1, TinyVector<double, 2> > coords(Shape1(1000));
+        for(int k = 0; k < coords.size(); ++k)
+            coords(k) = TinyVector<double, 2>((k * 0.37) - 0.3*w + 0.013, (k * 0.853) - 0.2*h + 0.013);
+        for(int k = 0; k < coords.size(); ++k)
+            coords(k) = TinyVector<double, 2>(coords(k)[0] - 1.5*w*std::floor(coords(k)[0] / (1.5*w)) - 0.3*w,
+                                              coords(k)[1] - 1.5*h*std::floor(coords(k)[1] / (1.5*h)) - 0.2*h);
+
+        MultiArray<1, double> res(coords.shape()), res4(coords.shape());
+        view.sample(coords, res, ParallelOptions().numThreads(1));
+        view.sample(coords, res4, ParallelOptions().numThreads(4));
+        for(int k = 0; k < coords.size(); ++k)
+        {
+            shouldEqualTolerance(res(k), view(coords(k)), 1e-12);
+            shouldEqual(res4(k), res(k));
+        }
+
+        // the N-dimensional view agrees with SplineImageView
+        MultiArrayView<2, double> a(Shape2(w, h), img.begin());
+        MultiSplineView<2, N, double> nview(a);
+        MultiArray<1, double> nres(coords.shape());
+        nview.sample(coords, nres);
+        for(int k = 0; k < coords.size(); ++k)
+        {
+            shouldEqualTolerance(nres(k), res(k), 1e-10);
+            shouldEqualTolerance(nview(coords(k)), res(k), 1e-10);
+            if(N > 1)
+                shouldEqualTolerance(nview(coords(k), Shape2(1, 1)),
+                                     view(coords(k), 1, 1), 1e-10);
+        }
+
+        try
+        {
+            coords(500) = TinyVector<double, 2>(2*w, 0.0);
+            view.sample(coords, res);
+            failTest("Out-of-range coordinate failed to throw exception");
+        }
+        catch(vigra::PreconditionViolation &) {}
+    }
+
+    void testVolumeView()
+    {
+        MultiArray<3, float> volume(Shape3(24, 19, 17));
+        for(int k = 0; k < volume.size(); ++k)
+            volume[k] = (float)((k * 7919) % 101);
+
+        MultiSplineView<3, N, float> view(volume);
+
+        // interpolating: grid points reproduce the data (up to the
+        // prefilter's border approximation, as in SplineImageView)
+        for(int k = 0; k < volume.size(); ++k)
+        {
+            TinyVector<double, 3> p(volume.scanOrderIndexToCoordinate(k));
+            should(std::abs(view(p) - volume[k]) < 1e-2);
+        }
+
+        // a separable volume is interpolated separately along each axis
+        MultiArray<3, double> separable(volume.shape());
+        Image plane(24, 19);
+        for(int k = 0; k < plane.width()*plane.height(); ++k)
+            plane.begin()[k] = volume[k];
+        for(int k = 0; k < separable.size(); ++k)
+            separable[k] = plane.begin()[k % (24*19)] * (1.0 + 0.5*(k / (24*19)));
+        MultiSplineView<3, N, double> sview(separable);
+        SplineImageView<N, double> pview(srcImageRange(plane));
+        MultiArray<1, TinyVector<double, 3> > coords(Shape1(200));
+        MultiArray<1, double> res(coords.shape());
+        for(int k = 0; k < coords.size(); ++k)
+            coords(k) = TinyVector<double, 3>(fmod(k*0.37, 23.0), fmod(k*0.53, 18.0), (double)(k % 17));
+        sview.sample(coords, res, ParallelOptions().numThreads(2));
+        for(int k = 0; k < coords.size(); ++k)
+        {
+            double expected = pview(coords(k)[0], coords(k)[1]) * (1.0 + 0.5*coords(k)[2]);
+            should(std::abs(res(k) - expected) < 1e-2);
+        }
+    }
+
 };
 
 struct GeometricTransformsTest
@@ -1627,7 +1710,7 @@ struct GeometricTransformsTest
             rotateImage(srcImageRange(img), destImage(res2), 22);
             failTest("rotateImage() failed to throw exception");
         }
-        catch(vigra::PreconditionViolation) {}
+        catch(vigra::PreconditionViolation &) {}
 
         transposeImage(srcImageRange(img), destImage(res2), vigra::major);
         transposeImage(View(img), View(res21), vigra::major);
@@ -1803,22 +1886,32 @@ struct ImageFunctionsTestSuite
         add( testCase( &SplineImageViewTest<0>::testCoefficientArray));
         add( testCase( &SplineImageViewTest<0>::testImageResize0));
         add( testCase( &SplineImageViewTest<0>::testOutside));
+        add( testCase( &SplineImageViewTest<0>::testSample));
+        add( testCase( &SplineImageViewTest<0>::testVolumeView));
         add( testCase( &SplineImageViewTest<1>::testPSF));
         add( testCase( &SplineImageViewTest<1>::testCoefficientArray));
         add( testCase( &SplineImageViewTest<1>::testImageResize1));
         add( testCase( &SplineImageViewTest<1>::testOutside));
+        add( testCase( &SplineImageViewTest<1>::testSample));
+        add( testCase( &SplineImageViewTest<1>::testVolumeView));
         add( testCase( &SplineImageViewTest<2>::testPSF));
         add( testCase( &SplineImageViewTest<2>::testCoefficientArray));
         add( testCase( &SplineImageViewTest<2>::testImageResize));
         add( testCase( &SplineImageViewTest<2>::testOutside));
+        add( testCase( &SplineImageViewTest<2>::testSample));
+        add( testCase( &SplineImageViewTest<2>::testVolumeView));
         add( testCase( &SplineImageViewTest<3>::testPSF));
         add( testCase( &SplineImageViewTest<3>::testCoefficientArray));
         add( testCase( &SplineImageViewTest<3>::testImageResize));
         add( testCase( &SplineImageViewTest<3>::testOutside));
+        add( testCase( &SplineImageViewTest<3>::testSample));
+        add( testCase( &SplineImageViewTest<3>::testVolumeView));
         add( testCase( &SplineImageViewTest<5>::testPSF));
         add( testCase( &SplineImageViewTest<5>::testCoefficientArray));
         add( testCase( &SplineImageViewTest<5>::testImageResize));
         add( testCase( &SplineImageViewTest<5>::testOutside));
+        add( testCase( &SplineImageViewTest<5>::testSample));
+        add( testCase( &SplineImageViewTest<5>::testVolumeView));
         add( testCase( &SplineImageViewTest<5>::testVectorSIV));
 
         add( testCase( &GeometricTransformsTest::testSimpleGeometry));
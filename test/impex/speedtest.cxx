@@ -0,0 +1,121 @@
+//We need to undefine NDEBUG so that we have TIC, TOC available!
+#undef NDEBUG
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <vigra/timing.hxx>
+USETICTOC;
+#include <vigra/multi_array.hxx>
+#include <vigra/multi_impex.hxx>
+#include <vigra/impex.hxx>
+#include <vigra/basicimage.hxx>
+
+using namespace vigra;
+
+// file name of slice z, following the numbering scheme of exportVolume()
+std::string sliceName(int z, int depth)
+{
+    std::ostringstream name;
+    name << "speed_slice" << std::setfill('0')
+         << std::setw((int)std::ceil(std::log10((double)depth))) << z << ".tif";
+    return name.str();
+}
+
+// read and write a 16-bit volume as a TIFF stack and as a multi-page TIFF,
+// comparing the per-pixel accessor path with direct decoding into
+// MultiArrayViews and with parallel slice I/O
+int main(int argc, char ** argv)
+{
+#if defined(HasTIFF)
+    typedef MultiArray<3, UInt16> Volume;
+
+    Shape3 shape(512, 512, 48);
+    int threads = argc > 1 ? atoi(argv[1]) : ParallelOptions::Auto;
+
+    Volume volume(shape);
+    for(int k = 0; k < volume.size(); ++k)
+        volume[k] = (UInt16)((k * 2654435761u) >> 16);
+
+    std::cerr << "Writing " << shape << " UInt16 TIFF stack:" << std::endl;
+    TIC;
+    exportVolume(volume, VolumeExportInfo("speed_slice", ".tif"));
+    TOC;
+    std::cerr << "Writing TIFF stack with " << threads << " threads:" << std::endl;
+    TIC;
+    exportVolume(volume, VolumeExportInfo("speed_slice", ".tif"), ParallelOptions().numThreads(threads));
+    TOC;
+    std::cerr << "Writing multi-page TIFF:" << std::endl;
+    TIC;
+    exportVolume(volume, VolumeExportInfo("speed_multipage.tif"));
+    TOC;
+    std::cerr << "Writing multi-page TIFF with " << threads << " threads:" << std::endl;
+    TIC;
+    exportVolume(volume, VolumeExportInfo("speed_multipage_par.tif"), ParallelOptions().numThreads(threads));
+    TOC;
+
+    int failures = 0;
+
+    std::cerr << "Reading TIFF stack slice by slice through BasicImage accessors:" << std::endl;
+    Volume res(shape);
+    TIC;
+    for(int z = 0; z < shape[2]; ++z)
+    {
+        BasicImage<UInt16> slice(shape[0], shape[1]);
+        importImage(ImageImportInfo(sliceName(z, shape[2]).c_str()), destImage(slice));
+        for(int y = 0; y < shape[1]; ++y)
+            for(int x = 0; x < shape[0]; ++x)
+                res(x, y, z) = slice(x, y);
+    }
+    TOC;
+    failures += (res != volume);
+
+    std::cerr << "Reading TIFF stack slice by slice into MultiArrayViews:" << std::endl;
+    res.init(0);
+    TIC;
+    for(int z = 0; z < shape[2]; ++z)
+    {
+        MultiArrayView<2, UInt16> slice = res.bindOuter(z);
+        importImage(ImageImportInfo(sliceName(z, shape[2]).c_str()), slice);
+    }
+    TOC;
+    failures += (res != volume);
+
+    std::cerr << "Reading TIFF stack with importVolume():" << std::endl;
+    res.init(0);
+    TIC;
+    importVolume(VolumeImportInfo("speed_slice", ".tif"), res);
+    TOC;
+    failures += (res != volume);
+
+    std::cerr << "Reading TIFF stack with " << threads << " threads:" << std::endl;
+    res.init(0);
+    TIC;
+    importVolume(VolumeImportInfo("speed_slice", ".tif"), res, ParallelOptions().numThreads(threads));
+    TOC;
+    failures += (res != volume);
+
+    std::cerr << "Reading multi-page TIFF:" << std::endl;
+    res.init(0);
+    TIC;
+    importVolume(VolumeImportInfo("speed_multipage.tif"), res);
+    TOC;
+    failures += (res != volume);
+
+    res.init(0);
+    importVolume(VolumeImportInfo("speed_multipage_par.tif"), res);
+    failures += (res != volume);
+
+    if(failures > 0)
+    {
+        std::cerr << failures << " read(s) returned wrong data." << std::endl;
+        return 1;
+    }
+#else
+    std::cerr << "TIFF support not available, nothing to measure." << std::endl;
+#endif
+    return 0;
+}
@@ -36,6 +36,8 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 #include "vigra/stdimage.hxx"
 #include "vigra/impex.hxx"
 #include "vigra/impexalpha.hxx"
@@ -48,6 +50,38 @@
 
 using namespace vigra;
 
+#if defined(HasTIFF)
+// write an 8-bit image as a tiled TIFF (vigra's encoder only writes strips)
+template <class T>
+void writeTiledTiff(MultiArrayView<2, T> const & img, int bands, const char * filename)
+{
+    const uint32 tw = 16, th = 16;
+    TIFF * tiff = TIFFOpen(filename, "w");
+    TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32)img.width());
+    TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32)img.height());
+    TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+    TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, bands);
+    TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, bands == 1 ? PHOTOMETRIC_MINISBLACK : PHOTOMETRIC_RGB);
+    TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tw);
+    TIFFSetField(tiff, TIFFTAG_TILELENGTH, th);
+
+    std::vector<UInt8> tile(tw*th*bands);
+    for(uint32 y0 = 0; y0 < (uint32)img.height(); y0 += th)
+    {
+        for(uint32 x0 = 0; x0 < (uint32)img.width(); x0 += tw)
+        {
+            std::fill(tile.begin(), tile.end(), 0);
+            for(uint32 y = y0; y < std::min(y0+th, (uint32)img.height()); ++y)
+                for(uint32 x = x0; x < std::min(x0+tw, (uint32)img.width()); ++x)
+                    std::memcpy(&tile[((y-y0)*tw + (x-x0))*bands], &img(x, y), bands);
+            TIFFWriteTile(tiff, &tile[0], x0, y0, 0, 0);
+        }
+    }
+    TIFFClose(tiff);
+}
+#endif
+
 template <class Image>
 void failCodec(Image const & img, ImageExportInfo const & info)
 {
@@ -178,6 +212,126 @@ public:
         shouldEqualSequence(img.begin(), img.end(), rgb.bindElementChannel(2).begin());
     }
 
+    template <class T>
+    void checkDirectImport(MultiArrayView<2, T> const & ref, const char * filename)
+    {
+        exportImage(ref, filename);
+
+        // fast path (type and layout match the file)
+        MultiArray<2, T> direct(ref.shape());
+        importImage(filename, direct);
+        should(direct == ref);
+
+        // accessor-based path
+        BasicImage<T> generic(ref.width(), ref.height());
+        importImage(vigra::ImageImportInfo(filename), destImage(generic));
+        shouldEqualSequence(generic.begin(), generic.end(), ref.begin());
+
+        // strided destinations fall back to the accessor-based path
+        MultiArray<2, T> transposed(ref.shape(1), ref.shape(0));
+        importImage(vigra::ImageImportInfo(filename), transposed.transpose());
+        should(transposed.transpose() == ref);
+
+        // partial reads
+        Rect2D roi(Point2D(0, 5), Size2D(ref.width(), 9));
+        MultiArray<2, T> part(Shape2(ref.width(), 9));
+        importImage(vigra::ImageImportInfo(filename), roi, part);
+        should(part == ref.subarray(Shape2(0, 5), Shape2(ref.width(), 14)));
+    }
+
+    void testDirectImport()
+    {
+        View full(Shape2(img.width(), img.height()), img.data());
+        MultiArray<2, UInt16> img16(full.shape());
+        MultiArray<2, RGBValue<UInt8> > rgb(full.shape());
+        for(int k = 0; k < full.size(); ++k)
+        {
+            img16[k] = full[k] * 257 - k % 3;
+            rgb[k] = RGBValue<UInt8>(full[k], 255 - full[k], k % 251);
+        }
+
+        checkDirectImport(full, "direct.pgm");
+        checkDirectImport(MultiArrayView<2, UInt16>(img16), "direct.pgm");
+        checkDirectImport(MultiArrayView<2, RGBValue<UInt8> >(rgb), "direct.ppm");
+#if defined(HasPNG)
+        checkDirectImport(full, "direct.png");
+        checkDirectImport(MultiArrayView<2, UInt16>(img16), "direct.png");
+        checkDirectImport(MultiArrayView<2, RGBValue<UInt8> >(rgb), "direct.png");
+#endif
+#if defined(HasTIFF)
+        checkDirectImport(full, "direct.tif");
+        checkDirectImport(MultiArrayView<2, UInt16>(img16), "direct.tif");
+        checkDirectImport(MultiArrayView<2, RGBValue<UInt8> >(rgb), "direct.tif");
+#endif
+    }
+
+    void testImportROI()
+    {
+        View full(Shape2(img.width(), img.height()), img.data());
+        Rect2D roi(Point2D(13, 7), Size2D(37, 29));
+        View ref = full.subarray(Shape2(13, 7), Shape2(50, 36));
+
+        // generic fallback (skipping rows in the decoder)
+        exportImage(srcImageRange(img), vigra::ImageExportInfo("roi.pgm"));
+        MultiArray<2, unsigned char> res(Shape2(37, 29));
+        importImage(vigra::ImageImportInfo("roi.pgm"), roi, res);
+        should(res == ref);
+
+        // ROI touching the bottom-right corner
+        Rect2D corner(Point2D(img.width()-5, img.height()-3), Size2D(5, 3));
+        MultiArray<2, unsigned char> res2(Shape2(5, 3));
+        importImage(vigra::ImageImportInfo("roi.pgm"), corner, res2);
+        should(res2 == full.subarray(Shape2(img.width()-5, img.height()-3), full.shape()));
+
+#if defined(HasTIFF)
+        // native support for stripped and tiled TIFF
+        exportImage(srcImageRange(img), vigra::ImageExportInfo("roi.tif"));
+        res.init(0);
+        importImage(vigra::ImageImportInfo("roi.tif"), roi, res);
+        should(res == ref);
+
+        // compressed strips must be decoded from their first row
+        exportImage(srcImageRange(img), vigra::ImageExportInfo("roi.tif").setCompression("LZW"));
+        res.init(0);
+        importImage(vigra::ImageImportInfo("roi.tif"), roi, res);
+        should(res == ref);
+
+        writeTiledTiff(full, 1, "roitiled.tif");
+        MultiArray<2, unsigned char> tiled(full.shape());
+        importImage("roitiled.tif", tiled);
+        should(tiled == full);
+
+        res.init(0);
+        importImage(vigra::ImageImportInfo("roitiled.tif"), roi, res);
+        should(res == ref);
+
+        res2.init(0);
+        importImage(vigra::ImageImportInfo("roitiled.tif"), corner, res2);
+        should(res2 == full.subarray(Shape2(img.width()-5, img.height()-3), full.shape()));
+
+        MultiArray<2, RGBValue<unsigned char> > rgb(full.shape());
+        for(int k = 0; k < rgb.size(); ++k)
+            rgb[k] = RGBValue<unsigned char>(full[k], 255 - full[k], k % 251);
+        writeTiledTiff(rgb, 3, "roitiled.tif");
+        MultiArray<2, RGBValue<unsigned char> > rgbres(Shape2(37, 29));
+        importImage(vigra::ImageImportInfo("roitiled.tif"), roi, rgbres);
+        should(rgbres == rgb.subarray(Shape2(13, 7), Shape2(50, 36)));
+#endif
+
+        try
+        {
+            // destination matches the ROI, so only the bounds check can fail
+            MultiArray<2, unsigned char> res3(Shape2(img.width(), img.height()));
+            importImage(vigra::ImageImportInfo("roi.pgm"), Rect2D(Point2D(1, 1), Size2D(img.width(), img.height())), res3);
+            failTest("no exception thrown");
+        }
+        catch(vigra::PreconditionViolation & e)
+        {
+            std::string message(e.what());
+            should(message.find("region of interest must be a non-empty rectangle inside the image") != std::string::npos);
+        }
+    }
+
     void testJPEG ()
     {
         vigra::ImageExportInfo exportinfo ("res.jpg");
@@ -1833,6 +1987,8 @@ struct ImageImportExportTestSuite : public vigra::test_suite
         add(testCase(&ByteImageExportImportTest::testVIFF1));
         add(testCase(&ByteImageExportImportTest::testVIFF2));
         add(testCase(&ByteImageExportImportTest::testGrayToRGB));
+        add(testCase(&ByteImageExportImportTest::testImportROI));
+        add(testCase(&ByteImageExportImportTest::testDirectImport));
         
         // rgb byte images
         add(testCase(&ByteRGBImageExportImportTest::testGIF));
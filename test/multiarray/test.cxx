@@ -38,11 +38,13 @@
 #include "vigra/multi_iterator_coupled.hxx"
 #include "vigra/multi_hierarchical_iterator.hxx"
 #include "vigra/multi_impex.hxx"
+#include "vigra/multi_array_chunked_tiff.hxx"
 #include "vigra/basicimageview.hxx"
 #include "vigra/navigator.hxx"
 #include "vigra/multi_pointoperators.hxx"
 #include "vigra/tensorutilities.hxx"
 #include "vigra/multi_tensorutilities.hxx"
+#include "vigra/eigensystem.hxx"
 #include "vigra/functorexpression.hxx"
 #include "vigra/multi_math.hxx"
 #include "vigra/algorithm.hxx"
@@ -1708,6 +1710,69 @@ struct MultiImpexTest
 #endif // _MSC_VER
     }
 
+    void testParallelImpex()
+    {
+#if defined(HasPNG)
+        const char * ext = ".png";
+#else
+        const char * ext = ".pnm";
+#endif
+        MultiArray<3, UInt16> data(Shape(17, 13, 23));
+        for(int k = 0; k < data.size(); ++k)
+            data[k] = (UInt16)(k * 37);
+
+        exportVolume(data, VolumeExportInfo("impex/partest", ext), ParallelOptions().numThreads(4));
+
+        VolumeImportInfo info("impex/partest", ext);
+        shouldEqual(info.shape(), data.shape());
+
+        MultiArray<3, UInt16> sequential(info.shape()), parallel(info.shape());
+        importVolume(info, sequential);
+        importVolume(info, parallel, ParallelOptions().numThreads(4));
+        should(sequential == data);
+        should(parallel == data);
+
+        // range mapping must be the same for all slices
+        MultiArray<3, float> fdata(data);
+        fdata *= 0.5f;
+        exportVolume(fdata, VolumeExportInfo("impex/partest_f", ext), ParallelOptions().numThreads(3));
+        exportVolume(fdata, VolumeExportInfo("impex/seqtest_f", ext));
+        MultiArray<3, UInt16> pres, sres;
+        importVolume(pres, std::string("impex/partest_f"), std::string(ext));
+        importVolume(sres, std::string("impex/seqtest_f"), std::string(ext));
+        should(pres == sres);
+
+#if defined(HasTIFF)
+        exportVolume(data, VolumeExportInfo("multipage_par.tif"), ParallelOptions().numThreads(4));
+        VolumeImportInfo minfo("multipage_par.tif");
+        MultiArray<3, UInt16> mresult(minfo.shape());
+        importVolume(minfo, mresult, ParallelOptions().numThreads(4));
+        should(mresult == data);
+
+        // pages are encoded concurrently, but must end up in order and
+        // with the range mapping of the entire volume
+        exportVolume(fdata, VolumeExportInfo("multipage_par_f.tif").setPixelType("UINT16"),
+                     ParallelOptions().numThreads(3));
+        exportVolume(fdata, VolumeExportInfo("multipage_seq_f.tif").setPixelType("UINT16"));
+        importVolume(pres, std::string("multipage_par_f.tif"));
+        importVolume(sres, std::string("multipage_seq_f.tif"));
+        shouldEqual(pres.shape(), fdata.shape());
+        should(pres == sres);
+
+        // extra samples and uncompressed pages
+        MultiArray<3, TinyVector<UInt8, 4> > rgba(Shape(9, 7, 11));
+        for(int k = 0; k < rgba.size(); ++k)
+            rgba[k] = TinyVector<UInt8, 4>(k % 256, (3*k) % 256, (7*k) % 256, k % 2 ? 255 : 0);
+        exportVolume(rgba, VolumeExportInfo("multipage_par_rgba.tif").setCompression("NONE"),
+                     ParallelOptions().numThreads(2));
+        VolumeImportInfo rgbainfo("multipage_par_rgba.tif");
+        shouldEqual(rgbainfo.numBands(), 4);
+        MultiArray<3, TinyVector<UInt8, 4> > rgbaresult(rgbainfo.shape());
+        importVolume(rgbainfo, rgbaresult);
+        should(rgbaresult == rgba);
+#endif
+    }
+
 #if defined(HasTIFF)
     void testMultipageTIFF()
     {
@@ -1723,6 +1788,31 @@ struct MultiImpexTest
         shouldEqual(result(0,1,2), 3);
         shouldEqual(result(0,1,3), 4);
     }
+
+    void testChunkedTIFF()
+    {
+        MultiArray<3, UInt16> data(Shape(37, 21, 11));
+        for(int k = 0; k < data.size(); ++k)
+            data[k] = (UInt16)(k * 7);
+        exportVolume(data, VolumeExportInfo("multipage_chunked.tif"));
+
+        ChunkedArrayTIFF<UInt16> chunked("multipage_chunked.tif", Shape(16, 8, 4),
+                                         ChunkedArrayOptions().cacheMax(3));
+        shouldEqual(chunked.shape(), data.shape());
+        should(chunked.isReadOnly());
+
+        // a region covering partial chunks and pages
+        Shape start(5, 3, 2), stop(30, 20, 9);
+        MultiArray<3, UInt16> roi(stop - start);
+        chunked.checkoutSubarray(start, roi);
+        should(roi == data.subarray(start, stop));
+
+        // the entire volume, evicting and decoding chunks again
+        MultiArray<3, UInt16> all(data.shape());
+        chunked.checkoutSubarray(Shape(0), all);
+        should(all == data);
+        shouldEqual(chunked.getItem(Shape(36, 20, 10)), data(36, 20, 10));
+    }
 #endif
 
 };
@@ -2456,6 +2546,100 @@ struct MultiArrayPointoperatorsTest
         tensorEigenvaluesMultiArray(tensor1, vector);
         shouldEqualSequenceTolerance(vector.begin(), vector.end(), rtensor.begin(), (TinyVector<double, 2>(1e-14)));
     }
+
+    template <int N>
+    void checkTensorEigensystem(MultiArrayView<N, TinyVector<double, N*(N+1)/2> > const & tensor)
+    {
+        using namespace vigra::linalg;
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        MultiArray<N, TinyVector<double, N> > ew(tensor.shape()), ewt(tensor.shape()), ewv(tensor.shape());
+        MultiArray<N, TinyVector<double, N*N> > ev(tensor.shape()), evt(tensor.shape());
+
+        tensorEigensystemMultiArray(tensor, ew, ev);
+        tensorEigensystemMultiArray(tensor, ewt, evt, ParallelOptions().numThreads(4));
+        tensorEigenvaluesMultiArray(tensor, ewv, ParallelOptions().numThreads(4));
+        shouldEqualSequence(ew.begin(), ew.end(), ewt.begin());
+        shouldEqualSequence(ev.begin(), ev.end(), evt.begin());
+        for(int k=0; k<tensor.size(); ++k)
+        {
+            Matrix<double> a(N, N), ewref(N, 1), evref(N, N);
+            for(int i=0, l=0; i<N; ++i)
+                for(int j=i; j<N; ++j, ++l)
+                    a(i,j) = a(j,i) = tensor[k][l];
+            symmetricEigensystem(a, ewref, evref);
+
+            // errors are measured relative to the largest eigenvalue, because
+            // relative tolerances are meaningless for results near zero
+            double scale = std::max(1.0, std::max(std::abs(ewref(0,0)), std::abs(ewref(N-1,0))));
+
+            for(int i=0; i<N; ++i)
+            {
+                should(std::abs(ew[k][i] - ewref(i,0)) < 1e-10*scale);
+                // the eigenvalue-only kernels lose up to half the digits for repeated eigenvalues
+                should(std::abs(ewv[k][i] - ewref(i,0)) < 1e-7*scale);
+
+                // check A*v == lambda*v, since eigenvectors of repeated eigenvalues are not unique
+                double len = 0.0;
+                for(int j=0; j<N; ++j)
+                    len += sq(ev[k][i*N+j]);
+                shouldEqualTolerance(len, 1.0, 1e-12);
+                double residual = 0.0;
+                for(int j=0; j<N; ++j)
+                {
+                    double av = 0.0;
+                    for(int m=0; m<N; ++m)
+                        av += a(j,m)*ev[k][i*N+m];
+                    residual += sq(av - ew[k][i]*ev[k][i*N+j]);
+                }
+                should(std::sqrt(residual) < 1e-12*scale);
+                if(i+1 < N && ewref(i,0) - ewref(i+1,0) > 1e-3 && (i == 0 || ewref(i-1,0) - ewref(i,0) > 1e-3))
+                {
+                    double d = 0.0;
+                    for(int j=0; j<N; ++j)
+                        d += ev[k][i*N+j]*evref(j,i);
+                    shouldEqualTolerance(std::abs(d), 1.0, 1e-8);
+                }
+            }
+        }
+
+        // strided views must give the same result
+        MultiArray<N, TinyVector<double, N> > ews(tensor.shape()*2);
+        MultiArrayView<N, TinyVector<double, N> > ewsv = ews.subarray(Shape(), tensor.shape()*2).stridearray(Shape(2));
+        tensorEigenvaluesMultiArray(tensor, ewsv, ParallelOptions().numThreads(2));
+        shouldEqualSequence(ewv.begin(), ewv.end(), ewsv.begin());
+    }
+
+    void testTensorEigensystem()
+    {
+        // use a local generator, so that the data don't depend on the other tests
+        RandomMT19937 random(42);
+
+        MultiArray<2, TinyVector<double, 3> > tensor2(Shape2(100, 90));
+        for(int k=0; k<tensor2.size(); ++k)
+            for(int l=0; l<3; ++l)
+                tensor2[k][l] = 2.0*random.uniform() - 1.0;
+        // degenerate and diagonal tensors
+        tensor2[0] = TinyVector<double, 3>(1.0, 0.0, 1.0);
+        tensor2[1] = TinyVector<double, 3>(0.0, 0.0, 0.0);
+        tensor2[2] = TinyVector<double, 3>(-1.0, 0.0, 2.0);
+        tensor2[3] = TinyVector<double, 3>(1.0, 1.0, 1.0);
+        checkTensorEigensystem<2>(tensor2);
+
+        MultiArray<3, TinyVector<double, 6> > tensor3(Shape3(20, 21, 22));
+        for(int k=0; k<tensor3.size(); ++k)
+            for(int l=0; l<6; ++l)
+                tensor3[k][l] = 2.0*random.uniform() - 1.0;
+        double special[6][6] = { {  1.0, 0.0, 0.0, 1.0, 0.0, 1.0 },
+                                 {  0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+                                 { -1.0, 0.0, 0.0, 3.0, 0.0, 2.0 },
+                                 {  1.0, 1.0, 1.0, 1.0, 1.0, 1.0 },
+                                 {  2.0, 1.0, 0.0, 2.0, 0.0, 3.0 },
+                                 {  2.0, 1.0, 0.0, 2.0, 0.0, 1.0 } };
+        for(int k=0; k<6; ++k)
+            tensor3[k] = TinyVector<double, 6>(special[k]);
+        checkTensorEigensystem<3>(tensor3);
+    }
 };
 
 class MultiMathTest
@@ -3077,8 +3261,10 @@ struct MultiArrayTestSuite
         add( testCase( &MultiArrayTest::test_expandElements ) );
 
         add( testCase( &MultiImpexTest::testImpex ) );
+        add( testCase( &MultiImpexTest::testParallelImpex ) );
 #if defined(HasTIFF)
         add( testCase( &MultiImpexTest::testMultipageTIFF ) );
+        add( testCase( &MultiImpexTest::testChunkedTIFF ) );
 #endif
     }
 };
@@ -3154,6 +3340,7 @@ struct MultiArrayPointOperatorsTestSuite
         add( testCase( &MultiArrayPointoperatorsTest::testInitMultiArrayBorder ) );
         add( testCase( &MultiArrayPointoperatorsTest::testInspect ) );
         add( testCase( &MultiArrayPointoperatorsTest::testTensorUtilities ) );
+        add( testCase( &MultiArrayPointoperatorsTest::testTensorEigensystem ) );
 
         add( testCase( &MultiMathTest::testSpeed ) );
         add( testCase( &MultiMathTest::testBasicArithmetic ) );
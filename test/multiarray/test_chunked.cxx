@@ -1512,6 +1512,135 @@ public:
     }
 };
 
+#ifdef HasHDF5
+struct ChunkedArrayHDF5Test
+{
+    typedef MultiArrayShape<3>::type Shape3;
+
+    void testDirectChunkIO()
+    {
+        MultiArray<3, float> data(Shape3(50, 40, 30));
+        for(int k=0; k<data.size(); ++k)
+            data[k] = k % 1000 + 0.25f;
+        MultiArray<3, float> block(Shape3(20, 20, 20), 1.5f);
+
+        // 0: uncompressed, 5: compressed, 10: chunks don't match the array's chunks
+        for(int mode=0; mode<=10; mode += 5)
+        {
+            Shape3 fileChunks = mode == 10 ? Shape3(10) : Shape3(16);
+            {
+                HDF5File file("chunked_direct.h5", HDF5File::New);
+                file.write("data", data, fileChunks, mode == 0 ? 0 : 5);
+            }
+            {
+                HDF5File file("chunked_direct.h5", HDF5File::Open);
+                ChunkedArrayHDF5<3, float> array(file, "data", HDF5File::ReadWrite);
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+                shouldEqual(array.direct_chunk_io_, mode != 10);
+#endif
+                shouldEqual(array.shape(), data.shape());
+
+                MultiArray<3, float> checkout(data.shape());
+                array.checkoutSubarray(Shape3(), checkout);
+                should(checkout == data);
+
+                // change some complete and some border chunks
+                array.commitSubarray(Shape3(30, 20, 10), block);
+                array.close();
+            }
+            MultiArray<3, float> expected(data);
+            expected.subarray(Shape3(30, 20, 10), Shape3(50, 40, 30)) = block;
+
+            HDF5File file("chunked_direct.h5", HDF5File::OpenReadOnly);
+            MultiArray<3, float> result(data.shape());
+            file.read("data", result);
+            should(result == expected);
+        }
+    }
+
+    void testLZ4Compression()
+    {
+        MultiArray<3, float> data(Shape3(50, 40, 30));
+        for(int k=0; k<data.size(); ++k)
+            data[k] = k % 1000 + 0.25f;
+        {
+            HDF5File file("chunked_lz4.h5", HDF5File::New);
+            ChunkedArrayHDF5<3, float> array(file, "data", HDF5File::New, data.shape(), Shape3(16),
+                                             ChunkedArrayOptions().compression(LZ4));
+            array.commitSubarray(Shape3(), data);
+            array.close();
+        }
+        HDF5File file("chunked_lz4.h5", HDF5File::OpenReadOnly);
+        {
+            HDF5Handle dataset = file.getDatasetHandle("data");
+            HDF5Handle plist(H5Dget_create_plist(dataset), &H5Pclose, "");
+            shouldEqual(H5Pget_nfilters(plist), 2);
+            should(H5Dget_storage_size(dataset) < data.size()*sizeof(float));
+        }
+        MultiArray<3, float> result;
+        file.readAndResize("data", result);
+        should(result == data);
+
+        ChunkedArrayHDF5<3, float> array(file, "data");
+        MultiArray<3, float> checkout(data.shape());
+        array.checkoutSubarray(Shape3(), checkout);
+        should(checkout == data);
+    }
+
+    void testParallelSubarray()
+    {
+        MultiArray<3, float> data(Shape3(50, 40, 30));
+        for(int k=0; k<data.size(); ++k)
+            data[k] = k % 1000 + 0.25f;
+        MultiArray<3, float> block(Shape3(30, 20, 20));
+        for(int k=0; k<block.size(); ++k)
+            block[k] = -(k % 100) - 0.5f;
+        ParallelOptions options = ParallelOptions().numThreads(4);
+
+        for(int compression=0; compression<2; ++compression)
+        {
+            HDF5File file("chunked_parallel.h5", HDF5File::New);
+            ChunkedArrayOptions chunkedOptions = ChunkedArrayOptions().fillValue(2.0);
+            chunkedOptions.compression(compression ? ZLIB_FAST : ZLIB_NONE);
+            ChunkedArrayHDF5<3, float> array(file, "data", HDF5File::New,
+                                             data.shape(), Shape3(16), chunkedOptions);
+
+            // chunks that are not in the block keep the fill value
+            array.commitSubarray(Shape3(5, 7, 3), block, options);
+            MultiArray<3, float> expected(data.shape(), 2.0f);
+            expected.subarray(Shape3(5, 7, 3), Shape3(35, 27, 23)) = block;
+            MultiArray<3, float> result(data.shape());
+            array.checkoutSubarray(Shape3(), result);
+            should(result == expected);
+            shouldEqual(array.getItem(Shape3(0)), 2.0f);
+            shouldEqual(array.getItem(Shape3(49, 39, 29)), 2.0f);
+
+            array.commitSubarray(Shape3(), data, options);
+            array.checkoutSubarray(Shape3(), result, options);
+            should(result == data);
+
+            // chunks in memory are newer than the file
+            array.setItem(Shape3(1, 2, 3), 42.0f);
+            array.setItem(Shape3(49, 39, 29), 43.0f);
+            expected = data;
+            expected(1, 2, 3) = 42.0f;
+            expected(49, 39, 29) = 43.0f;
+            MultiArray<3, float> roi(Shape3(48, 37, 26));
+            array.checkoutSubarray(Shape3(1, 2, 3), roi, options);
+            should(roi == expected.subarray(Shape3(1, 2, 3), Shape3(49, 39, 29)));
+
+            // partially covered chunks, including border chunks and chunks in memory
+            array.commitSubarray(Shape3(19, 19, 9), block, options);
+            expected.subarray(Shape3(19, 19, 9), Shape3(49, 39, 29)) = block;
+            array.checkoutSubarray(Shape3(), result);
+            should(result == expected);
+            array.checkoutSubarray(Shape3(), result, options);
+            should(result == expected);
+        }
+    }
+};
+#endif
+
 struct ChunkedMultiArrayTestSuite
 : public vigra::test_suite
 {
@@ -1575,6 +1704,9 @@ struct ChunkedMultiArrayTestSuite
         testImpl<ChunkedArrayTmpFile<3, TinyVector<float, 3> > >();
 #ifdef HasHDF5
         testImpl<ChunkedArrayHDF5<3, TinyVector<float, 3> > >();
+        add( testCase( &ChunkedArrayHDF5Test::testDirectChunkIO ) );
+        add( testCase( &ChunkedArrayHDF5Test::testParallelSubarray ) );
+        add( testCase( &ChunkedArrayHDF5Test::testLZ4Compression ) );
 #endif
 
         testSpeedImpl<unsigned char>();
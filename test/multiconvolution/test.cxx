@@ -59,6 +59,7 @@
 #include "vigra/stdimage.hxx"
 #include "vigra/multi_resize.hxx"
 #include "vigra/separableconvolution.hxx"
+#include "vigra/recursiveconvolution.hxx"
 #include "vigra/bordertreatment.hxx"
 
 using namespace vigra;
@@ -530,6 +531,119 @@ struct MultiArraySeparableConvolutionTest
         shouldEqualSequenceTolerance(st1.data(), st1.data()+size, rst.data(), epsilon);
     }
 
+    void test_resizeParallel()
+    {
+        MultiArray<3, double> src(Shape3(23, 17, 9));
+        makeRandom(src);
+
+        // enlarge, shrink, and exactly double the axes
+        Shape3 shapes[] = { Shape3(40, 11, 5), Shape3(45, 33, 17), Shape3(12, 30, 4) };
+        for(int k = 0; k < 3; ++k)
+        {
+            MultiArray<3, double> ref(shapes[k]), res(shapes[k]);
+            resizeMultiArraySplineInterpolation(src, ref, BSpline<3, double>());
+
+            resizeMultiArraySplineInterpolation(src, res, BSpline<3, double>(),
+                                                ParallelOptions().numThreads(1));
+            shouldEqualSequenceTolerance(res.begin(), res.end(), ref.begin(), 1e-10);
+
+            res.init(0.0);
+            resizeMultiArraySplineInterpolation(src, res, BSpline<5, double>(),
+                                                ParallelOptions().numThreads(4));
+            resizeMultiArraySplineInterpolation(src, ref, BSpline<5, double>());
+            shouldEqualSequenceTolerance(res.begin(), res.end(), ref.begin(), 1e-10);
+        }
+
+        MultiArray<3, float> fsrc(src), fref(shapes[0]), fres(shapes[0]);
+        resizeMultiArraySplineInterpolation(fsrc, fref, BSpline<3, double>());
+        resizeMultiArraySplineInterpolation(fsrc, fres, BSpline<3, double>(),
+                                            ParallelOptions().numThreads(2));
+        float maxDiff = 0.0f;
+        for(int k = 0; k < fres.size(); ++k)
+            maxDiff = std::max(maxDiff, std::abs(fres[k] - fref[k]));
+        should(maxDiff < 1e-5f);
+
+        // axes of unchanged size are not resampled (the sequential version
+        // only reproduces them up to the prefilter's border approximation)
+        MultiArray<3, double> ref(Shape3(40, 17, 9)), res(Shape3(40, 17, 9));
+        resizeMultiArraySplineInterpolation(src, ref, BSpline<3, double>());
+        resizeMultiArraySplineInterpolation(src, res, BSpline<3, double>(), ParallelOptions());
+        double maxDiff2 = 0.0;
+        for(int k = 0; k < res.size(); ++k)
+            maxDiff2 = std::max(maxDiff2, std::abs(res[k] - ref[k]));
+        should(maxDiff2 < 1e-4);
+
+        MultiArray<3, double> same(src.shape());
+        resizeMultiArraySplineInterpolation(src, same, BSpline<3, double>(), ParallelOptions());
+        should(same == src);
+    }
+
+    void test_recursiveGaussian()
+    {
+        // same result as the line filter along every axis
+        MultiArray<2, double> img(Shape2(50, 37)), tmp(img.shape()), ref(img.shape()), res(img.shape());
+        makeRandom(img);
+        recursiveGaussianFilterX(img, tmp, 3.0);
+        recursiveGaussianFilterY(tmp, ref, 3.0);
+        recursiveGaussianMultiArray(img, res, 3.0, ParallelOptions().numThreads(3));
+        shouldEqualSequenceTolerance(res.begin(), res.end(), ref.begin(), 1e-12);
+
+        MultiArray<3, float> vol(Shape3(30, 40, 20)), r1(vol.shape()), r2(vol.shape());
+        makeRandom(vol);
+        recursiveGaussianMultiArray(vol, r1, TinyVector<double, 3>(2.0, 5.0, 1.5));
+        recursiveGaussianMultiArray(vol, r2, TinyVector<double, 3>(2.0, 5.0, 1.5),
+                                    TinyVector<int, 3>(), ParallelOptions().numThreads(4));
+        should(r1 == r2);
+
+        // in-place operation
+        r2 = vol;
+        recursiveGaussianMultiArray(r2, r2, TinyVector<double, 3>(2.0, 5.0, 1.5));
+        should(r1 == r2);
+
+        // zero scale leaves an axis unfiltered
+        MultiArray<2, double> rx(img.shape());
+        recursiveGaussianMultiArray(img, rx, TinyVector<double, 2>(3.0, 0.0));
+        shouldEqualSequenceTolerance(rx.begin(), rx.end(), tmp.begin(), 1e-12);
+
+        // derivatives of a linear and a quadratic function in the interior
+        MultiArray<3, double> ramp(Shape3(40, 50, 30)), d(ramp.shape());
+        for(int z = 0; z < 30; ++z)
+            for(int y = 0; y < 50; ++y)
+                for(int x = 0; x < 40; ++x)
+                    ramp(x, y, z) = 2.0*y + 0.5*sq(z);
+        recursiveGaussianMultiArray(ramp, d, TinyVector<double, 3>(2.0), TinyVector<int, 3>(0, 1, 0));
+        shouldEqualTolerance(d(20, 25, 15), 2.0, 1e-6);
+        recursiveGaussianMultiArray(ramp, d, TinyVector<double, 3>(2.0), TinyVector<int, 3>(0, 0, 2));
+        shouldEqualTolerance(d(20, 25, 15), 1.0, 1e-3);
+        recursiveGaussianMultiArray(ramp, d, TinyVector<double, 3>(2.0), TinyVector<int, 3>(1, 0, 0));
+        shouldEqualTolerance(d(20, 25, 15), 0.0, 1e-6);
+
+        // the gradient consists of the first derivatives
+        MultiArray<3, TinyVector<double, 3> > grad(ramp.shape());
+        MultiArray<3, double> random(ramp.shape());
+        makeRandom(random);
+        recursiveGaussianGradientMultiArray(random, grad, 2.5, ParallelOptions().numThreads(2));
+        for(int k = 0; k < 3; ++k)
+        {
+            TinyVector<int, 3> order;
+            order[k] = 1;
+            recursiveGaussianMultiArray(random, d, TinyVector<double, 3>(2.5), order);
+            should(grad.bindElementChannel(k) == d);
+        }
+
+        // approximates the FIR Gaussian
+        MultiArray<3, double> fir(ramp.shape());
+        recursiveGaussianMultiArray(random, d, 4.0);
+        gaussianSmoothMultiArray(random, fir, 4.0);
+        double maxDiff = 0.0, range = 0.0;
+        for(int k = 0; k < d.size(); ++k)
+        {
+            maxDiff = std::max(maxDiff, std::abs(d[k] - fir[k]));
+            range = std::max(range, std::abs(fir[k]));
+        }
+        should(maxDiff < 0.05*range);
+    }
+
     //--------------------------------------------
 
     const Size3 shape;
@@ -598,6 +712,8 @@ struct MultiArraySeparableConvolutionTestSuite
                 add( testCase( &MultiArraySeparableConvolutionTest::test_hessian ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_structureTensor ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_gradient_magnitude ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_resizeParallel ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_recursiveGaussian ) );
     }
 }; // struct MultiArraySeparableConvolutionTestSuite
 
@@ -44,6 +44,7 @@
 #include <vigra/eccentricitytransform.hxx>
 #include <vigra/impex.hxx>
 #include <vigra/vector_distance.hxx>
+#include <vigra/blockwise_distance.hxx>
 #include <vigra/skeleton.hxx>
 #include <vigra/timing.hxx>
 
@@ -362,6 +363,116 @@ struct MultiDistanceTest
         separableMultiDistance(img2, res, true);
         shouldEqualSequence(res.begin(), res.end(), desired);
     }
+
+    template <class Array>
+    static void makeSparseMask(Array & mask)
+    {
+        typename Array::iterator i = mask.begin();
+        for(; i.isValid(); ++i)
+            *i = (dot(i.point(), typename Array::difference_type(7, 13, 17)) % 53 == 0) ? 1 : 0;
+    }
+
+    void testDistanceParallel()
+    {
+        typedef MultiArray<3, unsigned char> MaskVolume;
+        MaskVolume mask(Shape3(37, 29, 23));
+        makeSparseMask(mask);
+        TinyVector<double, 3> unitPitch(1.0), pixelPitch(1.2, 1.0, 2.4);
+        ParallelOptions options = ParallelOptions().numThreads(4);
+
+        for(int background = 0; background < 2; ++background)
+        {
+            IntVolume ires(mask.shape()), iref(mask.shape());
+            separableMultiDistSquared(mask, iref, background == 1);
+            separableMultiDistSquared(mask, ires, background == 1, unitPitch, options);
+            should(ires == iref);
+
+            // real-valued pitch requires a temporary array
+            separableMultiDistSquared(mask, iref, background == 1, pixelPitch);
+            separableMultiDistSquared(mask, ires, background == 1, pixelPitch, options);
+            should(ires == iref);
+
+            DoubleVolume res(mask.shape()), ref(mask.shape());
+            separableMultiDistance(mask, ref, background == 1, pixelPitch);
+            separableMultiDistance(mask, res, background == 1, pixelPitch,
+                                   BlockwiseOptions().numThreads(3));
+            should(res == ref);
+
+            MultiArray<3, float> fres(mask.shape()), fref(mask.shape());
+            separableMultiDistance(mask, fref, background == 1, unitPitch);
+            separableMultiDistance(mask, fres, background == 1, unitPitch, ParallelOptions().numThreads(0));
+            should(fres == fref);
+
+            DoubleVecVolume vres(mask.shape()), vref(mask.shape());
+            separableVectorDistance(mask, vref, background == 1, pixelPitch);
+            separableVectorDistance(mask, vres, background == 1, pixelPitch, options);
+            should(vres == vref);
+        }
+
+        // in-place operation on a strided view
+        DoubleVolume ref(mask.shape()), res(mask.shape());
+        separableMultiDistance(mask, ref, true);
+        res = mask;
+        separableMultiDistance(res.transpose(), res.transpose(), true, unitPitch, options);
+        should(res == ref);
+
+        // 1D
+        MultiArray<1, double> line(Shape1(7)), lres(Shape1(7));
+        line[3] = 1.0;
+        static const double desired[] = {3, 2, 1, 0, 1, 2, 3};
+        separableMultiDistance(line, lres, true, TinyVector<double, 1>(1.0), options);
+        shouldEqualSequence(lres.begin(), lres.end(), desired);
+    }
+
+    void testDistanceChunked()
+    {
+        typedef MultiArray<3, unsigned char> MaskVolume;
+        MaskVolume mask(Shape3(37, 29, 23));
+        makeSparseMask(mask);
+        TinyVector<double, 3> unitPitch(1.0), pixelPitch(1.2, 1.0, 2.4);
+
+        ChunkedArrayLazy<3, unsigned char> cmask(mask.shape(), Shape3(8));
+        cmask.commitSubarray(Shape3(), mask);
+
+        {
+            IntVolume ref(mask.shape()), res(mask.shape());
+            separableMultiDistSquared(mask, ref, true);
+            ChunkedArrayLazy<3, int> cres(mask.shape(), Shape3(8));
+            separableMultiDistSquared(cmask, cres, true, unitPitch, BlockwiseOptions().numThreads(4));
+            cres.checkoutSubarray(Shape3(), res);
+            should(res == ref);
+
+            // intermediate results don't fit into 'int'
+            try
+            {
+                separableMultiDistSquared(cmask, cres, true, pixelPitch);
+                failTest("no exception thrown");
+            }
+            catch(PreconditionViolation & e)
+            {
+                std::string expected("\nPrecondition violation!\nseparableMultiDistSquared(): destination type cannot hold");
+                std::string message(e.what());
+                should(0 == expected.compare(message.substr(0, expected.size())));
+            }
+        }
+        {
+            MultiArray<3, float> ref(mask.shape()), res(mask.shape());
+            separableMultiDistance(mask, ref, false, pixelPitch);
+            ChunkedArrayCompressed<3, float> cres(mask.shape(), Shape3(16));
+            separableMultiDistance(cmask, cres, false, pixelPitch,
+                                   BlockwiseOptions().numThreads(2).blockShape(Shape3(5, 7, 3)));
+            cres.checkoutSubarray(Shape3(), res);
+            should(res == ref);
+        }
+        {
+            DoubleVecVolume ref(mask.shape()), res(mask.shape());
+            separableVectorDistance(mask, ref, true, pixelPitch);
+            ChunkedArrayLazy<3, TinyVector<double, 3> > cres(mask.shape(), Shape3(8));
+            separableVectorDistance(cmask, cres, true, pixelPitch, BlockwiseOptions().numThreads(3));
+            cres.checkoutSubarray(Shape3(), res);
+            should(res == ref);
+        }
+    }
 };
 
 struct BoundaryMultiDistanceTest
@@ -863,6 +974,8 @@ struct DistanceTransformTestSuite
         add( testCase( &MultiDistanceTest::testDistanceVolumesAnisotropic));
         add( testCase( &MultiDistanceTest::distanceTransform2DCompare));
         add( testCase( &MultiDistanceTest::distanceTest1D));
+        add( testCase( &MultiDistanceTest::testDistanceParallel));
+        add( testCase( &MultiDistanceTest::testDistanceChunked));
         add( testCase( &BoundaryMultiDistanceTest::distanceTest1D));
         add( testCase( &BoundaryMultiDistanceTest::testDistanceVolumes));
         add( testCase( &BoundaryMultiDistanceTest::vectorDistanceTest1D));
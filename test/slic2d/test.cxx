@@ -120,6 +120,35 @@ struct SlicTest
 
         should(labels == labels_ref);
     }
+
+    void test_slic_threads()
+    {
+        // tile the image such that multi-threaded runs compute the cluster statistics
+        // in several slabs, whereas sequential runs use the single-slab algorithm
+        Shape tiles(3, 4);
+        FRGBArray image(lennaImage.shape()*tiles);
+        MultiCoordinateIterator<N> tile(tiles), end = tile.getEndIterator();
+        for(; tile != end; ++tile)
+            image.subarray(lennaImage.shape()*(*tile), lennaImage.shape()*(*tile+Shape(1))) = lennaImage;
+
+        // the default is sequential execution
+        shouldEqual(SlicOptions().getNumThreads(), (int)ParallelOptions::NoThreads);
+
+        int seedDistance = 8;
+        IArray labels_ref(image.shape());
+        int maxlabel_ref = slicSuperpixels(image, labels_ref, 20.0, seedDistance,
+                                           SlicOptions().iterations(10).numThreads(ParallelOptions::NoThreads));
+
+        int threads[] = { 1, 2, 4 };
+        for(int k=0; k<3; ++k)
+        {
+            IArray labels(image.shape());
+            int maxlabel = slicSuperpixels(image, labels, 20.0, seedDistance,
+                                           SlicOptions().iterations(10).numThreads(threads[k]));
+            shouldEqual(maxlabel, maxlabel_ref);
+            should(labels == labels_ref);
+        }
+    }
 };
 
 
@@ -131,6 +160,7 @@ struct Slic2dTestSuite
     {
         add( testCase( &SlicTest<2>::test_seeding));
         add( testCase( &SlicTest<2>::test_slic));
+        add( testCase( &SlicTest<2>::test_slic_threads));
     }
 };
 
@@ -21,6 +21,7 @@
 #include <vigra/multi_gridgraph.hxx>
 #include <vigra/error.hxx>
 #include <vigra/graph_rag_project_back.hxx>
+#include <vigra/graph_rag_features.hxx>
 #include <vigra/threadpool.hxx>
 
 #include <vigra/accumulator.hxx>
@@ -446,55 +447,8 @@ public:
         typename PyEdgeMapTraits<Graph   ,T >::Map edgeSizesArrayMap(graph,edgeSizesArray);
         typename PyEdgeMapTraits<RagGraph,T >::Map ragEdgeFeaturesArrayMap(rag,ragEdgeFeaturesArray);
 
-
-        if(accumulator == std::string("mean") ){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                float weightSum=0.0;
-                for(size_t i=0;i<affEdges.size();++i){
-                    const float weight = edgeSizesArrayMap[affEdges[i]];
-                    ragEdgeFeaturesArrayMap[ragEdge]+=weight*edgeFeaturesArrayMap[affEdges[i]];
-                    weightSum+=weight;
-                }
-
-                ragEdgeFeaturesArrayMap[ragEdge]/=weightSum;
-            }
-        }
-        else if( accumulator == std::string("sum")){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                for(size_t i=0;i<affEdges.size();++i){
-                    ragEdgeFeaturesArrayMap[ragEdge]+=edgeFeaturesArrayMap[affEdges[i]];
-                }
-            }
-        }
-        else if(accumulator == std::string("min")){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                float minVal=std::numeric_limits<float>::infinity();
-                for(size_t i=0;i<affEdges.size();++i){
-                    minVal  = std::min(minVal,edgeFeaturesArrayMap[affEdges[i]]);
-                }
-                ragEdgeFeaturesArrayMap[ragEdge]=minVal;
-            }
-        }
-        else if(accumulator == std::string("max")){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                float maxVal=-1.0*std::numeric_limits<float>::infinity();
-                for(size_t i=0;i<affEdges.size();++i){
-                    maxVal  = std::max(maxVal,edgeFeaturesArrayMap[affEdges[i]]);
-                }
-                ragEdgeFeaturesArrayMap[ragEdge]=maxVal;
-            }
-        }
-        else{
-            throw std::runtime_error("not supported accumulator");
-        }
+        ragEdgeFeatures(rag, affiliatedEdges, edgeFeaturesArrayMap, edgeSizesArrayMap,
+                        accumulator, ragEdgeFeaturesArrayMap);
 
         return ragEdgeFeaturesArray;
     }
@@ -544,35 +498,8 @@ public:
         typename PyEdgeMapTraits<Graph   ,float >::Map edgeSizesArrayMap(graph,edgeSizesArray);
         typename PyEdgeMapTraits<RagGraph,T >::Map ragEdgeFeaturesArrayMap(rag,ragEdgeFeaturesArray);
 
-        //typedef typename PyEdgeMapTraits<Graph,float >::Array::value_type ValType;
-
-        if(accumulator == std::string("mean") ){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                float weightSum=0.0;
-                for(size_t i=0;i<affEdges.size();++i){
-                    const float weight = edgeSizesArrayMap[affEdges[i]];
-                    vigra::MultiArray<1,float> val = edgeFeaturesArrayMap[affEdges[i]];
-                    val*=weight;
-                    ragEdgeFeaturesArrayMap[ragEdge]+=val;
-                    weightSum+=weight;
-                }
-                ragEdgeFeaturesArrayMap[ragEdge]/=weightSum;
-            }
-        }
-        else if( accumulator == std::string("sum")){
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                for(size_t i=0;i<affEdges.size();++i){
-                    ragEdgeFeaturesArrayMap[ragEdge]+=edgeFeaturesArrayMap[affEdges[i]];
-                }
-            }
-        }
-        else{
-            throw std::runtime_error("not supported accumulator");
-        }
+        ragEdgeFeatures(rag, affiliatedEdges, edgeFeaturesArrayMap, edgeSizesArrayMap,
+                        accumulator, ragEdgeFeaturesArrayMap);
 
         return ragEdgeFeaturesArray;
     }
@@ -593,47 +520,12 @@ public:
 
         // resize out
         ragEdgeFeaturesArray.reshapeIfEmpty(TaggedGraphShape<RagGraph>::taggedEdgeMapShape(rag));
-        
-
+        std::fill(ragEdgeFeaturesArray.begin(),ragEdgeFeaturesArray.end(),0.0f);
 
         // numpy arrays => lemon maps
         typename PyEdgeMapTraits<RagGraph,T >::Map ragEdgeFeaturesArrayMap(rag,ragEdgeFeaturesArray);
 
-
-        if(accumulator == std::string("mean") || accumulator == std::string("sum") ){
-            std::fill(ragEdgeFeaturesArray.begin(),ragEdgeFeaturesArray.end(),0.0f);
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                for(size_t i=0;i<affEdges.size();++i){
-                    ragEdgeFeaturesArrayMap[ragEdge]+=otfEdgeMap[affEdges[i]];
-                }
-                if(accumulator == std::string("mean")){
-                    ragEdgeFeaturesArrayMap[ragEdge]/=affEdges.size();
-                }
-            }
-        }
-        if(accumulator == std::string("min") ){
-            std::fill(ragEdgeFeaturesArray.begin(),ragEdgeFeaturesArray.end(),std::numeric_limits<float>::infinity());
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                for(size_t i=0;i<affEdges.size();++i){
-                    ragEdgeFeaturesArrayMap[ragEdge] = std::min(otfEdgeMap[affEdges[i]], ragEdgeFeaturesArrayMap[ragEdge]);
-                }
-            }
-        }
-        if(accumulator == std::string("max") ){
-            std::fill(ragEdgeFeaturesArray.begin(),ragEdgeFeaturesArray.end(),-1.0f*std::numeric_limits<float>::infinity());
-            for(RagEdgeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagEdge ragEdge = *iter;
-                const std::vector<Edge> & affEdges = affiliatedEdges[ragEdge];
-                for(size_t i=0;i<affEdges.size();++i){
-                    ragEdgeFeaturesArrayMap[ragEdge] = std::max(otfEdgeMap[affEdges[i]], ragEdgeFeaturesArrayMap[ragEdge]);
-                }
-            }
-        }
-        
+        ragEdgeFeatures(rag, affiliatedEdges, otfEdgeMap, accumulator, ragEdgeFeaturesArrayMap);
 
         // return 
         return ragEdgeFeaturesArray;
@@ -653,8 +545,6 @@ public:
         // preconditions
         vigra_precondition(rag.edgeNum()>=1,"rag.edgeNum()>=1 is violated");
 
-        using namespace vigra::acc;
-
         const size_t NFeatures = 12;
 
         // resize out
@@ -666,51 +556,7 @@ public:
 
         ragEdgeFeaturesArray.reshapeIfEmpty(outShape);
 
-        // define histogram for quantiles
-        typedef StandardQuantiles<AutoRangeHistogram<0> > Quantiles;
-        size_t n_bins_min = 2;
-        size_t n_bins_max = 64;
-
-        //in parallel with threadpool
-        // -1 = use all cores
-        parallel_foreach( -1, rag.edgeNum(),
-            [&](size_t /*thread_id*/, int id) 
-            {
-                auto feat = ragEdgeFeaturesArray.bindInner(id);
-                // init the accumulator chain with the appropriate statistics
-                AccumulatorChain<double,
-                    Select<Mean, Sum, Minimum, Maximum, Variance, Skewness, Kurtosis, Quantiles> > a;
-                const std::vector<Edge> & affEdges = affiliatedEdges[id];
-                
-                // set n_bins = ceil( n_values**1./2.5 ) , clipped to [2,64]
-                // turned out to be suitable empirically 
-                // see https://github.com/consti123/quantile_tests
-                size_t n_bins = std::pow( affiliatedEdges.size(), 1. / 2.5); 
-                n_bins = std::max( n_bins_min, std::min(n_bins, n_bins_max) );
-                a.setHistogramOptions(HistogramOptions().setBinCount(n_bins));
-                
-                // accumulate the values of this edge
-                for(unsigned int k=1; k <= a.passesRequired(); ++k)
-                    for(size_t i=0;i<affEdges.size();++i)
-                        a.updatePassN( otfEdgeMap[affEdges[i]], k );
-                
-                feat[0] = get<Mean>(a);
-                feat[1] = get<Sum>(a);
-                feat[2] = get<Minimum>(a);
-                feat[3] = get<Maximum>(a);
-                feat[4] = get<Variance>(a);
-                feat[5] = get<Skewness>(a);
-                feat[6] = get<Kurtosis>(a);
-                // get quantiles, keep only the ones we care for
-                TinyVector<double, 7> quant = get<Quantiles>(a);
-                // we keep: 0.1, 0.25, 05 (median), 0.75 and 0.9 quantile
-                feat[7] = quant[1];
-                feat[8] = quant[2];
-                feat[9] = quant[3];
-                feat[10] = quant[4];
-                feat[11] = quant[5];
-            }
-        );
+        ragEdgeStatistics(rag, affiliatedEdges, otfEdgeMap, ragEdgeFeaturesArray);
         
         return ragEdgeFeaturesArray;
 
@@ -795,66 +641,8 @@ public:
         FloatNodeArrayMap    nodeSizesArrayMap(graph,nodeSizesArray);
         RagFloatNodeArrayMap ragNodeFeaturesArrayMap(rag,ragNodeFeaturesArray);
 
-        if(accumulator == std::string("mean")){
-            typename RagGraph:: template NodeMap<float> counting(rag,0.0f);
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const float  weight = nodeSizesArrayMap[*iter];
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]+= weight*nodeFeaturesArrayMap[*iter];
-                    counting[ragNode]+=weight;
-                }
-            }
-            for(RagNodeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagNode ragNode   = *iter;
-                ragNodeFeaturesArrayMap[ragNode]/=counting[ragNode];
-            }
-        }
-        else if(accumulator == std::string("sum")){
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]+=nodeFeaturesArrayMap[*iter];
-                }
-            }
-        }
-        else if(accumulator == std::string("min")){
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]=std::numeric_limits<float>::infinity();
-                }
-            }
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]=std::min(nodeFeaturesArrayMap[*iter],ragNodeFeaturesArrayMap[ragNode]);
-                }
-            }
-        }
-        else if(accumulator == std::string("max")){
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]= -1.0*std::numeric_limits<float>::infinity();
-                }
-            }
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]=std::max(nodeFeaturesArrayMap[*iter],ragNodeFeaturesArrayMap[ragNode]);
-                }
-            }
-        }
-        else{
-           
-        }
+        ragNodeFeatures(rag, graph, labelsArrayMap, nodeFeaturesArrayMap, nodeSizesArrayMap,
+                        accumulator, ignoreLabel, ragNodeFeaturesArrayMap);
         return ragNodeFeaturesArray;
     }
 
@@ -869,8 +657,9 @@ public:
         const Int32                ignoreLabel=-1,
         RagMultiFloatNodeArray     ragNodeFeaturesArray=RagMultiFloatNodeArray()
     ){
-        vigra_precondition(accumulator==std::string("mean") || accumulator==std::string("sum"),
-            "currently the accumulators are limited to mean and sum"
+        vigra_precondition(accumulator==std::string("mean") || accumulator==std::string("sum") || 
+                           accumulator==std::string("min")  || accumulator==std::string("max"),
+            "currently the accumulators are limited to mean and sum and min and max "
         );
 
         // resize out
@@ -889,36 +678,8 @@ public:
         FloatNodeArrayMap         nodeSizesArrayMap(graph,nodeSizesArray);
         RagMultiFloatNodeArrayMap ragNodeFeaturesArrayMap(rag,ragNodeFeaturesArray);
 
-        if(accumulator == std::string("mean")){
-            typename RagGraph:: template NodeMap<float> counting(rag,0.0f);
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const float weight = nodeSizesArrayMap[*iter];
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    typename MultiFloatNodeArrayMap::Value feat = nodeFeaturesArrayMap[*iter];
-                    feat*=weight;
-                    ragNodeFeaturesArrayMap[ragNode]+=feat;
-                    counting[ragNode]+=weight;
-                }
-            }
-            for(RagNodeIt iter(rag);iter!=lemon::INVALID;++iter){
-                const RagNode ragNode   = *iter;
-                ragNodeFeaturesArrayMap[ragNode]/=counting[ragNode];
-            }
-        }
-        else if(accumulator == std::string("sum")){
-            for(NodeIt iter(graph);iter!=lemon::INVALID;++iter){
-                UInt32 l = labelsArrayMap[*iter];
-                if(ignoreLabel==-1 || static_cast<Int32>(l)!=ignoreLabel){
-                    const RagNode ragNode   = rag.nodeFromId(l);
-                    ragNodeFeaturesArrayMap[ragNode]+=nodeFeaturesArrayMap[*iter];
-                }
-            }
-        }
-        else{
-            throw std::runtime_error("for multiband only mean and sum is implemented");
-        }
+        ragNodeFeatures(rag, graph, labelsArrayMap, nodeFeaturesArrayMap, nodeSizesArrayMap,
+                        accumulator, ignoreLabel, ragNodeFeaturesArrayMap);
         return ragNodeFeaturesArray;
     }
 
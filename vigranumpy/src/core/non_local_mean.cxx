@@ -62,6 +62,7 @@ NumpyAnyArray  pyNonLocalMean(
     const int iterations,
     const int nThreads,
     const bool verbose,
+    const bool useIntegralImage,
     NumpyArray<DIM,PIXEL_TYPE> out = NumpyArray<DIM,PIXEL_TYPE>()
 ){
 
@@ -75,6 +76,7 @@ NumpyAnyArray  pyNonLocalMean(
     param.iterations_=iterations;
     param.nThreads_ = nThreads;
     param.verbose_=verbose;
+    param.useIntegralImage_=useIntegralImage;
     out.reshapeIfEmpty(image.shape());
     nonLocalMean<DIM,PIXEL_TYPE>(image,smoothPolicy,param,out);
     return out;
@@ -148,6 +150,7 @@ void exportNonLocalMean(const std::string name){
             python::arg("iterations")=1,
             python::arg("nThreads")=8,
             python::arg("verbose")=true,
+            python::arg("useIntegralImage")=false,
             python::arg("out") = boost::python::object()
         ),
         "loop over an image and do something with each pixels\n\n"